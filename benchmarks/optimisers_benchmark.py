@@ -0,0 +1,75 @@
+"""
+Iterations to convergence of the gradient descent optimisers
+
+Compares RMSprop with Adam, AdamW, Nadam and L-BFGS on the bundled regression and gaussian generators.
+Run from the repository root after building the extensions in place:
+
+    python setup.py build_ext --inplace
+    PYTHONPATH=. python benchmarks/optimisers_benchmark.py
+"""
+import time
+from pyml.linear_models import LinearRegression, LogisticRegression
+from pyml.datasets import regression, gaussian
+from pyml.preprocessing import train_test_split
+
+SEEDS = [1970, 1971, 1972, 1973, 1974]
+
+# method: optimiser parameters
+OPTIMISERS = {'rmsprop': {'learning_rate': 1, 'alpha': 0.99},
+              'adam': {'learning_rate': 0.1, 'alpha': 0.9},
+              'adamw': {'learning_rate': 0.1, 'alpha': 0.9, 'weight_decay': 0.001},
+              'nadam': {'learning_rate': 0.1, 'alpha': 0.9},
+              'lbfgs': {}}
+
+
+def run(model_class, dataset, **kwargs):
+
+    iterations = 0
+    scores = 0
+    elapsed = 0
+
+    for seed in SEEDS:
+        X, y = dataset(seed)
+        X_train, y_train, X_test, y_test = train_test_split(X, y, train_split=0.8, seed=seed)
+
+        model = model_class(seed=seed, **kwargs)
+
+        start = time.time()
+        model.train(X_train, y_train)
+        elapsed += time.time() - start
+
+        model_iterations = model.iterations
+        if isinstance(model_iterations, list):
+            model_iterations = sum(model_iterations)
+
+        iterations += model_iterations
+        scores += model.score(X_test, y_test)
+
+    n = len(SEEDS)
+
+    return iterations / n, scores / n, elapsed / n
+
+
+def main():
+
+    benchmarks = [('regression', LinearRegression, lambda seed: regression(1000, seed=seed),
+                   {'solver': 'gradient_descent'}, 'mse'),
+                  ('gaussian (2 labels)', LogisticRegression, lambda seed: gaussian(labels=2, sigma=0.2, seed=seed),
+                   {}, 'accuracy'),
+                  ('gaussian (3 labels)', LogisticRegression, lambda seed: gaussian(labels=3, sigma=0.2, seed=seed),
+                   {}, 'accuracy')]
+
+    for name, model_class, dataset, kwargs, scorer in benchmarks:
+        print(name)
+        print("{:<10}{:>12}{:>12}{:>12}".format('method', 'iterations', scorer, 'time (s)'))
+
+        for method, parameters in OPTIMISERS.items():
+            iterations, score, elapsed = run(model_class, dataset, method=method, max_iterations=10000,
+                                             **parameters, **kwargs)
+            print("{:<10}{:>12.1f}{:>12.4f}{:>12.4f}".format(method, iterations, score, elapsed))
+
+        print()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,42 @@
+"""
+Bandwidth of the flatArray transpose
+
+Times the cache-oblivious transpose (into a new array and in place) on square and rectangular matrices
+and reports it in GB/s, counting each element as read once and written once, next to memcpy of the same
+array, which is about as fast as anything that reads and writes the whole array can go.
+Run from the repository root after building the extensions in place:
+
+    python setup.py build_ext --inplace
+    PYTHONPATH=. python benchmarks/transpose_benchmark.py
+"""
+from pyml.maths.Clinear_algebra import transpose_bandwidth
+
+SHAPES = [(256, 256), (1024, 1024), (4096, 4096), (1000, 1000), (8192, 512), (512, 8192), (100000, 64)]
+
+
+def gigabytes_per_second(nbytes, seconds):
+    # read and written once
+    return 2 * nbytes / seconds / 1e9
+
+
+def main():
+
+    for dtype in ['float64', 'float32']:
+        print(dtype)
+        print("{:<16}{:>12}{:>12}{:>12}{:>10}".format('shape', 'transpose', 'in place', 'memcpy', 'ratio'))
+
+        for rows, cols in SHAPES:
+            timings = transpose_bandwidth(rows, cols, repeats=5, dtype=dtype)
+
+            transpose = gigabytes_per_second(timings['bytes'], timings['transpose'])
+            in_place = gigabytes_per_second(timings['bytes'], timings['transpose_in_place'])
+            memcpy = gigabytes_per_second(timings['bytes'], timings['memcpy'])
+
+            print("{:<16}{:>12.2f}{:>12.2f}{:>12.2f}{:>10.2f}".format('{}x{}'.format(rows, cols), transpose,
+                                                                      in_place, memcpy, transpose / memcpy))
+
+        print()
+
+
+if __name__ == '__main__':
+    main()
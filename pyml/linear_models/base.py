@@ -1,7 +1,8 @@
 from pyml.base import BaseLearner
 from pyml.base import Predictor
 import random
-from pyml.maths.optimisers import gradient_descent
+from pyml.maths.optimisers import gradient_descent, newton, hogwild, optimiser_state, partial_fit
+from pyml.maths import is_sparse, as_csr
 from pyml.utils import set_seed
 import warnings
 
@@ -12,7 +13,10 @@ class LinearBase(BaseLearner, Predictor):
     Base class for linear models
     """
 
-    def __init__(self, learning_rate, epsilon, max_iterations, alpha, fudge_factor, batch_size, method, seed, _type):
+    def __init__(self, learning_rate, epsilon, max_iterations, alpha, fudge_factor, batch_size, method, seed, _type,
+                 beta_2=0.999, weight_decay=0.0, history_size=10, n_workers=1, monitor='full', monitor_frequency=10,
+                 monitor_samples=1000, physical_shuffle=False, early_stopping=False, validation_split=0.1, patience=5,
+                 min_improvement=0.0, schedule=None, warm_start=False, dtype='float64'):
         """
         Inherits methods from BaseLearner
         """
@@ -26,7 +30,8 @@ class LinearBase(BaseLearner, Predictor):
         self._alpha = alpha
         self._batch_size = batch_size
 
-        if method in ['normal', 'nesterov', 'adagrad', 'adadelta', 'rmsprop']:
+        if method in ['normal', 'nesterov', 'adagrad', 'adadelta', 'rmsprop', 'adam', 'adamw', 'nadam',
+                      'lbfgs', 'hogwild']:
             self._method = method
 
         else:
@@ -35,7 +40,7 @@ class LinearBase(BaseLearner, Predictor):
         self._seed = set_seed(seed)
         self._type = _type
 
-        if self._method == 'adagrad' or self._method == 'adadelta' or self._method == 'rmsprop':
+        if self._method in ['adagrad', 'adadelta', 'rmsprop', 'adam', 'adamw', 'nadam']:
             if fudge_factor == 0:
                 warnings.warn("Fudge factor for {} optimisation is 0, it will be set to 10e-8 for your own "
                               "safety".format(self._method))
@@ -45,26 +50,288 @@ class LinearBase(BaseLearner, Predictor):
             warnings.warn("Adadelta does not use a learning rate, setting this value to 1!")
             self._learning_rate = 1
 
+        if self._method in ['adam', 'adamw', 'nadam'] and self._alpha == 0:
+            warnings.warn("{} uses alpha as the first moment decay rate (beta_1), but it is 0, it will be set to 0.9"
+                          .format(self._method))
+            self._alpha = 0.9
+
         self._fudge_factor = fudge_factor
+        self._beta_2 = beta_2
+        self._weight_decay = weight_decay
+        self._history_size = history_size
+        self._n_workers = n_workers
+
+        if monitor in ['full', 'average', 'every', 'subsample']:
+            self._monitor = monitor
+        else:
+            raise ValueError("Unknown monitor policy")
+
+        self._monitor_frequency = monitor_frequency
+        self._monitor_samples = monitor_samples
+        self._physical_shuffle = physical_shuffle
+
+        if early_stopping and self._method in ['lbfgs', 'hogwild']:
+            raise ValueError("Early stopping is not supported by {}".format(self._method))
+
+        if not 0 < validation_split < 1:
+            raise ValueError("Validation split must be between 0 and 1")
+
+        self._early_stopping = early_stopping
+        self._validation_split = validation_split
+        self._patience = patience
+        self._min_improvement = min_improvement
+        self._schedule = self._read_schedule(schedule)
+        self._throughput = None
+        self._warm_start = warm_start
+        self._state = None
+
+        if dtype not in ['float64', 'float32']:
+            raise ValueError("Unknown dtype")
+
+        self._dtype = dtype
+
+    def train(self, X, y=None):
+        """
+        Fit the model to X and y, discarding the optimiser state of partial_fit
+
+        :type X: list or CSRMatrix
+        :type y: list
+        :rtype: object
+        :return: self
+        """
+        self._state = None
+
+        # other CSR matrices (e.g. from scipy) are converted once, so that they can be sliced
+        if is_sparse(X):
+            X = as_csr(X)
+
+        return BaseLearner.train(self, X, y)
+
+    def _read_schedule(self, schedule):
+        """
+        Check a learning rate schedule descriptor and convert it to the tuple used by the optimisers
+
+        :type schedule: None or str or dict
+        :param schedule: schedule name or dictionary with its type and parameters
+        :rtype: None or tuple
+        :return: (type, gamma, period, min_learning_rate, warmup)
+        """
+        if schedule is None:
+            return None
+
+        if isinstance(schedule, str):
+            schedule = {'type': schedule}
+
+        parameters = {'type': 'constant', 'gamma': 0.5, 'period': 100, 'min_learning_rate': 0.0, 'warmup': 0.3}
 
-    def _initiate_weights(self, bias):
+        for key in schedule:
+            if key not in parameters:
+                raise ValueError("Unknown learning rate schedule parameter {}".format(key))
+
+        parameters.update(schedule)
+
+        if parameters['type'] not in ['constant', 'step', 'exponential', 'inverse_time', 'cosine', 'one_cycle']:
+            raise ValueError("Unknown learning rate schedule")
+
+        if self._method in ['lbfgs', 'hogwild']:
+            raise ValueError("Learning rate schedules are not supported by {}".format(self._method))
+
+        if parameters['period'] < 1:
+            raise ValueError("Learning rate schedule period must be at least 1")
+
+        if not 0 <= parameters['warmup'] <= 1:
+            raise ValueError("Learning rate schedule warmup must be between 0 and 1")
+
+        return (parameters['type'], float(parameters['gamma']), int(parameters['period']),
+                float(parameters['min_learning_rate']), float(parameters['warmup']))
+
+    def _initiate_weights(self, bias, c=None):
         """
         initialisation of weights
 
         :type bias: bool
-        :param bias: whether or not to include bias, and if so add a column of 1's
+        :type c: None or int
+        :param bias: whether or not to include bias, which is the first coefficient (X is not modified, the
+                     optimisers add the intercept themselves)
+        :param c: class index when there is one set of coefficients per class
         :rtype: None
-        :return: returns init coefficients
+        :return: returns init coefficients, the coefficients of the last fit with warm_start
         """
-        if bias:
-            coefficients = [random.gauss(0, 1) for x in range(self._n_features + 1)]
-            self.X = [[1] + row for row in self.X]
-            return coefficients
-        else:
-            coefficients = [random.gauss(0, 1) for x in range(self._n_features)]
-            return coefficients
+        size = self._n_features + 1 if bias else self._n_features
+        coefficients = self._warm_coefficients(size, c)
+
+        if coefficients is None:
+            coefficients = [random.gauss(0, 1) for x in range(size)]
+
+        return coefficients
+
+    @staticmethod
+    def _n_columns(X):
+        """
+        Number of features of X, without building a dense row of a sparse matrix
+
+        :type X: list or CSRMatrix
+        :rtype: int
+        """
+        return X.shape[1] if is_sparse(X) else len(X[0])
+
+    @staticmethod
+    def _check_dense(X, solver):
+        """
+        Raise a ValueError if X is sparse, for the solvers that only take lists of lists
+
+        :type X: list or CSRMatrix
+        :type solver: str
+        :rtype: None
+        """
+        if is_sparse(X):
+            raise ValueError("{} does not support sparse matrices, use gradient descent".format(solver))
+
+    def _warm_coefficients(self, size, c=None):
+        """
+        Coefficients of the last fit, used as the starting point with warm_start
 
-    def _gradient_descent(self, X, y, theta):
+        :type size: int
+        :type c: None or int
+        :param size: expected number of coefficients
+        :param c: class index when there is one set of coefficients per class
+        :rtype: None or list
+        :return: a copy of the coefficients, or None if warm_start is off or they don't match
+        """
+        coefficients = getattr(self, '_coefficients', None)
+
+        if not self._warm_start or not coefficients:
+            return None
+
+        if c is not None:
+            if not isinstance(coefficients[0], list) or len(coefficients) <= c:
+                return None
+            coefficients = coefficients[c]
+
+        if isinstance(coefficients[0], list) or len(coefficients) != size:
+            return None
+
+        return list(coefficients)
+
+    def _partial_fit(self, X, y, epochs, bias):
+        """
+        Run gradient descent epochs on a chunk of data, continuing from the coefficients and optimiser state
+        (momentum, squared gradients, update count) of the previous call
+
+        :type X: list
+        :type y: list
+        :type epochs: int
+        :type bias: bool
+        :rtype: object
+        :return: self
+        """
+        if self._method in ['lbfgs', 'hogwild']:
+            raise ValueError("partial_fit is not supported by {}".format(self._method))
+
+        self._check_dense(X, 'partial_fit')
+
+        size = len(X[0]) + 1 if bias else len(X[0])
+
+        if self._state is None:
+            self._n_features = len(X[0])
+            theta = self._warm_coefficients(size)
+
+            if theta is None:
+                theta = [random.gauss(0, 1) for x in range(size)]
+
+            self._state = optimiser_state(theta, self._seed)
+            self._iterations = 0
+
+        elif size != len(self._coefficients):
+            raise ValueError("X should have {} features".format(self._n_features))
+
+        self._coefficients, self._cost, _ = partial_fit(self._state, X, y, epochs, self._learning_rate, self._alpha,
+                                                        self._type, self._method, self._fudge_factor,
+                                                        batch_size=self._batch_size, beta_2=self._beta_2,
+                                                        weight_decay=self._weight_decay, fit_intercept=bias,
+                                                        **self._schedule_kwargs())
+        self._iterations += epochs
+
+        return self
+
+    def _split_validation(self, X, y):
+        """
+        Hold out a fraction of the training set for early stopping
+
+        The split only depends on the seed, so every one-vs-rest classifier holds out the same examples, and the
+        global random state is left untouched.
+
+        :type X: list or CSRMatrix
+        :type y: list
+        :rtype: tuple
+        :return: X_train, y_train, X_val, y_val
+        """
+        n = X.shape[0] if is_sparse(X) else len(X)
+        index = list(range(n))
+        random.Random(self._seed).shuffle(index)
+
+        n_val = max(1, int(n * self._validation_split))
+
+        if is_sparse(X):
+            return X.take(index[n_val:]), [y[i] for i in index[n_val:]], X.take(index[:n_val]), \
+                   [y[i] for i in index[:n_val]]
+
+        X_train = [X[i] for i in index[n_val:]]
+        y_train = [y[i] for i in index[n_val:]]
+        X_val = [X[i] for i in index[:n_val]]
+        y_val = [y[i] for i in index[:n_val]]
+
+        return X_train, y_train, X_val, y_val
+
+    def _early_stopping_kwargs(self, X_val, y_val):
+
+        return {'X_val': X_val, 'y_val': y_val, 'patience': self._patience,
+                'min_improvement': self._min_improvement}
+
+    def _schedule_kwargs(self):
+
+        if self._schedule is None:
+            return {}
+
+        return {'schedule': self._schedule}
+
+    def _gradient_descent(self, X, y, theta, fit_intercept=False):
+
+        # with fit_intercept theta[0] is the intercept and X has no column of ones
+        if self._method == 'hogwild':
+            coefficients, cost, iterations, self._throughput = hogwild(X, theta, y, self._max_iterations,
+                                                                       self._epsilon, self._learning_rate,
+                                                                       self._type, self._seed,
+                                                                       n_workers=self._n_workers,
+                                                                       fit_intercept=fit_intercept)
+            return coefficients, cost, iterations
+
+        kwargs = self._schedule_kwargs()
+
+        if self._early_stopping:
+            X, y, X_val, y_val = self._split_validation(X, y)
+            kwargs.update(self._early_stopping_kwargs(X_val, y_val))
 
         return gradient_descent(X, theta, y, self._batch_size, self._max_iterations, self._epsilon, self._learning_rate,
-                                self._alpha, self._type, self._method, self._seed, self._fudge_factor)
+                                self._alpha, self._type, self._method, self._seed, self._fudge_factor,
+                                beta_2=self._beta_2, weight_decay=self._weight_decay,
+                                history_size=self._history_size, monitor=self._monitor,
+                                monitor_frequency=self._monitor_frequency, monitor_samples=self._monitor_samples,
+                                physical_shuffle=self._physical_shuffle, dtype=self._dtype,
+                                fit_intercept=fit_intercept, **kwargs)
+
+    def _newton(self, X, y, theta, fit_intercept=False):
+
+        self._check_dense(X, "Newton's method")
+
+        return newton(X, theta, y, self._max_iterations, self._epsilon, fit_intercept=fit_intercept)
+
+    @property
+    def throughput(self):
+        """
+        Hogwild! throughput
+        :getter: returns the number of updates per second of the last asynchronous SGD run, or None if it was not
+                 used
+        :type: float
+        """
+        return self._throughput
@@ -1,12 +1,17 @@
 from pyml.linear_models.base import LinearBase
-from pyml.maths import dot_product, least_squares
+from pyml.maths import least_squares
+from pyml.maths.optimisers import elastic_net, elastic_net_path, predict
 from pyml.metrics.scores import mean_squared_error, mean_absolute_error
 
 
 class LinearRegression(LinearBase):
     def __init__(self, seed=None, bias=True, solver='OLS', learning_rate=0.01,
                  epsilon=0.01, max_iterations=10000, alpha=0.0, batch_size=0,
-                 method='normal', fudge_factor=10e-8):
+                 method='normal', fudge_factor=10e-8, beta_2=0.999, weight_decay=0.0,
+                 history_size=10, n_workers=1, monitor='full', monitor_frequency=10,
+                 monitor_samples=1000, physical_shuffle=False, early_stopping=False, validation_split=0.1,
+                 patience=5, min_improvement=0.0, schedule=None, regularisation=1.0, l1_ratio=1.0,
+                 warm_start=False, dtype='float64', n_jobs=1):
         """
         Linear regression implementation
 
@@ -20,14 +25,33 @@ class LinearRegression(LinearBase):
         :type batch_size: int
         :type method: str
         :type fudge_factor: float
+        :type beta_2: float
+        :type weight_decay: float
+        :type history_size: int
+        :type n_workers: int
+        :type monitor: str
+        :type monitor_frequency: int
+        :type monitor_samples: int
+        :type physical_shuffle: bool
+        :type early_stopping: bool
+        :type validation_split: float
+        :type patience: int
+        :type min_improvement: float
+        :type schedule: None or str or dict
+        :type regularisation: float
+        :type l1_ratio: float
+        :type warm_start: bool
+        :type dtype: str
+        :type n_jobs: int
 
         :param seed: random seed
         :param bias: whether or not to add a bias (column of 1s) if it isn't already present
-        :param solver: use 'OLS' (ordinary least squares) or 'gradient_descent'
+        :param solver: use 'OLS' (ordinary least squares), 'gradient_descent' or 'coordinate_descent' (Lasso and
+                       elastic net, uses max_iterations, epsilon, regularisation and l1_ratio)
         :param learning_rate: learning rate for gradient descent
         :param epsilon: early stopping parameter for gradient descent
         :param max_iterations: early stopping parameter for gradient descent
-        :param alpha: momentum parameter for gradient descent
+        :param alpha: momentum parameter for gradient descent (first moment decay rate with Adam/AdamW/Nadam)
         :param batch_size: batch size, if it is set to zero or a number larger than training examples it will
                            default to batch gradient descent
         :param method: method to run gradient descent.
@@ -36,7 +60,55 @@ class LinearRegression(LinearBase):
                         - "adagrad": adagrad method for GD
                         - "adadelta": adadelta method for GD
                         - "rmsprop": rmsprop method for GD
-        :param fudge_factor: fudge factor for Adagrad/Adadelta/RMSprop to avoid zero divisions
+                        - "adam": adam method for GD
+                        - "adamw": adam method with decoupled weight decay for GD
+                        - "nadam": adam method with nesterov momentum for GD
+                        - "lbfgs": limited memory BFGS quasi-Newton method (ignores learning_rate, alpha and
+                                   batch_size)
+                        - "hogwild": lock-free asynchronous SGD with n_workers threads (ignores alpha and
+                                     batch_size)
+        :param fudge_factor: fudge factor for Adagrad/Adadelta/RMSprop/Adam to avoid zero divisions
+        :param beta_2: second moment decay rate for Adam/AdamW/Nadam
+        :param weight_decay: decoupled weight decay for AdamW
+        :param history_size: number of curvature pairs kept by L-BFGS
+        :param n_workers: number of Hogwild! worker threads, -1 uses all cores
+        :param monitor: cost monitored by mini batch gradient descent, which is stored in cost and used to test for
+                        convergence.
+                        - "full": cost of the whole dataset after every batch
+                        - "average": running average of the batch costs over each epoch
+                        - "every": cost of the whole dataset after every monitor_frequency batches
+                        - "subsample": cost of a fixed subsample of monitor_samples examples after every batch
+        :param monitor_frequency: number of batches between cost evaluations with monitor="every"
+        :param monitor_samples: number of examples used with monitor="subsample"
+        :param physical_shuffle: copy the shuffled training set to a buffer once per epoch so that mini batches are
+                                 read sequentially (uses another copy of X, the result is the same)
+        :param early_stopping: hold out validation_split of the training examples and stop gradient descent once
+                               their cost has not improved by more than min_improvement for patience epochs, keeping
+                               the best coefficients (not supported by "lbfgs" and "hogwild")
+        :param validation_split: fraction of the training examples used for early stopping
+        :param patience: number of epochs without improvement before stopping
+        :param min_improvement: minimum decrease of the validation cost that counts as an improvement
+        :param schedule: learning rate schedule applied to each gradient descent update (each batch with mini
+                         batches), either a name or a dictionary with a 'type' and its parameters 'gamma',
+                         'period', 'min_learning_rate' and 'warmup'. Types:
+                            - constant: the learning rate is not changed (default)
+                            - step: multiplied by gamma every period updates
+                            - exponential: multiplied by gamma ** (t / period)
+                            - inverse_time: divided by 1 + gamma * t / period
+                            - cosine: cosine annealing to min_learning_rate with warm restarts, the first cycle
+                                      lasts period updates and each one is gamma times longer (SGDR)
+                            - one_cycle: linear warmup from min_learning_rate during warmup * period updates,
+                                         then cosine annealing down to min_learning_rate at update period
+        :param regularisation: elastic net penalty λ used by coordinate descent, the cost is
+                               ||y - X.θ||² / 2n + λ (l1_ratio |θ|₁ + (1 - l1_ratio) / 2 ||θ||²₂), the bias is not
+                               penalised
+        :param l1_ratio: mix of the l1 and l2 penalties, 1 is the Lasso and 0 is ridge regression
+        :param warm_start: start gradient or coordinate descent from the coefficients of the previous fit instead
+                           of random ones (zeros with coordinate descent)
+        :param dtype: precision of gradient descent and predictions, 'float64' or 'float32'. With 'float32' X is
+                      stored in single precision, halving its memory, while sums are accumulated in double
+                      precision. Coordinate descent, partial_fit and parallel one-vs-rest always use 'float64'
+        :param n_jobs: number of threads used to predict blocks of rows, -1 uses all cores
 
 
         Example:
@@ -52,23 +124,36 @@ class LinearRegression(LinearBase):
 
         LinearBase.__init__(self, learning_rate=learning_rate, epsilon=epsilon, max_iterations=max_iterations,
                             alpha=alpha, batch_size=batch_size, method=method, seed=seed, _type='regressor',
-                            fudge_factor=fudge_factor)
+                            fudge_factor=fudge_factor, beta_2=beta_2, weight_decay=weight_decay,
+                            history_size=history_size, n_workers=n_workers,
+                            monitor=monitor, monitor_frequency=monitor_frequency, monitor_samples=monitor_samples,
+                            physical_shuffle=physical_shuffle, early_stopping=early_stopping,
+                            validation_split=validation_split, patience=patience, min_improvement=min_improvement,
+                            schedule=schedule, warm_start=warm_start, dtype=dtype)
 
         self.bias = bias
-        if solver in ['OLS', 'gradient_descent']:
+        if solver in ['OLS', 'gradient_descent', 'coordinate_descent']:
             self._solver = solver
         else:
             raise ValueError("Unknown solver!")
 
+        if regularisation < 0 or not 0 <= l1_ratio <= 1:
+            raise ValueError("Regularisation must be positive and l1_ratio between 0 and 1")
+
+        self._regularisation = regularisation
+        self._l1_ratio = l1_ratio
+        self._n_jobs = n_jobs
+
     def _train(self, X, y=None):
 
         """
         Train a linear regression model
 
-        :type X: list
+        :type X: list or CSRMatrix
         :type y: list
 
-        :param X: list of lists with each row corresponding to a datapoint's features
+        :param X: list of lists with each row corresponding to a datapoint's features,
+                  or a CSRMatrix with gradient descent
         :param y: list of targets
 
         :rtype: object
@@ -78,17 +163,82 @@ class LinearRegression(LinearBase):
         self.X = X
         self.y = y
 
-        self._n_features = len(X[0])
+        self._n_features = self._n_columns(X)
+
+        if self._solver != 'gradient_descent':
+            self._check_dense(X, 'The {} solver'.format(self._solver))
 
         if self._solver == 'gradient_descent':
             theta = self._initiate_weights(bias=self.bias)
-            self._coefficients, self._cost, self._iterations = self._gradient_descent(self.X, self.y, theta=theta)
+            self._coefficients, self._cost, self._iterations = self._gradient_descent(self.X, self.y, theta=theta,
+                                                                                      fit_intercept=self.bias)
+        elif self._solver == 'coordinate_descent':
+            size = self._n_features + 1 if self.bias else self._n_features
+            theta = self._warm_coefficients(size) or [0.0] * size
+            self._coefficients, self._cost, self._iterations = elastic_net(self.X, theta, self.y,
+                                                                           self._max_iterations, self._epsilon,
+                                                                           self._regularisation, self._l1_ratio,
+                                                                           intercept=self.bias,
+                                                                           covariance=self._covariance(self.X, size),
+                                                                           fit_intercept=self.bias)
         else:
-            if self.bias:
-                self.X = [[1] + row for row in self.X]
             self._cost = 'NaN'
             self._iterations = 'NaN'
-            self._coefficients = least_squares(self.X, self.y)
+            self._coefficients = least_squares(self.X, self.y, fit_intercept=self.bias)
+
+    def partial_fit(self, X, y, epochs=1):
+        """
+        Run gradient descent epochs on a chunk of data, continuing from the coefficients and optimiser state of the
+        previous call (or of the last fit with warm_start)
+
+        :type X: list
+        :type y: list
+        :type epochs: int
+
+        :param X: list of lists with each row corresponding to a datapoint's features
+        :param y: list of targets
+        :param epochs: number of passes over the chunk
+
+        :rtype: object
+        :return: self
+        """
+        return self._partial_fit(X, y, epochs, bias=self.bias)
+
+    def regularisation_path(self, X, y, n_lambdas=100, lambda_ratio=0.001):
+        """
+        Elastic net coefficients over a descending grid of regularisation values
+
+        The grid goes from the smallest regularisation that sets all coefficients (except the bias) to zero down
+        to lambda_ratio times that value, evenly spaced on a log scale. Each fit is warm started from the previous
+        one. The model itself is not changed.
+
+        :type X: list
+        :type y: list
+        :type n_lambdas: int
+        :type lambda_ratio: float
+
+        :param X: list of lists with each row corresponding to a datapoint's features
+        :param y: list of targets
+        :param n_lambdas: number of regularisation values
+        :param lambda_ratio: ratio between the smallest and the largest regularisation
+
+        :rtype: tuple
+        :return: list of regularisation values and list with the coefficients for each of them
+        """
+        size = len(X[0]) + 1 if self.bias else len(X[0])
+
+        lambdas, coefficients, _, _ = elastic_net_path(X, y, self._max_iterations, self._epsilon, self._l1_ratio,
+                                                       n_lambdas=n_lambdas, lambda_ratio=lambda_ratio,
+                                                       intercept=self.bias, covariance=self._covariance(X, size),
+                                                       fit_intercept=self.bias)
+
+        return lambdas, coefficients
+
+    @staticmethod
+    def _covariance(X, size):
+
+        # covariance updates are cheaper when there are more examples than coefficients
+        return len(X) > size
 
     def _predict(self, X):
 
@@ -103,12 +253,11 @@ class LinearRegression(LinearBase):
         :return: list of predictions
         """
 
-        if self.bias and len(X[0]) == self._n_features + 1:
-            return dot_product(X, self.coefficients)
-        elif self.bias and len(X[0]) == self._n_features:
-            return dot_product([[1] + row for row in X], self._coefficients)
-        elif not self.bias:
-            return dot_product(X, self.coefficients)
+        # the bias is added by predict when X doesn't have the column of ones
+        if self.bias and self._n_columns(X) == self._n_features:
+            return predict(X, self._coefficients, True, 'identity', self._n_jobs, self._dtype)
+        elif (self.bias and self._n_columns(X) == self._n_features + 1) or not self.bias:
+            return predict(X, self._coefficients, False, 'identity', self._n_jobs, self._dtype)
         else:
             raise NotImplementedError("This part of the code has not been explored yet, "
                                       "returning to safety...")
@@ -1,6 +1,7 @@
 from pyml.linear_models.base import LinearBase
 from pyml.base import Classifier
-from pyml.maths import dot_product, sigmoid, power, argmax
+from pyml.maths import power, argmax, is_sparse
+from pyml.maths.optimisers import softmax_regression, one_vs_rest, predict
 from pyml.metrics.scores import accuracy
 import random
 import math
@@ -9,7 +10,11 @@ import math
 class LogisticRegression(LinearBase, Classifier):
     def __init__(self, seed=None, bias=True, learning_rate=0.01,
                  epsilon=0.01, max_iterations=10000, alpha=0.0,
-                 batch_size=0, method='normal', fudge_factor=10e-8):
+                 batch_size=0, method='normal', fudge_factor=10e-8, beta_2=0.999, weight_decay=0.0,
+                 history_size=10, solver='gradient_descent', multi_class='ovr',
+                 n_jobs=1, n_workers=1, monitor='full', monitor_frequency=10,
+                 monitor_samples=1000, physical_shuffle=False, early_stopping=False, validation_split=0.1,
+                 patience=5, min_improvement=0.0, schedule=None, warm_start=False, dtype='float64'):
         """
         Logistic regression implementation
 
@@ -22,13 +27,31 @@ class LogisticRegression(LinearBase, Classifier):
         :type batch_size: int
         :type method: str
         :type fudge_factor: float
+        :type beta_2: float
+        :type weight_decay: float
+        :type history_size: int
+        :type solver: str
+        :type multi_class: str
+        :type n_jobs: int
+        :type n_workers: int
+        :type monitor: str
+        :type monitor_frequency: int
+        :type monitor_samples: int
+        :type physical_shuffle: bool
+        :type early_stopping: bool
+        :type validation_split: float
+        :type patience: int
+        :type min_improvement: float
+        :type schedule: None or str or dict
+        :type warm_start: bool
+        :type dtype: str
 
         :param seed: random seed
         :param bias: whether or not to add a bias (column of 1s) if it isn't already present
         :param learning_rate: learning rate for gradient descent
         :param epsilon: early stopping parameter for gradient descent
         :param max_iterations: early stopping parameter for gradient descent
-        :param alpha: momentum parameter for gradient descent
+        :param alpha: momentum parameter for gradient descent (first moment decay rate with Adam/AdamW/Nadam)
         :param batch_size: batch size, if it is set to zero or a number larger than training examples it will
                            default to batch gradient descent
         :param method: method to run gradient descent.
@@ -37,7 +60,61 @@ class LogisticRegression(LinearBase, Classifier):
                         - "adagrad": adagrad method for GD
                         - "adadelta": adadelta method for GD
                         - "rmsprop": rmsprop method for GD
-        :param fudge_factor: fudge factor for Adagrad/Adadelta/RMSprop to avoid zero divisions
+                        - "adam": adam method for GD
+                        - "adamw": adam method with decoupled weight decay for GD
+                        - "nadam": adam method with nesterov momentum for GD
+                        - "lbfgs": limited memory BFGS quasi-Newton method (ignores learning_rate, alpha and
+                                   batch_size)
+                        - "hogwild": lock-free asynchronous SGD with n_workers threads (ignores alpha and
+                                     batch_size)
+        :param fudge_factor: fudge factor for Adagrad/Adadelta/RMSprop/Adam to avoid zero divisions
+        :param beta_2: second moment decay rate for Adam/AdamW/Nadam
+        :param weight_decay: decoupled weight decay for AdamW
+        :param history_size: number of curvature pairs kept by L-BFGS
+        :param solver: use 'gradient_descent' or 'newton' (Newton's method/IRLS, ignores the gradient descent
+                       parameters)
+        :param multi_class: strategy used with more than two classes.
+                        - "ovr": one binary classifier per class (one-vs-rest)
+                        - "multinomial": a single softmax regression trained on all classes at once (supports
+                                         the "normal", "nesterov", "adam", "adamw" and "nadam" gradient descent
+                                         methods and ignores batch_size)
+        :param n_jobs: number of threads used to train the one-vs-rest classifiers with gradient descent, -1 uses
+                       all cores. With n_jobs != 1 each class draws its mini batches from its own random stream
+                       derived from the seed, so the result does not depend on the number of threads. Predictions
+                       also use n_jobs threads, each taking blocks of rows
+        :param n_workers: number of Hogwild! worker threads, -1 uses all cores
+        :param monitor: cost monitored by mini batch gradient descent, which is stored in cost and used to test for
+                        convergence.
+                        - "full": cost of the whole dataset after every batch
+                        - "average": running average of the batch costs over each epoch
+                        - "every": cost of the whole dataset after every monitor_frequency batches
+                        - "subsample": cost of a fixed subsample of monitor_samples examples after every batch
+        :param monitor_frequency: number of batches between cost evaluations with monitor="every"
+        :param monitor_samples: number of examples used with monitor="subsample"
+        :param physical_shuffle: copy the shuffled training set to a buffer once per epoch so that mini batches are
+                                 read sequentially (uses another copy of X, the result is the same)
+        :param early_stopping: hold out validation_split of the training examples and stop gradient descent once
+                               their cost has not improved by more than min_improvement for patience epochs, keeping
+                               the best coefficients (not supported by "lbfgs" and "hogwild")
+        :param validation_split: fraction of the training examples used for early stopping
+        :param patience: number of epochs without improvement before stopping
+        :param min_improvement: minimum decrease of the validation cost that counts as an improvement
+        :param schedule: learning rate schedule applied to each gradient descent update (each batch with mini
+                         batches), either a name or a dictionary with a 'type' and its parameters 'gamma',
+                         'period', 'min_learning_rate' and 'warmup'. Types:
+                            - constant: the learning rate is not changed (default)
+                            - step: multiplied by gamma every period updates
+                            - exponential: multiplied by gamma ** (t / period)
+                            - inverse_time: divided by 1 + gamma * t / period
+                            - cosine: cosine annealing to min_learning_rate with warm restarts, the first cycle
+                                      lasts period updates and each one is gamma times longer (SGDR)
+                            - one_cycle: linear warmup from min_learning_rate during warmup * period updates,
+                                         then cosine annealing down to min_learning_rate at update period
+        :param warm_start: start training from the coefficients of the previous fit instead of random ones
+        :param dtype: precision of gradient descent and predictions, 'float64' or 'float32'. With 'float32' X is
+                      stored in single precision, halving its memory, while sums are accumulated in double
+                      precision. Newton's method, multinomial regression, partial_fit and parallel one-vs-rest
+                      always use 'float64'
 
         Example:
         --------
@@ -61,21 +138,49 @@ class LogisticRegression(LinearBase, Classifier):
 
         LinearBase.__init__(self, learning_rate=learning_rate, epsilon=epsilon, max_iterations=max_iterations,
                             alpha=alpha, batch_size=batch_size, method=method, seed=seed, _type='logit',
-                            fudge_factor=fudge_factor)
+                            fudge_factor=fudge_factor, beta_2=beta_2, weight_decay=weight_decay,
+                            history_size=history_size, n_workers=n_workers,
+                            monitor=monitor, monitor_frequency=monitor_frequency, monitor_samples=monitor_samples,
+                            physical_shuffle=physical_shuffle, early_stopping=early_stopping,
+                            validation_split=validation_split, patience=patience, min_improvement=min_improvement,
+                            schedule=schedule, warm_start=warm_start, dtype=dtype)
         Classifier.__init__(self)
 
         self._bias = bias
         self._coefficients = list()
 
+        if solver in ['gradient_descent', 'newton']:
+            self._solver = solver
+        else:
+            raise ValueError("Unknown solver!")
+
+        if multi_class not in ['ovr', 'multinomial']:
+            raise ValueError("Unknown multi_class strategy!")
+
+        if multi_class == 'multinomial' and (solver != 'gradient_descent' or
+                                             method not in ['normal', 'nesterov', 'adam', 'adamw', 'nadam']):
+            raise ValueError("Multinomial regression only supports gradient descent with the normal, nesterov, "
+                             "adam, adamw and nadam methods!")
+
+        if early_stopping and (solver != 'gradient_descent' or multi_class == 'multinomial'):
+            raise ValueError("Early stopping is only supported by one-vs-rest gradient descent!")
+
+        if schedule is not None and (solver != 'gradient_descent' or multi_class == 'multinomial'):
+            raise ValueError("Learning rate schedules are only supported by one-vs-rest gradient descent!")
+
+        self._multi_class = multi_class
+        self._n_jobs = n_jobs
+
     def _train(self, X, y=None):
 
         """
         Train a logistic regression model
 
-        :type X: list
+        :type X: list or CSRMatrix
         :type y: list
 
-        :param X: list of lists with each row corresponding to a datapoint's features
+        :param X: list of lists with each row corresponding to a datapoint's features,
+                  or a CSRMatrix with gradient descent
         :param y: list of targets
 
         :rtype: object
@@ -84,12 +189,58 @@ class LogisticRegression(LinearBase, Classifier):
         self.X = X
         self.y = y
 
-        self._n_features = len(X[0])
+        self._n_features = self._n_columns(X)
         self._n_classes = len(set(y))
 
         if self._n_classes == 2:
             theta = self._initiate_weights(bias=self._bias)
-            self._coefficients, self._cost, self._iterations = self._gradient_descent(self.X, self.y, theta=theta)
+            self._coefficients, self._cost, self._iterations = self._solve(self.X, self.y, theta=theta)
+
+        elif self._multi_class == 'multinomial':
+
+            # a single softmax model with one set of coefficients per class
+            self._check_dense(self.X, 'Multinomial logistic regression')
+
+            theta = [self._initiate_weights(bias=self._bias, c=0)]
+            theta += [self._warm_coefficients(len(theta[0]), c) or [random.gauss(0, 1) for x in range(len(theta[0]))]
+                      for c in range(1, self._n_classes)]
+
+            self._coefficients, self._cost, self._iterations = softmax_regression(self.X, theta, self.y,
+                                                                                  self._max_iterations,
+                                                                                  self._epsilon,
+                                                                                  self._learning_rate, self._alpha,
+                                                                                  self._method, self._fudge_factor,
+                                                                                  beta_2=self._beta_2,
+                                                                                  weight_decay=self._weight_decay,
+                                                                                  fit_intercept=self._bias)
+
+        elif self._n_jobs != 1 and self._solver == 'gradient_descent' and self._method != 'hogwild' and \
+                not is_sparse(self.X):
+
+            # all binary classifiers are trained concurrently in C++ (sparse X is trained one class at a time below)
+            theta = [self._initiate_weights(bias=self._bias, c=0)]
+            theta += [self._warm_coefficients(self._n_features + 1, c) or
+                      [random.gauss(0, 1) for x in range(self._n_features + 1)] for c in range(1, self._n_classes)]
+
+            X, y = self.X, self.y
+            kwargs = self._schedule_kwargs()
+
+            if self._early_stopping:
+                X, y, X_val, y_val = self._split_validation(X, y)
+                kwargs.update(self._early_stopping_kwargs(X_val, y_val))
+
+            self._coefficients, self._cost, self._iterations = one_vs_rest(X, theta, y, self._batch_size,
+                                                                           self._max_iterations, self._epsilon,
+                                                                           self._learning_rate, self._alpha,
+                                                                           self._method, self._seed,
+                                                                           self._fudge_factor, beta_2=self._beta_2,
+                                                                           weight_decay=self._weight_decay,
+                                                                           history_size=self._history_size,
+                                                                           n_jobs=self._n_jobs, monitor=self._monitor,
+                                                                           monitor_frequency=self._monitor_frequency,
+                                                                           monitor_samples=self._monitor_samples,
+                                                                           physical_shuffle=self._physical_shuffle,
+                                                                           fit_intercept=self._bias, **kwargs)
 
         else:
 
@@ -98,6 +249,8 @@ class LogisticRegression(LinearBase, Classifier):
             self._cost = []
             self._iterations = []
 
+            coefficients = []
+
             first = True
             for x in range(self._n_classes):
                 # relabel classes
@@ -105,18 +258,51 @@ class LogisticRegression(LinearBase, Classifier):
 
                 # initiate coefficients
                 if first:
-                    theta = self._initiate_weights(bias=self._bias)
+                    theta = self._initiate_weights(bias=self._bias, c=x)
                     first = False
                 else:
-                    theta = [random.gauss(0, 1) for x in range(self._n_features + 1)]
+                    theta = self._warm_coefficients(self._n_features + 1, x) or \
+                            [random.gauss(0, 1) for x in range(self._n_features + 1)]
 
-                _coefficients_i, cost_i, iterations_i = self._gradient_descent(self.X, y_i, theta=theta)
+                _coefficients_i, cost_i, iterations_i = self._solve(self.X, y_i, theta=theta)
 
                 # keep coefficients of each model
-                self._coefficients.append(_coefficients_i)
+                coefficients.append(_coefficients_i)
                 self._cost.append(cost_i)
                 self._iterations.append(iterations_i)
 
+            self._coefficients = coefficients
+
+    def partial_fit(self, X, y, epochs=1):
+        """
+        Run gradient descent epochs on a chunk of data, continuing from the coefficients and optimiser state of the
+        previous call (or of the last fit with warm_start). Only binary labels (0 and 1) are supported.
+
+        :type X: list
+        :type y: list
+        :type epochs: int
+
+        :param X: list of lists with each row corresponding to a datapoint's features
+        :param y: list of binary targets
+        :param epochs: number of passes over the chunk
+
+        :rtype: object
+        :return: self
+        """
+        if not set(y) <= {0, 1}:
+            raise ValueError("partial_fit only supports binary labels (0 and 1)")
+
+        self._n_classes = 2
+
+        return self._partial_fit(X, y, epochs, bias=self._bias)
+
+    def _solve(self, X, y, theta):
+
+        if self._solver == 'newton':
+            return self._newton(X, y, theta, fit_intercept=self._bias)
+        else:
+            return self._gradient_descent(X, y, theta, fit_intercept=self._bias)
+
     def _predict(self, X):
 
         """
@@ -149,23 +335,14 @@ class LogisticRegression(LinearBase, Classifier):
         :return: list of prediction probabilities
         """
 
-        if (self._bias and len(X[0]) == self._n_features + 1) or not self._bias:
-
-            if self.n_classes > 2:
-                scores = [dot_product(X, coef) for coef in self.coefficients]
-                return [softmax([scores[i][x] for i in range(self.n_classes)]) for x in range(len(scores[0]))]
-
-            else:
-                return sigmoid(dot_product(X, self.coefficients))
-
-        elif self._bias and len(X[0]) == self._n_features:
+        link = 'softmax' if self.n_classes > 2 else 'sigmoid'
 
-            if self.n_classes > 2:
-                scores = [dot_product([[1] + row for row in X], coef) for coef in self.coefficients]
-                return [softmax([scores[i][x] for i in range(self.n_classes)]) for x in range(len(scores[0]))]
+        # the bias is added by predict when X doesn't have the column of ones
+        if self._bias and self._n_columns(X) == self._n_features:
+            return predict(X, self.coefficients, True, link, self._n_jobs, self._dtype)
 
-            else:
-                return sigmoid(dot_product([[1] + row for row in X], self.coefficients))
+        elif (self._bias and self._n_columns(X) == self._n_features + 1) or not self._bias:
+            return predict(X, self.coefficients, False, link, self._n_jobs, self._dtype)
 
         else:
             raise NotImplementedError("This part of the code has not been explored yet, "
@@ -1,3 +1,4 @@
 from .linear_algebra import dot_product, transpose, add, subtract, power, multiply, divide, \
     least_squares, eigen, determinant
-from .math_utils import mean, max_occurence, argsort, sigmoid, sort, std, covariance, argmax, argmin
+from .math_utils import mean, mapped_mean, RunningMoments, max_occurence, argsort, sigmoid, sort, std, covariance, argmax, argmin
+from .sparse import CSRMatrix, is_sparse, as_csr
@@ -0,0 +1,86 @@
+//
+// Created by Gil Ferreira Hoben on 19/10/26.
+//
+// Allocation policies for the storage of flatArrays. A policy provides
+//
+//      template <typename T> static T* allocate(flatIndex size);
+//      template <typename T> static void deallocate(T* data, flatIndex size);
+//
+// and is picked when an array is created, e.g. new flatArray<double>(rows, cols, hugePageAllocator()).
+// The array remembers how to free its storage, so arrays with different policies are still the same
+// type and go through the same kernels. Storage is uninitialised, so T must be a trivial type.
+//
+
+#ifndef PYML_ALLOCATORS_H
+#define PYML_ALLOCATORS_H
+
+#include <cstdlib>
+#include <new>
+#include <sys/mman.h>
+
+// default policy, storage starts on a cache line, which is also the width of an AVX-512 register,
+// so vectorised loops over a whole array start with aligned loads and stores
+struct alignedAllocator {
+
+    static const std::size_t alignment = 64;
+
+    template <typename T>
+    static T* allocate(flatIndex size) {
+
+        void* data = nullptr;
+
+        // posix_memalign may return a nullptr for 0 bytes, which would look like a failure
+        std::size_t bytes = size > 0 ? static_cast<std::size_t>(size) * sizeof(T) : 1;
+
+        if (posix_memalign(&data, alignment, bytes) != 0) {
+            throw std::bad_alloc();
+        }
+
+        return static_cast<T*>(data);
+    }
+
+    template <typename T>
+    static void deallocate(T* data, flatIndex /* size */) {
+        free(data);
+    }
+};
+
+// storage of at least a huge page (2MB) is aligned to a huge page and the OS is asked to back it with
+// huge pages, which cuts TLB misses when large arrays are streamed. Smaller arrays are aligned as above.
+struct hugePageAllocator {
+
+    static const std::size_t alignment = 2 * 1024 * 1024;
+
+    template <typename T>
+    static T* allocate(flatIndex size) {
+
+        auto bytes = static_cast<std::size_t>(size) * sizeof(T);
+
+        if (size <= 0 || bytes < alignment) {
+            return alignedAllocator::allocate<T>(size);
+        }
+
+        void* data = nullptr;
+
+        // round up, so the last huge page isn't shared with other allocations
+        bytes = (bytes + alignment - 1) / alignment * alignment;
+
+        if (posix_memalign(&data, alignment, bytes) != 0) {
+            throw std::bad_alloc();
+        }
+
+#ifdef MADV_HUGEPAGE
+        // only a hint, transparent huge pages may be disabled
+        madvise(data, bytes, MADV_HUGEPAGE);
+#endif
+
+        return static_cast<T*>(data);
+    }
+
+    template <typename T>
+    static void deallocate(T* data, flatIndex /* size */) {
+        free(data);
+    }
+};
+
+#endif //PYML_ALLOCATORS_H
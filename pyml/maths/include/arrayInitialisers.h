@@ -12,18 +12,18 @@ template <typename T>
 flatArray<T>* readFromPythonList(PyObject *pyList);
 
 template <typename T>
-flatArray<T>* emptyArray(int rows, int cols);
+flatArray<T>* emptyArray(flatIndex rows, flatIndex cols);
 
 template <typename T>
-inline flatArray<T>* identity(int n);
+inline flatArray<T>* identity(flatIndex n);
 
 template <typename T>
-inline flatArray<T>* zeroArray(int rows, int cols);
+inline flatArray<T>* zeroArray(flatIndex rows, flatIndex cols);
 
 template <typename T>
-inline flatArray<T>* oneArray(int rows, int cols);
+inline flatArray<T>* oneArray(flatIndex rows, flatIndex cols);
 
 template <typename T>
-inline flatArray<T>* constArray(int rows, int cols, double c);
+inline flatArray<T>* constArray(flatIndex rows, flatIndex cols, double c);
 
 #endif //PYML_ARRAYINITIALISERS_H
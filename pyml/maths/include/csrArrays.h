@@ -0,0 +1,318 @@
+//
+// Created by Gil Ferreira Hoben on 19/10/26.
+//
+// Sparse matrices in compressed sparse row (CSR) format, for data that is mostly zeros such as bag of
+// words or one hot features. Only the non zero elements are stored: the values of row i are
+// data[indptr[i]] to data[indptr[i + 1] - 1], and their columns are the same range of indices.
+//
+//      | 1 0 2 |         data    = [1, 2, 3]
+//      | 0 0 0 |   ->    indices = [0, 2, 1]
+//      | 0 3 0 |         indptr  = [0, 2, 2, 3]
+//
+// The column indices of each row are sorted and unique (the canonical format), which the constructor
+// checks. Products with dense matrices read each non zero once, so their memory and time scale with the
+// number of non zeros rather than with rows * cols, and rows of large products are computed by several
+// threads (see forRowBands in flatArrayReductions.h). Sums are accumulated in double precision for float.
+//
+
+#ifndef PYML_CSRARRAYS_H
+#define PYML_CSRARRAYS_H
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+#include "flatArrays.h"
+#include "exceptionClasses.h"
+#include "flatArrayReductions.h"
+
+template <class T>
+class csrArray {
+private:
+    flatIndex rows;
+    flatIndex cols;
+
+    std::vector<flatIndex> indptr;
+    std::vector<flatIndex> indices;
+    std::vector<T> data;
+
+    // rows in each band of a product with work multiply adds, one band per thread for large products
+    flatIndex bandRows(flatIndex work) const {
+
+        flatIndex nBands = 1;
+
+        if (work >= reductionParallelSize) {
+            nBands = std::min(static_cast<flatIndex>(std::max(std::thread::hardware_concurrency(), 1u)), rows);
+        }
+
+        return std::max((rows + nBands - 1) / nBands, static_cast<flatIndex>(1));
+    }
+
+public:
+    // rows by cols matrix of zeros
+    csrArray(flatIndex rows, flatIndex cols) : rows(rows), cols(cols), indptr(static_cast<std::size_t>(rows + 1)) {}
+
+    // takes over the buffers of a CSR matrix, throws a csrArrayException if they don't describe one
+    csrArray(flatIndex rows, flatIndex cols, std::vector<flatIndex>&& indptr, std::vector<flatIndex>&& indices,
+             std::vector<T>&& data) :
+            rows(rows), cols(cols), indptr(std::move(indptr)), indices(std::move(indices)), data(std::move(data)) {
+        check();
+    }
+
+    // copy of the CSR matrix with nonZeros elements in data, indices and indptr
+    csrArray(const T* data, const flatIndex* indices, const flatIndex* indptr, flatIndex rows, flatIndex cols) :
+            csrArray(rows, cols, std::vector<flatIndex>(indptr, indptr + rows + 1),
+                     std::vector<flatIndex>(indices, indices + indptr[rows]),
+                     std::vector<T>(data, data + indptr[rows])) {}
+
+    // the non zero elements of a dense array
+    static csrArray<T>* fromDense(const flatArray<T>& A) {
+
+        auto* result = new csrArray<T>(A.getRows(), A.getCols());
+        const T* a = A.getArray();
+
+        for (flatIndex i = 0; i < A.getRows(); ++i) {
+            for (flatIndex j = 0; j < A.getCols(); ++j) {
+                if (a[i * A.getCols() + j] != 0) {
+                    result->indices.push_back(j);
+                    result->data.push_back(a[i * A.getCols() + j]);
+                }
+            }
+            result->indptr[i + 1] = static_cast<flatIndex>(result->data.size());
+        }
+
+        return result;
+    }
+
+    // throws a csrArrayException unless the buffers describe a rows by cols CSR matrix
+    void check() const {
+
+        if (rows < 0 || cols < 0 || static_cast<flatIndex>(indptr.size()) != rows + 1) {
+            throw csrArrayException("indptr should have rows + 1 elements");
+        }
+
+        if (indptr[0] != 0 || indptr[rows] != static_cast<flatIndex>(indices.size()) ||
+            indices.size() != data.size()) {
+            throw csrArrayException("indptr should go from 0 to the number of non zero elements, which is the "
+                                    "size of indices and data");
+        }
+
+        for (flatIndex i = 0; i < rows; ++i) {
+
+            if (indptr[i + 1] < indptr[i]) {
+                throw csrArrayException("indptr should not decrease (row " + std::to_string(i) + ")");
+            }
+
+            for (flatIndex k = indptr[i]; k < indptr[i + 1]; ++k) {
+
+                if (indices[k] < 0 || indices[k] >= cols) {
+                    throw csrArrayException("column index " + std::to_string(indices[k]) + " out of bounds in row "
+                                            + std::to_string(i));
+                }
+
+                if (k > indptr[i] && indices[k] <= indices[k - 1]) {
+                    throw csrArrayException("the column indices of row " + std::to_string(i) +
+                                            " should be sorted and unique");
+                }
+            }
+        }
+    }
+
+    flatIndex getRows() const {return rows;}
+    flatIndex getCols() const {return cols;}
+    flatIndex getNonZeros() const {return static_cast<flatIndex>(data.size());}
+
+    const T* getData() const {return data.data();}
+    const flatIndex* getIndices() const {return indices.data();}
+    const flatIndex* getIndptr() const {return indptr.data();}
+
+    flatIndex rowStart(flatIndex i) const {return indptr[i];}
+    flatIndex rowEnd(flatIndex i) const {return indptr[i + 1];}
+
+    flatArray<T>* toDense() const {
+
+        auto* result = new flatArray<T>(rows, cols);
+        T* a = result->getArray();
+
+        std::fill(a, a + result->getSize(), static_cast<T>(0));
+
+        for (flatIndex i = 0; i < rows; ++i) {
+            for (flatIndex k = indptr[i]; k < indptr[i + 1]; ++k) {
+                a[i * cols + indices[k]] = data[k];
+            }
+        }
+
+        return result;
+    }
+
+    // ROW KERNELS, used by the optimisers one row at a time
+    // init + row i · w, where w has cols elements (of any type that converts to T), in precision A
+    template <class A, class W>
+    inline A rowDot(flatIndex i, const W* w, A init=0) const {
+
+        A result = init;
+
+        for (flatIndex k = indptr[i]; k < indptr[i + 1]; ++k) {
+            result += data[k] * w[indices[k]];
+        }
+
+        return result;
+    }
+
+    // out += alpha * row i, where out has cols elements
+    template <class A, class W>
+    inline void rowAxpy(flatIndex i, A alpha, W* out) const {
+        for (flatIndex k = indptr[i]; k < indptr[i + 1]; ++k) {
+            out[indices[k]] += alpha * data[k];
+        }
+    }
+
+    // PRODUCTS
+    // sparse-dense products, B is either a vector with cols elements (the result is 1 by rows, as with
+    // flatArray::dot) or a cols by k matrix (the result is rows by k)
+    flatArray<T>* dot(const flatArray<T>& B) const {
+
+        typedef typename accumulator<T>::type A;
+
+        const T* b = B.getArray();
+
+        if (B.getRows() == 1 && B.getCols() == cols) {
+
+            auto* result = new flatArray<T>(1, rows);
+            T* out = result->getArray();
+
+            forRowBands(rows, bandRows(getNonZeros()), [&](flatIndex start, flatIndex end) {
+                for (flatIndex i = start; i < end; ++i) {
+                    out[i] = static_cast<T>(rowDot<A>(i, b));
+                }
+            });
+
+            return result;
+        }
+
+        if (B.getRows() == cols) {
+
+            flatIndex k = B.getCols();
+            auto* result = new flatArray<T>(rows, k);
+            T* out = result->getArray();
+
+            forRowBands(rows, bandRows(getNonZeros() * k), [&](flatIndex start, flatIndex end) {
+
+                // each non zero of the row scales a row of B
+                std::vector<A> sum(static_cast<std::size_t>(k));
+
+                for (flatIndex i = start; i < end; ++i) {
+
+                    std::fill(sum.begin(), sum.end(), static_cast<A>(0));
+
+                    for (flatIndex n = indptr[i]; n < indptr[i + 1]; ++n) {
+
+                        const T* row = b + indices[n] * k;
+                        A value = data[n];
+
+                        for (flatIndex j = 0; j < k; ++j) {
+                            sum[j] += value * row[j];
+                        }
+                    }
+
+                    std::copy(sum.begin(), sum.end(), out + i * k);
+                }
+            });
+
+            return result;
+        }
+
+        throw flatArrayDimensionMismatchException<T>(rows, cols, B.getRows(), B.getCols());
+    }
+
+    // transpose(this) · B without forming the transpose, B is either a vector with rows elements (the
+    // result is 1 by cols) or a rows by k matrix (the result is cols by k). Each row of this scatters into
+    // the result, so the rows are read in order by a single thread
+    flatArray<T>* transposeDot(const flatArray<T>& B) const {
+
+        typedef typename accumulator<T>::type A;
+
+        const T* b = B.getArray();
+        flatIndex k;
+
+        if (B.getRows() == 1 && B.getCols() == rows) {
+            k = 1;
+        }
+
+        else if (B.getRows() == rows) {
+            k = B.getCols();
+        }
+
+        else {
+            throw flatArrayDimensionMismatchException<T>(cols, rows, B.getRows(), B.getCols());
+        }
+
+        std::vector<A> sum(static_cast<std::size_t>(cols * k));
+
+        for (flatIndex i = 0; i < rows; ++i) {
+
+            const T* row = b + i * k;
+
+            for (flatIndex n = indptr[i]; n < indptr[i + 1]; ++n) {
+
+                A* out = sum.data() + indices[n] * k;
+                A value = data[n];
+
+                for (flatIndex j = 0; j < k; ++j) {
+                    out[j] += value * row[j];
+                }
+            }
+        }
+
+        auto* result = k == 1 && B.getRows() == 1 ? new flatArray<T>(1, cols) : new flatArray<T>(cols, k);
+
+        std::copy(sum.begin(), sum.end(), result->getArray());
+
+        return result;
+    }
+
+    // ROW SELECTION
+    // copy of the rows from start to end - 1
+    csrArray<T>* slice(flatIndex start, flatIndex end) const {
+
+        if (start < 0 || end > rows || start > end) {
+            throw arrayOutOfBoundsException(rows, start < 0 || start > end ? start : end);
+        }
+
+        std::vector<flatIndex> sliceIndptr(static_cast<std::size_t>(end - start + 1));
+
+        for (flatIndex i = start; i <= end; ++i) {
+            sliceIndptr[i - start] = indptr[i] - indptr[start];
+        }
+
+        return new csrArray<T>(end - start, cols, std::move(sliceIndptr),
+                               std::vector<flatIndex>(indices.begin() + indptr[start], indices.begin() + indptr[end]),
+                               std::vector<T>(data.begin() + indptr[start], data.begin() + indptr[end]));
+    }
+
+    // result = rows index[0] to index[count - 1], e.g. a shuffled copy. The storage of result is reused,
+    // so repeated calls only allocate when the number of non zeros grows
+    void take(const flatIndex* index, flatIndex count, csrArray<T>& result) const {
+
+        result.rows = count;
+        result.cols = cols;
+        result.indptr.resize(static_cast<std::size_t>(count + 1));
+        result.indptr[0] = 0;
+
+        for (flatIndex i = 0; i < count; ++i) {
+            result.indptr[i + 1] = result.indptr[i] + indptr[index[i] + 1] - indptr[index[i]];
+        }
+
+        result.indices.resize(static_cast<std::size_t>(result.indptr[count]));
+        result.data.resize(result.indices.size());
+
+        for (flatIndex i = 0; i < count; ++i) {
+            std::copy(indices.begin() + indptr[index[i]], indices.begin() + indptr[index[i] + 1],
+                      result.indices.begin() + result.indptr[i]);
+            std::copy(data.begin() + indptr[index[i]], data.begin() + indptr[index[i] + 1],
+                      result.data.begin() + result.indptr[i]);
+        }
+    }
+};
+
+#endif //PYML_CSRARRAYS_H
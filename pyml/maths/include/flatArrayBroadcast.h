@@ -0,0 +1,179 @@
+//
+// Created by Gil Ferreira Hoben on 19/10/26.
+//
+// Broadcasting of elementwise operations between two arrays.
+//
+// Each operand is described by its shape and strides, so element (i, j) is data[i * rowStride + j * colStride].
+// Two shapes are compatible when, along each dimension, they are equal or one of them is 1, and the
+// dimensions of size 1 are stretched by giving them a stride of 0, so nothing is ever copied:
+//
+//      (rows, cols) op (rows, cols)     elementwise
+//      (rows, cols) op (1, cols)        row vector applied to every row
+//      (rows, cols) op (rows, 1)        column vector applied to every column
+//      (rows, cols) op (1, 1)           scalar
+//
+// and the same with the operands swapped. The result is written into an existing array of the broadcast
+// shape, which may be one of the operands. Rows are processed one at a time, and the inner loop is picked
+// from the column strides, so that it is always unit stride (or a constant) and can be vectorised.
+//
+
+#ifndef PYML_FLATARRAYBROADCAST_H
+#define PYML_FLATARRAYBROADCAST_H
+
+#include "flatArrays.h"
+#include "exceptionClasses.h"
+
+template <class T>
+struct broadcastOperand {
+    const T* data;
+    flatIndex rows;
+    flatIndex cols;
+    flatIndex rowStride;
+    flatIndex colStride;
+};
+
+
+// an array as it is laid out in memory
+template <class T>
+inline broadcastOperand<T> asOperand(const flatArray<T>& array) {
+    return {array.getArray(), array.getRows(), array.getCols(), array.getCols(), 1};
+}
+
+
+// a 1 by n vector as a n by 1 column, without copying it
+template <class T>
+inline broadcastOperand<T> asColumn(const flatArray<T>& vector) {
+    return {vector.getArray(), vector.getSize(), 1, 1, 0};
+}
+
+
+// vectors read from Python lists always have a single row. When such a vector is combined with a matrix
+// it is applied to each row if its length matches the number of rows of the matrix, and to each column
+// otherwise. So for square matrices the ith element is combined with the ith row (transpose the matrix if
+// this isn't what you want).
+template <class T>
+inline broadcastOperand<T> vectorOperand(const flatArray<T>& array, flatIndex otherRows) {
+
+    if (array.getRows() == 1 && array.getCols() > 1 && otherRows > 1 && array.getCols() == otherRows) {
+        return asColumn(array);
+    }
+
+    return asOperand(array);
+}
+
+
+inline bool broadcastDimension(flatIndex a, flatIndex b, flatIndex& result) {
+
+    if (a == b || b == 1) {
+        result = a;
+        return true;
+    }
+
+    if (a == 1) {
+        result = b;
+        return true;
+    }
+
+    return false;
+}
+
+
+// shape of the result of an operation between a and b
+template <class T>
+inline void broadcastShape(const broadcastOperand<T>& a, const broadcastOperand<T>& b,
+                           flatIndex& rows, flatIndex& cols) {
+
+    if (!broadcastDimension(a.rows, b.rows, rows) || !broadcastDimension(a.cols, b.cols, cols)) {
+        throw flatArrayDimensionMismatchException<T>(a.rows, a.cols, b.rows, b.cols);
+    }
+}
+
+
+// the operand stretched to rows by cols, the shapes must be compatible
+template <class T>
+inline broadcastOperand<T> stretch(const broadcastOperand<T>& operand, flatIndex rows, flatIndex cols) {
+    return {operand.data, rows, cols,
+            operand.rows == 1 ? 0 : operand.rowStride,
+            operand.cols == 1 ? 0 : operand.colStride};
+}
+
+
+// the operand covers a contiguous block of memory in row major order
+template <class T>
+inline bool isContiguous(const broadcastOperand<T>& operand) {
+    return operand.colStride == 1 && (operand.rowStride == operand.cols || operand.rows == 1);
+}
+
+
+// result = f(a, b), result must already have the broadcast shape of a and b
+template <class T, class F>
+void broadcast(const broadcastOperand<T>& a, const broadcastOperand<T>& b, F f, flatArray<T>& result) {
+
+    flatIndex rows, cols;
+
+    broadcastShape(a, b, rows, cols);
+
+    if (rows != result.getRows() || cols != result.getCols()) {
+        throw flatArrayDimensionMismatchException<T>(result.getRows(), result.getCols(), rows, cols);
+    }
+
+    const broadcastOperand<T> A = stretch(a, rows, cols);
+    const broadcastOperand<T> B = stretch(b, rows, cols);
+
+    T* out = result.getArray();
+
+    if (isContiguous(A) && isContiguous(B)) {
+        // same shape, a single loop over all the elements
+        flatIndex size = rows * cols;
+        const T* x = A.data;
+        const T* y = B.data;
+
+        for (flatIndex n = 0; n < size; ++n) {
+            out[n] = f(x[n], y[n]);
+        }
+
+        return;
+    }
+
+    for (flatIndex i = 0; i < rows; ++i) {
+
+        const T* x = A.data + i * A.rowStride;
+        const T* y = B.data + i * B.rowStride;
+        T* z = out + i * cols;
+
+        if (A.colStride == 1 && B.colStride == 1) {
+            for (flatIndex j = 0; j < cols; ++j) {
+                z[j] = f(x[j], y[j]);
+            }
+        }
+
+        else if (A.colStride == 1 && B.colStride == 0) {
+            const T yValue = y[0];
+            for (flatIndex j = 0; j < cols; ++j) {
+                z[j] = f(x[j], yValue);
+            }
+        }
+
+        else if (A.colStride == 0 && B.colStride == 1) {
+            const T xValue = x[0];
+            for (flatIndex j = 0; j < cols; ++j) {
+                z[j] = f(xValue, y[j]);
+            }
+        }
+
+        else if (A.colStride == 0 && B.colStride == 0) {
+            const T value = f(x[0], y[0]);
+            for (flatIndex j = 0; j < cols; ++j) {
+                z[j] = value;
+            }
+        }
+
+        else {
+            for (flatIndex j = 0; j < cols; ++j) {
+                z[j] = f(x[j * A.colStride], y[j * B.colStride]);
+            }
+        }
+    }
+}
+
+#endif //PYML_FLATARRAYBROADCAST_H
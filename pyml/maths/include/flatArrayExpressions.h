@@ -0,0 +1,280 @@
+//
+// Created by Gil Ferreira Hoben on 19/10/26.
+//
+// Lazy elementwise arithmetic on flatArrays with expression templates.
+//
+// lazy(a) wraps a flatArray, and +, -, *, / (with other expressions or scalars), power and nlog build
+// an expression tree at compile time instead of computing anything. The tree is evaluated in a single
+// loop, which the compiler can inline and vectorise, when it is assigned or reduced:
+//
+//      assign(*G, lazy(*G) + power(lazy(*g), 2));                 // G += g ** 2, in place
+//      T J = sum(power(lazy(*prediction) - lazy(y), 2));           // one pass, no temporaries
+//      flatArray<T>* r = evaluate(lazy(a) * 2 - lazy(b));          // new array
+//
+// so (a - b) ** 2 summed reads a and b once, where the flatArray operators write two temporaries.
+// The operators of flatArray itself are unchanged and still return new arrays.
+//
+// Operands must have the same shape, or be scalars. Unlike flatArray::divide, division follows the
+// IEEE rules and doesn't check for zeros, since the check would stop the loop from being vectorised.
+//
+
+#ifndef PYML_FLATARRAYEXPRESSIONS_H
+#define PYML_FLATARRAYEXPRESSIONS_H
+
+#include <cmath>
+#include "flatArrays.h"
+#include "exceptionClasses.h"
+#include "arrayInitialisers.h"
+#include "flatArrayReductions.h"
+
+// base of all expressions, E is the expression type itself
+template <class E>
+struct flatExpression {
+    const E& self() const {return static_cast<const E&>(*this);}
+};
+
+
+// leaf with the elements of a flatArray, which must outlive the expression
+template <class T>
+class arrayTerminal : public flatExpression<arrayTerminal<T>> {
+private:
+    const T* data;
+    flatIndex rows;
+    flatIndex cols;
+
+public:
+    typedef T valueType;
+
+    explicit arrayTerminal(const flatArray<T>& array) :
+            data(array.getArray()), rows(array.getRows()), cols(array.getCols()) {}
+
+    T operator[](flatIndex i) const {return data[i];}
+
+    flatIndex getRows() const {return rows;}
+    flatIndex getCols() const {return cols;}
+    bool isScalar() const {return false;}
+};
+
+
+// leaf with the same value everywhere
+template <class T>
+class scalarTerminal : public flatExpression<scalarTerminal<T>> {
+private:
+    T value;
+
+public:
+    typedef T valueType;
+
+    explicit scalarTerminal(T value) : value(value) {}
+
+    T operator[](flatIndex /* i */) const {return value;}
+
+    flatIndex getRows() const {return 1;}
+    flatIndex getCols() const {return 1;}
+    bool isScalar() const {return true;}
+};
+
+
+// operations, as function objects so that they are inlined
+struct addOp {
+    template <class T>
+    T operator()(T a, T b) const {return a + b;}
+};
+
+struct subtractOp {
+    template <class T>
+    T operator()(T a, T b) const {return a - b;}
+};
+
+struct multiplyOp {
+    template <class T>
+    T operator()(T a, T b) const {return a * b;}
+};
+
+struct divideOp {
+    template <class T>
+    T operator()(T a, T b) const {return a / b;}
+};
+
+template <class T>
+struct powerOp {
+    T exponent;
+    T operator()(T a) const {return pow(a, exponent);}
+};
+
+template <class T>
+struct logOp {
+    T base;
+    T operator()(T a) const {return log(a) / log(base);}
+};
+
+
+// children are held by value, they are either leaves (a pointer and a shape) or other small nodes,
+// so an expression doesn't refer to the temporaries it was built from
+template <class L, class R, class Op>
+class binaryExpression : public flatExpression<binaryExpression<L, R, Op>> {
+private:
+    L left;
+    R right;
+    Op op;
+    flatIndex rows;
+    flatIndex cols;
+    bool scalar;
+
+public:
+    typedef typename L::valueType valueType;
+
+    binaryExpression(const L& left, const R& right) : left(left), right(right) {
+
+        const bool leftScalar = left.isScalar();
+        const bool rightScalar = right.isScalar();
+
+        rows = leftScalar ? right.getRows() : left.getRows();
+        cols = leftScalar ? right.getCols() : left.getCols();
+        scalar = leftScalar && rightScalar;
+
+        if (!leftScalar && !rightScalar && (left.getRows() != right.getRows() || left.getCols() != right.getCols())) {
+            throw flatArrayDimensionMismatchException<valueType>(left.getRows(), left.getCols(),
+                                                                 right.getRows(), right.getCols());
+        }
+    }
+
+    valueType operator[](flatIndex i) const {return op(left[i], right[i]);}
+
+    flatIndex getRows() const {return rows;}
+    flatIndex getCols() const {return cols;}
+    bool isScalar() const {return scalar;}
+};
+
+
+template <class E, class Op>
+class unaryExpression : public flatExpression<unaryExpression<E, Op>> {
+private:
+    E expression;
+    Op op;
+
+public:
+    typedef typename E::valueType valueType;
+
+    unaryExpression(const E& expression, const Op& op) : expression(expression), op(op) {}
+
+    valueType operator[](flatIndex i) const {return op(expression[i]);}
+
+    flatIndex getRows() const {return expression.getRows();}
+    flatIndex getCols() const {return expression.getCols();}
+    bool isScalar() const {return expression.isScalar();}
+};
+
+
+template <class T>
+inline arrayTerminal<T> lazy(const flatArray<T>& array) {
+    return arrayTerminal<T>(array);
+}
+
+
+// expression op expression, expression op scalar and scalar op expression
+template <class Op, class L, class R>
+inline binaryExpression<L, R, Op> combine(const flatExpression<L>& left, const flatExpression<R>& right) {
+    return binaryExpression<L, R, Op>(left.self(), right.self());
+}
+
+template <class Op, class E>
+inline binaryExpression<E, scalarTerminal<typename E::valueType>, Op> combine(const flatExpression<E>& left,
+                                                                             typename E::valueType right) {
+    return binaryExpression<E, scalarTerminal<typename E::valueType>, Op>(
+            left.self(), scalarTerminal<typename E::valueType>(right));
+}
+
+template <class Op, class E>
+inline binaryExpression<scalarTerminal<typename E::valueType>, E, Op> combine(typename E::valueType left,
+                                                                             const flatExpression<E>& right) {
+    return binaryExpression<scalarTerminal<typename E::valueType>, E, Op>(
+            scalarTerminal<typename E::valueType>(left), right.self());
+}
+
+template <class L, class R>
+inline auto operator+(const L& left, const R& right) -> decltype(combine<addOp>(left, right)) {
+    return combine<addOp>(left, right);
+}
+
+template <class L, class R>
+inline auto operator-(const L& left, const R& right) -> decltype(combine<subtractOp>(left, right)) {
+    return combine<subtractOp>(left, right);
+}
+
+template <class L, class R>
+inline auto operator*(const L& left, const R& right) -> decltype(combine<multiplyOp>(left, right)) {
+    return combine<multiplyOp>(left, right);
+}
+
+template <class L, class R>
+inline auto operator/(const L& left, const R& right) -> decltype(combine<divideOp>(left, right)) {
+    return combine<divideOp>(left, right);
+}
+
+
+template <class E>
+inline unaryExpression<E, powerOp<typename E::valueType>> power(const flatExpression<E>& expression, double p) {
+    powerOp<typename E::valueType> op = {static_cast<typename E::valueType>(p)};
+    return unaryExpression<E, powerOp<typename E::valueType>>(expression.self(), op);
+}
+
+
+template <class E>
+inline unaryExpression<E, logOp<typename E::valueType>> nlog(const flatExpression<E>& expression, double base) {
+    logOp<typename E::valueType> op = {static_cast<typename E::valueType>(base)};
+    return unaryExpression<E, logOp<typename E::valueType>>(expression.self(), op);
+}
+
+
+// EVALUATION
+// writes the expression into destination, which may also appear in it since every element
+// is read before it is written
+template <class E>
+inline void assign(flatArray<typename E::valueType>& destination, const flatExpression<E>& expression) {
+
+    const E& e = expression.self();
+
+    if (e.isScalar()) {
+        std::fill(destination.getArray(), destination.getArray() + destination.getSize(), e[0]);
+        return;
+    }
+
+    if (e.getRows() != destination.getRows() || e.getCols() != destination.getCols()) {
+        throw flatArrayDimensionMismatchException<typename E::valueType>(destination.getRows(), destination.getCols(),
+                                                                         e.getRows(), e.getCols());
+    }
+
+    typename E::valueType* result = destination.getArray();
+    flatIndex size = destination.getSize();
+
+    for (flatIndex i = 0; i < size; ++i) {
+        result[i] = e[i];
+    }
+}
+
+
+// the expression as a new array
+template <class E>
+inline flatArray<typename E::valueType>* evaluate(const flatExpression<E>& expression) {
+
+    const E& e = expression.self();
+    flatArray<typename E::valueType>* result = emptyArray<typename E::valueType>(e.getRows(), e.getCols());
+
+    assign(*result, e);
+
+    return result;
+}
+
+
+// sum of the elements of the expression, pairwise in the same order and precision as flatArray::sum
+template <class E>
+inline typename E::valueType sum(const flatExpression<E>& expression) {
+
+    const E& e = expression.self();
+
+    return pairwiseSum<typename accumulator<typename E::valueType>::type>(e, 0, e.getRows() * e.getCols(),
+                                                                         reductionSpawnDepth(e.getRows() * e.getCols()));
+}
+
+#endif //PYML_FLATARRAYEXPRESSIONS_H
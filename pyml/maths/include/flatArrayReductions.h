@@ -0,0 +1,363 @@
+//
+// Created by Gil Ferreira Hoben on 19/10/26.
+//
+// Reductions of flatArrays (sum, mean, variance, min, max and their arguments) along axis 0 (each column),
+// axis 1 (each row) or over the whole array (reduceAll).
+//
+// Sums are pairwise: blocks of pairwiseBlockSize elements are added with 8 independent accumulators, which
+// the compiler can keep in vector registers, and the blocks are added up as a binary tree. The rounding
+// error then grows with log(n) rather than n, at the speed of a plain loop. Axis 0 walks the rows in
+// memory order, accumulating whole rows into a vector of column sums, and adds blocks of rows pairwise.
+// Variances are computed from the deviations to the mean (two passes), which is more accurate than
+// from the sum of squares.
+//
+// Large arrays are reduced by several threads. Threads compute subtrees of the same pairwise tree, so the
+// result doesn't depend on the number of threads. Floats are accumulated in double precision (see
+// accumulator in flatArrays.h).
+//
+
+#ifndef PYML_FLATARRAYREDUCTIONS_H
+#define PYML_FLATARRAYREDUCTIONS_H
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include "flatArrays.h"
+#include "exceptionClasses.h"
+
+// axis of reductions over all the elements of an array
+const int reduceAll = -1;
+
+// elements summed with independent accumulators before pairwise addition
+const flatIndex pairwiseBlockSize = 128;
+
+// rows accumulated one after the other before pairwise addition (axis 0)
+const flatIndex pairwiseBlockRows = 128;
+
+// arrays with at least this many elements are reduced by several threads
+const flatIndex reductionParallelSize = 1 << 20;
+
+
+// number of times the pairwise tree of an array of size elements is split between two threads, at most 8 threads
+inline int reductionSpawnDepth(flatIndex size) {
+
+    if (size < reductionParallelSize) {
+        return 0;
+    }
+
+    unsigned int nThreads = std::thread::hardware_concurrency();
+    int depth = 0;
+
+    while (depth < 3 && (2u << depth) <= nThreads) {
+        depth++;
+    }
+
+    return depth;
+}
+
+
+// rows in each band of rows of an array reduced by rows, one band per thread for large arrays
+inline flatIndex reductionBandRows(flatIndex rows, flatIndex cols) {
+
+    flatIndex nBands = 1;
+
+    if (rows * cols >= reductionParallelSize) {
+        nBands = std::min(static_cast<flatIndex>(std::max(std::thread::hardware_concurrency(), 1u)), rows);
+    }
+
+    return (rows + nBands - 1) / nBands;
+}
+
+
+// calls f(start, end) on the bands of bandRows rows of an array, each from its own thread
+template <class F>
+void forRowBands(flatIndex rows, flatIndex bandRows, F f) {
+
+    std::vector<std::thread> threads;
+
+    for (flatIndex start = bandRows; start < rows; start += bandRows) {
+        threads.emplace_back(f, start, std::min(start + bandRows, rows));
+    }
+
+    f(0, std::min(bandRows, rows));
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+
+// SUMS
+// sum of a[start] to a[start + n - 1] in precision R, a is a pointer or anything else with an operator[]
+template <class R, class A>
+inline R blockSum(const A& a, flatIndex start, flatIndex n) {
+
+    R result = 0;
+
+    if (n < 8) {
+        for (flatIndex i = 0; i < n; ++i) {
+            result += a[start + i];
+        }
+        return result;
+    }
+
+    R partial[8];
+
+    for (flatIndex k = 0; k < 8; ++k) {
+        partial[k] = a[start + k];
+    }
+
+    flatIndex i;
+
+    for (i = 8; i + 8 <= n; i += 8) {
+        for (flatIndex k = 0; k < 8; ++k) {
+            partial[k] += a[start + i + k];
+        }
+    }
+
+    result = ((partial[0] + partial[1]) + (partial[2] + partial[3])) +
+             ((partial[4] + partial[5]) + (partial[6] + partial[7]));
+
+    for (; i < n; ++i) {
+        result += a[start + i];
+    }
+
+    return result;
+}
+
+
+// halves n, keeping the first half a multiple of 8
+inline flatIndex pairwiseSplit(flatIndex n) {
+    flatIndex half = n / 2;
+    return half - half % 8;
+}
+
+
+// pairwise sum of a[start] to a[start + n - 1], the first spawn levels of the tree are split between threads
+template <class R, class A>
+R pairwiseSum(const A& a, flatIndex start, flatIndex n, int spawn=0) {
+
+    if (n <= pairwiseBlockSize) {
+        return blockSum<R>(a, start, n);
+    }
+
+    flatIndex half = pairwiseSplit(n);
+
+    if (spawn > 0) {
+        R left = 0;
+        std::thread thread([&]() {left = pairwiseSum<R>(a, start, half, spawn - 1);});
+        R right = pairwiseSum<R>(a, start + half, n - half, spawn - 1);
+        thread.join();
+        return left + right;
+    }
+
+    return pairwiseSum<R>(a, start, half) + pairwiseSum<R>(a, start + half, n - half);
+}
+
+
+// out[j] = sum over the rows of a rows by cols array of f(data[i, j], j), blocks of rows are added pairwise
+template <class R, class T, class F>
+void columnSums(const T* data, flatIndex rows, flatIndex cols, F f, R* out, int spawn=0) {
+
+    if (rows <= pairwiseBlockRows) {
+
+        for (flatIndex j = 0; j < cols; ++j) {
+            out[j] = f(data[j], j);
+        }
+
+        for (flatIndex i = 1; i < rows; ++i) {
+
+            const T* row = data + i * cols;
+
+            for (flatIndex j = 0; j < cols; ++j) {
+                out[j] += f(row[j], j);
+            }
+        }
+
+        return;
+    }
+
+    flatIndex half = rows / 2;
+    std::vector<R> right(cols);
+
+    if (spawn > 0) {
+        std::thread thread([&]() {columnSums(data, half, cols, f, out, spawn - 1);});
+        columnSums(data + half * cols, rows - half, cols, f, right.data(), spawn - 1);
+        thread.join();
+    }
+
+    else {
+        columnSums(data, half, cols, f, out);
+        columnSums(data + half * cols, rows - half, cols, f, right.data());
+    }
+
+    for (flatIndex j = 0; j < cols; ++j) {
+        out[j] += right[j];
+    }
+}
+
+
+// (x - centre) ** 2 of the elements of data, in precision R
+template <class T, class R>
+struct squaredDeviations {
+    const T* data;
+    R centre;
+
+    R operator[](flatIndex i) const {
+        R deviation = data[i] - centre;
+        return deviation * deviation;
+    }
+};
+
+
+// sums of a rows by cols array along axis (0, 1 or reduceAll), out has cols, rows or 1 elements
+template <class R, class T>
+void reduceSums(const T* data, flatIndex rows, flatIndex cols, int axis, R* out) {
+
+    int spawn = reductionSpawnDepth(rows * cols);
+
+    if (axis == reduceAll) {
+        out[0] = pairwiseSum<R>(data, 0, rows * cols, spawn);
+    }
+
+    else if (axis == 0) {
+        columnSums(data, rows, cols, [](T x, flatIndex /* j */) {return static_cast<R>(x);}, out, spawn);
+    }
+
+    else if (axis == 1) {
+        forRowBands(rows, reductionBandRows(rows, cols), [&](flatIndex start, flatIndex end) {
+            for (flatIndex i = start; i < end; ++i) {
+                out[i] = pairwiseSum<R>(data + i * cols, 0, cols);
+            }
+        });
+    }
+
+    else {
+        throw flatArrayUnknownAxis(axis);
+    }
+}
+
+
+// sums of squared deviations to centre (with as many elements as the result of reduceSums)
+template <class R, class T>
+void reduceSquaredDeviations(const T* data, flatIndex rows, flatIndex cols, int axis, const R* centre, R* out) {
+
+    int spawn = reductionSpawnDepth(rows * cols);
+
+    if (axis == reduceAll) {
+        squaredDeviations<T, R> deviations = {data, centre[0]};
+        out[0] = pairwiseSum<R>(deviations, 0, rows * cols, spawn);
+    }
+
+    else if (axis == 0) {
+        columnSums(data, rows, cols, [centre](T x, flatIndex j) {
+            R deviation = x - centre[j];
+            return deviation * deviation;
+        }, out, spawn);
+    }
+
+    else if (axis == 1) {
+        forRowBands(rows, reductionBandRows(rows, cols), [&](flatIndex start, flatIndex end) {
+            for (flatIndex i = start; i < end; ++i) {
+                squaredDeviations<T, R> deviations = {data + i * cols, centre[i]};
+                out[i] = pairwiseSum<R>(deviations, 0, cols);
+            }
+        });
+    }
+
+    else {
+        throw flatArrayUnknownAxis(axis);
+    }
+}
+
+
+// EXTREMES
+// index (within the reduced axis, or in the whole array for reduceAll) and value of the first element for
+// which better(x, current) holds against all the others, e.g. std::less for the minimum
+template <class T, class Better>
+void reduceExtremes(const T* data, flatIndex rows, flatIndex cols, int axis, Better better,
+                    T* values, flatIndex* indices) {
+
+    if (axis == reduceAll || axis == 1) {
+
+        // each row (or the whole array) is scanned in order
+        flatIndex n = axis == 1 ? cols : rows * cols;
+        flatIndex count = axis == 1 ? rows : 1;
+
+        auto scan = [&](flatIndex start, flatIndex end) {
+            for (flatIndex r = start; r < end; ++r) {
+
+                const T* x = data + r * n;
+                T best = x[0];
+                flatIndex index = 0;
+
+                for (flatIndex i = 1; i < n; ++i) {
+                    if (better(x[i], best)) {
+                        best = x[i];
+                        index = i;
+                    }
+                }
+
+                values[r] = best;
+                indices[r] = index;
+            }
+        };
+
+        if (axis == 1) {
+            forRowBands(rows, reductionBandRows(rows, cols), scan);
+        }
+
+        else {
+            scan(0, count);
+        }
+    }
+
+    else if (axis == 0) {
+
+        // bands of rows are scanned into their own vectors of column extremes, which are merged in order
+        flatIndex bandRows = reductionBandRows(rows, cols);
+        flatIndex nBands = (rows + bandRows - 1) / bandRows;
+
+        std::vector<T> bandValues(static_cast<std::size_t>(nBands * cols));
+        std::vector<flatIndex> bandIndices(bandValues.size());
+
+        forRowBands(rows, bandRows, [&](flatIndex start, flatIndex end) {
+
+            flatIndex band = start / bandRows;
+            T* v = bandValues.data() + band * cols;
+            flatIndex* idx = bandIndices.data() + band * cols;
+
+            std::copy(data + start * cols, data + (start + 1) * cols, v);
+            std::fill(idx, idx + cols, start);
+
+            for (flatIndex i = start + 1; i < end; ++i) {
+
+                const T* row = data + i * cols;
+
+                for (flatIndex j = 0; j < cols; ++j) {
+                    bool replace = better(row[j], v[j]);
+                    v[j] = replace ? row[j] : v[j];
+                    idx[j] = replace ? i : idx[j];
+                }
+            }
+        });
+
+        std::copy(bandValues.data(), bandValues.data() + cols, values);
+        std::copy(bandIndices.data(), bandIndices.data() + cols, indices);
+
+        for (flatIndex band = 1; band < nBands; ++band) {
+            for (flatIndex j = 0; j < cols; ++j) {
+                if (better(bandValues[band * cols + j], values[j])) {
+                    values[j] = bandValues[band * cols + j];
+                    indices[j] = bandIndices[band * cols + j];
+                }
+            }
+        }
+    }
+
+    else {
+        throw flatArrayUnknownAxis(axis);
+    }
+}
+
+#endif //PYML_FLATARRAYREDUCTIONS_H
@@ -0,0 +1,233 @@
+//
+// Created by Gil Ferreira Hoben on 19/10/26.
+//
+// Cache-oblivious matrix transposition.
+//
+// Walking the output of a transpose linearly reads the input a column at a time, so every element of a
+// large matrix comes from a different cache line. Instead the matrix is halved along its longest side
+// until the pieces fit in the cache whatever its size, and each piece is transposed as 4 by 4 tiles.
+// A tile is read a row at a time into a small local array and written out a row at a time, which the
+// compiler keeps in registers and turns into shuffles where it can. Large matrices are split into bands
+// of rows that are transposed by separate threads. Square matrices can be transposed in place by
+// swapping the blocks on either side of the diagonal.
+//
+
+#ifndef PYML_FLATARRAYTRANSPOSE_H
+#define PYML_FLATARRAYTRANSPOSE_H
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include "flatArrays.h"
+
+// side of the tiles transposed in registers. Wider tiles (8 by 8) spill out of the registers with the
+// default (SSE2) compiler flags and were slower for both float and double
+const flatIndex transposeTile = 4;
+
+// pieces with at most this many elements are transposed tile by tile (32 by 32 doubles, 8KB each way)
+const flatIndex transposeLeaf = 32 * 32;
+
+// matrices with at least this many elements are transposed by several threads
+const flatIndex transposeParallelSize = 1 << 21;
+
+
+// dst (cols by rows, consecutive rows dstStride apart) = transpose of src (rows by cols)
+template <class T>
+inline void transposeNaive(const T* src, flatIndex srcStride, T* dst, flatIndex dstStride,
+                           flatIndex rows, flatIndex cols) {
+
+    for (flatIndex i = 0; i < rows; ++i) {
+        for (flatIndex j = 0; j < cols; ++j) {
+            dst[j * dstStride + i] = src[i * srcStride + j];
+        }
+    }
+}
+
+
+// a single tile, its size is known at compile time so the loops are unrolled
+template <class T>
+inline void transposeTileKernel(const T* src, flatIndex srcStride, T* dst, flatIndex dstStride) {
+
+    T tile[transposeTile][transposeTile];
+
+    for (flatIndex i = 0; i < transposeTile; ++i) {
+        for (flatIndex j = 0; j < transposeTile; ++j) {
+            tile[j][i] = src[i * srcStride + j];
+        }
+    }
+
+    for (flatIndex i = 0; i < transposeTile; ++i) {
+        for (flatIndex j = 0; j < transposeTile; ++j) {
+            dst[i * dstStride + j] = tile[i][j];
+        }
+    }
+}
+
+
+template <class T>
+void transposeLeafBlock(const T* src, flatIndex srcStride, T* dst, flatIndex dstStride,
+                        flatIndex rows, flatIndex cols) {
+
+    flatIndex fullRows = rows - rows % transposeTile;
+    flatIndex fullCols = cols - cols % transposeTile;
+
+    for (flatIndex i = 0; i < fullRows; i += transposeTile) {
+        for (flatIndex j = 0; j < fullCols; j += transposeTile) {
+            transposeTileKernel(src + i * srcStride + j, srcStride, dst + j * dstStride + i, dstStride);
+        }
+    }
+
+    // the edges that don't make a whole tile
+    transposeNaive(src + fullCols, srcStride, dst + fullCols * dstStride, dstStride, rows, cols - fullCols);
+    transposeNaive(src + fullRows * srcStride, srcStride, dst + fullRows, dstStride, rows - fullRows, fullCols);
+}
+
+
+// halves a length, rounding the first half to whole tiles so that tiles aren't cut
+inline flatIndex transposeSplit(flatIndex length) {
+    flatIndex half = length / 2;
+    return half > transposeTile ? half - half % transposeTile : half;
+}
+
+
+template <class T>
+void transposeRecursive(const T* src, flatIndex srcStride, T* dst, flatIndex dstStride,
+                        flatIndex rows, flatIndex cols) {
+
+    if (rows * cols <= transposeLeaf || rows <= transposeTile || cols <= transposeTile) {
+        transposeLeafBlock(src, srcStride, dst, dstStride, rows, cols);
+    }
+
+    else if (rows >= cols) {
+        flatIndex half = transposeSplit(rows);
+        transposeRecursive(src, srcStride, dst, dstStride, half, cols);
+        transposeRecursive(src + half * srcStride, srcStride, dst + half, dstStride, rows - half, cols);
+    }
+
+    else {
+        flatIndex half = transposeSplit(cols);
+        transposeRecursive(src, srcStride, dst, dstStride, rows, half);
+        transposeRecursive(src + half, srcStride, dst + half * dstStride, dstStride, rows, cols - half);
+    }
+}
+
+
+// dst (cols by rows) = transpose of src (rows by cols), both contiguous and not overlapping
+template <class T>
+void transposeInto(const T* src, T* dst, flatIndex rows, flatIndex cols) {
+
+    unsigned int nThreads = std::thread::hardware_concurrency();
+
+    if (rows * cols < transposeParallelSize || nThreads < 2 || rows < 4 * transposeTile) {
+        transposeRecursive(src, cols, dst, rows, rows, cols);
+        return;
+    }
+
+    // each thread transposes a band of rows of src, i.e. a band of columns of dst. Bands are whole tiles,
+    // so threads don't write to the same cache lines of dst except where a band ends
+    flatIndex band = (rows + nThreads - 1) / nThreads;
+    band += (transposeTile - band % transposeTile) % transposeTile;
+
+    std::vector<std::thread> threads;
+
+    for (flatIndex start = band; start < rows; start += band) {
+        flatIndex length = std::min(band, rows - start);
+        threads.emplace_back(transposeRecursive<T>, src + start * cols, cols, dst + start, rows, length, cols);
+    }
+
+    transposeRecursive(src, cols, dst, rows, std::min(band, rows), cols);
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+
+// swaps a tile of a with the transpose of a tile of b
+template <class T>
+inline void transposeSwapTileKernel(T* a, T* b, flatIndex stride) {
+
+    T tileA[transposeTile][transposeTile];
+    T tileB[transposeTile][transposeTile];
+
+    for (flatIndex i = 0; i < transposeTile; ++i) {
+        for (flatIndex j = 0; j < transposeTile; ++j) {
+            tileA[j][i] = a[i * stride + j];
+            tileB[j][i] = b[i * stride + j];
+        }
+    }
+
+    for (flatIndex i = 0; i < transposeTile; ++i) {
+        for (flatIndex j = 0; j < transposeTile; ++j) {
+            a[i * stride + j] = tileB[i][j];
+            b[i * stride + j] = tileA[i][j];
+        }
+    }
+}
+
+
+template <class T>
+void transposeSwapLeafBlock(T* a, T* b, flatIndex stride, flatIndex rows, flatIndex cols) {
+
+    flatIndex fullRows = rows - rows % transposeTile;
+    flatIndex fullCols = cols - cols % transposeTile;
+
+    for (flatIndex i = 0; i < fullRows; i += transposeTile) {
+        for (flatIndex j = 0; j < fullCols; j += transposeTile) {
+            transposeSwapTileKernel(a + i * stride + j, b + j * stride + i, stride);
+        }
+    }
+
+    // the edges that don't make a whole tile
+    for (flatIndex i = 0; i < rows; ++i) {
+        for (flatIndex j = i < fullRows ? fullCols : 0; j < cols; ++j) {
+            std::swap(a[i * stride + j], b[j * stride + i]);
+        }
+    }
+}
+
+
+// swaps block a (rows by cols) with the transpose of block b (cols by rows)
+template <class T>
+void transposeSwap(T* a, T* b, flatIndex stride, flatIndex rows, flatIndex cols) {
+
+    if (rows * cols <= transposeLeaf || rows <= transposeTile || cols <= transposeTile) {
+        transposeSwapLeafBlock(a, b, stride, rows, cols);
+    }
+
+    else if (rows >= cols) {
+        flatIndex half = transposeSplit(rows);
+        transposeSwap(a, b, stride, half, cols);
+        transposeSwap(a + half * stride, b + half, stride, rows - half, cols);
+    }
+
+    else {
+        flatIndex half = transposeSplit(cols);
+        transposeSwap(a, b, stride, rows, half);
+        transposeSwap(a + half, b + half * stride, stride, rows, cols - half);
+    }
+}
+
+
+// transposes the n by n block starting at a in place
+template <class T>
+void transposeSquare(T* a, flatIndex stride, flatIndex n) {
+
+    if (n * n <= transposeLeaf) {
+        for (flatIndex i = 0; i < n; ++i) {
+            for (flatIndex j = i + 1; j < n; ++j) {
+                std::swap(a[i * stride + j], a[j * stride + i]);
+            }
+        }
+        return;
+    }
+
+    flatIndex half = transposeSplit(n);
+
+    // the diagonal blocks are transposed in place, and the off diagonal blocks swapped
+    transposeSquare(a, stride, half);
+    transposeSquare(a + half * stride + half, stride, n - half);
+    transposeSwap(a + half, a + half * stride, stride, half, n - half);
+}
+
+#endif //PYML_FLATARRAYTRANSPOSE_H
@@ -15,6 +15,9 @@
  */
 
 #include <Python.h>
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
 
 #ifndef PYML_FLATARRAYS_H
 #define PYML_FLATARRAYS_H
@@ -41,54 +44,156 @@ class flatArrayOutOfBoundsColumnException;
 class flatArrayZeroDivisionError;
 class flatArrayUnknownAxis;
 
+// type of flatArray sizes, indices and offsets. This is signed and pointer wide, so arrays can hold
+// more than 2^31 elements and loops that count down or take differences of indices are safe
+typedef std::ptrdiff_t flatIndex;
+
+#include "allocators.h"
+
+// type used to accumulate sums of T, single precision sums are accumulated in double precision
+template <class T>
+struct accumulator {
+    typedef T type;
+};
+
+template <>
+struct accumulator<float> {
+    typedef double type;
+};
+
+// Non-owning view of length elements that are stride elements apart, e.g. a row (stride 1)
+// or a column (stride cols) of a flatArray. Views are cheap to copy and never free the data,
+// so they must not outlive the array they look into. Indices are only checked in debug builds.
+template <class T>
+class flatArrayView {
+private:
+    T* data;
+    flatIndex length;
+    flatIndex stride;
+
+public:
+    flatArrayView(T* data, flatIndex length, flatIndex stride) : data(data), length(length), stride(stride) {}
+
+    T& operator[](flatIndex i) const {
+        assert(i >= 0 && i < length);
+        return data[i * stride];
+    }
+
+    flatIndex getSize() const {return length;}
+    flatIndex getStride() const {return stride;}
+
+    // first element, the view is contiguous if the stride is 1
+    T* getData() const {return data;}
+
+    // elements start to end - 1 of this view
+    flatArrayView<T> slice(flatIndex start, flatIndex end) const {
+        assert(start >= 0 && start <= end && end <= length);
+        return flatArrayView<T>(data + start * stride, end - start, stride);
+    }
+
+    // copies the view to the length elements of destination
+    void copyTo(T* destination) const {
+        for (flatIndex i = 0; i < length; ++i) {
+            destination[i] = data[i * stride];
+        }
+    }
+};
+
+// Non-owning view of a rows by cols block of a row major matrix, where consecutive rows are
+// leadingDimension elements apart (the number of columns of the whole matrix)
+template <class T>
+class flatArrayBlock {
+private:
+    T* data;
+    flatIndex rows;
+    flatIndex cols;
+    flatIndex leadingDimension;
+
+public:
+    flatArrayBlock(T* data, flatIndex rows, flatIndex cols, flatIndex leadingDimension) :
+            data(data), rows(rows), cols(cols), leadingDimension(leadingDimension) {}
+
+    T& operator()(flatIndex i, flatIndex j) const {
+        assert(i >= 0 && i < rows && j >= 0 && j < cols);
+        return data[i * leadingDimension + j];
+    }
+
+    flatIndex getRows() const {return rows;}
+    flatIndex getCols() const {return cols;}
+    flatIndex getLeadingDimension() const {return leadingDimension;}
+    T* getData() const {return data;}
+
+    flatArrayView<T> row(flatIndex i) const {
+        assert(i >= 0 && i < rows);
+        return flatArrayView<T>(data + i * leadingDimension, cols, 1);
+    }
+
+    flatArrayView<T> col(flatIndex j) const {
+        assert(j >= 0 && j < cols);
+        return flatArrayView<T>(data + j, rows, leadingDimension);
+    }
+
+    flatArrayBlock<T> block(flatIndex row, flatIndex col, flatIndex nRows, flatIndex nCols) const {
+        assert(row >= 0 && col >= 0 && row + nRows <= rows && col + nCols <= cols);
+        return flatArrayBlock<T>(data + row * leadingDimension + col, nRows, nCols, leadingDimension);
+    }
+};
+
 template <class T>
 class flatArray {
 private:
     T* array = nullptr;
-    int rows;
-    int cols;
-    int size;
+    flatIndex rows;
+    flatIndex cols;
+    flatIndex size;
+
+    // frees array with the policy that allocated it, nullptr if array belongs to someone else (see wrap)
+    void (*release)(T*, flatIndex) = nullptr;
+
+    // values and/or indices of the first elements that are better than all the others along axis
+    template <class Better>
+    void extremes(int axis, Better better, flatArray<T>* values, flatArray<flatIndex>* indices);
 
 public:
 
+    // tag of the constructor that borrows memory instead of copying it
+    struct borrowedTag {};
+
+    // rows by cols array with uninitialised storage from an allocation policy (see allocators.h)
+    template <class Allocator = alignedAllocator>
+    flatArray(flatIndex rows, flatIndex cols, Allocator /* policy */ = Allocator()) :
+            rows(rows), cols(cols), size(rows * cols) {
+        array = Allocator::template allocate<T>(size);
+        release = &Allocator::template deallocate<T>;
+    }
+
     // constructor
-    flatArray(T* const array, int rows, int cols) {
-        flatArray::rows = rows;
-        flatArray::cols = cols;
-        flatArray::size = rows * cols;
-        flatArray::array = new T [size];
+    flatArray(T* const array, flatIndex rows, flatIndex cols) : flatArray(rows, cols) {
 
         // creates a copy of input array and stores in flatArray::array
-        for (int i = 0; i < size; ++i) {
-            flatArray::array[i] = array[i];
-        }
+        std::copy(array, array + size, flatArray::array);
+    }
+
+    // flatArray that reads and writes memory it doesn't own, e.g. a memory mapped file (see mappedFile.h),
+    // a scratch arena (see scratchArena.h) or a buffer provided by the caller, instead of copying it.
+    // The memory is not freed by the destructor and must outlive the array
+    flatArray(T* const array, flatIndex rows, flatIndex cols, borrowedTag) :
+            array(array), rows(rows), cols(cols), size(rows * cols) {}
+
+    static flatArray<T>* wrap(T* const array, flatIndex rows, flatIndex cols) {
+        return new flatArray<T>(array, rows, cols, borrowedTag());
     }
 
     // destructor
     ~flatArray() {
-        delete [] array;
+        if (release != nullptr) {
+            release(array, size);
+        }
     }
 
-    // Copy constructor
-    flatArray(const flatArray& source) {
-
-        // because row, cols and size are not pointers, we can shallow copy
-        rows = source.rows;
-        cols = source.cols;
-        size = source.size;
-
-        // array is a pointer, so we need to deep copy it if it is non-null
-        // allocate memory for our copy
-        array = new T[size];
-
-        // do the copy
-        if (source.array != nullptr) {
-            for (int i=0; i < size; ++i)
-                array[i] = source.array[i];
-        }
-        else {
-            array = nullptr;
-        }
+    // Copy constructor, the copy always owns its (aligned) storage
+    flatArray(const flatArray& source) : flatArray(source.rows, source.cols) {
+        std::copy(source.array, source.array + size, array);
     }
 
     // overloading +, -, / and * operators
@@ -125,32 +230,32 @@ public:
 //    flatArray<T>* run();
 
     // simplifying element getters and setters with [] operator
-    T& operator[](int n) {return array[n];}
-    const T&operator[](int n) const { return array[n];}
+    T& operator[](flatIndex n) {return array[n];}
+    const T&operator[](flatIndex n) const { return array[n];}
 
     // GETTERS/SETTERS
     // column and row size
-    int getRows()const {return rows;}
-    int getCols()const {return cols;}
-    void setRows(int r) {rows = r;}
-    void setCols(int c) {cols = c;}
+    flatIndex getRows()const {return rows;}
+    flatIndex getCols()const {return cols;}
+    void setRows(flatIndex r) {rows = r;}
+    void setCols(flatIndex c) {cols = c;}
 
     // matrix size
-    int getSize()const {return size;};
+    flatIndex getSize()const {return size;};
 
     // get array
     T * getArray()const {return array;};
 
     // get array element by row and column
-    T getElement(int row, int col) {return array[row * cols + col];}
-    void setElement(T value, int row, int col) {array[row * cols + col] = value;}
+    T getElement(flatIndex row, flatIndex col) {return array[row * cols + col];}
+    void setElement(T value, flatIndex row, flatIndex col) {array[row * cols + col] = value;}
 
     // set array element by element position inD array
-    T getNElement(int n)const {return array[n];}
-    void setNElement(T value, int n)const { array[n] = value;}
+    T getNElement(flatIndex n)const {return array[n];}
+    void setNElement(T value, flatIndex n)const { array[n] = value;}
 
     // row and column
-    T * getRow(int i)const {
+    T * getRow(flatIndex i)const {
 
         if (i > rows) {
             throw flatArrayOutOfBoundsRowException<T>(*this, i);
@@ -159,9 +264,9 @@ public:
         T *row = nullptr;
 
         row = new T [cols];
-        int n = 0;
+        flatIndex n = 0;
 
-        for (int j = i * cols; j < (i + 1) * cols; ++j) {
+        for (flatIndex j = i * cols; j < (i + 1) * cols; ++j) {
             row[n] = array[j];
             n++;
         }
@@ -169,7 +274,7 @@ public:
         return row;
     }
 
-    T* getCol(int j){
+    T* getCol(flatIndex j){
 
         if (j > cols) {
             throw flatArrayOutOfBoundsColumnException<T>(*this, j);
@@ -178,9 +283,9 @@ public:
         T *column = nullptr;
 
         column = new T [rows];
-        int n = 0;
+        flatIndex n = 0;
 
-        for (int i = j; i < size; i+=cols) {
+        for (flatIndex i = j; i < size; i+=cols) {
             column[n] = array[i];
             n++;
         }
@@ -188,39 +293,58 @@ public:
         return column;
     }
 
-    void setRow(const T *row, int i) {
+    void setRow(const T *row, flatIndex i) {
 
         if (i > rows) {
             throw flatArrayOutOfBoundsRowException<T>(*this, i);
         }
 
-        int n = 0;
+        flatIndex n = 0;
 
-        for (int j = i * cols; j < (i + 1) * cols; ++j) {
+        for (flatIndex j = i * cols; j < (i + 1) * cols; ++j) {
             array[j] = row[n];
             n++;
         }
     }
 
-    void setCol(const T *column, int j) {
+    void setCol(const T *column, flatIndex j) {
 
         if (j > cols) {
             throw flatArrayOutOfBoundsColumnException<T>(*this, j);
         }
 
-        int n = 0;
-        for (int k = j; k < size; k+=cols) {
+        flatIndex n = 0;
+        for (flatIndex k = j; k < size; k+=cols) {
             array[k] = column[n];
             n++;
         }
     }
 
     // row and column slices
-    T *getRowSlice(int i, int start, int end);
-    T *getColSlice(int j, int start, int end);
+    T *getRowSlice(flatIndex i, flatIndex start, flatIndex end);
+    T *getColSlice(flatIndex j, flatIndex start, flatIndex end);
+
+    // views of rows, columns, slices and blocks, which read and write this array without copying
+    flatArrayView<T> viewRow(flatIndex i) const {
+        assert(i >= 0 && i < rows);
+        return flatArrayView<T>(array + i * cols, cols, 1);
+    }
+
+    flatArrayView<T> viewCol(flatIndex j) const {
+        assert(j >= 0 && j < cols);
+        return flatArrayView<T>(array + j, rows, cols);
+    }
+
+    flatArrayView<T> viewRowSlice(flatIndex i, flatIndex start, flatIndex end) const {return viewRow(i).slice(start, end);}
+    flatArrayView<T> viewColSlice(flatIndex j, flatIndex start, flatIndex end) const {return viewCol(j).slice(start, end);}
+
+    flatArrayBlock<T> viewBlock(flatIndex row, flatIndex col, flatIndex nRows, flatIndex nCols) const {
+        return flatArrayBlock<T>(array, rows, cols, cols).block(row, col, nRows, nCols);
+    }
 
     // MATRIX MANIPULATION/LINEAR ALGEBRA
-    flatArray<T>* transpose();
+    // replace=1 transposes the array itself (in place for square matrices and vectors)
+    flatArray<T>* transpose(int replace=0);
     T sum();
     flatArray<T>* dot(const flatArray& other);
 
@@ -239,9 +363,15 @@ public:
     flatArray<T>* power(double p, int replace=0);
 
     flatArray<T>* nlog(double base, int replace=0);
+    // reductions along axis 0, 1 or -1 (all the elements), vectors are always reduced as a whole
+    flatArray<T>* sum(int axis);
     flatArray<T>* mean(int axis);
     flatArray<T>* std(int degreesOfFreedom, int axis);
     flatArray<T>* var(int degreesOfFreedom, int axis);
+    flatArray<T>* min(int axis);
+    flatArray<T>* max(int axis);
+    flatArray<flatIndex>* argmin(int axis);
+    flatArray<flatIndex>* argmax(int axis);
     T* diagonal();
     double det();
     flatArray<T>& invertSign(int replace=0);
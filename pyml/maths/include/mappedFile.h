@@ -0,0 +1,91 @@
+//
+// Created by Gil Ferreira Hoben on 19/10/26.
+//
+
+#ifndef PYML_MAPPEDFILE_H
+#define PYML_MAPPEDFILE_H
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "flatArrays.h"
+#include "exceptionClasses.h"
+
+// Memory mapped binary file, used as the backing store of flatArrays that are too large to be read
+// into a Python list (or into memory at all). Pages are loaded by the OS as the kernels read them.
+// The mapping is private and writable, so in place operations work but are never written to the file.
+class mappedFile {
+private:
+    void* data = MAP_FAILED;
+    std::size_t length = 0;
+
+public:
+    explicit mappedFile(const char* path) {
+
+        int fd = open(path, O_RDONLY);
+
+        if (fd < 0) {
+            throw mappedFileException(path, strerror(errno));
+        }
+
+        struct stat info;
+
+        if (fstat(fd, &info) != 0 || info.st_size == 0) {
+            int error = errno;
+            close(fd);
+            throw mappedFileException(path, info.st_size == 0 ? "empty file" : strerror(error));
+        }
+
+        length = static_cast<std::size_t>(info.st_size);
+        // no swap is reserved for the (copy on write) pages, most of which are only ever read
+        data = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_NORESERVE, fd, 0);
+
+        // the mapping keeps its own reference to the file
+        int error = errno;
+        close(fd);
+
+        if (data == MAP_FAILED) {
+            throw mappedFileException(path, strerror(error));
+        }
+
+        // the kernels mostly stream through arrays, so ask for aggressive read ahead
+        madvise(data, length, MADV_SEQUENTIAL);
+    }
+
+    ~mappedFile() {
+        if (data != MAP_FAILED) {
+            munmap(data, length);
+        }
+    }
+
+    mappedFile(const mappedFile&) = delete;
+    mappedFile& operator=(const mappedFile&) = delete;
+
+    // size of the file in bytes
+    std::size_t getLength() const {return length;}
+
+    // rows by cols array of T stored row major offset bytes into the file. The array doesn't own
+    // its memory (see flatArray::wrap) and must be deleted before the mapping.
+    template <typename T>
+    flatArray<T>* array(flatIndex rows, flatIndex cols, flatIndex offset=0) const {
+
+        auto available = static_cast<flatIndex>(length / sizeof(T));
+
+        if (rows <= 0 || cols <= 0 || offset < 0 || offset % static_cast<flatIndex>(sizeof(T)) != 0) {
+            throw arrayOutOfBoundsException(available, offset / static_cast<flatIndex>(sizeof(T)));
+        }
+
+        flatIndex first = offset / static_cast<flatIndex>(sizeof(T));
+
+        if (rows > (available - first) / cols) {
+            throw arrayOutOfBoundsException(available, first + rows * cols);
+        }
+
+        return flatArray<T>::wrap(reinterpret_cast<T*>(static_cast<char*>(data) + offset), rows, cols);
+    }
+};
+
+#endif //PYML_MAPPEDFILE_H
@@ -5,13 +5,18 @@
 #ifndef MATHS_MATHS_H
 #define MATHS_MATHS_H
 
+#include <cstddef>
+
 template <typename T>
 inline T MIN(T a, T b);
 
 template <typename T>
 inline T MAX(T a, T b);
 
-inline void shuffle(int* rNums, int size);
+inline void shuffle(std::ptrdiff_t* rNums, std::ptrdiff_t size);
+
+template <typename Generator>
+inline void shuffle(std::ptrdiff_t* rNums, std::ptrdiff_t size, Generator& generator);
 
 template <typename T>
 inline void swap(T& a, T& b);
@@ -21,7 +26,4 @@ void permutations(double* array, double** result, int size);
 template <typename T>
 void quicksort(T* array, int* order, int low, int high);
 
-int argmax(const double *array, int size);
-int argmin(const double *array, int size);
-
 #endif //MATHS_MATHS_H
@@ -6,10 +6,61 @@
 #ifndef PYML_GRADIENTDESCENT_H
 #define PYML_GRADIENTDESCENT_H
 
-template <typename T>
-int gradientDescent(flatArray<T> &X, flatArray<T> &y, flatArray<T> *theta, int maxIteration, T epsilon,
+#include <vector>
+
+class learningRateSchedule;
+
+// X (and XVal) is a flatArray<T> or a csrArray<T>
+template <typename T, class M>
+int gradientDescent(M &X, flatArray<T> &y, flatArray<T> *theta, int maxIteration, T epsilon,
                     T learningRate, T alpha, flatArray<T>* costArray, char predType[10], int batchSize,
-                    int seed, char method[10], T fudgeFactor);
+                    int seed, char method[10], T fudgeFactor, double beta2, double weightDecay,
+                    int historySize, char monitor[10], int monitorFrequency, int monitorSamples,
+                    int physicalShuffle, M* XVal, flatArray<T>* yVal, int patience,
+                    double minImprovement, const learningRateSchedule& schedule, int fitIntercept);
+
+template <typename T>
+void oneVsRest(flatArray<T>& X, const int* labels, std::vector<flatArray<T>*>& thetas,
+               std::vector<flatArray<T>*>& costArrays, int* iterations, int maxIteration, T epsilon,
+               T learningRate, T alpha, int batchSize, int seed, char method[10], T fudgeFactor, double beta2,
+               double weightDecay, int historySize, char monitor[10], int monitorFrequency, int monitorSamples,
+               int physicalShuffle, flatArray<T>* XVal, const int* labelsVal, int patience, double minImprovement,
+               const learningRateSchedule& schedule, int nThreads, int fitIntercept);
+
+template <typename T>
+class optimiserState;
+
+template <typename T>
+void partialFit(flatArray<T>& X, flatArray<T>& y, optimiserState<T>& state, flatArray<T>* costArray, int epochs,
+                double learningRate, double alpha, char predType[10], char method[10], T fudgeFactor,
+                double beta2, double weightDecay, int batchSize, const learningRateSchedule& schedule,
+                int fitIntercept);
+
+template <typename T, class M>
+int hogwild(M& X, flatArray<T>& y, flatArray<T>* theta, flatArray<T>* costArray, int maxIteration,
+            double epsilon, double learningRate, char predType[10], int seed, int nWorkers, double& throughput,
+            int fitIntercept);
+
+template <typename T>
+int newtonMethod(flatArray<T>& X, flatArray<T>& y, flatArray<T>* theta, flatArray<T>* costArray, double epsilon,
+                 int maxIteration, int cgThreshold, int fitIntercept);
+
+template <typename T>
+int elasticNet(flatArray<T>& X, flatArray<T>& y, flatArray<T>* theta, flatArray<T>* costArray, double lambda,
+               double l1Ratio, double epsilon, int maxIteration, int intercept, int covariance, int fitIntercept);
+
+template <typename T>
+void elasticNetPath(flatArray<T>& X, flatArray<T>& y, double* lambdas, int nLambdas, double lambdaRatio,
+                    flatArray<T>* thetas, T* costs, int* iterations, double l1Ratio, double epsilon,
+                    int maxIteration, int intercept, int covariance, int fitIntercept);
+
+template <typename T>
+int softmaxGradientDescent(flatArray<T>& X, const int* labels, flatArray<T>* Theta, flatArray<T>* costArray,
+                           int maxIteration, double epsilon, double learningRate, double gamma, char method[10],
+                           T fudgeFactor, double beta2, double weightDecay, int fitIntercept);
+
+template <typename T, class M>
+void linearPredict(M& X, flatArray<T>& coefficients, int bias, char link[10], T* result, int nThreads);
 
 
 #endif //PYML_GRADIENTDESCENT_H
@@ -8,25 +8,28 @@
 #include <Python.h>
 #include <iostream>
 #include <typeinfo>
+#include <type_traits>
+#include <vector>
 #include "flatArrays.h"
+#include "csrArrays.h"
 #include "arrayInitialisers.h"
 
 
 template <typename T>
-inline PyObject* Convert_1DArray(T* array, int size) {
+inline PyObject* Convert_1DArray(T* array, flatIndex size) {
 
     // converts a C++ 1D array to a python list
 
     PyObject *pylist = nullptr;
     PyObject *item = nullptr;
-    int i;
+    flatIndex i;
 
     pylist = PyList_New(size);
 
     if (pylist != nullptr) {
 
         for (i=0; i < size; i++) {
-            if (typeid(T) == typeid(double)) {
+            if (std::is_floating_point<T>::value) {
                 item = PyFloat_FromDouble(array[i]);
             }
             else if (typeid(T) == typeid(int)) {
@@ -42,13 +45,13 @@ inline PyObject* Convert_1DArray(T* array, int size) {
 }
 
 
-inline PyObject* Convert_1DArrayInt(long* array, int size) {
+inline PyObject* Convert_1DArrayInt(long* array, flatIndex size) {
 
     // converts a C++ 1D array to a python list
 
     PyObject *pylist;
     PyObject *item;
-    int i;
+    flatIndex i;
 
     pylist = PyList_New(size);
 
@@ -65,7 +68,7 @@ inline PyObject* Convert_1DArrayInt(long* array, int size) {
 }
 
 
-inline PyObject* Convert_2DArray(double** array, int rows, int cols) {
+inline PyObject* Convert_2DArray(double** array, flatIndex rows, flatIndex cols) {
 
     // converts a C++ 2D array to a python list
 
@@ -77,12 +80,12 @@ inline PyObject* Convert_2DArray(double** array, int rows, int cols) {
 
     if (twoDResult != nullptr) {
 
-        for (int j = 0; j < rows; ++j) {
+        for (flatIndex j = 0; j < rows; ++j) {
             row = PyList_New(cols);
 
             if (row != nullptr) {
 
-                for (int k = 0; k < cols; ++k) {
+                for (flatIndex k = 0; k < cols; ++k) {
                     item = PyFloat_FromDouble(array[j][k]);
                     PyList_SET_ITEM(row, k, item);
                 }
@@ -109,7 +112,7 @@ inline PyObject* ConvertFlatArray_PyList(flatArray<T> *array, const char pyType[
     PyObject* item;
 
     // internal representation of the array
-    int n = 0;
+    flatIndex n = 0;
 
     if (array->getRows() > 1) {
         // if it's a matrix create list that will have N lists
@@ -125,14 +128,14 @@ inline PyObject* ConvertFlatArray_PyList(flatArray<T> *array, const char pyType[
 
             if (strcmp(pyType, "int") == 0) {
 
-                for (int j = 0; j < array->getRows(); ++j) {
+                for (flatIndex j = 0; j < array->getRows(); ++j) {
 
                     // if it's a matrix (instead of a vector) return a list of lists
                     row = PyList_New(array->getCols());
 
                     if (row != nullptr) {
 
-                        for (int k = 0; k < array->getCols(); ++k) {
+                        for (flatIndex k = 0; k < array->getCols(); ++k) {
                             item = PyLong_FromDouble(array->getNElement(n));
                             PyList_SET_ITEM(row, k, item);
                             n++;
@@ -144,13 +147,13 @@ inline PyObject* ConvertFlatArray_PyList(flatArray<T> *array, const char pyType[
             }
 
             else {
-                for (int j = 0; j < array->getRows(); ++j) {
+                for (flatIndex j = 0; j < array->getRows(); ++j) {
                     // if it's a matrix (instead of a vector) return a list of lists
                     row = PyList_New(array->getCols());
 
                     if (row != nullptr) {
 
-                        for (int k = 0; k < array->getCols(); ++k) {
+                        for (flatIndex k = 0; k < array->getCols(); ++k) {
                             item = PyFloat_FromDouble(array->getNElement(n));
                             PyList_SET_ITEM(row, k, item);
                             n++;
@@ -165,14 +168,14 @@ inline PyObject* ConvertFlatArray_PyList(flatArray<T> *array, const char pyType[
         else {
 
             if (strcmp(pyType, "int") == 0) {
-                for (int k = 0; k < array->getCols(); ++k) {
+                for (flatIndex k = 0; k < array->getCols(); ++k) {
                     item = PyLong_FromDouble(array->getNElement(k));
                     PyList_SET_ITEM(result, k, item);
                 }
             }
 
             else {
-                for (int k = 0; k < array->getCols(); ++k) {
+                for (flatIndex k = 0; k < array->getCols(); ++k) {
                     item = PyFloat_FromDouble(array->getNElement(k));
                     PyList_SET_ITEM(result, k, item);
                 }
@@ -185,17 +188,17 @@ inline PyObject* ConvertFlatArray_PyList(flatArray<T> *array, const char pyType[
 
 
 template<typename T>
-inline T* convertPy_1DArray(PyObject *array, int size) {
+inline T* convertPy_1DArray(PyObject *array, flatIndex size) {
     // converts a python list to a C++ 1D array
     T* result;
 
     result = new T[size];
 
     // iterate through python list and populate C++ array
-    for (int i = 0; i < size; ++i) {
+    for (flatIndex i = 0; i < size; ++i) {
 
-        if (typeid(T) == typeid(double)) {
-            result[i] = PyFloat_AsDouble(PyList_GET_ITEM(array, i));
+        if (std::is_floating_point<T>::value) {
+            result[i] = static_cast<T>(PyFloat_AsDouble(PyList_GET_ITEM(array, i)));
         }
 
         else if (typeid(T) == typeid(int)) {
@@ -207,7 +210,8 @@ inline T* convertPy_1DArray(PyObject *array, int size) {
 }
 
 
-inline void convertPy_2DArray(PyObject* array, double** result, int rows, int cols) {
+template <typename T>
+inline void convertPy_2DArray(PyObject* array, T** result, flatIndex rows, flatIndex cols) {
 
     // converts a python list to a C++ 2D array
 
@@ -216,7 +220,7 @@ inline void convertPy_2DArray(PyObject* array, double** result, int rows, int co
     PyObject* row;
 
     // iterate through python list and populate C++ array
-    for (int i = 0; i < rows; ++i) {
+    for (flatIndex i = 0; i < rows; ++i) {
 
         row = PyList_GET_ITEM(array, i);
 
@@ -224,14 +228,14 @@ inline void convertPy_2DArray(PyObject* array, double** result, int rows, int co
             std::string error1 = "Size of row ";
             std::string error2 = " is ";
             std::string error3 = " but expected row of size ";
-            int length = PyList_GET_SIZE(row);
+            flatIndex length = PyList_GET_SIZE(row);
             std::string resultE;
             resultE = error1 + std::to_string(i) + error2 + std::to_string(length) + error3 + std::to_string(cols);
             PyErr_SetString(PyExc_ValueError, resultE.c_str());
         }
 
-        for (int j = 0; j < cols; ++j) {
-            result[i][j] = PyFloat_AsDouble(PyList_GET_ITEM(row, j));
+        for (flatIndex j = 0; j < cols; ++j) {
+            result[i][j] = static_cast<T>(PyFloat_AsDouble(PyList_GET_ITEM(row, j)));
         }
 
     }
@@ -239,7 +243,7 @@ inline void convertPy_2DArray(PyObject* array, double** result, int rows, int co
 
 
 template <typename T>
-flatArray<T>* convertPy_flatArray(PyObject *array, int rows, int cols) {
+flatArray<T>* convertPy_flatArray(PyObject *array, flatIndex rows, flatIndex cols) {
 
     // converts a python list/list of lists to a C++ 1D array representation of a 1D/2D array
 
@@ -250,12 +254,13 @@ flatArray<T>* convertPy_flatArray(PyObject *array, int rows, int cols) {
 
     PyObject* row;
     // n is the position in the flat matrix
-    int n = 0;
+    flatIndex n = 0;
 
     // iterate through python list and populate C++ array
-    for (int i = 0; i < rows; ++i) {
+    for (flatIndex i = 0; i < rows; ++i) {
 
-        if (rows > 1) {
+        // a matrix with a single row is still a list of lists
+        if (PyList_Check(PyList_GET_ITEM(array, 0))) {
             row = PyList_GET_ITEM(array, i);
         }
         else {
@@ -266,14 +271,14 @@ flatArray<T>* convertPy_flatArray(PyObject *array, int rows, int cols) {
             std::string error1 = "Size of row ";
             std::string error2 = " is ";
             std::string error3 = " but expected row of size ";
-            auto length = static_cast<int>(PyList_GET_SIZE(row));
+            auto length = static_cast<flatIndex>(PyList_GET_SIZE(row));
             std::string resultE;
             resultE = error1 + std::to_string(i) + error2 + std::to_string(length) + error3 + std::to_string(result->getCols());
             PyErr_SetString(PyExc_ValueError, resultE.c_str());
         }
 
-        for (int j = 0; j < cols; ++j) {
-            result->setNElement(PyFloat_AsDouble(PyList_GET_ITEM(row, j)), n);
+        for (flatIndex j = 0; j < cols; ++j) {
+            result->setNElement(static_cast<T>(PyFloat_AsDouble(PyList_GET_ITEM(row, j))), n);
             n++;
         }
     }
@@ -281,4 +286,156 @@ flatArray<T>* convertPy_flatArray(PyObject *array, int rows, int cols) {
     return result;
 }
 
+template <typename S, typename V>
+inline void copyBuffer(const void* buffer, flatIndex size, std::vector<V>& values) {
+
+    const S* source = static_cast<const S*>(buffer);
+
+    values.resize(static_cast<std::size_t>(size));
+
+    for (flatIndex i = 0; i < size; ++i) {
+        values[i] = static_cast<V>(source[i]);
+    }
+}
+
+
+template <typename V>
+inline bool convertPy_vector(PyObject* sequence, std::vector<V>& values) {
+
+    // copies a sequence of numbers to values, through the buffer protocol if the sequence supports it
+    // (e.g. array.array or numpy arrays), which avoids creating a Python object per element, and item by
+    // item otherwise (e.g. lists). Sets a Python error and returns false if it can't be read
+
+    if (PyObject_CheckBuffer(sequence)) {
+
+        Py_buffer view;
+
+        if (PyObject_GetBuffer(sequence, &view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0) {
+            return false;
+        }
+
+        // native byte order and alignment only
+        const char* format = view.format == nullptr ? "B" : view.format;
+
+        if (format[0] == '@') {
+            format++;
+        }
+
+        auto size = static_cast<flatIndex>(view.len / view.itemsize);
+        bool known = view.ndim <= 1 && format[0] != '\0' && format[1] == '\0';
+
+        if (known) {
+            switch (format[0]) {
+                case 'd': copyBuffer<double>(view.buf, size, values); break;
+                case 'f': copyBuffer<float>(view.buf, size, values); break;
+                case 'q': copyBuffer<long long>(view.buf, size, values); break;
+                case 'Q': copyBuffer<unsigned long long>(view.buf, size, values); break;
+                case 'l': copyBuffer<long>(view.buf, size, values); break;
+                case 'L': copyBuffer<unsigned long>(view.buf, size, values); break;
+                case 'i': copyBuffer<int>(view.buf, size, values); break;
+                case 'I': copyBuffer<unsigned int>(view.buf, size, values); break;
+                case 'n': copyBuffer<Py_ssize_t>(view.buf, size, values); break;
+                default: known = false;
+            }
+        }
+
+        PyBuffer_Release(&view);
+
+        if (!known) {
+            PyErr_SetString(PyExc_TypeError, "Expected a one dimensional buffer of floats or integers!");
+        }
+
+        return known;
+    }
+
+    PyObject* items = PySequence_Fast(sequence, "Expected a sequence of numbers!");
+
+    if (items == nullptr) {
+        return false;
+    }
+
+    auto size = static_cast<flatIndex>(PySequence_Fast_GET_SIZE(items));
+    PyObject** item = PySequence_Fast_ITEMS(items);
+
+    values.resize(static_cast<std::size_t>(size));
+
+    for (flatIndex i = 0; i < size; ++i) {
+        if (std::is_floating_point<V>::value) {
+            values[i] = static_cast<V>(PyFloat_AsDouble(item[i]));
+        }
+        else {
+            values[i] = static_cast<V>(PyLong_AsSsize_t(item[i]));
+        }
+    }
+
+    Py_DECREF(items);
+
+    return PyErr_Occurred() == nullptr;
+}
+
+
+inline bool isSparse(PyObject* matrix) {
+
+    // CSR matrices are passed as objects with data, indices, indptr and shape attributes
+    // (pyml.maths.CSRMatrix or scipy.sparse.csr_matrix) instead of lists
+    return !PyList_Check(matrix) && PyObject_HasAttrString(matrix, "indptr");
+}
+
+
+template <typename T>
+inline bool readAttribute(PyObject* matrix, const char* name, std::vector<T>& values) {
+
+    PyObject* attribute = PyObject_GetAttrString(matrix, name);
+
+    if (attribute == nullptr) {
+        return false;
+    }
+
+    bool read = convertPy_vector(attribute, values);
+
+    Py_DECREF(attribute);
+
+    return read;
+}
+
+
+template <typename T>
+csrArray<T>* convertPy_csrArray(PyObject* matrix) {
+
+    // converts a CSR matrix (see isSparse) to a csrArray, returns a nullptr with a Python error set
+    // if it isn't a valid CSR matrix
+
+    Py_ssize_t rows, cols;
+    std::vector<flatIndex> indptr, indices;
+    std::vector<T> data;
+
+    PyObject* shape = PyObject_GetAttrString(matrix, "shape");
+
+    if (shape == nullptr) {
+        return nullptr;
+    }
+
+    if (!PyArg_ParseTuple(shape, "nn", &rows, &cols)) {
+        Py_DECREF(shape);
+        PyErr_SetString(PyExc_TypeError, "The shape of a CSR matrix should be a tuple (rows, columns)!");
+        return nullptr;
+    }
+
+    Py_DECREF(shape);
+
+    if (!readAttribute(matrix, "indptr", indptr) || !readAttribute(matrix, "indices", indices) ||
+        !readAttribute(matrix, "data", data)) {
+        return nullptr;
+    }
+
+    try {
+        return new csrArray<T>(rows, cols, std::move(indptr), std::move(indices), std::move(data));
+    }
+    catch (csrArrayException &e) {
+        PyErr_SetString(PyExc_ValueError, e.what());
+        return nullptr;
+    }
+}
+
+
 #endif
@@ -0,0 +1,228 @@
+//
+// Created by Gil Ferreira Hoben on 19/10/26.
+//
+// Running moments of the columns (features) of data that arrives in chunks of rows, e.g. read from a
+// file a block at a time. Only the count, the mean and the sums of squared deviations (M2, and the
+// co-moments if the covariance is wanted) are kept, so any number of rows is summarised in a single pass.
+//
+// Rows are added with Welford's update, which takes deviations from the running mean and doesn't suffer
+// the cancellation of sum(x ** 2) - n * mean ** 2. Accumulators are merged with the parallel formula of
+// Chan et al.:
+//
+//      n = na + nb        delta = mean_b - mean_a
+//      mean = mean_a + delta * nb / n
+//      M2 = M2_a + M2_b + delta ** 2 * na * nb / n
+//
+// so chunks, threads or whole machines can summarise their rows separately. Large chunks are split into
+// bands of momentsBandRows rows, which are summarised (in parallel) and merged in order, so the result
+// doesn't depend on the number of threads.
+//
+
+#ifndef PYML_RUNNINGMOMENTS_H
+#define PYML_RUNNINGMOMENTS_H
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+#include "flatArrays.h"
+#include "exceptionClasses.h"
+#include "flatArrayReductions.h"
+
+// rows of a chunk summarised before being merged into the running moments
+const flatIndex momentsBandRows = 1024;
+
+// bands summarised at the same time, which bounds the memory of large chunks with co-moments
+const flatIndex momentsBandsPerWave = 8;
+
+class runningMoments {
+private:
+    flatIndex cols;
+    bool withCovariance;
+
+    flatIndex count = 0;
+    std::vector<double> mean;
+    std::vector<double> M2;
+
+    // cols by cols co-moments sum((x_j - mean_j) * (x_k - mean_k)), only if withCovariance
+    std::vector<double> C;
+
+    // Welford's update with the rows of a band
+    template <class T>
+    void addRows(const T* data, flatIndex rows) {
+
+        std::vector<double> delta(cols);
+
+        for (flatIndex i = 0; i < rows; ++i) {
+
+            const T* x = data + i * cols;
+
+            count++;
+            double inverse = 1.0 / count;
+
+            for (flatIndex j = 0; j < cols; ++j) {
+                delta[j] = x[j] - mean[j];
+                mean[j] += delta[j] * inverse;
+                M2[j] += delta[j] * (x[j] - mean[j]);
+            }
+
+            if (withCovariance) {
+                for (flatIndex j = 0; j < cols; ++j) {
+
+                    double* Cj = C.data() + j * cols;
+
+                    for (flatIndex k = 0; k < cols; ++k) {
+                        Cj[k] += delta[j] * (x[k] - mean[k]);
+                    }
+                }
+            }
+        }
+    }
+
+public:
+    explicit runningMoments(flatIndex cols, bool withCovariance=false) :
+            cols(cols), withCovariance(withCovariance), mean(cols), M2(cols),
+            C(withCovariance ? cols * cols : 0) {}
+
+    flatIndex getCols() const {return cols;}
+    flatIndex getCount() const {return count;}
+    bool hasCovariance() const {return withCovariance;}
+
+    // adds the rows of a rows by cols chunk
+    template <class T>
+    void update(const T* data, flatIndex rows) {
+
+        if (rows <= momentsBandRows) {
+            runningMoments band(cols, withCovariance);
+            band.addRows(data, rows);
+            merge(band);
+            return;
+        }
+
+        flatIndex nBands = (rows + momentsBandRows - 1) / momentsBandRows;
+        bool parallel = rows * cols >= reductionParallelSize && std::thread::hardware_concurrency() > 1;
+
+        for (flatIndex wave = 0; wave < nBands; wave += momentsBandsPerWave) {
+
+            flatIndex waveBands = std::min(momentsBandsPerWave, nBands - wave);
+            std::vector<runningMoments> bands(waveBands, runningMoments(cols, withCovariance));
+
+            auto summarise = [&](flatIndex b) {
+                flatIndex start = (wave + b) * momentsBandRows;
+                bands[b].addRows(data + start * cols, std::min(momentsBandRows, rows - start));
+            };
+
+            if (parallel) {
+                std::vector<std::thread> threads;
+
+                for (flatIndex b = 1; b < waveBands; ++b) {
+                    threads.emplace_back(summarise, b);
+                }
+
+                summarise(0);
+
+                for (auto& thread : threads) {
+                    thread.join();
+                }
+            }
+
+            else {
+                for (flatIndex b = 0; b < waveBands; ++b) {
+                    summarise(b);
+                }
+            }
+
+            for (auto& band : bands) {
+                merge(band);
+            }
+        }
+    }
+
+    // adds the rows summarised by other (Chan et al.)
+    void merge(const runningMoments& other) {
+
+        if (other.cols != cols || other.withCovariance != withCovariance) {
+            throw flatArrayDimensionMismatchException<double>(1, cols, 1, other.cols);
+        }
+
+        if (other.count == 0) {
+            return;
+        }
+
+        if (count == 0) {
+            count = other.count;
+            mean = other.mean;
+            M2 = other.M2;
+            C = other.C;
+            return;
+        }
+
+        double na = count;
+        double nb = other.count;
+        double n = na + nb;
+        double weight = na * nb / n;
+
+        std::vector<double> delta(cols);
+
+        for (flatIndex j = 0; j < cols; ++j) {
+            delta[j] = other.mean[j] - mean[j];
+            mean[j] += delta[j] * nb / n;
+            M2[j] += other.M2[j] + delta[j] * delta[j] * weight;
+        }
+
+        if (withCovariance) {
+            for (flatIndex j = 0; j < cols; ++j) {
+                for (flatIndex k = 0; k < cols; ++k) {
+                    C[j * cols + k] += other.C[j * cols + k] + delta[j] * delta[k] * weight;
+                }
+            }
+        }
+
+        count += other.count;
+    }
+
+    // RESULTS, each is 1 by cols (cols by cols for the covariance)
+    flatArray<double>* getMean() const {
+        return new flatArray<double>(const_cast<double*>(mean.data()), 1, cols);
+    }
+
+    flatArray<double>* getVariance(int degreesOfFreedom=0) const {
+
+        flatArray<double>* result = new flatArray<double>(1, cols);
+
+        for (flatIndex j = 0; j < cols; ++j) {
+            (*result)[j] = M2[j] / (count - degreesOfFreedom);
+        }
+
+        return result;
+    }
+
+    flatArray<double>* getStd(int degreesOfFreedom=0) const {
+
+        flatArray<double>* result = getVariance(degreesOfFreedom);
+
+        for (flatIndex j = 0; j < cols; ++j) {
+            (*result)[j] = sqrt((*result)[j]);
+        }
+
+        return result;
+    }
+
+    // nullptr unless the accumulator was created with withCovariance
+    flatArray<double>* getCovariance(int degreesOfFreedom=0) const {
+
+        if (!withCovariance) {
+            return nullptr;
+        }
+
+        flatArray<double>* result = new flatArray<double>(cols, cols);
+
+        for (flatIndex i = 0; i < cols * cols; ++i) {
+            (*result)[i] = C[i] / (count - degreesOfFreedom);
+        }
+
+        return result;
+    }
+};
+
+#endif //PYML_RUNNINGMOMENTS_H
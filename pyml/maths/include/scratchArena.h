@@ -0,0 +1,166 @@
+//
+// Created by Gil Ferreira Hoben on 19/10/26.
+//
+// Scratch arena for the temporaries of iterative algorithms. Each call of an algorithm owns an arena,
+// draws its same sized temporaries from it and resets it at iteration boundaries, so after the first
+// iteration no memory is requested from the heap and parallel fits don't contend for the allocator.
+//
+
+#ifndef PYML_SCRATCHARENA_H
+#define PYML_SCRATCHARENA_H
+
+#include <Python.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include "flatArrays.h"
+
+// counters of all the arenas of a module, updated when an arena is destroyed
+struct scratchStatistics {
+    std::atomic<long> arenas;
+    std::atomic<long> allocations;
+    std::atomic<long> mallocs;
+    std::atomic<std::size_t> peakBytes;
+};
+
+inline scratchStatistics& globalScratchStatistics() {
+    static scratchStatistics statistics = {{0}, {0}, {0}, {0}};
+    return statistics;
+}
+
+class scratchArena {
+private:
+    static const std::size_t alignment = alignedAllocator::alignment;
+
+    std::size_t blockSize;
+    std::vector<char*> blocks;
+    std::vector<std::size_t> blockSizes;
+
+    // next free byte is offset bytes into blocks[block]
+    std::size_t block = 0;
+    std::size_t offset = 0;
+
+    std::size_t inUse = 0;
+    std::size_t peak = 0;
+    long allocations = 0;
+    long mallocs = 0;
+
+public:
+    // position of the arena, allocations made after a mark are released by rewinding to it
+    struct mark {
+        std::size_t block;
+        std::size_t offset;
+        std::size_t inUse;
+    };
+
+    explicit scratchArena(std::size_t blockSize=64 * 1024) : blockSize(blockSize) {}
+
+    ~scratchArena() {
+
+        scratchStatistics& statistics = globalScratchStatistics();
+
+        statistics.arenas += 1;
+        statistics.allocations += allocations;
+        statistics.mallocs += mallocs;
+
+        std::size_t previous = statistics.peakBytes.load();
+        while (peak > previous && !statistics.peakBytes.compare_exchange_weak(previous, peak)) {}
+
+        for (auto data : blocks) {
+            free(data);
+        }
+    }
+
+    scratchArena(const scratchArena&) = delete;
+    scratchArena& operator=(const scratchArena&) = delete;
+
+    // uninitialised storage for size elements of T, aligned like alignedAllocator
+    template <typename T>
+    T* allocate(flatIndex size) {
+
+        std::size_t bytes = (static_cast<std::size_t>(size) * sizeof(T) + alignment - 1) / alignment * alignment;
+
+        // move on to the first block with enough space left, only allocating a new one after the last
+        while (block < blocks.size() && offset + bytes > blockSizes[block]) {
+            block++;
+            offset = 0;
+        }
+
+        if (block == blocks.size()) {
+
+            void* data = nullptr;
+            std::size_t newSize = bytes > blockSize ? bytes : blockSize;
+
+            if (posix_memalign(&data, alignment, newSize) != 0) {
+                throw std::bad_alloc();
+            }
+
+            blocks.push_back(static_cast<char*>(data));
+            blockSizes.push_back(newSize);
+            mallocs++;
+        }
+
+        char* result = blocks[block] + offset;
+
+        offset += bytes;
+        inUse += bytes;
+        allocations++;
+
+        if (inUse > peak) {
+            peak = inUse;
+        }
+
+        return reinterpret_cast<T*>(result);
+    }
+
+    // rows by cols array in the arena. It is released with the arena and must not be deleted
+    template <typename T>
+    flatArray<T>* array(flatIndex rows, flatIndex cols) {
+        T* data = allocate<T>(rows * cols);
+        return new (allocate<flatArray<T>>(1)) flatArray<T>(data, rows, cols, typename flatArray<T>::borrowedTag());
+    }
+
+    // copy of source in the arena
+    template <typename T>
+    flatArray<T>* copy(const flatArray<T>& source) {
+        flatArray<T>* result = array<T>(source.getRows(), source.getCols());
+        std::copy(source.getArray(), source.getArray() + source.getSize(), result->getArray());
+        return result;
+    }
+
+    mark getMark() const {return {block, offset, inUse};}
+
+    // releases everything allocated since m, the memory is kept for the next allocations
+    void rewind(const mark& m) {
+        block = m.block;
+        offset = m.offset;
+        inUse = m.inUse;
+    }
+
+    // releases everything, e.g. at the end of an iteration
+    void reset() {rewind({0, 0, 0});}
+
+    // largest number of bytes in use at once
+    std::size_t getPeak() const {return peak;}
+
+    // number of allocations served, and how many of these had to get memory from the heap
+    long getAllocations() const {return allocations;}
+    long getMallocs() const {return mallocs;}
+    long getMallocsAvoided() const {return allocations - mallocs;}
+};
+
+// statistics of the arenas of a module as a Python dictionary
+inline PyObject* scratchStatisticsDict() {
+
+    scratchStatistics& statistics = globalScratchStatistics();
+
+    long allocations = statistics.allocations.load();
+    long mallocs = statistics.mallocs.load();
+
+    return Py_BuildValue("{s:l,s:l,s:l,s:l,s:n}", "arenas", statistics.arenas.load(), "allocations", allocations,
+                         "mallocs", mallocs, "mallocs_avoided", allocations - mallocs,
+                         "peak_bytes", static_cast<Py_ssize_t>(statistics.peakBytes.load()));
+}
+
+#endif //PYML_SCRATCHARENA_H
@@ -2,12 +2,13 @@ from pyml.maths import Clinear_algebra
 from pyml.maths.math_utils import argsort
 
 
-def dot_product(u, v):
+def dot_product(u, v, dtype='float64'):
     """
     Matrix/matrix, matrix/vector and vector/vector dot product
 
     :param u:
     :param v:
+    :param dtype: precision of the computation, 'float64' or 'float32' (sums are accumulated in double precision)
     :return:
 
     Example:
@@ -32,7 +33,7 @@ def dot_product(u, v):
 
     """
     # TODO: write exceptions to help user with errors from the backend
-    return Clinear_algebra.dot_product(u, v)
+    return Clinear_algebra.dot_product(u, v, dtype)
 
 
 def transpose(A):
@@ -60,6 +61,8 @@ def add(A, B):
     """
     Calculates elementwise sum of each element in a list (vector) or list of lists (matrix)
     If matrix has the same number of columns or rows as the vector the vector is automatically broadcast to fit the matrix
+    (row by row when both match). A column vector ([[0], [1]]) is applied to each column, and either argument can be
+    the one that is broadcast
 
     :type A: list
     :type B: scalar or list
@@ -96,6 +99,8 @@ def subtract(A, B):
     """
     Calculates elementwise difference of each element in a list (vector) or list of lists (matrix)
     If matrix has the same number of columns or rows as the vector the vector is automatically broadcast to fit the matrix
+    (row by row when both match). A column vector ([[0], [1]]) is applied to each column, and either argument can be
+    the one that is broadcast
 
     :type A: list
     :type B: scalar or list
@@ -232,23 +237,25 @@ def determinant(A):
     return Clinear_algebra.determinant(A)
 
 
-def least_squares(X, y):
+def least_squares(X, y, fit_intercept=False):
     """
     Solves a system of linear equations using Gaussian elimination
 
     :type X: list
     :type y: list
+    :type fit_intercept: bool
 
     :param X: list of lists representing a matrix
     :param y: a vector with all targets
+    :param fit_intercept: also fit an intercept, by centring X and y, instead of needing a column of ones in X
 
     :rtype: list
     :return: list with the same number of dimensions as the number of columns of X with the solution of the system of
-    linear equations
+    linear equations, preceded by the intercept with fit_intercept
     """
     # TODO: write exceptions to help user with errors from the backend
 
-    return Clinear_algebra.least_squares(X, y)
+    return Clinear_algebra.least_squares(X, y, fit_intercept)
 
 
 def eigen(array, tolerance=1.0e-9, max_iterations=0, sort=True, normalise=True):
@@ -1,6 +1,7 @@
 from collections import Counter
 from pyml.maths.CMaths import quick_sort, Cargmax, Cargmin
-from pyml.maths.Clinear_algebra import Cmean, Cstd, Cvariance, Ccovariance
+from pyml.maths.Clinear_algebra import Cmean, Cstd, Cvariance, Ccovariance, Cmapped_mean, Crunning_moments, \
+    Cmoments_update, Cmoments_update_mapped, Cmoments_merge, Cmoments_result, Cmoments_count
 from math import exp
 
 
@@ -152,7 +153,8 @@ def mean(array, axis=None):
                 if axis == 1 or axis == 0:
                     return Cmean(array, axis)
                 else:
-                    return Cmean(Cmean(array, 0), 0)
+                    # mean of all the elements
+                    return Cmean(array, -1)
 
             elif isinstance(array[0], (int, float)):
                 # in this case we have a vector
@@ -166,6 +168,49 @@ def mean(array, axis=None):
         raise TypeError("Expected a list")
 
 
+def mapped_mean(path, shape, axis=None, dtype='float64', offset=0):
+    """
+    numpy style mean of an array stored in a raw binary file
+
+    The file is memory mapped instead of being read into a list, so it can be larger than the
+    available memory (and have more than 2 ** 31 elements).
+
+    :type path: str
+    :type shape: tuple
+    :type axis: int
+    :type dtype: str
+    :type offset: int
+
+    :param path: file with the array stored row major in native byte order, e.g. written with numpy's tofile
+    :param shape: (rows, columns) of the array, or the number of elements of a vector
+    :param axis: 0 for the mean of each column, 1 for the mean of each row and None for the overall mean
+    :param dtype: 'float64' or 'float32'
+    :param offset: position in bytes of the first element in the file
+
+    :rtype: list or float
+    :return: list with row/column mean(s) or float of overall mean
+
+    Example:
+    --------
+
+    >>> from array import array
+    >>> from pyml.maths import mapped_mean
+    >>> with open('data.bin', 'wb') as f:
+    ...     array('d', [1, 2, 3, 4, 5, 6]).tofile(f)
+    >>> print(mapped_mean('data.bin', (2, 3), axis=0))
+    [2.5, 3.5, 4.5]
+    """
+    if isinstance(shape, int):
+        shape = (1, shape)
+
+    rows, cols = shape
+
+    if axis is None:
+        return Cmapped_mean(path, 1, rows * cols, 0, dtype, offset)
+
+    return Cmapped_mean(path, rows, cols, axis, dtype, offset)
+
+
 def std(array, degrees_of_freedom=0, axis=None):
 
     """
@@ -175,7 +220,7 @@ def std(array, degrees_of_freedom=0, axis=None):
     :type axis: int
 
     :param array: list of lists (matrix) or list (vector)
-    :param axis: if array is a matrix this is used to determine whether to calculate standard deviation of array column or row wise
+    :param axis: if array is a matrix this is used to determine whether to calculate standard deviation of array column or row wise, or None for all elements
 
     :rtype: list or int
     :return: list with row/column standard deviation(s) or int of overall standard deviation
@@ -196,7 +241,8 @@ def std(array, degrees_of_freedom=0, axis=None):
                 if axis == 1 or axis == 0:
                     return Cstd(array, degrees_of_freedom, axis)
                 else:
-                    raise NotImplementedError("This is not the code you are looking for.")
+                    # of all the elements
+                    return Cstd(array, degrees_of_freedom, -1)
 
             elif isinstance(array[0], (int, float)):
                 # in this case we have a vector
@@ -220,7 +266,7 @@ def variance(array, degrees_of_freedom=0, axis=None):
     :type axis: int
 
     :param array: list of lists (matrix) or list (vector)
-    :param axis: if array is a matrix this is used to determine whether to calculate variance of array column or row wise
+    :param axis: if array is a matrix this is used to determine whether to calculate variance of array column or row wise, or None for all elements
 
     :rtype: list or int
     :return: list with row/column standard deviation(s) or int of overall variance
@@ -233,7 +279,8 @@ def variance(array, degrees_of_freedom=0, axis=None):
                 if axis == 1 or axis == 0:
                     return Cvariance(array, degrees_of_freedom, axis)
                 else:
-                    raise NotImplementedError("This is not the code you are looking for.")
+                    # of all the elements
+                    return Cvariance(array, degrees_of_freedom, -1)
 
             elif isinstance(array[0], (int, float)):
                 # in this case we have a vector
@@ -275,6 +322,88 @@ def covariance(array):
     return Ccovariance(array)
 
 
+class RunningMoments(object):
+    """
+    Single pass mean, variance, standard deviation and (optionally) covariance of the columns of data
+    that arrives in chunks of rows, e.g. a file too large to read at once
+
+    Only the count, the means and the sums of squared deviations are kept, which are updated with
+    Welford's algorithm, and accumulators of different chunks of the same data can be merged (e.g.
+    one per process). The results match the numpy style functions on all the rows at once.
+
+    :type n_features: int
+    :type covariance: bool
+
+    :param n_features: number of columns of each row
+    :param covariance: whether to also accumulate the covariance matrix (memory grows with n_features ** 2)
+
+    Example:
+    --------
+
+    >>> from pyml.maths import RunningMoments
+    >>> moments = RunningMoments(2)
+    >>> moments.update([[1, 2], [3, 4]])
+    >>> moments.update([[5, 6]])
+    >>> print(moments.result()['mean'])
+    [3.0, 4.0]
+    """
+
+    def __init__(self, n_features, covariance=False):
+        self._n_features = n_features
+        self._covariance = covariance
+        self._state = Crunning_moments(n_features, covariance)
+
+    @property
+    def count(self):
+        return Cmoments_count(self._state)
+
+    def update(self, chunk):
+        """
+        Adds a chunk of rows
+
+        :type chunk: list
+        :param chunk: list of lists (rows), or a list representing a single row
+        """
+        Cmoments_update(self._state, chunk)
+
+    def update_file(self, path, n_rows, dtype='float64', offset=0):
+        """
+        Adds rows stored in a raw binary file, which is memory mapped (see mapped_mean)
+
+        :type path: str
+        :type n_rows: int
+        :type dtype: str
+        :type offset: int
+
+        :param path: file with the rows stored row major in native byte order
+        :param n_rows: number of rows to read
+        :param dtype: 'float64' or 'float32'
+        :param offset: position in bytes of the first row in the file
+        """
+        Cmoments_update_mapped(self._state, path, n_rows, dtype, offset)
+
+    def merge(self, other):
+        """
+        Adds the rows summarised by another RunningMoments instance with the same number of features
+
+        :type other: RunningMoments
+        """
+        Cmoments_merge(self._state, other._state)
+
+    def result(self, degrees_of_freedom=0):
+        """
+        Statistics of all the rows added so far
+
+        :type degrees_of_freedom: int
+        :param degrees_of_freedom: the divisor is the number of rows minus degrees_of_freedom
+
+        :rtype: dict
+        :return: 'count', 'mean', 'variance' and 'std' of each column, and 'covariance' (list of lists,
+                 or None if it wasn't accumulated)
+        """
+        return Cmoments_result(self._state, degrees_of_freedom)
+
+
 def sigmoid(array):
     """
     Python implementation of element wise sigmoid of a vector
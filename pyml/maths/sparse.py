@@ -0,0 +1,165 @@
+from array import array
+from pyml.maths import Clinear_algebra
+
+
+class CSRMatrix(object):
+    """
+    Sparse matrix in compressed sparse row (CSR) format
+
+    Only the non zero elements are stored: the values of row i are data[indptr[i]:indptr[i + 1]] and their
+    columns are indices[indptr[i]:indptr[i + 1]], sorted and without duplicates. The buffers are kept as
+    arrays, which the C++ extensions copy without going through Python objects, so memory and time scale with
+    the number of non zeros. Any object with data, indices, indptr and shape attributes (e.g. a
+    scipy.sparse.csr_matrix with sorted indices) can be used where a CSRMatrix is accepted, the linear models
+    convert it once with as_csr.
+
+    Gradient descent (linear and logistic regression), linear model predictions and the distance functions
+    accept a CSRMatrix in place of a list of lists.
+
+    :type data: list or array
+    :type indices: list or array
+    :type indptr: list or array
+    :type shape: tuple
+
+    :param data: values of the non zero elements, row by row
+    :param indices: column of each value in data
+    :param indptr: position in data of the first value of each row, followed by the number of non zeros
+    :param shape: (rows, columns)
+
+    Example:
+    --------
+
+    >>> from pyml.maths import CSRMatrix
+    >>> X = CSRMatrix([1, 2, 3], [0, 2, 1], [0, 2, 2, 3], (3, 3))
+    >>> print(X.dot([1, 1, 1]))
+    [3.0, 0.0, 3.0]
+    >>> print(X[2])
+    [0.0, 3.0, 0.0]
+    """
+
+    def __init__(self, data, indices, indptr, shape):
+
+        self.data = array('d', data)
+        self.indices = array('q', indices)
+        self.indptr = array('q', indptr)
+        self.shape = (int(shape[0]), int(shape[1]))
+
+        if len(self.indptr) != self.shape[0] + 1 or len(self.indices) != len(self.data) or \
+                self.indptr[-1] != len(self.data):
+            raise ValueError("indptr should have rows + 1 elements and end with the number of non zeros")
+
+    @classmethod
+    def from_dense(cls, X):
+        """
+        CSR matrix with the non zero elements of a list of lists
+
+        :type X: list
+        :rtype: CSRMatrix
+        """
+        data, indices, indptr = array('d'), array('q'), array('q', [0])
+
+        for row in X:
+            for j, value in enumerate(row):
+                if value != 0:
+                    data.append(value)
+                    indices.append(j)
+            indptr.append(len(data))
+
+        return cls(data, indices, indptr, (len(X), len(X[0]) if len(X) > 0 else 0))
+
+    @property
+    def nnz(self):
+        """
+        Number of stored (non zero) elements
+        :type: int
+        """
+        return len(self.data)
+
+    def __len__(self):
+        return self.shape[0]
+
+    def __getitem__(self, item):
+        """
+        A row as a dense list, or a CSRMatrix of the rows of a slice
+        """
+        if isinstance(item, slice):
+            return self.take(range(*item.indices(self.shape[0])))
+
+        if item < 0:
+            item += self.shape[0]
+
+        if not 0 <= item < self.shape[0]:
+            raise IndexError("row index out of range")
+
+        row = [0.0] * self.shape[1]
+
+        for k in range(self.indptr[item], self.indptr[item + 1]):
+            row[self.indices[k]] = self.data[k]
+
+        return row
+
+    def take(self, rows):
+        """
+        CSR matrix of the given rows, in the given order
+
+        :type rows: list or range
+        :rtype: CSRMatrix
+        """
+        data, indices, indptr = array('d'), array('q'), array('q', [0])
+
+        for i in rows:
+            start, end = self.indptr[i], self.indptr[i + 1]
+            data.extend(self.data[start:end])
+            indices.extend(self.indices[start:end])
+            indptr.append(len(data))
+
+        return CSRMatrix(data, indices, indptr, (len(indptr) - 1, self.shape[1]))
+
+    def to_dense(self):
+        """
+        :rtype: list
+        :return: list of lists with all the elements
+        """
+        return [self[i] for i in range(self.shape[0])]
+
+    def dot(self, B, dtype='float64'):
+        """
+        Product with a dense vector (list) or matrix (list of lists), in time proportional to the number of non
+        zeros (times the number of columns of B)
+
+        :type B: list
+        :type dtype: str
+        :rtype: list
+        """
+        return Clinear_algebra.csr_dot(self, B, dtype=dtype)
+
+    def transpose_dot(self, B, dtype='float64'):
+        """
+        Product of the transpose with a dense vector (list) or matrix (list of lists), without forming the
+        transpose
+
+        :type B: list
+        :type dtype: str
+        :rtype: list
+        """
+        return Clinear_algebra.csr_dot(self, B, transpose=True, dtype=dtype)
+
+
+def is_sparse(X):
+    """
+    Whether X is a CSR matrix (see CSRMatrix) rather than a list
+    """
+    return not isinstance(X, list) and hasattr(X, 'indptr')
+
+
+def as_csr(X):
+    """
+    X as a CSRMatrix, copying the buffers of other CSR matrices (see is_sparse)
+
+    :type X: CSRMatrix or object with data, indices, indptr and shape attributes
+    :rtype: CSRMatrix
+    """
+    if isinstance(X, CSRMatrix):
+        return X
+
+    return CSRMatrix(X.data, X.indices, X.indptr, X.shape)
@@ -2,6 +2,9 @@
 // Created by gil on 22/11/17.
 //
 
+#ifndef PYML_ARRAYINITIALISERS_CPP
+#define PYML_ARRAYINITIALISERS_CPP
+
 #include "pythonconverters.h"
 #include "arrayInitialisers.h"
 
@@ -10,16 +13,16 @@ flatArray<T>* readFromPythonList(PyObject *pyList) {
 
     // read in array from Python list
     // check if it's a matrix or a vector
-    int cols, rows;
+    flatIndex cols, rows;
     flatArray<T>* result = nullptr;
 
     if (PyFloat_Check(PyList_GET_ITEM(pyList, 0)) || PyLong_Check(PyList_GET_ITEM(pyList, 0))) {
-        cols = static_cast<int>(PyList_GET_SIZE(pyList));
+        cols = static_cast<flatIndex>(PyList_GET_SIZE(pyList));
         rows = 1;
     }
     else {
-        rows = static_cast<int>(PyList_GET_SIZE(pyList));
-        cols = static_cast<int>(PyList_GET_SIZE(PyList_GET_ITEM(pyList, 0)));
+        rows = static_cast<flatIndex>(PyList_GET_SIZE(pyList));
+        cols = static_cast<flatIndex>(PyList_GET_SIZE(PyList_GET_ITEM(pyList, 0)));
     }
 
     result = convertPy_flatArray <T> (pyList, rows, cols);
@@ -29,33 +32,22 @@ flatArray<T>* readFromPythonList(PyObject *pyList) {
 
 
 template <typename T>
-flatArray<T>* emptyArray(int rows, int cols) {
-    flatArray<T>* result = nullptr;
-    T* array = nullptr;
-    int size = rows * cols;
-
-    array = new T [size];
-
-    result = new flatArray <T> (array, rows, cols);
-
-    delete [] array;
+flatArray<T>* emptyArray(flatIndex rows, flatIndex cols) {
 
-    return result;
+    // storage is allocated directly and left uninitialised
+    return new flatArray <T> (rows, cols);
 }
 
 
 template <typename T>
-inline flatArray<T>* identity(int n) {
-
-    int row=0;
-    int size = n * n;
-    flatArray<T>* result = nullptr;
-    T* array = nullptr;
+inline flatArray<T>* identity(flatIndex n) {
 
+    flatIndex row=0;
+    flatIndex size = n * n;
+    flatArray<T>* result = emptyArray<T>(n, n);
+    T* array = result->getArray();
 
-    array = new T [size];
-
-    for (int i = 0; i < size; ++i) {
+    for (flatIndex i = 0; i < size; ++i) {
         if (i == row) {
             array[i] = 1;
             row += n + 1;
@@ -65,47 +57,33 @@ inline flatArray<T>* identity(int n) {
         }
     }
 
-    result = new flatArray <T> (array, n, n);
-
-    delete [] array;
-
     return result;
 }
 
 
 template <typename T>
-inline flatArray<T>* constArray(int rows, int cols, double c) {
+inline flatArray<T>* constArray(flatIndex rows, flatIndex cols, double c) {
 
-    T* array = nullptr;
-    flatArray<T>* result = nullptr;
-    int size = rows * cols;
+    flatArray<T>* result = emptyArray<T>(rows, cols);
 
     // convert c to type T
-    c = static_cast<T>(c);
-
-    array = new T [size];
-
-    for (int i = 0; i < size; ++i) {
-        array[i] = c;
-    }
-
-    result = new flatArray <T> (array, rows, cols);
-
-    delete [] array;
+    std::fill(result->getArray(), result->getArray() + result->getSize(), static_cast<T>(c));
 
     return result;
 }
 
 
 template <typename T>
-inline flatArray<T>* zeroArray(int rows, int cols) {
+inline flatArray<T>* zeroArray(flatIndex rows, flatIndex cols) {
 
     return constArray <T> (rows, cols, 0);
 }
 
 
 template <typename T>
-inline flatArray<T>* oneArray(int rows, int cols) {
+inline flatArray<T>* oneArray(flatIndex rows, flatIndex cols) {
 
     return constArray <T> (rows, cols, 1);
-}
\ No newline at end of file
+}
+
+#endif //PYML_ARRAYINITIALISERS_CPP
@@ -12,25 +12,61 @@
  *  following pointers of pointers
  *
  */
+
+#ifndef PYML_FLATARRAYS_CPP
+#define PYML_FLATARRAYS_CPP
+
 #include "pythonconverters.h"
 #include "linearalgebramodule.h"
 #include "exceptionClasses.h"
+#include "flatArrayBroadcast.h"
+#include "flatArrayTranspose.h"
+#include "flatArrayReductions.h"
 
 
 template <class T>
-flatArray<T>* flatArray<T>::transpose() {
+flatArray<T>* flatArray<T>::transpose(int replace) {
 
-    auto result = emptyArray <T> (cols, rows);
+    // see flatArrayTranspose.h
+    if (replace == 0) {
 
-    for (int n = 0; n < rows * cols; ++n) {
+        auto result = emptyArray <T> (cols, rows);
 
-        int column = n / rows;
-        int row = n % rows * cols;
+        transposeInto(array, result->getArray(), rows, cols);
 
-        result->setNElement(array[row + column],n);
+        return result;
     }
 
-    return result;
+    if (rows == cols) {
+        transposeSquare(array, cols, rows);
+    }
+
+    else if (rows > 1 && cols > 1 && release != nullptr) {
+        // rectangular matrices are transposed into new storage
+        T* result = alignedAllocator::allocate<T>(size);
+
+        transposeInto(array, result, rows, cols);
+
+        release(array, size);
+        array = result;
+        release = &alignedAllocator::deallocate<T>;
+    }
+
+    else if (rows > 1 && cols > 1) {
+        // borrowed memory is kept, the matrix is transposed back into it from a copy
+        T* source = alignedAllocator::allocate<T>(size);
+
+        std::copy(array, array + size, source);
+
+        transposeInto(source, array, rows, cols);
+
+        alignedAllocator::deallocate(source, size);
+    }
+
+    // vectors have the same layout either way
+    std::swap(rows, cols);
+
+    return this;
 }
 
 
@@ -38,11 +74,10 @@ flatArray<T>* flatArray<T>::transpose() {
 template <class T>
 T flatArray<T>::sum() {
 
-    T result = 0;
+    // pairwise, see flatArrayReductions.h
+    typename accumulator<T>::type result;
 
-    for (int n = 0; n < size; ++n) {
-        result += array[n];
-    };
+    reduceSums(array, rows, cols, reduceAll, &result);
 
     return result;
 }
@@ -60,12 +95,12 @@ flatArray<T>* flatArray<T>::dot(const flatArray& other) {
 
         result = emptyArray<T>(rows, other.getCols());
 
-        int rRows = result->getRows();
-        int rCols = result->getCols();
-        int N = getCols();
-        int M = other.getCols();
-        int n, i, j, k, posA, posB;
-        T eResult;
+        flatIndex rRows = result->getRows();
+        flatIndex rCols = result->getCols();
+        flatIndex N = getCols();
+        flatIndex M = other.getCols();
+        flatIndex n, i, j, k, posA, posB;
+        typename accumulator<T>::type eResult;
         T *otherArray = other.getArray();
 
         for (i = 0; i < rRows; ++i) {
@@ -97,12 +132,12 @@ flatArray<T>* flatArray<T>::dot(const flatArray& other) {
         result = emptyArray<T>(1, rows);
         T *v = other.getArray();
 
-        int n = 0;
-        T row_result;
+        flatIndex n = 0;
+        typename accumulator<T>::type row_result;
 
-        for (int i = 0; i < rows; ++i) {
+        for (flatIndex i = 0; i < rows; ++i) {
             row_result = 0;
-            for (int j = 0; j < cols; ++j) {
+            for (flatIndex j = 0; j < cols; ++j) {
                 row_result += array[n] * v[j];
                 n++;
             }
@@ -119,144 +154,79 @@ flatArray<T>* flatArray<T>::dot(const flatArray& other) {
 }
 
 
-// templates for elementwise operations (matrix and scalar)
-template <typename T>
-void scalarElementwiseTemplate(flatArray<T>& self, const T other, T (f(T, T)), flatArray<T>* result) {
+// templates for elementwise operations (matrix and scalar), f is taken by type rather than as a
+// function pointer so that the operation is inlined in the loops
+template <typename T, typename F>
+void scalarElementwiseTemplate(flatArray<T>& self, const T other, F f, flatArray<T>* result) {
 
-    int size = self.getSize();
+    flatIndex size = self.getSize();
     T* array = self.getArray();
 
-    for (int i = 0; i < size; ++i) {
+    for (flatIndex i = 0; i < size; ++i) {
         (*result)[i] = f(array[i], other);
     }
 }
 
 
-template <typename T>
-void elementwiseTemplate(flatArray<T>& self, const flatArray<T> &other, T (f(T, T)), flatArray<T>* result) {
-
-    int rows = self.getRows();
-    int cols = self.getCols();
-    int size = self.getSize();
-    T* array = self.getArray();
-
-    if (other.getCols() > 1 && other.getRows() == 1 && rows > 1) {
-        // other is a vector and self is a matrix
-
-        // if square matrix will prioritise column wise operation f (consider transposing matrix
-        // if this is not what you want)
-        if (rows == other.getCols()) {
-
-            // number of rows match number of dimensions of vector
-            T *B = other.getRow(0);
-            int n = 0;
-            for (int i = 0; i < rows; ++i) {
-
-                for (int j = 0; j < cols; ++j) {
-
-                    // operation f on each row by the ith element of other vector
-                    (*result)[n] = f(array[n], B[i]);
-
-                    n++;
-                }
-            }
-
-            delete [] B;
-        }
-
-        else if (cols == other.getCols()){
+// other is broadcast to the shape of self, see flatArrayBroadcast.h. A vector with as many elements as
+// self has rows is applied row by row, which takes priority for square matrices (consider transposing
+// the matrix if this is not what you want)
+template <typename T, typename F>
+void elementwiseTemplate(flatArray<T>& self, const flatArray<T> &other, F f, flatArray<T>* result) {
 
-            // number of columns of self match number of dimensions of vector
-            T *B = other.getRow(0);
+    broadcastOperand<T> A = asOperand(self);
+    broadcastOperand<T> B = vectorOperand(other, self.getRows());
 
-            int n = 0;
-            for (int i = 0; i < rows; ++i) {
+    flatIndex rows, cols;
 
-                for (int j = 0; j < cols; ++j) {
-
-                    // operation f on each each column by the ith element of other vector
-                    (*result)[n] = f(array[n], B[j]);
-
-                    n++;
-                }
-            }
+    broadcastShape(A, B, rows, cols);
 
-            delete [] B;
-        }
-
-        else {
-            throw flatArrayDimensionMismatchException<T>(self, other);
-        }
-    }
-
-    else if (other.getSize() == size) {
-        // both are matrices or vectors (with same size)
-
-        if (rows != other.getRows() || cols != other.getCols()) {
-            throw flatArrayDimensionMismatchException<T>(self, other);
-        }
-
-        T *B = other.getArray();
-
-        for (int n = 0; n < size; ++n) {
-            (*result)[n] = f(array[n], B[n]);
-        }
-    }
-
-    else if (other.getCols() == 1) {
-        // other is a scalar represented as an array
-
-        T B = other.getNElement(0);
-
-        for (int n = 0; n < size; ++n) {
-            (*result)[n] = f(array[n], B);
-        }
-
-    }
-
-    else {
+    // the result has the shape of self
+    if (rows != self.getRows() || cols != self.getCols()) {
         throw flatArrayDimensionMismatchException<T>(self, other);
     }
+
+    broadcast(A, B, f, *result);
 }
 
 
-template <typename T>
-flatArray<T>* elementwiseHelper(flatArray<T>* self, const flatArray<T> &other, T (f(T, T)), int replace) {
+template <typename T, typename F>
+flatArray<T>* elementwiseHelper(flatArray<T>* self, const flatArray<T> &other, F f, int replace) {
 
     if (replace == 0) {
 
-        int rows = self->getRows();
-        int cols = self->getCols();
+        flatIndex rows = self->getRows();
+        flatIndex cols = self->getCols();
         auto* result = emptyArray<T>(rows, cols);
 
-        elementwiseTemplate<T>(*self, other, f, result);
+        elementwiseTemplate(*self, other, f, result);
 
         return result;
     }
 
     else {
-        elementwiseTemplate<T>(*self, other, f, self);
+        elementwiseTemplate(*self, other, f, self);
         return self;
     }
 }
 
 
-template <typename T>
-flatArray<T>* scalarElementwiseHelper(flatArray<T>* self, const T other, T (f(T, T)), int replace) {
+template <typename T, typename F>
+flatArray<T>* scalarElementwiseHelper(flatArray<T>* self, const T other, F f, int replace) {
 
     if (replace == 0) {
 
-        int rows = self->getRows();
-        int cols = self->getCols();
+        flatIndex rows = self->getRows();
+        flatIndex cols = self->getCols();
         auto* result = emptyArray<T>(rows, cols);
 
-        scalarElementwiseTemplate<T>(*self, other, f, result);
+        scalarElementwiseTemplate(*self, other, f, result);
 
         return result;
     }
 
     else {
-        scalarElementwiseTemplate<T>(*self, other, f, self);
+        scalarElementwiseTemplate(*self, other, f, self);
         return self;
     }
 }
@@ -302,7 +272,13 @@ flatArray<T> *flatArray<T>::subtract(T other, int replace) {
 template <class T>
 flatArray<T>* flatArray<T>::divide(const flatArray<T> &other, int replace) {
 
-    auto f =[](T a, T b) { if (b != 0) {return (a / b);} else {throw flatArrayZeroDivisionError();} };
+    // zeros are looked for before dividing, so the division loop has no branches and self is left
+    // untouched when the error is raised
+    if (std::find(other.getArray(), other.getArray() + other.getSize(), T(0)) != other.getArray() + other.getSize()) {
+        throw flatArrayZeroDivisionError();
+    }
+
+    auto f =[](T a, T b) { return (a / b); };
 
     return elementwiseHelper<T>(this, other, f, replace);
 }
@@ -310,7 +286,11 @@ flatArray<T>* flatArray<T>::divide(const flatArray<T> &other, int replace) {
 template <class T>
 flatArray<T> *flatArray<T>::divide(const T other, int replace) {
 
-    auto f =[](T a, T b) { if (b != 0) {return (a / b);} else {throw flatArrayZeroDivisionError();} };
+    if (other == 0) {
+        throw flatArrayZeroDivisionError();
+    }
+
+    auto f =[](T a, T b) { return (a / b); };
 
     return scalarElementwiseHelper<T>(this, other, f, replace);
 }
@@ -353,265 +333,208 @@ flatArray<T>* flatArray<T>::nlog(double base, int replace) {
     return scalarElementwiseHelper<T>(this, base, f, replace);
 }
 
-template <class T>
-flatArray<T>* flatArray<T>::mean(int axis) {
-
-    flatArray<T>* result = nullptr;
+// reductions, see flatArrayReductions.h. Vectors are always reduced as a whole, and matrices along
+// axis 0 (each column), 1 (each row) or reduceAll (all the elements)
+inline int reductionAxis(flatIndex rows, int axis) {
 
     if (rows == 1) {
-        // vector
-        T rowResult = 0;
-
-        result = emptyArray<T>(1, 1);
-
-        for (int i = 0; i < cols; ++i) {
-            rowResult += array[i];
-        }
-
-        rowResult /= static_cast<T>(cols);
+        return reduceAll;
+    }
 
-        (*result)[0] = rowResult;
+    if (axis != 0 && axis != 1 && axis != reduceAll) {
+        throw flatArrayUnknownAxis(axis);
     }
 
-    else if (rows > 1) {
-        // matrix
-        if (axis == 0) {
-            // mean of each column
-            T colResult;
+    return axis;
+}
 
-            result = emptyArray<T>(1 , cols);
 
-            for (int i = 0; i < cols; ++i) {
+// number of results of a reduction of a rows by cols array along axis
+inline flatIndex reductionLength(flatIndex rows, flatIndex cols, int axis) {
+    return axis == 0 ? cols : axis == 1 ? rows : 1;
+}
 
-                colResult = 0;
-                T *colArray = getCol(i);
 
-                for (int j = 0; j < rows; ++j) {
-                    colResult += colArray[j];
-                }
+template <class T>
+flatArray<T>* flatArray<T>::sum(int axis) {
 
-                colResult /= static_cast<T>(rows);
+    axis = reductionAxis(rows, axis);
+    flatIndex n = reductionLength(rows, cols, axis);
 
-                (*result)[i] = colResult;
+    std::vector<typename accumulator<T>::type> sums(n);
 
-                delete [] colArray;
-            }
-        }
+    reduceSums(array, rows, cols, axis, sums.data());
 
-        else if (axis == 1) {
-            // mean of each row
-            T rowResult;
+    flatArray<T>* result = emptyArray<T>(1, n);
 
-            result = emptyArray<T>(1, rows);
+    std::copy(sums.begin(), sums.end(), result->getArray());
 
-            for (int i = 0; i < rows; ++i) {
+    return result;
+}
 
-                rowResult = 0;
-                T *rowArray = getRow(i);
 
-                for (int j = 0; j < cols; ++j) {
-                    rowResult += rowArray[j];
-                }
+template <class T>
+flatArray<T>* flatArray<T>::mean(int axis) {
 
-                rowResult /= static_cast<T>(cols);
+    axis = reductionAxis(rows, axis);
+    flatIndex n = reductionLength(rows, cols, axis);
+    auto count = static_cast<typename accumulator<T>::type>(size / n);
 
-                (*result)[i] = rowResult;
+    std::vector<typename accumulator<T>::type> sums(n);
 
-                delete [] rowArray;
-            }
-        }
+    reduceSums(array, rows, cols, axis, sums.data());
 
-        else {
-            throw flatArrayUnknownAxis(axis);
-        }
+    flatArray<T>* result = emptyArray<T>(1, n);
 
+    for (flatIndex i = 0; i < n; ++i) {
+        (*result)[i] = sums[i] / count;
     }
 
     return result;
 }
 
+
 template <class T>
 flatArray<T>* flatArray<T>::std(int degreesOfFreedom, int axis) {
 
-    flatArray* result = nullptr;
-    flatArray *arrayVar = nullptr;
-
-    arrayVar = var(degreesOfFreedom, axis);
+    flatArray<T>* result = var(degreesOfFreedom, axis);
 
-    if (rows == 1) {
-        // vector
-        result = emptyArray<T>(1, 1);
+    for (flatIndex i = 0; i < result->getSize(); ++i) {
+        (*result)[i] = sqrt((*result)[i]);
+    }
 
-        T arrayMean_i = arrayVar->getNElement(0);
+    return result;
+}
 
-        result->setNElement(pow(arrayMean_i, 0.5), 0);
-    }
 
-    else if (rows > 1) {
-        // matrix
-        if (axis == 0) {
-            // std of each column
-            result = emptyArray<T>(1, cols);
+template <class T>
+flatArray<T>* flatArray<T>::var(int degreesOfFreedom, int axis) {
 
-            for (int i = 0; i < cols; ++i) {
+    // the squared deviations are taken from the mean in accumulator precision, before it is rounded to T
+    axis = reductionAxis(rows, axis);
+    flatIndex n = reductionLength(rows, cols, axis);
+    auto count = static_cast<typename accumulator<T>::type>(size / n);
 
-                result->setNElement(pow(arrayVar->getNElement(i), 0.5), i);
-            }
+    std::vector<typename accumulator<T>::type> means(n);
+    std::vector<typename accumulator<T>::type> squares(n);
 
-        }
+    reduceSums(array, rows, cols, axis, means.data());
 
-        else {
-            // std of each row
-            result = emptyArray<T>(1, rows);
+    for (flatIndex i = 0; i < n; ++i) {
+        means[i] /= count;
+    }
 
-            for (int i = 0; i < rows; ++i) {
+    reduceSquaredDeviations(array, rows, cols, axis, means.data(), squares.data());
 
-                result->setNElement(pow(arrayVar->getNElement(i), 0.5), i);
+    flatArray<T>* result = emptyArray<T>(1, n);
 
-            }
-        }
+    for (flatIndex i = 0; i < n; ++i) {
+        (*result)[i] = squares[i] / (count - degreesOfFreedom);
     }
 
-    delete arrayVar;
-
     return result;
 }
 
-template <class T>
-flatArray<T>* flatArray<T>::var(int degreesOfFreedom, int axis) {
 
-    flatArray<T>* result = nullptr;
-    flatArray<T>* arrayMean = nullptr;
-
-    arrayMean = mean(axis);
+template <class T>
+template <class Better>
+void flatArray<T>::extremes(int axis, Better better, flatArray<T>* values, flatArray<flatIndex>* indices) {
 
-    if (rows == 1) {
-        // vector
-        T rowResult = 0;
+    axis = reductionAxis(rows, axis);
+    flatIndex n = reductionLength(rows, cols, axis);
 
-        result = emptyArray<T>(1, 1);
+    std::vector<T> v(n);
+    std::vector<flatIndex> idx(n);
 
-        T arrayMean_i = arrayMean->getNElement(0);
+    reduceExtremes(array, rows, cols, axis, better, v.data(), idx.data());
 
-        for (int i = 0; i < size; ++i) {
-            rowResult += pow(array[i] - arrayMean_i, 2);
-        }
-
-        rowResult /= static_cast<T>(size - degreesOfFreedom);
+    if (values != nullptr) {
+        std::copy(v.begin(), v.end(), values->getArray());
+    }
 
-        result->setNElement(rowResult, 0);
+    if (indices != nullptr) {
+        std::copy(idx.begin(), idx.end(), indices->getArray());
     }
+}
 
-    else if (rows > 1) {
-        // matrix
-        if (axis == 0) {
-            // std of each column
-            T colResult;
 
-            result = emptyArray<T>(1, cols);
+template <class T>
+flatArray<T>* flatArray<T>::min(int axis) {
 
-            for (int i = 0; i < cols; ++i) {
+    flatArray<T>* result = emptyArray<T>(1, reductionLength(rows, cols, reductionAxis(rows, axis)));
 
-                colResult = 0;
-                T colMean = arrayMean->getNElement(i);
-                T *colArray = getCol(i);
+    extremes(axis, [](T a, T b) {return a < b;}, result, nullptr);
 
-                for (int j = 0; j < rows; ++j) {
-                    colResult += pow(colArray[j] - colMean, 2);
-                }
+    return result;
+}
 
-                colResult /= static_cast<T>(rows - degreesOfFreedom);
 
-                result->setNElement(colResult, i);
+template <class T>
+flatArray<T>* flatArray<T>::max(int axis) {
 
-                delete [] colArray;
-            }
-        }
+    flatArray<T>* result = emptyArray<T>(1, reductionLength(rows, cols, reductionAxis(rows, axis)));
 
-        else if (axis == 1) {
-            // std of each row
-            T rowResult;
+    extremes(axis, [](T a, T b) {return a > b;}, result, nullptr);
 
-            result = emptyArray<T>(1, rows);
+    return result;
+}
 
-            for (int i = 0; i < rows; ++i) {
 
-                rowResult = 0;
-                T rowMean = arrayMean->getNElement(i);
-                T *rowArray = getRow(i);
+template <class T>
+flatArray<flatIndex>* flatArray<T>::argmin(int axis) {
 
-                for (int j = 0; j < cols; ++j) {
-                    rowResult += pow(rowArray[j] - rowMean, 2);
-                }
+    flatArray<flatIndex>* result = emptyArray<flatIndex>(1, reductionLength(rows, cols, reductionAxis(rows, axis)));
 
-                rowResult /=  static_cast<T>(cols - degreesOfFreedom);
+    extremes(axis, [](T a, T b) {return a < b;}, nullptr, result);
 
-                result->setNElement(rowResult, i);
+    return result;
+}
 
-                delete [] rowArray;
-            }
-        }
 
-        else {
-            throw flatArrayUnknownAxis(axis);
-        }
-    }
+template <class T>
+flatArray<flatIndex>* flatArray<T>::argmax(int axis) {
 
-    delete arrayMean;
+    flatArray<flatIndex>* result = emptyArray<flatIndex>(1, reductionLength(rows, cols, reductionAxis(rows, axis)));
+
+    extremes(axis, [](T a, T b) {return a > b;}, nullptr, result);
 
     return result;
 }
 
 template <class T>
-T* flatArray<T>::getRowSlice(int i, int start, int end) {
-
-    T* result = nullptr;
-    T* row = nullptr;
+T* flatArray<T>::getRowSlice(flatIndex i, flatIndex start, flatIndex end) {
 
-    row = getRow(i);
-
-    if (end > getCols()) {
-        arrayOutOfBoundsException(getRows(), end);
+    // copy of elements start to end - 1 of row i, read through a view so the row isn't copied first
+    if (i >= rows) {
+        throw flatArrayOutOfBoundsRowException<T>(*this, i);
     }
 
-    result = new T [end - start];
-
-    int n = 0;
-    for (int j = start; j < end; ++j) {
-
-        result[n] = row[j];
-
-        n++;
+    if (start < 0 || start > end || end > cols) {
+        throw arrayOutOfBoundsException(cols, end);
     }
 
-    delete [] row;
+    T* result = new T [end - start];
+
+    viewRowSlice(i, start, end).copyTo(result);
 
     return result;
 }
 
 template <class T>
-T* flatArray<T>::getColSlice(int j, int start, int end) {
-
-    T* result = nullptr;
-    T* col = nullptr;
+T* flatArray<T>::getColSlice(flatIndex j, flatIndex start, flatIndex end) {
 
-    col = getCol(j);
-
-    if (end > getCols()) {
-        arrayOutOfBoundsException(getCols(), end);
+    // copy of elements start to end - 1 of column j (see getRowSlice)
+    if (j >= cols) {
+        throw flatArrayOutOfBoundsColumnException<T>(*this, j);
     }
 
-    result = new T[end - start];
-
-    int n = 0;
-    for (int i = start; i < end; ++i) {
-
-        result[n] = col[i];
-
-        n++;
+    if (start < 0 || start > end || end > rows) {
+        throw arrayOutOfBoundsException(rows, end);
     }
 
-    delete [] col;
+    T* result = new T[end - start];
+
+    viewColSlice(j, start, end).copyTo(result);
 
     return result;
 }
@@ -623,7 +546,7 @@ T* flatArray<T>::diagonal() {
 
     result = new T [rows];
 
-    for (int i = 0; i < rows; ++i) {
+    for (flatIndex i = 0; i < rows; ++i) {
         result[i] = array[i + i * rows];
     }
 
@@ -642,7 +565,7 @@ flatArray<T>& flatArray<T>::invertSign(int replace) {
     if (replace == 0) {
         auto newArray = new double[size];
 
-        for (int i = 0; i < size; ++i) {
+        for (flatIndex i = 0; i < size; ++i) {
             newArray[i] = -array[i];
         }
 
@@ -653,9 +576,11 @@ flatArray<T>& flatArray<T>::invertSign(int replace) {
         return result;
     }
     else {
-        for (int i = 0; i < size; ++i) {
+        for (flatIndex i = 0; i < size; ++i) {
             array[i] = -array[i];
         }
         return *this;
     }
 }
+
+#endif //PYML_FLATARRAYS_CPP
@@ -6,10 +6,16 @@
 
 
 #include <Python.h>
+#include <chrono>
+#include <cstring>
+#include <functional>
 #include "linearalgebramodule.h"
 #include "linearalgebramodule.cpp"
 #include "exceptionClasses.h"
 #include "arrayInitialisers.cpp"
+#include "mappedFile.h"
+#include "csrArrays.h"
+#include "runningMoments.h"
 
 // Exceptions
 static PyObject *DimensionMismatchException;
@@ -19,38 +25,32 @@ static PyObject *UnknownAxis;
 static PyObject *LinearAlgebraException;
 
 
-static PyObject* dot_product(PyObject* self, PyObject *args) {
+template <typename T>
+static PyObject* dotProduct(PyObject* pAArray, PyObject* pVVector) {
 
-    flatArray<double>* A = nullptr;
-    flatArray<double>* V = nullptr;
-    flatArray<double>* result = nullptr;
+    // dot product with T precision data (accumulated in double precision for float),
+    // the result is returned as Python floats
 
-    // pointers to python lists
-    PyObject* pAArray;
-    PyObject* pVVector;
+    flatArray<T>* A = nullptr;
+    flatArray<T>* V = nullptr;
+    flatArray<T>* result = nullptr;
 
-    // return error if we don't get all the arguments
-    if (!PyArg_ParseTuple(args, "O!O!", &PyList_Type, &pAArray, &PyList_Type, &pVVector)) {
-        PyErr_SetString(PyExc_TypeError, "Expected two lists!");
-        return nullptr;
-    }
-
-    A = readFromPythonList<double>(pAArray);
-    V = readFromPythonList<double>(pVVector);
+    A = readFromPythonList<T>(pAArray);
+    V = readFromPythonList<T>(pVVector);
 
     // calculate dot product
     try {
         result = A->dot(*V);
     }
-    catch (flatArrayDimensionMismatchException<double> &e) {
+    catch (flatArrayDimensionMismatchException<T> &e) {
         PyErr_SetString(DimensionMismatchException, e.what());
         return nullptr;
     }
-    catch (flatArrayRowMismatchException<double> &e) {
+    catch (flatArrayRowMismatchException<T> &e) {
         PyErr_SetString(DimensionMismatchException, e.what());
         return nullptr;
     }
-    catch (flatArrayColumnMismatchException<double> &e) {
+    catch (flatArrayColumnMismatchException<T> &e) {
         PyErr_SetString(DimensionMismatchException, e.what());
         return nullptr;
     }
@@ -71,184 +71,130 @@ static PyObject* dot_product(PyObject* self, PyObject *args) {
 }
 
 
-static PyObject* power(PyObject* self, PyObject *args) {
+static PyObject* dot_product(PyObject* self, PyObject *args) {
 
-    // variable declaration
-    flatArray<double>* A = nullptr;
-    double p;
+    char defaultDtype[10] = "float64";
+    char* dtype = defaultDtype;
 
     // pointers to python lists
-    PyObject * pAArray;
-
+    PyObject* pAArray;
+    PyObject* pVVector;
 
     // return error if we don't get all the arguments
-    if(!PyArg_ParseTuple(args, "O!d", &PyList_Type, &pAArray, &p)) {
-        PyErr_SetString(PyExc_TypeError, "Expected a list and a float!");
+    if (!PyArg_ParseTuple(args, "O!O!|s", &PyList_Type, &pAArray, &PyList_Type, &pVVector, &dtype)) {
+        PyErr_SetString(PyExc_TypeError, "Expected two lists!");
         return nullptr;
     }
 
-    // read in python list
-    A = readFromPythonList<double>(pAArray);
-
-    // calculate the power elementwise
-    A->power(p, 1);
-
-    // convert vector to python list
-    PyObject* result_py_list = ConvertFlatArray_PyList(A, "float");
-
-    // build python object
-    PyObject *FinalResult = Py_BuildValue("O", result_py_list);
-
-    // deallocate memory
-    delete A;
+    if (strcmp(dtype, "float32") == 0) {
+        return dotProduct<float>(pAArray, pVVector);
+    }
 
-    Py_DECREF(result_py_list);
+    if (strcmp(dtype, "float64") == 0) {
+        return dotProduct<double>(pAArray, pVVector);
+    }
 
-    return FinalResult;
+    PyErr_SetString(PyExc_ValueError, "Unknown dtype!");
+    return nullptr;
 }
 
 
-static PyObject* add(PyObject* self, PyObject *args) {
+template <typename T>
+static PyObject* csrDot(PyObject* pX, PyObject* pB, int transpose) {
 
-    // variable instantiation
-    flatArray<double>* A = nullptr;
-    flatArray<double>* B = nullptr;
+    // sparse-dense product with T precision data, the result is returned as Python floats
 
-    PyObject *pA;
-    PyObject *pB;
-    PyObject *result_py_list;
-    PyObject *FinalResult;
+    csrArray<T>* X = convertPy_csrArray<T>(pX);
 
-    // return error if we don't get all the arguments
-    if(!PyArg_ParseTuple(args, "O!O!", &PyList_Type, &pA, &PyList_Type, &pB)) {
-        PyErr_SetString(PyExc_TypeError, "Expected two lists!");
+    if (X == nullptr) {
         return nullptr;
     }
 
-    // get python lists
-    A = readFromPythonList<double>(pA);
-    B = readFromPythonList<double>(pB);
+    flatArray<T>* B = readFromPythonList<T>(pB);
+    flatArray<T>* result = nullptr;
 
-    // subtraction
     try {
-        (*A) += (*B);
-    }
-
-    catch (flatArrayDimensionMismatchException<double> &e) {
-        PyErr_SetString(DimensionMismatchException, e.what());
-        return nullptr;
-    }
-
-    catch (flatArrayColumnMismatchException<double> &e) {
-        PyErr_SetString(DimensionMismatchException, e.what());
-        return nullptr;
+        result = transpose ? X->transposeDot(*B) : X->dot(*B);
     }
-
-    catch (flatArrayRowMismatchException<double> &e) {
+    catch (flatArrayDimensionMismatchException<T> &e) {
         PyErr_SetString(DimensionMismatchException, e.what());
+        delete X;
+        delete B;
         return nullptr;
     }
 
-    result_py_list = ConvertFlatArray_PyList(A, "float");
-    FinalResult = Py_BuildValue("O", result_py_list);
+    PyObject* FinalResult = ConvertFlatArray_PyList(result, "float");
 
-    // memory deallocation
-    delete A;
+    delete X;
     delete B;
-
-    Py_DECREF(result_py_list);
+    delete result;
 
     return FinalResult;
 }
 
 
-static PyObject* subtract(PyObject* self, PyObject *args) {
-
-    // variable instantiation
-    flatArray<double>* A = nullptr;
-    flatArray<double>* B = nullptr;
+static PyObject* csr_dot(PyObject* self, PyObject *args, PyObject *kwargs) {
 
-    PyObject *pA;
-    PyObject *pB;
-    PyObject *result_py_list;
-    PyObject *FinalResult;
+    // X · B, or transpose(X) · B with transpose, where X is a CSR matrix and B a dense vector or matrix
 
-    // return error if we don't get all the arguments
-    if(!PyArg_ParseTuple(args, "O!O!", &PyList_Type, &pA, &PyList_Type, &pB)) {
-        PyErr_SetString(PyExc_TypeError, "Expected two lists!");
-        return nullptr;
-    }
+    char defaultDtype[10] = "float64";
+    char* dtype = defaultDtype;
+    int transpose = 0;
 
-    // get python lists
-    A = readFromPythonList<double>(pA);
-    B = readFromPythonList<double>(pB);
+    PyObject* pX;
+    PyObject* pB;
 
-    // subtraction
-    try {
-        (*A) -= (*B);
-    }
+    static const char* kwlist[] = {"X", "B", "transpose", "dtype", nullptr};
 
-    catch (flatArrayDimensionMismatchException<double> &e) {
-        PyErr_SetString(DimensionMismatchException, e.what());
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO!|ps", const_cast<char**>(kwlist), &pX, &PyList_Type, &pB,
+                                     &transpose, &dtype) || !isSparse(pX) || PyList_GET_SIZE(pB) == 0) {
+        PyErr_SetString(PyExc_TypeError, "Check arguments!");
         return nullptr;
     }
 
-    catch (flatArrayColumnMismatchException<double> &e) {
-        PyErr_SetString(DimensionMismatchException, e.what());
-        return nullptr;
+    if (strcmp(dtype, "float32") == 0) {
+        return csrDot<float>(pX, pB, transpose);
     }
 
-    catch (flatArrayRowMismatchException<double> &e) {
-        PyErr_SetString(DimensionMismatchException, e.what());
-        return nullptr;
+    if (strcmp(dtype, "float64") == 0) {
+        return csrDot<double>(pX, pB, transpose);
     }
 
-    result_py_list = ConvertFlatArray_PyList(A, "float");
-    FinalResult = Py_BuildValue("O", result_py_list);
-
-
-    // memory deallocation
-    delete A;
-    delete B;
-
-    Py_DECREF(result_py_list);
-
-    return FinalResult;
+    PyErr_SetString(PyExc_ValueError, "Unknown dtype!");
+    return nullptr;
 }
 
 
-static PyObject* multiply(PyObject* self, PyObject *args) {
+static PyObject* power(PyObject* self, PyObject *args) {
 
     // variable declaration
     flatArray<double>* A = nullptr;
-    flatArray<double>* B = nullptr;
+    double p;
 
     // pointers to python lists
-    PyObject* pAArray = nullptr;
-    PyObject* pBArray = nullptr;
+    PyObject * pAArray;
+
 
     // return error if we don't get all the arguments
-    if(!PyArg_ParseTuple(args, "O!O!", &PyList_Type, &pAArray, &PyList_Type, &pBArray)) {
-        PyErr_SetString(PyExc_TypeError, "Expected two lists!");
+    if(!PyArg_ParseTuple(args, "O!d", &PyList_Type, &pAArray, &p)) {
+        PyErr_SetString(PyExc_TypeError, "Expected a list and a float!");
         return nullptr;
     }
 
     // read in python list
     A = readFromPythonList<double>(pAArray);
-    B = readFromPythonList<double>(pBArray);
 
-    // calculate elementwise multiplication with B
-    (*A) *= (*B);
+    // calculate the power elementwise
+    A->power(p, 1);
 
     // convert vector to python list
     PyObject* result_py_list = ConvertFlatArray_PyList(A, "float");
 
     // build python object
-    PyObject* FinalResult = Py_BuildValue("O", result_py_list);
+    PyObject *FinalResult = Py_BuildValue("O", result_py_list);
 
     // deallocate memory
     delete A;
-    delete B;
 
     Py_DECREF(result_py_list);
 
@@ -256,43 +202,65 @@ static PyObject* multiply(PyObject* self, PyObject *args) {
 }
 
 
-static PyObject* divide(PyObject* self, PyObject *args) {
+template <typename F>
+static PyObject* broadcastElementwise(PyObject *args, F f, bool checkZeros=false) {
 
-    // variable declaration
+    // elementwise operation f between two lists, where either can be broadcast to the shape of the
+    // other (see flatArrayBroadcast.h)
+
+    // variable instantiation
     flatArray<double>* A = nullptr;
     flatArray<double>* B = nullptr;
+    flatArray<double>* result = nullptr;
 
-    // pointers to python lists
-    PyObject * pAArray;
-    PyObject * pBArray;
+    PyObject *pA;
+    PyObject *pB;
 
     // return error if we don't get all the arguments
-    if(!PyArg_ParseTuple(args, "O!O!", &PyList_Type, &pAArray, &PyList_Type, &pBArray)) {
+    if(!PyArg_ParseTuple(args, "O!O!", &PyList_Type, &pA, &PyList_Type, &pB)) {
         PyErr_SetString(PyExc_TypeError, "Expected two lists!");
         return nullptr;
     }
 
-    // read in python list
-    A = readFromPythonList<double>(pAArray);
-    B = readFromPythonList<double>(pBArray);
+    // get python lists
+    A = readFromPythonList<double>(pA);
+    B = readFromPythonList<double>(pB);
+
+    if (checkZeros && std::find(B->getArray(), B->getArray() + B->getSize(), 0.0) != B->getArray() + B->getSize()) {
+        PyErr_SetString(ZeroDivisionError, flatArrayZeroDivisionError().what());
+        delete A;
+        delete B;
+        return nullptr;
+    }
+
+    broadcastOperand<double> a = vectorOperand(*A, B->getRows());
+    broadcastOperand<double> b = vectorOperand(*B, A->getRows());
 
-    // calculate elementwise division by n
     try {
-        (*A) /= (*B);
+        flatIndex rows, cols;
+
+        broadcastShape(a, b, rows, cols);
+
+        result = emptyArray<double>(rows, cols);
+
+        broadcast(a, b, f, *result);
     }
-    catch (flatArrayZeroDivisionError &e) {
-        PyErr_SetString(ZeroDivisionError, e.what());
+
+    catch (flatArrayDimensionMismatchException<double> &e) {
+        PyErr_SetString(DimensionMismatchException, e.what());
+        delete A;
+        delete B;
+        delete result;
         return nullptr;
     }
 
-    // convert vector to python list
-    PyObject* result_py_list = ConvertFlatArray_PyList(A, "float");
-
-    // build python object
-    PyObject *FinalResult = Py_BuildValue("O", result_py_list);
+    PyObject* result_py_list = ConvertFlatArray_PyList(result, "float");
+    PyObject* FinalResult = Py_BuildValue("O", result_py_list);
 
-    // deallocate memory
+    // memory deallocation
     delete A;
+    delete B;
+    delete result;
 
     Py_DECREF(result_py_list);
 
@@ -300,6 +268,26 @@ static PyObject* divide(PyObject* self, PyObject *args) {
 }
 
 
+static PyObject* add(PyObject* self, PyObject *args) {
+    return broadcastElementwise(args, [](double a, double b) { return a + b; });
+}
+
+
+static PyObject* subtract(PyObject* self, PyObject *args) {
+    return broadcastElementwise(args, [](double a, double b) { return a - b; });
+}
+
+
+static PyObject* multiply(PyObject* self, PyObject *args) {
+    return broadcastElementwise(args, [](double a, double b) { return a * b; });
+}
+
+
+static PyObject* divide(PyObject* self, PyObject *args) {
+    return broadcastElementwise(args, [](double a, double b) { return a / b; }, true);
+}
+
+
 static PyObject* sum(PyObject* self, PyObject *args) {
 
     // sum of all elements in a matrix/vector
@@ -375,13 +363,13 @@ static PyObject* pyTranspose(PyObject* self, PyObject *args) {
 
     A = readFromPythonList<double>(pArray);
 
-    result = A->transpose();
+    // A isn't needed afterwards, so it is transposed in place
+    result = A->transpose(1);
 
     pyResult = ConvertFlatArray_PyList(result, "float");
 
     PyObject* FinalResult = Py_BuildValue("O", pyResult);
 
-    delete result;
     delete A;
 
     Py_DECREF(pyResult);
@@ -390,9 +378,99 @@ static PyObject* pyTranspose(PyObject* self, PyObject *args) {
 }
 
 
+template <typename T>
+static PyObject* transposeBandwidth(flatIndex rows, flatIndex cols, int repeats) {
+
+    // best of repeats timings of transposing a rows by cols array, in place and into a new array,
+    // and of copying it with memcpy, which bounds the bandwidth of anything that reads and writes it once
+
+    double transposeTime = 0;
+    double inPlaceTime = 0;
+    double copyTime = 0;
+
+    flatArray<T>* A = nullptr;
+    flatArray<T>* B = nullptr;
+
+    try {
+        A = new flatArray<T>(rows, cols);
+        B = new flatArray<T>(cols, rows);
+    }
+    catch (std::bad_alloc &e) {
+        delete A;
+        PyErr_NoMemory();
+        return nullptr;
+    }
+
+    auto best = [repeats](double& time, std::function<void()> f) {
+        for (int i = 0; i < repeats; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            f();
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            if (i == 0 || elapsed.count() < time) {
+                time = elapsed.count();
+            }
+        }
+    };
+
+    Py_BEGIN_ALLOW_THREADS
+
+    for (flatIndex i = 0; i < A->getSize(); ++i) {
+        (*A)[i] = static_cast<T>(i);
+    }
+
+    auto bytes = static_cast<std::size_t>(A->getSize()) * sizeof(T);
+
+    best(copyTime, [&]() {memcpy(B->getArray(), A->getArray(), bytes);});
+    best(transposeTime, [&]() {transposeInto(A->getArray(), B->getArray(), rows, cols);});
+    best(inPlaceTime, [&]() {A->transpose(1);});
+
+    Py_END_ALLOW_THREADS
+
+    delete A;
+    delete B;
+
+    return Py_BuildValue("{s:n,s:d,s:d,s:d}", "bytes", static_cast<Py_ssize_t>(rows * cols * sizeof(T)),
+                         "transpose", transposeTime, "transpose_in_place", inPlaceTime, "memcpy", copyTime);
+}
+
+
+static PyObject* transpose_bandwidth(PyObject* self, PyObject *args, PyObject *kwargs) {
+
+    char defaultDtype[10] = "float64";
+    char* dtype = defaultDtype;
+    Py_ssize_t rows, cols;
+    int repeats = 5;
+
+    static const char* kwlist[] = {"rows", "cols", "repeats", "dtype", nullptr};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "nn|is", const_cast<char**>(kwlist),
+                                     &rows, &cols, &repeats, &dtype)) {
+        PyErr_SetString(PyExc_TypeError, "Check arguments!");
+        return nullptr;
+    }
+
+    if (rows < 1 || cols < 1 || repeats < 1) {
+        PyErr_SetString(PyExc_ValueError, "rows, cols and repeats must be positive!");
+        return nullptr;
+    }
+
+    if (strcmp(dtype, "float32") == 0) {
+        return transposeBandwidth<float>(rows, cols, repeats);
+    }
+
+    if (strcmp(dtype, "float64") == 0) {
+        return transposeBandwidth<double>(rows, cols, repeats);
+    }
+
+    PyErr_SetString(PyExc_ValueError, "Unknown dtype!");
+    return nullptr;
+}
+
+
 static PyObject* least_squares(PyObject* self, PyObject *args) {
 
     // variable declaration
+    int fitIntercept = 0;
     flatArray<double>* X = nullptr;
     flatArray<double>* y = nullptr;
 
@@ -401,7 +479,7 @@ static PyObject* least_squares(PyObject* self, PyObject *args) {
     PyObject *result_py_list;
 
     // return error if we don't get all the arguments
-    if(!PyArg_ParseTuple(args, "O!O!", &PyList_Type, &pX, &PyList_Type, &py)) {
+    if(!PyArg_ParseTuple(args, "O!O!|p", &PyList_Type, &pX, &PyList_Type, &py, &fitIntercept)) {
         PyErr_SetString(PyExc_TypeError, "Expected two lists!");
         return nullptr;
     }
@@ -418,12 +496,12 @@ static PyObject* least_squares(PyObject* self, PyObject *args) {
         return nullptr;
     }
 
-    // memory allocation of theta
-    auto theta = new double [X->getCols()];
+    // memory allocation of theta, with the intercept first if there is one
+    auto theta = new double [X->getCols() + fitIntercept];
 
     // get theta estimate using least squares
     try {
-        leastSquares<double>(*X, *y, theta);
+        leastSquares<double>(*X, *y, theta, fitIntercept);
     }
     catch (singularMatrixException &e) {
         PyErr_SetString(LinearAlgebraException, e.what());
@@ -431,7 +509,7 @@ static PyObject* least_squares(PyObject* self, PyObject *args) {
     }
     
 
-    result_py_list = Convert_1DArray(theta, X->getCols());
+    result_py_list = Convert_1DArray(theta, X->getCols() + fitIntercept);
 
     PyObject *FinalResult = Py_BuildValue("O", result_py_list);
 
@@ -471,10 +549,11 @@ static PyObject* mean(PyObject* self, PyObject *args) {
     }
     catch (flatArrayUnknownAxis &e) {
         PyErr_SetString(UnknownAxis, e.what());
+        delete X;
         return nullptr;
     }
 
-    if (X->getRows() == 1) {
+    if (X->getRows() == 1 || axis == reduceAll) {
 
         FinalResult = Py_BuildValue("d", result->getNElement(0));
 
@@ -496,6 +575,84 @@ static PyObject* mean(PyObject* self, PyObject *args) {
 }
 
 
+template <typename T>
+static PyObject* mappedMean(const char* path, flatIndex rows, flatIndex cols, flatIndex offset, int axis) {
+
+    // mean of a rows by cols array of T read straight from a memory mapped file. The file is
+    // never copied, so it can be larger than memory and have more than 2^31 elements
+
+    flatArray<T>* result = nullptr;
+
+    if (rows > 1 && axis != 0 && axis != 1) {
+        PyErr_SetString(UnknownAxis, flatArrayUnknownAxis(axis).what());
+        return nullptr;
+    }
+
+    try {
+        mappedFile file(path);
+        flatArray<T>* X = file.array<T>(rows, cols, offset);
+
+        Py_BEGIN_ALLOW_THREADS
+        result = X->mean(axis);
+        Py_END_ALLOW_THREADS
+
+        delete X;
+    }
+    catch (mappedFileException &e) {
+        PyErr_SetString(PyExc_OSError, e.what());
+        return nullptr;
+    }
+    catch (arrayOutOfBoundsException &e) {
+        PyErr_SetString(OutOfBoundsException, e.what());
+        return nullptr;
+    }
+
+    PyObject *FinalResult = nullptr;
+
+    if (rows == 1) {
+        FinalResult = Py_BuildValue("d", result->getNElement(0));
+    }
+
+    else {
+        FinalResult = ConvertFlatArray_PyList(result, "float");
+    }
+
+    delete result;
+
+    return FinalResult;
+}
+
+
+static PyObject* mapped_mean(PyObject* self, PyObject *args, PyObject *kwargs) {
+
+    char defaultDtype[10] = "float64";
+    char* dtype = defaultDtype;
+    char* path = nullptr;
+    Py_ssize_t rows, cols;
+    Py_ssize_t offset = 0;
+    int axis = 0;
+
+    static const char* kwlist[] = {"path", "rows", "cols", "axis", "dtype", "offset", nullptr};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "snn|isn", const_cast<char**>(kwlist),
+                                     &path, &rows, &cols, &axis, &dtype, &offset)) {
+        PyErr_SetString(PyExc_TypeError, "Check arguments!");
+        return nullptr;
+    }
+
+    if (strcmp(dtype, "float32") == 0) {
+        return mappedMean<float>(path, rows, cols, offset, axis);
+    }
+
+    if (strcmp(dtype, "float64") == 0) {
+        return mappedMean<double>(path, rows, cols, offset, axis);
+    }
+
+    PyErr_SetString(PyExc_ValueError, "Unknown dtype!");
+    return nullptr;
+}
+
+
 static PyObject* standardDeviation(PyObject* self, PyObject *args) {
 
     // variable declaration
@@ -514,9 +671,16 @@ static PyObject* standardDeviation(PyObject* self, PyObject *args) {
 
     X = readFromPythonList<double>(pX);
 
-    result = X->std(degreesOfFreedom, axis);
+    try {
+        result = X->std(degreesOfFreedom, axis);
+    }
+    catch (flatArrayUnknownAxis &e) {
+        PyErr_SetString(UnknownAxis, e.what());
+        delete X;
+        return nullptr;
+    }
 
-    if (X->getRows() == 1) {
+    if (X->getRows() == 1 || axis == reduceAll) {
 
         FinalResult = Py_BuildValue("d", result->getNElement(0));
 
@@ -556,9 +720,16 @@ static PyObject* variance(PyObject* self, PyObject *args) {
 
     X = readFromPythonList<double>(pX);
 
-    result = X->var(degreesOfFreedom, axis);
+    try {
+        result = X->var(degreesOfFreedom, axis);
+    }
+    catch (flatArrayUnknownAxis &e) {
+        PyErr_SetString(UnknownAxis, e.what());
+        delete X;
+        return nullptr;
+    }
 
-    if (X->getRows() == 1) {
+    if (X->getRows() == 1 || axis == reduceAll) {
 
         FinalResult = Py_BuildValue("d", result->getNElement(0));
 
@@ -637,14 +808,12 @@ static PyObject* eigenSolve(PyObject* self, PyObject *args) {
 
     result = jacobiEigenDecomposition<double>(X, tolerance, maxIterations);
 
-    eigV = Convert_1DArray(result->getRow(0), result->getCols());
+    eigV = Convert_1DArray(result->viewRow(0).getData(), result->getCols());
 
     eigFArray = emptyArray<double>(result->getCols(), result->getCols());
 
     for (int i = 1; i < result->getRows(); ++i) {
-        double *rowResult = result->getRow(i);
-        eigFArray->setRow(rowResult, i - 1);
-        delete [] rowResult;
+        eigFArray->setRow(result->viewRow(i).getData(), i - 1);
     }
 
     eigE = ConvertFlatArray_PyList(eigFArray, "float");
@@ -662,6 +831,289 @@ static PyObject* eigenSolve(PyObject* self, PyObject *args) {
 }
 
 
+static const char* runningMomentsName = "pyml.maths.Clinear_algebra.moments";
+
+
+static void deleteRunningMoments(PyObject* capsule) {
+    delete static_cast<runningMoments*>(PyCapsule_GetPointer(capsule, runningMomentsName));
+}
+
+
+static PyObject* running_moments(PyObject* self, PyObject *args, PyObject *kwargs) {
+
+    Py_ssize_t cols;
+    int covariance = 0;
+
+    static const char* kwlist[] = {"cols", "covariance", nullptr};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "n|p", const_cast<char**>(kwlist), &cols, &covariance)) {
+        PyErr_SetString(PyExc_TypeError, "Check arguments!");
+        return nullptr;
+    }
+
+    if (cols < 1) {
+        PyErr_SetString(PyExc_ValueError, "The number of columns must be positive.");
+        return nullptr;
+    }
+
+    // the accumulator is owned by the capsule and freed with it
+    auto* moments = new runningMoments(cols, covariance != 0);
+
+    return PyCapsule_New(moments, runningMomentsName, deleteRunningMoments);
+}
+
+
+template <typename T>
+static bool updateMoments(runningMoments* moments, const flatArray<T>& X) {
+
+    // adds the rows of X, with the GIL released as chunks can be large
+
+    if (X.getCols() != moments->getCols()) {
+        flatArrayDimensionMismatchException<double> e(X.getRows(), X.getCols(), X.getRows(), moments->getCols());
+        PyErr_SetString(DimensionMismatchException, e.what());
+        return false;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    moments->update(X.getArray(), X.getRows());
+    Py_END_ALLOW_THREADS
+
+    return true;
+}
+
+
+static PyObject* moments_update(PyObject* self, PyObject *args, PyObject *kwargs) {
+
+    PyObject* pState;
+    PyObject* pX;
+
+    static const char* kwlist[] = {"state", "X", nullptr};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO!", const_cast<char**>(kwlist), &pState, &PyList_Type, &pX)) {
+        PyErr_SetString(PyExc_TypeError, "Check arguments!");
+        return nullptr;
+    }
+
+    auto* moments = static_cast<runningMoments*>(PyCapsule_GetPointer(pState, runningMomentsName));
+
+    if (moments == nullptr) {
+        return nullptr;
+    }
+
+    // empty chunks have nothing to add
+    if (PyList_GET_SIZE(pX) == 0) {
+        Py_RETURN_NONE;
+    }
+
+    // a list of numbers is a single row
+    flatArray<double>* X = readFromPythonList<double>(pX);
+
+    // rows that aren't numbers would add garbage to the accumulator
+    if (PyErr_Occurred()) {
+        delete X;
+        return nullptr;
+    }
+
+    bool updated = updateMoments(moments, *X);
+
+    delete X;
+
+    if (!updated) {
+        return nullptr;
+    }
+
+    Py_RETURN_NONE;
+}
+
+
+template <typename T>
+static bool updateMomentsMapped(runningMoments* moments, const char* path, flatIndex rows, flatIndex offset) {
+
+    try {
+        mappedFile file(path);
+        flatArray<T>* X = file.array<T>(rows, moments->getCols(), offset);
+
+        bool updated = updateMoments(moments, *X);
+
+        delete X;
+
+        return updated;
+    }
+    catch (mappedFileException &e) {
+        PyErr_SetString(PyExc_OSError, e.what());
+        return false;
+    }
+    catch (arrayOutOfBoundsException &e) {
+        PyErr_SetString(OutOfBoundsException, e.what());
+        return false;
+    }
+}
+
+
+static PyObject* moments_update_mapped(PyObject* self, PyObject *args, PyObject *kwargs) {
+
+    // adds rows read straight from a binary file (see Cmapped_mean)
+
+    char defaultDtype[10] = "float64";
+    char* dtype = defaultDtype;
+    char* path = nullptr;
+    PyObject* pState;
+    Py_ssize_t rows;
+    Py_ssize_t offset = 0;
+
+    static const char* kwlist[] = {"state", "path", "rows", "dtype", "offset", nullptr};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Osn|sn", const_cast<char**>(kwlist),
+                                     &pState, &path, &rows, &dtype, &offset)) {
+        PyErr_SetString(PyExc_TypeError, "Check arguments!");
+        return nullptr;
+    }
+
+    auto* moments = static_cast<runningMoments*>(PyCapsule_GetPointer(pState, runningMomentsName));
+
+    if (moments == nullptr) {
+        return nullptr;
+    }
+
+    bool updated;
+
+    if (strcmp(dtype, "float32") == 0) {
+        updated = updateMomentsMapped<float>(moments, path, rows, offset);
+    }
+
+    else if (strcmp(dtype, "float64") == 0) {
+        updated = updateMomentsMapped<double>(moments, path, rows, offset);
+    }
+
+    else {
+        PyErr_SetString(PyExc_ValueError, "Unknown dtype!");
+        return nullptr;
+    }
+
+    if (!updated) {
+        return nullptr;
+    }
+
+    Py_RETURN_NONE;
+}
+
+
+static PyObject* moments_merge(PyObject* self, PyObject *args) {
+
+    PyObject* pState;
+    PyObject* pOther;
+
+    if (!PyArg_ParseTuple(args, "OO", &pState, &pOther)) {
+        PyErr_SetString(PyExc_TypeError, "Check arguments!");
+        return nullptr;
+    }
+
+    auto* moments = static_cast<runningMoments*>(PyCapsule_GetPointer(pState, runningMomentsName));
+    auto* other = static_cast<runningMoments*>(PyCapsule_GetPointer(pOther, runningMomentsName));
+
+    if (moments == nullptr || other == nullptr) {
+        return nullptr;
+    }
+
+    try {
+        moments->merge(*other);
+    }
+    catch (flatArrayDimensionMismatchException<double> &e) {
+        PyErr_SetString(DimensionMismatchException, "Can only merge moments of the same columns, with or without "
+                                                    "covariance!");
+        return nullptr;
+    }
+
+    Py_RETURN_NONE;
+}
+
+
+static PyObject* moments_count(PyObject* self, PyObject *args) {
+
+    PyObject* pState;
+
+    if (!PyArg_ParseTuple(args, "O", &pState)) {
+        PyErr_SetString(PyExc_TypeError, "Check arguments!");
+        return nullptr;
+    }
+
+    auto* moments = static_cast<runningMoments*>(PyCapsule_GetPointer(pState, runningMomentsName));
+
+    if (moments == nullptr) {
+        return nullptr;
+    }
+
+    return Py_BuildValue("n", static_cast<Py_ssize_t>(moments->getCount()));
+}
+
+
+static PyObject* moments_result(PyObject* self, PyObject *args, PyObject *kwargs) {
+
+    // count, mean, variance, std and covariance (None unless requested) as a dictionary
+
+    PyObject* pState;
+    int degreesOfFreedom = 0;
+
+    static const char* kwlist[] = {"state", "degrees_of_freedom", nullptr};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|i", const_cast<char**>(kwlist), &pState, &degreesOfFreedom)) {
+        PyErr_SetString(PyExc_TypeError, "Check arguments!");
+        return nullptr;
+    }
+
+    auto* moments = static_cast<runningMoments*>(PyCapsule_GetPointer(pState, runningMomentsName));
+
+    if (moments == nullptr) {
+        return nullptr;
+    }
+
+    if (moments->getCount() <= degreesOfFreedom) {
+        PyErr_SetString(PyExc_ValueError, "Not enough rows for the degrees of freedom.");
+        return nullptr;
+    }
+
+    flatArray<double>* mean = moments->getMean();
+    flatArray<double>* variance = moments->getVariance(degreesOfFreedom);
+    flatArray<double>* std = moments->getStd(degreesOfFreedom);
+    flatArray<double>* covariance = moments->getCovariance(degreesOfFreedom);
+
+    PyObject* pyMean = ConvertFlatArray_PyList(mean, "float");
+    PyObject* pyVariance = ConvertFlatArray_PyList(variance, "float");
+    PyObject* pyStd = ConvertFlatArray_PyList(std, "float");
+    PyObject* pyCovariance = nullptr;
+
+    if (covariance != nullptr) {
+        pyCovariance = ConvertFlatArray_PyList(covariance, "float");
+    }
+
+    else {
+        Py_INCREF(Py_None);
+        pyCovariance = Py_None;
+    }
+
+    PyObject* FinalResult = Py_BuildValue("{s:n,s:O,s:O,s:O,s:O}", "count",
+                                          static_cast<Py_ssize_t>(moments->getCount()), "mean", pyMean,
+                                          "variance", pyVariance, "std", pyStd, "covariance", pyCovariance);
+
+    delete mean;
+    delete variance;
+    delete std;
+    delete covariance;
+
+    Py_DECREF(pyMean);
+    Py_DECREF(pyVariance);
+    Py_DECREF(pyStd);
+    Py_DECREF(pyCovariance);
+
+    return FinalResult;
+}
+
+
+static PyObject* scratchStatisticsPy(PyObject* self) {
+    return scratchStatisticsDict();
+}
+
+
 static PyObject* version(PyObject* self) {
     return Py_BuildValue("s", "Version 0.3");
 }
@@ -670,6 +1122,7 @@ static PyObject* version(PyObject* self) {
 static PyMethodDef linearAlgebraMethods[] = {
         // Python name    C function              argument representation  description
         {"dot_product",   dot_product,            METH_VARARGS,            "Calculate the dot product of two vectors"},
+        {"csr_dot",       (PyCFunction)csr_dot,   METH_VARARGS | METH_KEYWORDS, "Product of a CSR matrix (or its transpose) and a dense vector or matrix"},
         {"power",         power,                  METH_VARARGS,            "Calculate element wise power"},
         {"add",           add,                    METH_VARARGS,            "Calculate element wise addition"},
         {"subtract",      subtract,               METH_VARARGS,            "Calculate element wise subtraction"},
@@ -678,12 +1131,21 @@ static PyMethodDef linearAlgebraMethods[] = {
         {"sum",           sum,                    METH_VARARGS,            "Calculate the total sum of a vector"},
         {"determinant",   det,                    METH_VARARGS,            "Calculate the determinant of a square matrix"},
         {"transpose",     pyTranspose,            METH_VARARGS,            "Transpose a 2D matrix"},
+        {"transpose_bandwidth", (PyCFunction)transpose_bandwidth, METH_VARARGS | METH_KEYWORDS, "Timings of transpose and memcpy"},
         {"least_squares", least_squares,          METH_VARARGS,            "Perform least squares"},
         {"Cmean",         mean,                   METH_VARARGS,            "Numpy style array mean"},
+        {"Cmapped_mean",  (PyCFunction)mapped_mean, METH_VARARGS | METH_KEYWORDS, "Array mean of a binary file, read through a memory map"},
         {"Cstd",          standardDeviation,      METH_VARARGS,            "Numpy style array standard deviation"},
         {"Cvariance",     variance,               METH_VARARGS,            "Numpy style array variance"},
         {"Ccovariance",   cov,                    METH_VARARGS,            "Calculate covariance matrix"},
         {"eigen_solve",   eigenSolve,             METH_VARARGS,            "Eigendecomposition of symmetric matrix"},
+        {"Crunning_moments", (PyCFunction)running_moments, METH_VARARGS | METH_KEYWORDS, "New running moments accumulator"},
+        {"Cmoments_update", (PyCFunction)moments_update, METH_VARARGS | METH_KEYWORDS, "Add a chunk of rows to running moments"},
+        {"Cmoments_update_mapped", (PyCFunction)moments_update_mapped, METH_VARARGS | METH_KEYWORDS, "Add rows of a binary file to running moments"},
+        {"Cmoments_merge", moments_merge,          METH_VARARGS,            "Merge running moments into others"},
+        {"Cmoments_count", moments_count,          METH_VARARGS,            "Number of rows of running moments"},
+        {"Cmoments_result", (PyCFunction)moments_result, METH_VARARGS | METH_KEYWORDS, "Statistics of running moments"},
+        {"scratch_statistics", (PyCFunction)scratchStatisticsPy, METH_NOARGS, "Counters of the scratch arenas"},
         {"version",       (PyCFunction)version,   METH_NOARGS,             "Returns version."},
         {nullptr, nullptr, 0, nullptr}
 };
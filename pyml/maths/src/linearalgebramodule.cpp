@@ -2,16 +2,21 @@
 // Created by Gil Ferreira Hoben on 07/11/17.
 //
 
+#ifndef PYML_LINEARALGEBRAMODULE_CPP
+#define PYML_LINEARALGEBRAMODULE_CPP
+
 #include <flatArrays.h>
 #include "flatArrays.cpp"
 #include "linearalgebramodule.h"
 #include "exceptionClasses.h"
+#include "scratchArena.h"
 
 // Handle errors
 // static PyObject *algebraError;
 
 
-inline void maximumSearch(double* vector, int size, int i, double* result) {
+template <typename T>
+inline void maximumSearch(const flatArrayView<T>& vector, int size, int i, T* result) {
     // store result in result array
     // result[0] is the maximum value and result[1] is the position of the maximum value
     result[0] = vector[i];
@@ -33,15 +38,13 @@ inline void maximumSearch(double* vector, int size, int i, double* result) {
 template <typename T>
 inline void swapRows(flatArray<T> *A, int row1, int row2) {
 
-    T *aRow1 = A->getRow(row1);
-    T *aRow2 = A->getRow(row2);
-
-    A->setRow(aRow2, row1);
-    A->setRow(aRow1, row2);
-
-    delete [] aRow1;
-    delete [] aRow2;
+    // swaps the rows in place
+    flatArrayView<T> aRow1 = A->viewRow(row1);
+    flatArrayView<T> aRow2 = A->viewRow(row2);
 
+    for (int j = 0; j < A->getCols(); ++j) {
+        std::swap(aRow1[j], aRow2[j]);
+    }
 }
 
 template <typename T>
@@ -51,15 +54,12 @@ void gaussianElimination(flatArray<T> *A, T *result) {
 
     int n = A->getRows();
 
-    T *maxResult = nullptr;
-    maxResult = new T[2];
+    T maxResult[2];
     T c;
-    T *rowI = nullptr;
-    T *rowK = nullptr;
 
     for (int i = 0; i < n; ++i) {
         // Search for maximum in this column
-        maximumSearch(A->getRow(i), n, i, maxResult);
+        maximumSearch(A->viewRow(i), n, i, maxResult);
 
         if (maxResult[0] == 0) {
             throw singularMatrixException();
@@ -68,11 +68,13 @@ void gaussianElimination(flatArray<T> *A, T *result) {
         // Swap maximum row with current row (column by column)
         swapRows(A, (int) maxResult[1], i);
 
-        rowI = A->getRow(i);
+        // rows i and k are updated in place
+        flatArrayView<T> rowI = A->viewRow(i);
+
         // Make all rows below this one 0 in current column
         for (int k = i + 1; k < n; k++) {
 
-            rowK = A->getRow(k);
+            flatArrayView<T> rowK = A->viewRow(k);
 
             c = -rowK[i] / rowI[i];
 
@@ -87,11 +89,7 @@ void gaussianElimination(flatArray<T> *A, T *result) {
                     rowK[j] += c * rowI[j];
 
                 }
-
-                A->setRow(rowK, k);
             }
-
-            A->setRow(rowI, i);
         }
     }
 
@@ -105,15 +103,104 @@ void gaussianElimination(flatArray<T> *A, T *result) {
             A->setElement(A->getElement(j, n) - A->getElement(j, i) * result[i], j, n);
         }
     }
+}
+
+
+template <typename T>
+void centredLeastSquares(flatArray<T> &X, flatArray<T> &y, T *theta) {
+
+    // least squares with an intercept, without a column of ones in X
+    //
+    //      (Xc^T · Xc) · w = Xc^T · (y - ȳ)        b = ȳ - μ · w
+    //
+    // where Xc = X - μ is X with centred columns. Xc is never stored, the centred values are
+    // used to build the normal equations one row at a time, and theta is [b, w].
+
+    typedef typename accumulator<T>::type Acc;
+
+    flatIndex rows = X.getRows();
+    flatIndex m = X.getCols();
+    T* x = X.getArray();
+
+    auto* mu = new Acc[m]();
+    auto* centred = new Acc[m];
+    Acc yMean = 0;
+
+    for (flatIndex i = 0; i < rows; ++i) {
+        for (flatIndex j = 0; j < m; ++j) {
+            mu[j] += x[i * m + j];
+        }
+        yMean += y[i];
+    }
+
+    for (flatIndex j = 0; j < m; ++j) {
+        mu[j] /= rows;
+    }
+
+    yMean /= rows;
+
+    // the augmented matrix [Xc^T · Xc | Xc^T · (y - ȳ)], only the upper triangle is accumulated
+    auto* A = zeroArray<T>(m, m + 1);
+    auto* sums = new Acc[m * (m + 1)]();
+
+    for (flatIndex i = 0; i < rows; ++i) {
+
+        for (flatIndex j = 0; j < m; ++j) {
+            centred[j] = x[i * m + j] - mu[j];
+        }
+
+        Acc target = y[i] - yMean;
+
+        for (flatIndex j = 0; j < m; ++j) {
+            for (flatIndex k = j; k < m; ++k) {
+                sums[j * (m + 1) + k] += centred[j] * centred[k];
+            }
+            sums[j * (m + 1) + m] += centred[j] * target;
+        }
+    }
+
+    for (flatIndex j = 0; j < m; ++j) {
+        for (flatIndex k = j; k < m; ++k) {
+            A->setNElement(static_cast<T>(sums[j * (m + 1) + k]), j * (m + 1) + k);
+            A->setNElement(static_cast<T>(sums[j * (m + 1) + k]), k * (m + 1) + j);
+        }
+        A->setNElement(static_cast<T>(sums[j * (m + 1) + m]), j * (m + 1) + m);
+    }
+
+    delete [] sums;
+    delete [] centred;
+
+    try {
+        gaussianElimination(A, theta + 1);
+    }
+    catch (singularMatrixException &e) {
+        delete [] mu;
+        delete A;
+        throw;
+    }
+
+    Acc b = yMean;
+
+    for (flatIndex j = 0; j < m; ++j) {
+        b -= mu[j] * theta[j + 1];
+    }
+
+    theta[0] = static_cast<T>(b);
 
-    delete [] maxResult;
-    delete [] rowI;
-    delete [] rowK;
+    delete [] mu;
+    delete A;
 }
 
 
 template <typename T>
-void leastSquares(flatArray<T> &X, flatArray<T> &y, T *theta) {
+void leastSquares(flatArray<T> &X, flatArray<T> &y, T *theta, int fitIntercept) {
+
+    // with fitIntercept theta has X.getCols() + 1 elements, the first being the intercept
+
+    if (fitIntercept) {
+        centredLeastSquares(X, y, theta);
+        return;
+    }
 
     // variable declaration
     flatArray<T>* A = nullptr;
@@ -206,19 +293,16 @@ flatArray<T>* covariance(flatArray<T> *X) {
         // the diagonal of the covariance matrix is the column wise variance of X
         covMatrix->setNElement(XVar->getNElement(i), i + i * cols);
 
-        T *Vec1 = nullptr;
-
-        // get ith vector
-        Vec1 = X->getCol(i);
+        // ith vector
+        flatArrayView<T> Vec1 = X->viewCol(i);
 
         // only need to calculate the upper triangle
         for (int j = cols - 1; j > i; --j) {
 
-            T *Vec2 = nullptr;
             flatArray<T>* vecProdMean = nullptr;
 
-            // get jth vector
-            Vec2 = X->getCol(j);
+            // jth vector
+            flatArrayView<T> Vec2 = X->viewCol(j);
 
             for (int k = 0; k < rows; ++k) {
                 vecProd->setNElement(Vec1[k] * Vec2[k], k);
@@ -234,11 +318,8 @@ flatArray<T>* covariance(flatArray<T> *X) {
             covMatrix->setNElement(result, i * cols + j);
             covMatrix->setNElement(result, j * cols + i);
 
-            delete [] Vec2;
             delete vecProdMean;
         }
-
-        delete [] Vec1;
     }
 
     // memory dellocation
@@ -260,9 +341,7 @@ void *maxElementOffDiag(flatArray<T> *S, T result[3]) {
 
     for (int k = 0; k < n; ++k) {
 
-        T *row = nullptr;
-
-        row = S->getRowSlice(k, k + 1, n);
+        flatArrayView<T> row = S->viewRowSlice(k, k + 1, n);
 
         int j = 0;
         for (int i = k + 1; i < n; ++i) {
@@ -274,8 +353,6 @@ void *maxElementOffDiag(flatArray<T> *S, T result[3]) {
             }
             j++;
         }
-
-        delete [] row;
     }
 
     return result;
@@ -298,8 +375,7 @@ flatArray<T>* jacobiEigenDecomposition(flatArray<T> *S, double tolerance, int ma
     flatArray<T>* E = nullptr;
     flatArray<T>* result = nullptr;
 
-    T *maxValues = nullptr;
-    maxValues = new T[3];
+    T maxValues[3];
 
     // number of rows
     int n = S->getRows();
@@ -396,48 +472,25 @@ flatArray<T>* jacobiEigenDecomposition(flatArray<T> *S, double tolerance, int ma
     }
 
     // the diagonal of S has the eigenvalues
-    auto diag = S->diagonal();
-
-    result->setRow(diag, 0);
+    for (int i = 0; i < n; ++i) {
+        result->setNElement(S->getNElement(i * n + i), i);
+    }
 
     for (int j = 1; j < n + 1; ++j) {
-        auto *row = E->getRow(j -1);
-        result->setRow(row, j);
-        delete [] row;
+        E->viewRow(j - 1).copyTo(result->viewRow(j).getData());
     }
 
     // memory deallocation
     delete E;
-    delete [] diag;
-    delete [] maxValues;
 
     return result;
 }
 
 template <typename T>
-inline flatArray<T>* signChart(int rows, int cols) {
-
-    flatArray<T>* result = nullptr;
-
-    result = emptyArray<T>(rows, cols);
-
-    for (int i = 0; i < result->getSize(); ++i) {
-
-        if (i % 2 == 0) {
-            result->setNElement(1, i);
-        }
-
-        else {
-            result->setNElement(-1 , i);
-        }
-    }
-
-    return result;
-}
+double determinant(flatArray<T>* array, scratchArena& scratch) {
 
-
-template <typename T>
-double determinant(flatArray<T>* array) {
+    // Laplace expansion along the first row. The minors of each level are taken from scratch and
+    // released once their determinant is known, so the recursion reuses the same memory.
 
     int rows = array->getRows();
     int cols = array->getCols();
@@ -450,57 +503,46 @@ double determinant(flatArray<T>* array) {
     }
 
     else {
-        flatArray<T>* M = nullptr;
-        flatArray<T>* C = nullptr;
-        flatArray<T>* signs = nullptr;
-
-        // find determinant of minors and store in matrix M
-        M = emptyArray<T>(rows, cols);
+        flatArrayView<T> row = array->viewRow(0);
 
-        int m = 0;
+        for (int j = 0; j < cols; ++j) {
 
-        for (int i = 0; i < rows; ++i) {
-            for (int j = 0; j < cols; ++j) {
+            scratchArena::mark start = scratch.getMark();
 
-                flatArray<T> *M_i = nullptr;
+            flatArray<T>* M_0j = scratch.array<T>(rows - 1, cols - 1);
 
-                M_i = emptyArray<T>(rows - 1, cols - 1);
+            // populate M_0j with all rows except 0, and all cols except j
+            int n = 0;
 
-                // populate M_i with all rows except i, and all cols except j
-                int n = 0;
+            for (int k = 1; k < rows; ++k) {
+                for (int l = 0; l < cols; ++l) {
 
-                for (int k = 0; k < rows; ++k) {
-                    for (int l = 0; l < cols; ++l) {
-
-                        if (k != i && l != j) {
-                            M_i->setNElement(array->getNElement(k * cols + l), n);
-                            n++;
-                        }
+                    if (l != j) {
+                        M_0j->setNElement(array->getNElement(k * cols + l), n);
+                        n++;
                     }
                 }
+            }
 
-                M->setNElement(determinant(M_i), m);
+            // cofactor C(0, j) = (-1) ** j · det(M_0j)
+            T cofactor = static_cast<T>(determinant(M_0j, scratch)) * (j % 2 == 0 ? 1 : -1);
 
-                m++;
-                delete M_i;
-            }
+            determinantResult += row[j] * cofactor;
+
+            scratch.rewind(start);
         }
+    }
 
-        signs = signChart<T>(rows, cols);
+    return determinantResult;
+}
 
-        C = (*M) * (*signs);
 
-        T* row = array->getRow(0);
+template <typename T>
+double determinant(flatArray<T>* array) {
 
-        for (int i = 0; i < rows; ++i) {
-            determinantResult += row[i] * C->getNElement(i);
-        }
+    scratchArena scratch;
 
-        delete [] row;
-        delete signs;
-        delete M;
-        delete C;
-    }
+    return determinant(array, scratch);
+}
 
-    return determinantResult;
-}
\ No newline at end of file
+#endif //PYML_LINEARALGEBRAMODULE_CPP
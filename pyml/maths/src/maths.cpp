@@ -1,6 +1,10 @@
 //
 // Created by Gil Ferreira Hoben on 07/11/17.
 //
+
+#ifndef PYML_MATHS_CPP
+#define PYML_MATHS_CPP
+
 #include "maths.h"
 #include <random>
 
@@ -22,17 +26,35 @@ inline T MAX(T a, T b) {
 }
 
 
-inline void shuffle(int* rNums, int size) {
+inline void shuffle(std::ptrdiff_t* rNums, std::ptrdiff_t size) {
     // Fisher–Yates shuffle
 
-    int j, i;
+    std::ptrdiff_t j, i;
+
+    i = size - 1;
+
+    while (i > 0)
+    {
+        j = static_cast<std::ptrdiff_t>(random() % (size - i + 1));
+        swap<std::ptrdiff_t>(rNums[i], rNums[j]);
+        i--;
+    }
+}
+
+
+template <typename Generator>
+inline void shuffle(std::ptrdiff_t* rNums, std::ptrdiff_t size, Generator& generator) {
+    // Fisher–Yates shuffle drawing from a caller owned random number generator,
+    // so that concurrent callers do not share the random() state
+
+    std::ptrdiff_t j, i;
 
     i = size - 1;
 
     while (i > 0)
     {
-        j = static_cast<int>(random() % (size - i + 1));
-        swap<int>(rNums[i], rNums[j]);
+        j = static_cast<std::ptrdiff_t>(generator() % (size - i + 1));
+        swap<std::ptrdiff_t>(rNums[i], rNums[j]);
         i--;
     }
 }
@@ -104,33 +126,4 @@ template <typename T>
 }
 
 
-inline int argmax(const double *array, int size) {
-
-    int result = 0;
-    double max = array[result];
-
-    for (int i = 1; i < size; ++i) {
-        if (array[i] > max) {
-            result = i;
-            max = array[i];
-        }
-    }
-
-    return result;
-}
-
-
-inline int argmin(const double *array, int size) {
-
-    int result = 0;
-    double min = array[result];
-
-    for (int i = 1; i < size; ++i) {
-        if (array[i] < min) {
-            result = i;
-            min = array[i];
-        }
-    }
-
-    return result;
-}
\ No newline at end of file
+#endif //PYML_MATHS_CPP
@@ -36,7 +36,9 @@ static PyObject* quick_sort(PyObject* self, PyObject *args) {
         int*orderArray = nullptr;
 
         orderArray = new int[A->getSize()];
-        double *array = A->getRow(0);
+
+        // rows are contiguous, so they are sorted in place
+        double *array = A->viewRow(0).getData();
 
         for (int i = 0; i < A->getSize(); ++i) {
             orderArray[i] = i;
@@ -45,7 +47,6 @@ static PyObject* quick_sort(PyObject* self, PyObject *args) {
         quicksort<double>(array, orderArray, 0, A->getSize());
 
         order->setRow(orderArray, 0);
-        A->setRow(array, 0);
     }
 
     else {
@@ -58,7 +59,7 @@ static PyObject* quick_sort(PyObject* self, PyObject *args) {
             for (int i = 0; i < A->getRows(); ++i) {
 
                 auto *orderArray = new int[A->getCols()];
-                double *array = A->getRow(i);
+                double *array = A->viewRow(i).getData();
 
                 for (int j = 0; j < A->getCols(); ++j) {
                     orderArray[j] = j;
@@ -67,7 +68,6 @@ static PyObject* quick_sort(PyObject* self, PyObject *args) {
                 quicksort<double>(array, orderArray, 0, A->getCols());
 
                 order->setRow(orderArray, i);
-                A->setRow(array, i);
 
             }
         }
@@ -120,11 +120,11 @@ static PyObject* quick_sort(PyObject* self, PyObject *args) {
 }
 
 
-static PyObject* Cargmax(PyObject* self, PyObject *args) {
+static PyObject* argExtreme(PyObject *args, bool maximum) {
 
     // variable instantiation
     flatArray<double>* A = nullptr;
-    flatArray<double>* resultList = nullptr;
+    flatArray<flatIndex>* resultList = nullptr;
     int axis;
 
     // pointers to python lists
@@ -139,64 +139,16 @@ static PyObject* Cargmax(PyObject* self, PyObject *args) {
     // read in Python list
     A = readFromPythonList<double>(pA);
 
-    if (A->getRows() == 1) {
-
-        // if A is a vector
-        double *array = A->getRow(0);
-
-        resultList = emptyArray<double>(1, 1);
-
-        resultList->setNElement(argmax(array, A->getCols()), 0);
-
-        delete [] array;
+    // index of the extreme of a vector, or of each column (axis 0) or row (axis 1) of a matrix
+    try {
+        resultList = maximum ? A->argmax(axis) : A->argmin(axis);
     }
-
-    else {
-        // if A is a matrix
-        if (axis == 1) {
-
-            resultList = emptyArray<double>(1, A->getRows());
-
-            double *array = nullptr;
-
-            // if axis is 1 return row wise argmax
-            for (int i = 0; i < A->getRows(); ++i) {
-
-                array = A->getRow(i);
-
-                resultList->setNElement(argmax(array, A->getCols()), i);
-
-            }
-
-            delete [] array;
-
-        }
-        else if (axis == 0) {
-
-            resultList = emptyArray<double>(1, A->getCols());
-
-            double *array = nullptr;
-
-            // if axis is 1 return column wise argmax
-            for (int i = 0; i < A->getCols(); ++i) {
-
-                array = A->getCol(i);
-
-                resultList->setNElement(argmax(array, A->getRows()), i);
-
-            }
-
-            delete [] array;
-
-        }
-        else {
-            // ERROR
-            PyErr_SetString(PyExc_TypeError, "Expected axis value to be 0 or 1");
-            return nullptr;
-        }
+    catch (flatArrayUnknownAxis &e) {
+        PyErr_SetString(PyExc_TypeError, "Expected axis value to be 0 or 1");
+        delete A;
+        return nullptr;
     }
 
-
     // convert result to python list
     PyObject* result_py_list = ConvertFlatArray_PyList(resultList, "int");
 
@@ -205,6 +157,7 @@ static PyObject* Cargmax(PyObject* self, PyObject *args) {
 
     // free up memory
     delete A;
+    delete resultList;
 
     Py_DECREF(result_py_list);
 
@@ -212,95 +165,13 @@ static PyObject* Cargmax(PyObject* self, PyObject *args) {
 }
 
 
-static PyObject* Cargmin(PyObject* self, PyObject *args) {
-
-    // variable instantiation
-    flatArray<double>* A = nullptr;
-    flatArray<double>* resultList = nullptr;
-    int axis;
-
-    // pointers to python lists
-    PyObject* pA;
-
-    // return error if we don't get all the arguments
-    if (!PyArg_ParseTuple(args, "O!i", &PyList_Type, &pA, &axis)) {
-        PyErr_SetString(PyExc_TypeError, "Expected one lists and an integer!");
-        return nullptr;
-    }
-
-    // read in Python list
-    A = readFromPythonList<double>(pA);
-
-    if (A->getRows() == 1) {
-
-        // if A is a vector
-        double *array = A->getRow(0);
-
-        resultList = emptyArray<double>(1, 1);
-
-        resultList->setNElement(argmin(array, A->getCols()), 0);
-
-        delete [] array;
-    }
-
-    else {
-        // if A is a matrix
-        if (axis == 1) {
-
-            resultList = emptyArray<double>(1, A->getRows());
-
-            double *array = nullptr;
-
-            // if axis is 1 return row wise argmax
-            for (int i = 0; i < A->getRows(); ++i) {
-
-                array = A->getRow(i);
-
-                resultList->setNElement(argmin(array, A->getCols()), i);
-
-            }
-
-            delete [] array;
-
-        }
-        else if (axis == 0) {
-
-            resultList = emptyArray<double>(1, A->getCols());
-
-            double *array = nullptr;
-
-            // if axis is 1 return column wise argmax
-            for (int i = 0; i < A->getCols(); ++i) {
-
-                array = A->getCol(i);
-
-                resultList->setNElement(argmin(array, A->getRows()), i);
-
-            }
-
-            delete [] array;
-
-        }
-        else {
-            // ERROR
-            PyErr_SetString(PyExc_TypeError, "Expected axis value to be 0 or 1");
-            return nullptr;
-        }
-    }
-
-
-    // convert result to python list
-    PyObject* result_py_list = ConvertFlatArray_PyList(resultList, "int");
-
-    // build python object
-    PyObject *FinalResult = Py_BuildValue("O", result_py_list);
-
-    // free up memory
-    delete A;
+static PyObject* Cargmax(PyObject* self, PyObject *args) {
+    return argExtreme(args, true);
+}
 
-    Py_DECREF(result_py_list);
 
-    return FinalResult;
+static PyObject* Cargmin(PyObject* self, PyObject *args) {
+    return argExtreme(args, false);
 }
 
 
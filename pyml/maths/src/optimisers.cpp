@@ -3,11 +3,22 @@
 //
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
 #include "flatArrays.h"
 #include "flatArrays.cpp"
 #include "optimisersExtension.h"
 #include "maths.h"
 #include "maths.cpp"
+#include "linearalgebramodule.cpp"
+#include "scratchArena.h"
+#include "flatArrayExpressions.h"
+#include "csrArrays.h"
 
 
 template <typename T>
@@ -19,9 +30,27 @@ inline void sigmoid(flatArray<T> *scores) {
 
 
 template <typename T>
-inline void predict(flatArray<T> &X, flatArray<T> &w, char predType[10], flatArray<T> *result) {
+inline void predict(flatArray<T> &X, flatArray<T> &w, char predType[10], flatArray<T> *result, int fitIntercept) {
 
-    *result = *X.dot(w);
+    if (fitIntercept) {
+        // w[0] is the intercept, and X has no column for it
+        flatIndex m = X.getCols();
+        T* x = X.getArray();
+
+        for (flatIndex i = 0; i < X.getRows(); ++i) {
+            typename accumulator<T>::type score = w[0];
+
+            for (int j = 0; j < m; ++j) {
+                score += x[i * m + j] * w[j + 1];
+            }
+
+            result->setNElement(static_cast<T>(score), i);
+        }
+    }
+
+    else {
+        *result = *X.dot(w);
+    }
 
     // if using classification, calculate sigmoid(h)
     if (strcmp(predType, "logit") == 0) {
@@ -29,13 +58,35 @@ inline void predict(flatArray<T> &X, flatArray<T> &w, char predType[10], flatArr
     }
 }
 
+template <typename T>
+inline void predict(csrArray<T> &X, flatArray<T> &w, char predType[10], flatArray<T> *result, int fitIntercept) {
+
+    // same as above for sparse X, each score only reads the non zeros of its row
+
+    typedef typename accumulator<T>::type A;
+
+    for (flatIndex i = 0; i < X.getRows(); ++i) {
+        A score = X.rowDot(i, w.getArray() + fitIntercept, static_cast<A>(fitIntercept ? w[0] : 0));
+        result->setNElement(static_cast<T>(score), i);
+    }
+
+    if (strcmp(predType, "logit") == 0) {
+        sigmoid(result);
+    }
+}
+
+
 template <typename T>
 inline T logLikelihood(flatArray<T> &scores, flatArray<T> &y) {
 
-    T result = 0;
+    typedef typename accumulator<T>::type A;
 
-    for (int i = 0; i < y.getSize(); ++i) {
-        result += y[i] * scores[i] - log(1 + exp(scores[i]));
+    A result = 0;
+
+    for (flatIndex i = 0; i < y.getSize(); ++i) {
+        // log(1 + exp(s)) computed without overflow
+        A score = scores[i];
+        result += y[i] * score - (score > 0 ? score + log1p(exp(-score)) : log1p(exp(score)));
     }
 
     return result;
@@ -43,24 +94,23 @@ inline T logLikelihood(flatArray<T> &scores, flatArray<T> &y) {
 
 
 template <typename T>
-inline T cost(flatArray<T>& loss){
-
-    loss.power(2, 1);
+inline T cost(flatArray<T>& prediction, flatArray<T>& y){
 
-    T costResult = loss.sum() / (2 * loss.getCols());
+    // squared residuals summed in a single pass (see flatArrayExpressions.h)
+    T costResult = sum(power(lazy(prediction) - lazy(y), 2)) / (2 * prediction.getCols());
 
     return costResult;
 }
 
 
-template <typename T>
-inline T calculateCost(flatArray<T>& X, flatArray<T>& theta, flatArray<T> &y,
-                       flatArray<T>* prediction, char predType[10]) {
+template <typename T, class M>
+inline T calculateCost(M& X, flatArray<T>& theta, flatArray<T> &y,
+                       flatArray<T>* prediction, char predType[10], int fitIntercept) {
 
     T result;
-    char empty[0];
+    char empty[10] = "";
 
-    predict<T>(X, theta, empty, prediction);
+    predict<T>(X, theta, empty, prediction, fitIntercept);
 
 
     if (strcmp(predType, "logit") == 0) {
@@ -70,8 +120,7 @@ inline T calculateCost(flatArray<T>& X, flatArray<T>& theta, flatArray<T> &y,
     else {
 
         // calculate initial cost and store result
-        *prediction-=y;
-        result = cost(*prediction);
+        result = cost(*prediction, y);
     }
 
     return result;
@@ -79,467 +128,2808 @@ inline T calculateCost(flatArray<T>& X, flatArray<T>& theta, flatArray<T> &y,
 
 
 template <typename T>
-inline void updateWeights(flatArray<T>& X, flatArray<T>& y, flatArray<T>* theta, flatArray<T>& XT, flatArray<T>* nu,
-                          flatArray<T>* error, double gamma, double learningRate, int m, T n, char predType[10],
-                          char method[10], T epsilon, flatArray<T>* G, int iteration) {
-
-    // variable declaration
-    flatArray<T>* updateTerm = nullptr;
-
-    if (strcmp(method, "normal") == 0) {
+inline T lossAndGradient(flatArray<T>& X, flatArray<T>& y, const T* theta, char predType[10], T* gradient,
+                         int fitIntercept) {
 
-    // #######################################################
-    //                 Vanilla gradient term
-    // #######################################################
+    // Fused loss and gradient evaluation, with a single pass over the rows of X.
+    // Returns the objective to minimise, i.e. the mean squared error / 2 for regression
+    // and the mean negative log likelihood for classification
     //
-    //                   updateTerm = ∇J(θ)
+    //      J(θ) = Σ (h(x[i]) - y[i]) ** 2 / 2n      or      J(θ) = -Σ (y[i] · s[i] - log(1 + exp(s[i]))) / n
     //
-        // get error for this step
-        predict<T>(X, *theta, predType, error);
-        *error -= y;
+    //                          ∇J(θ) = Σ (h(x[i]) - y[i]) · x[i] / n
+    //
+    // With fitIntercept θ[0] is the intercept, which is added to the score instead of being
+    // multiplied by a column of ones, and its gradient is the mean residual.
 
-        // calculate updateTerm = gradient
-        updateTerm = XT.dot(*error);
-        *updateTerm /= n;
-    }
+    flatIndex rows = X.getRows();
+    flatIndex cols = X.getCols();
+    int m = cols + fitIntercept;
+    auto n = static_cast<T>(rows);
+    int logit = strcmp(predType, "logit") == 0;
 
-    else if (strcmp(method, "nesterov") == 0) {
+    typedef typename accumulator<T>::type A;
 
-    // #######################################################
-    //                 Nesterov gradient term
-    // #######################################################
-    //
-    //             updateTerm = ∇J(θ − γ · v[t-1])
-    //
+    T* x = X.getArray();
+    A loss = 0;
 
-        // copy theta
-        auto* tempTheta = new flatArray<T>(*theta);
+    // per thread buffer, as in gatherGradient
+    thread_local std::vector<A> sum;
+    sum.assign(static_cast<size_t>(m), 0);
 
-        // approximate next position of parameters (θ − γ · v[t-1])
-        for (int i = 0; i < m; ++i) {
-            T nu_i = nu->getNElement(i) * gamma;
-            tempTheta->setNElement((*theta)[i] - nu_i, i);
+    const T* w = theta + fitIntercept;
+
+    for (flatIndex i = 0; i < rows; ++i) {
+
+        T* row = x + i * cols;
+        A score = fitIntercept ? theta[0] : 0;
+        A residual;
+
+        for (flatIndex j = 0; j < cols; ++j) {
+            score += row[j] * w[j];
         }
 
-        // calculate the gradient with new theta
-        predict<T>(X, *tempTheta, predType, error);
-        *error -= y;
+        if (logit) {
+            // log(1 + exp(s)) computed without overflow
+            loss += (score > 0 ? score + log1p(exp(-score)) : log1p(exp(score))) - y[i] * score;
+            residual = 1 / (1 + exp(-score)) - y[i];
+        }
 
-        updateTerm = XT.dot(*error);
-        *updateTerm /= n;
+        else {
+            residual = score - y[i];
+            loss += residual * residual;
+        }
 
-        delete tempTheta;
+        if (fitIntercept) {
+            sum[0] += residual;
+        }
 
+        for (flatIndex j = 0; j < cols; ++j) {
+            sum[j + fitIntercept] += residual * row[j];
+        }
     }
 
-    else if (strcmp(method, "adagrad") == 0) {
+    for (int j = 0; j < m; ++j) {
+        gradient[j] = static_cast<T>(sum[j] / n);
+    }
 
-    // #######################################################
-    //                 Adagrad gradient term
-    // #######################################################
-    //
-    //                   g[t] = ∇J(θ[t])
-    //
-    //                  G[t] = G[t - 1] + g[t] ** 2
-    //
-    //         updateTerm = g[t] / ((G[t] ** 0.5 + e)
-    //
-        flatArray<T>* g = nullptr;
-        flatArray<T>* g_2 = nullptr;
-        flatArray<T>* G_i = nullptr;
+    if (logit) {
+        return static_cast<T>(loss / n);
+    }
 
-        // get predictions for this step
-        predict<T>(X, *theta, predType, error);
-        (*error) -= y;
+    return static_cast<T>(loss / (2 * n));
+}
 
-        g = XT.dot(*error);
-        (*g) /= n; // g = ∇J(θ[t])
 
-        g_2 = g->power(2, 0); // g_2 = g[t] ** 2
+template <typename T>
+inline T lossAndGradient(csrArray<T>& X, flatArray<T>& y, const T* theta, char predType[10], T* gradient,
+                         int fitIntercept) {
 
-        (*G) += (*g_2); // G += g_2
+    // same as above for sparse X, in time proportional to the number of non zeros
 
-        G_i = G->power(0.5, 0); // G_i = G ** 0.5
-        (*G_i) += epsilon; // G_i += e
+    flatIndex rows = X.getRows();
+    int m = X.getCols() + fitIntercept;
+    auto n = static_cast<T>(rows);
+    int logit = strcmp(predType, "logit") == 0;
 
-        updateTerm = g->divide(*G_i, 0); // updateTerm = g / G_i
+    typedef typename accumulator<T>::type A;
 
-        delete g;
-        delete G_i;
-        delete g_2;
-    }
+    A loss = 0;
 
-    else if (strcmp(method, "adadelta") == 0) {
-    // #######################################################
-    //                 Adadelta gradient term
-    // #######################################################
-    //
-    //            RMS[∆θ][t] = (E[∆θ**2] + e) ** .5
-    //
-    //          ∆θt= (-RMS[∆θ[t-1]] / RMS[g[t]]) · g[t]
-    //
-    // Note: In this implementation the negative sign is ignored,
-    // since all update terms are subtracted from theta anyway
-    //
+    thread_local std::vector<A> sum;
+    sum.assign(static_cast<size_t>(m), 0);
 
-        flatArray<T>* g = nullptr;
-        flatArray<T>* g_2 = nullptr;
-        flatArray<T>* E_prev = nullptr;
-        flatArray<T>* E_i = nullptr;
+    for (flatIndex i = 0; i < rows; ++i) {
 
-        // previous mean
-        // (E[g[t-1]**2] + e) ** .5
-        E_prev = (*G) + epsilon;
-        E_prev->power(0.5, 1);
+        A score = X.rowDot(i, theta + fitIntercept, static_cast<A>(fitIntercept ? theta[0] : 0));
+        A residual;
 
-        // get predictions for this step
-        predict<T>(X, *theta, predType, error);
-        *error -= y;
+        if (logit) {
+            loss += (score > 0 ? score + log1p(exp(-score)) : log1p(exp(score))) - y[i] * score;
+            residual = 1 / (1 + exp(-score)) - y[i];
+        }
 
-        g = XT.dot(*error);
-        *g /= n; // g = ∇J(θ[t])
+        else {
+            residual = score - y[i];
+            loss += residual * residual;
+        }
 
-        g_2 = g->power(2, 0); // g_2 = g[t] ** 2
+        if (fitIntercept) {
+            sum[0] += residual;
+        }
 
-        // online mean:
-        //
-        // delta = (x - mean) / n
-        // mean += delta
+        X.rowAxpy(i, residual, sum.data() + fitIntercept);
+    }
 
-        *g_2 -= *G;
+    for (int j = 0; j < m; ++j) {
+        gradient[j] = static_cast<T>(sum[j] / n);
+    }
 
-        // new mean
-        for (int j = 0; j < m; ++j) {
-            T temp = g_2->getNElement(j) / static_cast<T>(iteration + 1);
-            G->setNElement(G->getNElement(j) + temp, j); // G += E[∆θ**2]
-        }
+    if (logit) {
+        return static_cast<T>(loss / n);
+    }
 
-        E_i = *G + epsilon;
-        E_i->power(0.5, 1); // RMS[g[t]]
+    return static_cast<T>(loss / (2 * n));
+}
 
-        updateTerm = *E_prev / *E_i;
 
-        *updateTerm *= *g;// g[t] * (RMS[∆θ[t-1]] / RMS[g[t]])
+template <typename T>
+inline T objectiveToCost(T objective, char predType[10], T n) {
 
-        delete g;
-        delete g_2;
-        delete E_prev;
-        delete E_i;
+    // convert the objective returned by lossAndGradient to the cost reported by calculateCost
+    // (the log likelihood for classification)
+    if (strcmp(predType, "logit") == 0) {
+        return -objective * n;
     }
 
-    else if (strcmp(method, "rmsprop") == 0) {
-
-        // #######################################################
-        //                 RMSprop gradient update
-        // #######################################################
-        //
-        // RMS[∆θ][t] = ((γ · E[g[t-1]]**2] + (1 - γ) · E[g[t]]**2] )  + e) ** .5
-        //
-        //         θ[t + 1] = θ[t] - (η / RMS[∆θ][t]) · g[t]
-        //
-        // In this case we skip the generic update since the momentum
-        // is already used in the update term
+    return objective;
+}
 
-        flatArray<T>* g = nullptr;
-        flatArray<T>* g_2 = nullptr;
 
-        // previous mean
-        // E[g[t-1]**2]
-        auto* E_prev = new flatArray<T>(*G);
+template <typename T>
+inline void adamUpdate(T* theta, const T* g, T* mt, T* vt, int size, double beta1, double beta2,
+                       double learningRate, T epsilon, double weightDecay, int nesterov, int step) {
 
-        // get predictions for this step
-        predict<T>(X, *theta, predType, error);
-        *error -= y;
+    // #######################################################
+    //                 Adam family update
+    // #######################################################
+    //
+    //            m[t] = β1 · m[t-1] + (1 - β1) · g[t]
+    //
+    //            v[t] = β2 · v[t-1] + (1 - β2) · g[t] ** 2
+    //
+    //     m^[t] = m[t] / (1 - β1 ** t)    v^[t] = v[t] / (1 - β2 ** t)
+    //
+    //         θ[t + 1] = θ[t] - η · m^[t] / (v^[t] ** .5 + e)
+    //
+    // Nadam replaces m^[t] with the Nesterov look ahead
+    // β1 · m[t] / (1 - β1 ** (t + 1)) + (1 - β1) · g[t] / (1 - β1 ** t)
+    // and AdamW adds the decoupled weight decay term η · λ · θ[t].
+    //
+    // The moment estimates live in the momentum (nu) and squared gradient (G)
+    // buffers, so no temporaries are needed.
 
-        g = XT.dot(*error);
-        *g /= n; // g = ∇J(θ[t])
+    T biasCorrection1 = 1 - pow(beta1, step);
+    T biasCorrection2 = 1 - pow(beta2, step);
+    T biasCorrectionNext = 1 - pow(beta1, step + 1);
 
-        g_2 = g->power(2, 0); // g_2 = g[t] ** 2
+    for (int j = 0; j < size; ++j) {
 
-        // online mean:
-        //
-        // delta = (x - mean) / n
-        // mean += delta
-        //
-        // This avoids recalculating the mean after each iteration
+        mt[j] = beta1 * mt[j] + (1 - beta1) * g[j];
+        vt[j] = beta2 * vt[j] + (1 - beta2) * g[j] * g[j];
 
-        *g_2 -= *G;
-        T temp;
+        T mHat;
 
-        // new mean and gradient update
-        for (int j = 0; j < m; ++j) {
-            temp = g_2->getNElement(j) / static_cast<T>(iteration + 1);
-            G->setNElement(G->getNElement(j) + temp, j); // G += E[∆θ**2]
-            T update = learningRate / pow((gamma * E_prev->getNElement(j) + (1 - gamma) * G->getNElement(j)) + epsilon, 0.5);
-            theta->setNElement(theta->getNElement(j) - update * g->getNElement(j), j);
+        if (nesterov) {
+            mHat = beta1 * mt[j] / biasCorrectionNext + (1 - beta1) * g[j] / biasCorrection1;
+        }
+        else {
+            mHat = mt[j] / biasCorrection1;
         }
 
-        delete g;
-        delete g_2;
-        delete E_prev;
+        T vHat = vt[j] / biasCorrection2;
 
-        // skip generic theta update
-        goto END;
+        theta[j] -= learningRate * (mHat / (sqrt(vHat) + epsilon) + weightDecay * theta[j]);
     }
+}
 
-    else {
-        PyErr_SetString(PyExc_ValueError, method);
-        return;
-    }
+
+class learningRateSchedule {
 
     // #######################################################
-    //             Update theta with updateTerm
+    //                 Learning rate schedules
     // #######################################################
     //
-    //          v[t] = γ · v[t-1] + η · updateTerm
-    //
-    //                 θ[t + 1] = θ[t-1] − v[t]
+    // η[t] for update t (one update per batch), where η is the base learning rate:
     //
-
-
-    if (updateTerm == nullptr) {
-        PyErr_SetString(PyExc_ValueError, "ERROR");
-        return;
-    }
-
-    for (int i = 0; i < m; ++i) {
-        // to switch off momentum set gamma to 0
-        // to switch off learning rate set learningRate to 1
-        T nu_i = nu->getNElement(i) * gamma + updateTerm->getNElement(i) * learningRate;
-        theta->setNElement(theta->getNElement(i) - nu_i, i);
-        nu->setNElement(nu_i, i);
+    //  - "constant":      η
+    //  - "step":          η · γ ** floor(t / period)
+    //  - "exponential":   η · γ ** (t / period)
+    //  - "inverse_time":  η / (1 + γ · t / period)
+    //  - "cosine":        η_min + (η − η_min) · (1 + cos(π · t_cycle / T_cycle)) / 2
+    //                     restarting after each cycle, the first lasts period updates
+    //                     and each one is γ times longer than the previous one (SGDR)
+    //  - "one_cycle":     rises linearly from η_min to η during the first warmup · period
+    //                     updates, then follows a cosine down to η_min at update period
+    //                     and stays there
+
+public:
+    learningRateSchedule() : type(CONSTANT), gamma(1), period(1), minRate(0), warmup(0) {}
+
+    learningRateSchedule(const char* name, double gamma, int period, double minRate, double warmup) :
+            type(typeFromName(name)), gamma(gamma), period(period), minRate(minRate), warmup(warmup) {}
+
+    static bool valid(const char* name) {
+        return typeFromName(name) != UNKNOWN;
     }
 
-    END:
-    delete updateTerm;
-}
-
+    double rate(double baseRate, int t) const {
 
-template <typename T>
-void batchGradientDescent(flatArray<T>& X, flatArray<T>& y, flatArray<T>* theta, flatArray<T>& XT,
-                          flatArray<T>* costArray, flatArray<T>* nu, double e, double epsilon,
-                          int maxIteration, char predType[10], double alpha,
-                          double learningRate, int m, T n, int& iteration, char method[10],
-                          T fudgeFactor) {
+        switch (type) {
 
-    // calculate gradient using the whole dataset
-    T JOld;
-    T JNew;
-    auto* G = zeroArray<T>(1, m);
-    auto* prediction = emptyArray<T>(1, n);
-    auto* error = emptyArray<T>(1, n);
+            case STEP:
+                return baseRate * pow(gamma, t / period);
 
-    JNew = calculateCost(X, *theta, y, prediction, predType);
-    costArray->setNElement(JNew, iteration);
+            case EXPONENTIAL:
+                return baseRate * pow(gamma, static_cast<double>(t) / period);
 
+            case INVERSE_TIME:
+                return baseRate / (1 + gamma * t / period);
 
-    while (fabs(e) >= epsilon and iteration < maxIteration) {
+            case COSINE: {
+                // find the position in the current cycle
+                double cycle = period;
+                double position = t;
 
-        // update J
-        JOld = JNew;
+                while (position >= cycle) {
+                    position -= cycle;
+                    cycle *= MAX(gamma, 1.0);
+                }
 
-        // update weights
-        updateWeights<T>(X, y, theta, XT, nu, error, alpha, learningRate, m, n, predType, method, fudgeFactor, G,
-                         iteration);
+                return minRate + (baseRate - minRate) * (1 + cos(M_PI * position / cycle)) / 2;
+            }
 
-//        PyErr_SetString(PyExc_ValueError, std::to_string(y.getNElement(0)).c_str());
+            case ONE_CYCLE: {
+                double rising = warmup * period;
 
-        // calculate cost for new weights
-        JNew = calculateCost<T>(X, *theta, y, prediction, predType);
+                if (t < rising) {
+                    return minRate + (baseRate - minRate) * t / rising;
+                }
 
-        e = fabs(JOld) - fabs(JNew);
+                if (t >= period) {
+                    return minRate;
+                }
 
-        costArray->setNElement(JNew, iteration+1);
+                return minRate + (baseRate - minRate) * (1 + cos(M_PI * (t - rising) / (period - rising))) / 2;
+            }
 
-        iteration++;
+            default:
+                return baseRate;
+        }
     }
 
-    delete G;
-    delete prediction;
-    delete error;
-}
+private:
+    enum scheduleType {CONSTANT, STEP, EXPONENTIAL, INVERSE_TIME, COSINE, ONE_CYCLE, UNKNOWN};
+
+    scheduleType type;
+    double gamma;
+    int period;
+    double minRate;
+    double warmup;
+
+    static scheduleType typeFromName(const char* name) {
+        if (strcmp(name, "constant") == 0) return CONSTANT;
+        if (strcmp(name, "step") == 0) return STEP;
+        if (strcmp(name, "exponential") == 0) return EXPONENTIAL;
+        if (strcmp(name, "inverse_time") == 0) return INVERSE_TIME;
+        if (strcmp(name, "cosine") == 0) return COSINE;
+        if (strcmp(name, "one_cycle") == 0) return ONE_CYCLE;
+        return UNKNOWN;
+    }
+};
 
 
 template <typename T>
-void getBatches(flatArray<T>& X, flatArray<T>& y, flatArray<T>& XT, flatArray<T>* XNew, flatArray<T>* yNew,
-                flatArray<T>* XTNew, int* rNums, int batchSize, int batchNumber, int n) {
+inline void gatherGradient(const T* x, const T* y, const flatIndex* index, flatIndex count, flatIndex m, const T* theta,
+                           char predType[10], T* error, T* gradient, int fitIntercept) {
 
-    int t=0;
-    for (int i = batchSize * batchNumber; i < MIN(batchSize * (batchNumber + 1), n); ++i) {
-        T* rowX = X.getRow(rNums[i]);
-        T* rowXT = XT.getCol(rNums[i]);
+    // gradient of the cost over a batch of count rows, ∇J(θ) = X^T · (h(X · θ) - y) / count
+    //
+    // The batch is read in place: row t is index[t] of x, or row t if index is a nullptr.
+    // The gradient is accumulated row by row, in the same order as X^T · error, in the
+    // accumulator precision (double for single precision data).
+    //
+    // m is the size of θ. With fitIntercept θ[0] is the intercept and the rows of x have
+    // m - 1 features (see lossAndGradient).
 
-        XNew->setRow(rowX, t);
-        yNew->setNElement(y[rNums[i]], t);
-        XTNew->setCol(rowXT, t);
+    typedef typename accumulator<T>::type A;
 
-        delete rowX;
-        delete rowXT;
+    // per thread buffer, only allocated when the number of features grows
+    thread_local std::vector<A> sum;
+    sum.assign(static_cast<size_t>(m), 0);
 
-        t++;
-    }
-}
+    int logit = strcmp(predType, "logit") == 0;
+    flatIndex cols = m - fitIntercept;
+    const T* w = theta + fitIntercept;
 
+    for (flatIndex t = 0; t < count; ++t) {
 
-template <typename T>
-void minibatchGradientDescent(flatArray<T>& X, flatArray<T>& y, flatArray<T>* theta, flatArray<T>& XT,
-                              flatArray<T>* costArray, flatArray<T>* nu, double e, double epsilon,
-                              int maxIteration, char predType[10], double alpha,
-                              double learningRate, int m, T n, int batchSize, int& iteration,
-                              char method[10], T fudgeFactor) {
+        flatIndex row = index == nullptr ? t : index[t];
+        const T* rowX = x + row * cols;
 
-    // calculate gradient using mini batch (where 1 <= batch_size < m)
-    int remainder = static_cast<int>(n) % batchSize;
+        A score = fitIntercept ? theta[0] : 0;
 
-    T JOld;
-    T JNew;
-    auto* G = zeroArray<T>(1, m);
-    auto* prediction = emptyArray<T>(1, n);
-    auto* batchError = emptyArray<T>(1, batchSize);
-    auto* batchErrorRemainder = emptyArray<T>(1, remainder);
+        for (flatIndex j = 0; j < cols; ++j) {
+            score += rowX[j] * w[j];
+        }
 
-    JNew = calculateCost(X, *theta, y, prediction, predType);
-    costArray->setNElement(JNew, iteration);
+        if (logit) {
+            score = 1 / (1 + exp(-score));
+        }
 
-    auto batchIterations = static_cast<int>(floor(n / batchSize));
+        error[t] = static_cast<T>(score - y[row]);
 
-    int k = 0;
+        if (fitIntercept) {
+            sum[0] += error[t];
+        }
 
-    while (fabs(e) >= epsilon and iteration < maxIteration) {
+        for (flatIndex j = 0; j < cols; ++j) {
+            sum[j + fitIntercept] += rowX[j] * error[t];
+        }
+    }
 
-        JOld = JNew;
+    for (flatIndex j = 0; j < m; ++j) {
+        gradient[j] = static_cast<T>(sum[j] / count);
+    }
+}
 
-        // reshuffle data
-        auto rNums = new int[static_cast<int>(n)];
 
-        for (int i = 0; i < n; ++i) {
-            rNums[i] = i;
-        }
+template <typename T>
+inline T gatherCost(const T* x, const T* y, const flatIndex* index, flatIndex count, flatIndex m, const T* theta,
+                    char predType[10], int fitIntercept) {
 
-        shuffle(rNums, n);
-        int batchNumber = 0;
-        flatArray<T>* XNew = nullptr;
-        flatArray<T>* yNew = nullptr;
-        flatArray<T>* XTNew = nullptr;
+    // same cost as calculateCost, over a batch of count rows read in place (see gatherGradient)
 
-        XNew = emptyArray<T>(batchSize, m);
-        yNew = emptyArray<T>(1, batchSize);
-        XTNew = emptyArray<T>(m, batchSize);
+    typedef typename accumulator<T>::type A;
 
-        for (int i = 0; i < batchIterations; ++i) {
+    int logit = strcmp(predType, "logit") == 0;
+    flatIndex cols = m - fitIntercept;
+    const T* w = theta + fitIntercept;
+    A result = 0;
 
+    for (flatIndex t = 0; t < count; ++t) {
 
-            getBatches<T>(X, y, XT, XNew, yNew, XTNew, rNums, batchSize, batchNumber, n);
+        flatIndex row = index == nullptr ? t : index[t];
+        const T* rowX = x + row * cols;
 
-            // update weights using this batch
-            updateWeights<T>(*XNew, *yNew, theta, *XTNew, nu, batchError, alpha, learningRate, m, batchSize, predType,
-                             method, fudgeFactor, G, iteration);
+        A score = fitIntercept ? theta[0] : 0;
 
-            // calculate overall cost
-            JNew = calculateCost<T>(X, *theta, y, prediction, predType);
+        for (flatIndex j = 0; j < cols; ++j) {
+            score += rowX[j] * w[j];
+        }
 
-            costArray->setNElement(JNew, k);
-            batchNumber++;
-            k++;
+        if (logit) {
+            // log(1 + exp(s)) computed without overflow
+            result += y[row] * score - (score > 0 ? score + log1p(exp(-score)) : log1p(exp(score)));
         }
 
-        delete XNew;
-        delete yNew;
-        delete XTNew;
+        else {
+            result += (score - y[row]) * (score - y[row]);
+        }
+    }
 
-        if (remainder != 0) {
-            // in this case we need to perform update with last batch (where this batch < batchSize)
-            flatArray<T>* XNewi = nullptr;
-            flatArray<T>* yNewi = nullptr;
-            flatArray<T>* XTNewi = nullptr;
+    if (logit) {
+        return result;
+    }
 
-            XNewi = emptyArray<T>(remainder, m);
-            yNewi = emptyArray<T>(1, remainder);
-            XTNewi = emptyArray<T>(m, remainder);
+    return result / (2 * count);
+}
 
-            getBatches<T>(X, y, XT, XNewi, yNewi, XTNewi, rNums, batchSize, batchNumber, n);
 
-            // update weights using this batch
-            updateWeights<T>(*XNewi, *yNewi, theta, *XTNewi, nu, batchErrorRemainder, alpha, learningRate, m, remainder,
-                             predType, method, fudgeFactor, G, iteration);
+template <typename T>
+inline void gatherGradient(const csrArray<T>& X, const T* y, const flatIndex* index, flatIndex count, flatIndex m, const T* theta,
+                           char predType[10], T* error, T* gradient, int fitIntercept) {
 
-            // calculate overall cost
-            JNew = calculateCost<T>(X, *theta, y, prediction, predType);
+    // same as above for sparse X, the rows only scatter their non zeros into the gradient
 
-            costArray->setNElement(JNew, k);
+    typedef typename accumulator<T>::type A;
 
-            delete XNewi;
-            delete yNewi;
-            delete XTNewi;
-            k++;
+    thread_local std::vector<A> sum;
+    sum.assign(static_cast<size_t>(m), 0);
+
+    int logit = strcmp(predType, "logit") == 0;
+    const T* w = theta + fitIntercept;
+
+    for (flatIndex t = 0; t < count; ++t) {
+
+        flatIndex row = index == nullptr ? t : index[t];
+        A score = X.rowDot(row, w, static_cast<A>(fitIntercept ? theta[0] : 0));
+
+        if (logit) {
+            score = 1 / (1 + exp(-score));
         }
 
-        e = fabs(JOld) - fabs(JNew);
+        error[t] = static_cast<T>(score - y[row]);
 
-        iteration++;
+        if (fitIntercept) {
+            sum[0] += error[t];
+        }
+
+        X.rowAxpy(row, static_cast<A>(error[t]), sum.data() + fitIntercept);
     }
 
-    delete G;
-    delete prediction;
-    delete batchError;
-    delete batchErrorRemainder;
+    for (flatIndex j = 0; j < m; ++j) {
+        gradient[j] = static_cast<T>(sum[j] / count);
+    }
 }
 
 
 template <typename T>
-int gradientDescent(flatArray<T>& X, flatArray<T> &y, flatArray<T> *theta, int maxIteration, T epsilon,
-                    T learningRate, T alpha, flatArray<T>* costArray, char predType[10], int batchSize,
-                    int seed, char method[10], T fudge_factor) {
+inline T gatherCost(const csrArray<T>& X, const T* y, const flatIndex* index, flatIndex count, flatIndex /* m */, const T* theta,
+                    char predType[10], int fitIntercept) {
 
-    // set random variables
-    srand(static_cast<unsigned int>(seed));
+    typedef typename accumulator<T>::type A;
+
+    int logit = strcmp(predType, "logit") == 0;
+    const T* w = theta + fitIntercept;
+    A result = 0;
+
+    for (flatIndex t = 0; t < count; ++t) {
+
+        flatIndex row = index == nullptr ? t : index[t];
+        A score = X.rowDot(row, w, static_cast<A>(fitIntercept ? theta[0] : 0));
+
+        if (logit) {
+            // log(1 + exp(s)) computed without overflow
+            result += y[row] * score - (score > 0 ? score + log1p(exp(-score)) : log1p(exp(score)));
+        }
+
+        else {
+            result += (score - y[row]) * (score - y[row]);
+        }
+    }
+
+    if (logit) {
+        return result;
+    }
+
+    return result / (2 * count);
+}
+
+
+// what the gather kernels read the rows of X from, the data of a dense array or the sparse array itself
+template <typename T>
+inline const T* gatherSource(const flatArray<T>& X) {return X.getArray();}
+
+template <typename T>
+inline const csrArray<T>& gatherSource(const csrArray<T>& X) {return X;}
+
+
+// buffer for the shuffled copies of X made by mini batch gradient descent with physicalShuffle
+template <typename T>
+inline flatArray<T>* shuffleBuffer(const flatArray<T>& X) {return emptyArray<T>(X.getRows(), X.getCols());}
+
+template <typename T>
+inline csrArray<T>* shuffleBuffer(const csrArray<T>& X) {return new csrArray<T>(X.getRows(), X.getCols());}
+
+
+// result = rows order[0] to order[rows - 1] of X
+template <typename T>
+inline void shuffleRows(const flatArray<T>& X, const flatIndex* order, flatArray<T>& result) {
+
+    const T* x = X.getArray();
+    T* xShuffled = result.getArray();
+    flatIndex cols = X.getCols();
+
+    for (flatIndex i = 0; i < X.getRows(); ++i) {
+        std::copy(x + order[i] * cols, x + (order[i] + 1) * cols, xShuffled + i * cols);
+    }
+}
+
+template <typename T>
+inline void shuffleRows(const csrArray<T>& X, const flatIndex* order, csrArray<T>& result) {
+    X.take(order, X.getRows(), result);
+}
+
+
+template <typename T, class M>
+inline void updateWeights(M& X, flatArray<T>& y, const flatIndex* index, flatIndex count, flatArray<T>* theta,
+                          flatArray<T>* nu, flatArray<T>* error, double gamma, double learningRate, int m,
+                          char predType[10], char method[10], T epsilon, flatArray<T>* G, int iteration, int step,
+                          double beta2, double weightDecay, int fitIntercept, scratchArena& scratch) {
+
+    // the gradient is calculated with the count rows of X (and y) selected by index,
+    // or the first count rows if index is a nullptr (see gatherGradient)
+    //
+    // temporaries are taken from scratch, which is reset at the end of the update, so the
+    // arena of the caller serves every step after the first without touching the heap
+
+    // variable declaration
+    flatArray<T>* updateTerm = nullptr;
+    auto&& x = gatherSource(X);
+    T* target = y.getArray();
+
+    if (strcmp(method, "normal") == 0) {
+
+    // #######################################################
+    //                 Vanilla gradient term
+    // #######################################################
+    //
+    //                   updateTerm = ∇J(θ)
+    //
+        // calculate updateTerm = gradient
+        updateTerm = scratch.array<T>(1, m);
+        gatherGradient(x, target, index, count, m, theta->getArray(), predType, error->getArray(),
+                       updateTerm->getArray(), fitIntercept);
+    }
+
+    else if (strcmp(method, "nesterov") == 0) {
+
+    // #######################################################
+    //                 Nesterov gradient term
+    // #######################################################
+    //
+    //             updateTerm = ∇J(θ − γ · v[t-1])
+    //
+
+        // copy theta
+        auto* tempTheta = scratch.copy(*theta);
+
+        // approximate next position of parameters (θ − γ · v[t-1])
+        for (int i = 0; i < m; ++i) {
+            T nu_i = nu->getNElement(i) * gamma;
+            tempTheta->setNElement((*theta)[i] - nu_i, i);
+        }
+
+        // calculate the gradient with new theta
+        updateTerm = scratch.array<T>(1, m);
+        gatherGradient(x, target, index, count, m, tempTheta->getArray(), predType, error->getArray(),
+                       updateTerm->getArray(), fitIntercept);
+
+    }
+
+    else if (strcmp(method, "adagrad") == 0) {
+
+    // #######################################################
+    //                 Adagrad gradient term
+    // #######################################################
+    //
+    //                   g[t] = ∇J(θ[t])
+    //
+    //                  G[t] = G[t - 1] + g[t] ** 2
+    //
+    //         updateTerm = g[t] / ((G[t] ** 0.5 + e)
+    //
+        flatArray<T>* g = nullptr;
+
+        // g = ∇J(θ[t])
+        g = scratch.array<T>(1, m);
+        gatherGradient(x, target, index, count, m, theta->getArray(), predType, error->getArray(), g->getArray(),
+                       fitIntercept);
+
+        // G += g[t] ** 2
+        assign(*G, lazy(*G) + power(lazy(*g), 2));
+
+        // updateTerm = g / (G ** 0.5 + e)
+        updateTerm = scratch.array<T>(1, m);
+        assign(*updateTerm, lazy(*g) / (power(lazy(*G), 0.5) + epsilon));
+    }
+
+    else if (strcmp(method, "adadelta") == 0) {
+    // #######################################################
+    //                 Adadelta gradient term
+    // #######################################################
+    //
+    //            RMS[∆θ][t] = (E[∆θ**2] + e) ** .5
+    //
+    //          ∆θt= (-RMS[∆θ[t-1]] / RMS[g[t]]) · g[t]
+    //
+    // Note: In this implementation the negative sign is ignored,
+    // since all update terms are subtracted from theta anyway
+    //
+
+        flatArray<T>* g = nullptr;
+        flatArray<T>* E_prev = nullptr;
+
+        // previous mean
+        // (E[g[t-1]**2] + e) ** .5
+        E_prev = scratch.array<T>(1, m);
+        assign(*E_prev, power(lazy(*G) + epsilon, 0.5));
+
+        // g = ∇J(θ[t])
+        g = scratch.array<T>(1, m);
+        gatherGradient(x, target, index, count, m, theta->getArray(), predType, error->getArray(), g->getArray(),
+                       fitIntercept);
+
+        // online mean:
+        //
+        // delta = (x - mean) / n
+        // mean += delta
+        //
+        // G += (g[t] ** 2 - G) / t
+        assign(*G, lazy(*G) + (power(lazy(*g), 2) - lazy(*G)) / static_cast<T>(iteration + 1));
+
+        // g[t] * (RMS[∆θ[t-1]] / RMS[g[t]])
+        updateTerm = scratch.array<T>(1, m);
+        assign(*updateTerm, lazy(*E_prev) / power(lazy(*G) + epsilon, 0.5) * lazy(*g));
+    }
+
+    else if (strcmp(method, "rmsprop") == 0) {
+
+        // #######################################################
+        //                 RMSprop gradient update
+        // #######################################################
+        //
+        // RMS[∆θ][t] = ((γ · E[g[t-1]]**2] + (1 - γ) · E[g[t]]**2] )  + e) ** .5
+        //
+        //         θ[t + 1] = θ[t] - (η / RMS[∆θ][t]) · g[t]
+        //
+        // In this case we skip the generic update since the momentum
+        // is already used in the update term
+
+        flatArray<T>* g = nullptr;
+        flatArray<T>* g_2 = nullptr;
+
+        // previous mean
+        // E[g[t-1]**2]
+        auto* E_prev = scratch.copy(*G);
+
+        // g = ∇J(θ[t])
+        g = scratch.array<T>(1, m);
+        gatherGradient(x, target, index, count, m, theta->getArray(), predType, error->getArray(), g->getArray(),
+                       fitIntercept);
+
+        g_2 = scratch.copy(*g);
+        g_2->power(2, 1); // g_2 = g[t] ** 2
+
+        // online mean:
+        //
+        // delta = (x - mean) / n
+        // mean += delta
+        //
+        // This avoids recalculating the mean after each iteration
+
+        *g_2 -= *G;
+        T temp;
+
+        // new mean and gradient update
+        for (int j = 0; j < m; ++j) {
+            temp = g_2->getNElement(j) / static_cast<T>(iteration + 1);
+            G->setNElement(G->getNElement(j) + temp, j); // G += E[∆θ**2]
+            T update = learningRate / pow((gamma * E_prev->getNElement(j) + (1 - gamma) * G->getNElement(j)) + epsilon, 0.5);
+            theta->setNElement(theta->getNElement(j) - update * g->getNElement(j), j);
+        }
+
+        // skip generic theta update
+        goto END;
+    }
+
+    else if (strcmp(method, "adam") == 0 || strcmp(method, "adamw") == 0 || strcmp(method, "nadam") == 0) {
+
+        // #######################################################
+        //                 Adam/AdamW/Nadam update
+        // #######################################################
+        //
+        // gamma is used as β1, nu stores the first moment and G the second moment.
+        // Weight decay is only applied with AdamW.
+
+        // g = ∇J(θ[t])
+        updateTerm = scratch.array<T>(1, m);
+        gatherGradient(x, target, index, count, m, theta->getArray(), predType, error->getArray(),
+                       updateTerm->getArray(), fitIntercept);
+
+        adamUpdate<T>(theta->getArray(), updateTerm->getArray(), nu->getArray(), G->getArray(), m, gamma, beta2,
+                      learningRate, epsilon, strcmp(method, "adamw") == 0 ? weightDecay : 0,
+                      strcmp(method, "nadam") == 0, step);
+
+        // skip generic theta update
+        goto END;
+    }
+
+    else {
+        PyErr_SetString(PyExc_ValueError, method);
+        scratch.reset();
+        return;
+    }
+
+    // #######################################################
+    //             Update theta with updateTerm
+    // #######################################################
+    //
+    //          v[t] = γ · v[t-1] + η · updateTerm
+    //
+    //                 θ[t + 1] = θ[t-1] − v[t]
+    //
+
+
+    if (updateTerm == nullptr) {
+        PyErr_SetString(PyExc_ValueError, "ERROR");
+        scratch.reset();
+        return;
+    }
+
+    for (int i = 0; i < m; ++i) {
+        // to switch off momentum set gamma to 0
+        // to switch off learning rate set learningRate to 1
+        T nu_i = nu->getNElement(i) * gamma + updateTerm->getNElement(i) * learningRate;
+        theta->setNElement(theta->getNElement(i) - nu_i, i);
+        nu->setNElement(nu_i, i);
+    }
+
+    END:
+    scratch.reset();
+}
+
+
+template <typename T, class M = flatArray<T>>
+class earlyStopping {
+
+    // Tracks the cost of a validation set after each epoch and keeps the best weights seen so far.
+    // Training should stop once the cost has not improved by more than minImprovement for
+    // patience epochs in a row.
+
+public:
+    earlyStopping(M* XVal, flatArray<T>* yVal, int patience, double minImprovement, char predType[10],
+                  flatArray<T>* theta, int fitIntercept) :
+            XVal(XVal), yVal(yVal), patience(patience), minImprovement(minImprovement), predType(predType),
+            fitIntercept(fitIntercept), wait(0), bestIteration(0) {
+
+        // preallocated copy of the best weights, starting with the initial ones
+        bestTheta = new flatArray<T>(*theta);
+        best = cost(theta);
+    }
+
+    ~earlyStopping() {
+        delete bestTheta;
+    }
+
+    bool update(flatArray<T>* theta, int iteration) {
+
+        // returns true if training should stop
+        T J = cost(theta);
+
+        // the log likelihood is negative, so in both cases a smaller absolute cost is better
+        if (fabs(best) - fabs(J) > minImprovement) {
+            best = J;
+            bestIteration = iteration;
+            wait = 0;
+            std::copy(theta->getArray(), theta->getArray() + theta->getSize(), bestTheta->getArray());
+        }
+
+        else {
+            wait++;
+        }
+
+        return wait >= patience;
+    }
+
+    void restore(flatArray<T>* theta) {
+        std::copy(bestTheta->getArray(), bestTheta->getArray() + bestTheta->getSize(), theta->getArray());
+    }
+
+    T getBest() const {return best;}
+    int getBestIteration() const {return bestIteration;}
+
+private:
+    M* XVal;
+    flatArray<T>* yVal;
+    int patience;
+    double minImprovement;
+    char* predType;
+    int fitIntercept;
+    int wait;
+    int bestIteration;
+    T best;
+    flatArray<T>* bestTheta;
+
+    T cost(flatArray<T>* theta) {
+        return gatherCost(gatherSource(*XVal), yVal->getArray(), nullptr, XVal->getRows(), theta->getSize(),
+                          theta->getArray(), predType, fitIntercept);
+    }
+};
+
+
+template <typename T, class M>
+void batchGradientDescent(M& X, flatArray<T>& y, flatArray<T>* theta, flatArray<T>* costArray, flatArray<T>* nu, double e, double epsilon,
+                          int maxIteration, char predType[10], double alpha,
+                          double learningRate, int m, T n, int& iteration, char method[10],
+                          T fudgeFactor, double beta2, double weightDecay, earlyStopping<T, M>* stopping,
+                          const learningRateSchedule& schedule, int fitIntercept) {
+
+    // calculate gradient using the whole dataset
+    T JOld;
+    T JNew;
+    auto* G = zeroArray<T>(1, m);
+    auto* prediction = emptyArray<T>(1, n);
+    auto* error = emptyArray<T>(1, n);
+
+    // temporaries of the weight updates
+    scratchArena scratch;
+
+    JNew = calculateCost(X, *theta, y, prediction, predType, fitIntercept);
+    costArray->setNElement(JNew, iteration);
+
+
+    while (fabs(e) >= epsilon and iteration < maxIteration) {
+
+        // update J
+        JOld = JNew;
+
+        // update weights
+        updateWeights<T>(X, y, nullptr, X.getRows(), theta, nu, error, alpha, schedule.rate(learningRate, iteration),
+                         m, predType, method, fudgeFactor, G, iteration, iteration + 1, beta2, weightDecay,
+                         fitIntercept, scratch);
+
+//        PyErr_SetString(PyExc_ValueError, std::to_string(y.getNElement(0)).c_str());
+
+        // calculate cost for new weights
+        JNew = calculateCost<T>(X, *theta, y, prediction, predType, fitIntercept);
+
+        e = fabs(JOld) - fabs(JNew);
+
+        costArray->setNElement(JNew, iteration+1);
+
+        iteration++;
+
+        if (stopping != nullptr && stopping->update(theta, iteration)) {
+            break;
+        }
+    }
+
+    delete G;
+    delete prediction;
+    delete error;
+}
+
+
+template <typename T>
+inline T scaleCost(T cost, char predType[10], T scale) {
+
+    // the log likelihood is a sum over the rows, so the cost of a subset of the data is
+    // scaled to the size of the whole dataset (the squared error cost is already a mean)
+    if (strcmp(predType, "logit") == 0) {
+        return cost * scale;
+    }
+
+    return cost;
+}
+
+
+template <typename T, class M>
+void minibatchGradientDescent(M& X, flatArray<T>& y, flatArray<T>* theta,
+                              flatArray<T>* costArray, flatArray<T>* nu, double e, double epsilon,
+                              int maxIteration, char predType[10], double alpha,
+                              double learningRate, int m, T n, int batchSize, int& iteration,
+                              char method[10], T fudgeFactor, double beta2, double weightDecay,
+                              char monitor[10], int monitorFrequency, int monitorSamples, int physicalShuffle,
+                              std::mt19937* generator, earlyStopping<T, M>* stopping,
+                              const learningRateSchedule& schedule, int fitIntercept) {
+
+    // calculate gradient using mini batch (where 1 <= batch_size < m)
+    //
+    // A batch is a span of the shuffled row indices and the gradient kernels read its rows
+    // directly from X, so no batch is copied. With physicalShuffle the rows are instead copied
+    // once per epoch, in shuffled order, to a buffer so that every batch is read sequentially.
+    // Either way the result is the same, and nothing is allocated after the first epoch.
+    //
+    // the cost that is recorded and used to test for convergence depends on the monitor policy:
+    //  - "full": cost of the whole dataset after every batch (O(n) per batch)
+    //  - "average": running average of the batch costs (before each update) over the epoch
+    //  - "every": cost of the whole dataset after every monitorFrequency batches
+    //  - "subsample": cost of a fixed, evenly strided subsample of monitorSamples rows after every batch
+    // with the last three an epoch is linear in n
+
+    auto rows = static_cast<flatIndex>(n);
+    flatIndex remainder = rows % batchSize;
+
+    int full = strcmp(monitor, "full") == 0;
+    int average = strcmp(monitor, "average") == 0;
+    int every = strcmp(monitor, "every") == 0;
+    int subsample = strcmp(monitor, "subsample") == 0;
+
+    T JOld;
+    T JNew;
+    auto* G = zeroArray<T>(1, m);
+    auto* prediction = emptyArray<T>(1, n);
+    auto* batchError = emptyArray<T>(1, batchSize);
+
+    // temporaries of the weight updates
+    scratchArena scratch;
+
+    // permutation of the rows, allocated once and reset before each shuffle
+    auto* rNums = new flatIndex[rows];
+
+    // shuffled copies of X and y used with physicalShuffle, which are read in order
+    M* XShuffled = nullptr;
+    flatArray<T>* yShuffled = nullptr;
+    flatIndex* order = nullptr;
+
+    if (physicalShuffle) {
+        XShuffled = shuffleBuffer(X);
+        yShuffled = emptyArray<T>(1, rows);
+        order = new flatIndex[rows];
+
+        for (flatIndex i = 0; i < rows; ++i) {
+            order[i] = i;
+        }
+    }
+
+    // evenly strided rows used with the "subsample" policy
+    flatIndex sampleSize = 0;
+    flatIndex* sample = nullptr;
+
+    if (subsample) {
+        sampleSize = MIN(static_cast<flatIndex>(monitorSamples), rows);
+        sample = new flatIndex[sampleSize];
+
+        for (flatIndex i = 0; i < sampleSize; ++i) {
+            sample[i] = i * rows / sampleSize;
+        }
+    }
+
+    JNew = calculateCost(X, *theta, y, prediction, predType, fitIntercept);
+    costArray->setNElement(JNew, iteration);
+
+    auto batchIterations = static_cast<flatIndex>(floor(n / batchSize));
+
+    int k = 0;
+    int recorded = 0;
+
+    while (fabs(e) >= epsilon and iteration < maxIteration) {
+
+        JOld = JNew;
+
+        // batch costs seen in this epoch (average) and whether the full cost was evaluated (every)
+        T epochCost = 0;
+        flatIndex epochRows = 0;
+        bool evaluated = false;
+
+        // reshuffle data
+        for (flatIndex i = 0; i < rows; ++i) {
+            rNums[i] = i;
+        }
+
+        // without a generator fall back to the random() state seeded in gradientDescent
+        if (generator == nullptr) {
+            shuffle(rNums, rows);
+        }
+        else {
+            shuffle(rNums, rows, *generator);
+        }
+
+        if (physicalShuffle) {
+            shuffleRows(X, rNums, *XShuffled);
+
+            for (flatIndex i = 0; i < rows; ++i) {
+                yShuffled->setNElement(y[rNums[i]], i);
+            }
+        }
+
+        for (flatIndex i = 0; i < batchIterations + (remainder != 0 ? 1 : 0); ++i) {
+
+            // in the last batch of an uneven split there are less than batchSize examples
+            flatIndex start = i * batchSize;
+            flatIndex count = i == batchIterations ? remainder : batchSize;
+
+            // either the rows of the shuffled copy from start, or the rows of X at the shuffled indices
+            M& XBatch = physicalShuffle ? *XShuffled : X;
+            flatArray<T>& yBatch = physicalShuffle ? *yShuffled : y;
+            const flatIndex* index = (physicalShuffle ? order : rNums) + start;
+
+            if (average) {
+                // cost of this batch with the current weights
+                epochCost += scaleCost(gatherCost(gatherSource(XBatch), yBatch.getArray(), index, count, m,
+                                                  theta->getArray(), predType, fitIntercept),
+                                       predType, n / count) * count;
+                epochRows += count;
+                JNew = epochCost / epochRows;
+            }
+
+            // update weights using this batch
+            updateWeights<T>(XBatch, yBatch, index, count, theta, nu, batchError, alpha,
+                             schedule.rate(learningRate, k), m, predType, method, fudgeFactor, G, iteration, k + 1,
+                             beta2, weightDecay, fitIntercept, scratch);
+
+            if (full || (every && (k + 1) % monitorFrequency == 0)) {
+                // calculate overall cost
+                JNew = calculateCost<T>(X, *theta, y, prediction, predType, fitIntercept);
+                evaluated = true;
+            }
+
+            else if (subsample) {
+                JNew = scaleCost(gatherCost(gatherSource(X), y.getArray(), sample, sampleSize, m, theta->getArray(),
+                                            predType, fitIntercept), predType, n / sampleSize);
+            }
+
+            if (!every || (k + 1) % monitorFrequency == 0) {
+                costArray->setNElement(JNew, recorded);
+                recorded++;
+            }
+
+            k++;
+        }
+
+        // with "every" an epoch can end without a new cost, in which case there is nothing to compare
+        if (!every || evaluated) {
+            e = fabs(JOld) - fabs(JNew);
+        }
+
+        iteration++;
+
+        if (stopping != nullptr && stopping->update(theta, iteration)) {
+            break;
+        }
+    }
+
+    // the cost history has one entry per monitored cost
+    costArray->setCols(recorded);
+
+    delete G;
+    delete prediction;
+    delete batchError;
+    delete [] rNums;
+    delete [] sample;
+    delete [] order;
+    delete XShuffled;
+    delete yShuffled;
+}
+
+
+template <typename T>
+inline T vectorDot(const T* a, const T* b, int size) {
+
+    typename accumulator<T>::type result = 0;
+
+    for (int j = 0; j < size; ++j) {
+        result += a[j] * b[j];
+    }
+
+    return result;
+}
+
+
+template <typename T, class M>
+T strongWolfeLineSearch(M& X, flatArray<T>& y, char predType[10], const T* theta, const T* direction,
+                        T f0, T dPhi0, T alphaInit, T* thetaNew, T* gradientNew, T& fNew, int m, int fitIntercept) {
+
+    // Line search satisfying the strong Wolfe conditions
+    // (Nocedal & Wright, Numerical Optimization, algorithms 3.5 and 3.6)
+    //
+    //            φ(α) <= φ(0) + c1 · α · φ'(0)      and      |φ'(α)| <= c2 · |φ'(0)|
+    //
+    // where φ(α) = J(θ + α · d). On return thetaNew, gradientNew and fNew hold the
+    // evaluation at the accepted step. Returns 0 if no step was found.
+
+    const T c1 = 1e-4;
+    const T c2 = 0.9;
+    const int maxEvaluations = 25;
+
+    int evaluations = 0;
+
+    // evaluates φ(α) and φ'(α), storing θ + α · d and ∇J(θ + α · d)
+    auto phi = [&](T alpha, T& dPhi) {
+        for (int j = 0; j < m; ++j) {
+            thetaNew[j] = theta[j] + alpha * direction[j];
+        }
+        evaluations++;
+        T f = lossAndGradient<T>(X, y, thetaNew, predType, gradientNew, fitIntercept);
+        dPhi = vectorDot(gradientNew, direction, m);
+        return f;
+    };
+
+    auto zoom = [&](T alphaLo, T alphaHi, T fLo, T fHi, T dLo, T dHi) {
+
+        while (evaluations < maxEvaluations) {
+
+            // cubic interpolation of φ between alphaLo and alphaHi, with bisection as a safeguard
+            T alpha;
+            T d1 = dLo + dHi - 3 * (fLo - fHi) / (alphaLo - alphaHi);
+            T radicand = d1 * d1 - dLo * dHi;
+            T lower = MIN(alphaLo, alphaHi);
+            T upper = MAX(alphaLo, alphaHi);
+
+            if (radicand >= 0) {
+                T d2 = (alphaHi > alphaLo ? 1 : -1) * sqrt(radicand);
+                alpha = alphaHi - (alphaHi - alphaLo) * (dHi + d2 - d1) / (dHi - dLo + 2 * d2);
+            }
+            else {
+                alpha = (alphaLo + alphaHi) / 2;
+            }
+
+            if (!(alpha > lower + 0.1 * (upper - lower) && alpha < upper - 0.1 * (upper - lower))) {
+                alpha = (alphaLo + alphaHi) / 2;
+            }
+
+            T dAlpha;
+            T fAlpha = phi(alpha, dAlpha);
+
+            if (fAlpha > f0 + c1 * alpha * dPhi0 || fAlpha >= fLo) {
+                alphaHi = alpha;
+                fHi = fAlpha;
+                dHi = dAlpha;
+            }
+
+            else {
+                if (fabs(dAlpha) <= -c2 * dPhi0) {
+                    fNew = fAlpha;
+                    return alpha;
+                }
+
+                if (dAlpha * (alphaHi - alphaLo) >= 0) {
+                    alphaHi = alphaLo;
+                    fHi = fLo;
+                    dHi = dLo;
+                }
+
+                alphaLo = alpha;
+                fLo = fAlpha;
+                dLo = dAlpha;
+            }
+
+            if (fabs(alphaHi - alphaLo) < 1e-12) {
+                break;
+            }
+        }
+
+        // the curvature condition could not be met, fall back to the best step with sufficient decrease
+        if (alphaLo > 0) {
+            T dAlpha;
+            fNew = phi(alphaLo, dAlpha);
+            return alphaLo;
+        }
+
+        return static_cast<T>(0);
+    };
+
+    T alphaPrev = 0;
+    T fPrev = f0;
+    T dPrev = dPhi0;
+    T alpha = alphaInit;
+
+    while (evaluations < maxEvaluations) {
+
+        T dAlpha;
+        T fAlpha = phi(alpha, dAlpha);
+
+        if (fAlpha > f0 + c1 * alpha * dPhi0 || (alphaPrev > 0 && fAlpha >= fPrev)) {
+            return zoom(alphaPrev, alpha, fPrev, fAlpha, dPrev, dAlpha);
+        }
+
+        if (fabs(dAlpha) <= -c2 * dPhi0) {
+            fNew = fAlpha;
+            return alpha;
+        }
+
+        if (dAlpha >= 0) {
+            return zoom(alpha, alphaPrev, fAlpha, fPrev, dAlpha, dPrev);
+        }
+
+        alphaPrev = alpha;
+        fPrev = fAlpha;
+        dPrev = dAlpha;
+        alpha *= 2;
+    }
+
+    return static_cast<T>(0);
+}
+
+
+template <typename T, class M>
+void lbfgs(M& X, flatArray<T>& y, flatArray<T>* theta, flatArray<T>* costArray, double epsilon,
+           int maxIteration, char predType[10], int m, T n, int& iteration, int historySize, int fitIntercept) {
+
+    // #######################################################
+    //                 L-BFGS
+    // #######################################################
+    //
+    // Limited memory BFGS keeps the last historySize pairs
+    //
+    //          s[k] = θ[k + 1] - θ[k]    y[k] = ∇J(θ[k + 1]) - ∇J(θ[k])
+    //
+    // and computes the search direction d = -H · ∇J(θ) with the two-loop recursion,
+    // using H0 = (s · y) / (y · y) · I as the initial inverse Hessian approximation.
+    // The step length is found with a strong Wolfe line search.
+
+    T JOld;
+    T JNew;
+    T f;
+    T fNew = 0;
+    double e = epsilon * 2;
+
+    // circular buffers holding the curvature pairs
+    auto* S = zeroArray<T>(historySize, m);
+    auto* Y = zeroArray<T>(historySize, m);
+    auto* rho = zeroArray<T>(1, historySize);
+    auto* a = zeroArray<T>(1, historySize);
+
+    auto* gradient = emptyArray<T>(1, m);
+    auto* gradientNew = emptyArray<T>(1, m);
+    auto* thetaNew = emptyArray<T>(1, m);
+    auto* direction = emptyArray<T>(1, m);
+
+    T* w = theta->getArray();
+    T* g = gradient->getArray();
+    T* d = direction->getArray();
+    int historyStart = 0;
+    int historyCount = 0;
+
+    f = lossAndGradient<T>(X, y, w, predType, g, fitIntercept);
+
+    JNew = objectiveToCost<T>(f, predType, n);
+    costArray->setNElement(JNew, iteration);
+
+    while (fabs(e) >= epsilon and iteration < maxIteration) {
+
+        JOld = JNew;
+
+        // two-loop recursion, q is stored in d
+        for (int j = 0; j < m; ++j) {
+            d[j] = g[j];
+        }
+
+        for (int k = historyCount - 1; k >= 0; --k) {
+            int i = (historyStart + k) % historySize;
+            (*a)[i] = (*rho)[i] * vectorDot(S->getArray() + i * m, d, m);
+            for (int j = 0; j < m; ++j) {
+                d[j] -= (*a)[i] * Y->getNElement(i * m + j);
+            }
+        }
+
+        T scale = 1;
+
+        if (historyCount > 0) {
+            int newest = (historyStart + historyCount - 1) % historySize;
+            T* yNewest = Y->getArray() + newest * m;
+            scale = vectorDot(S->getArray() + newest * m, yNewest, m) / vectorDot(yNewest, yNewest, m);
+        }
+
+        for (int j = 0; j < m; ++j) {
+            d[j] *= scale;
+        }
+
+        for (int k = 0; k < historyCount; ++k) {
+            int i = (historyStart + k) % historySize;
+            T b = (*rho)[i] * vectorDot(Y->getArray() + i * m, d, m);
+            for (int j = 0; j < m; ++j) {
+                d[j] += S->getNElement(i * m + j) * ((*a)[i] - b);
+            }
+        }
+
+        for (int j = 0; j < m; ++j) {
+            d[j] = -d[j];
+        }
+
+        T dPhi0 = vectorDot(g, d, m);
+
+        if (dPhi0 >= 0) {
+            // not a descent direction, restart from steepest descent
+            historyCount = 0;
+            for (int j = 0; j < m; ++j) {
+                d[j] = -g[j];
+            }
+            dPhi0 = vectorDot(g, d, m);
+        }
+
+        T gradientNorm = sqrt(vectorDot(g, g, m));
+
+        if (gradientNorm == 0) {
+            break;
+        }
+
+        // without curvature information take a unit step along the normalised gradient
+        T alphaInit = historyCount == 0 ? MIN<T>(1, 1 / gradientNorm) : 1;
+
+        T step = strongWolfeLineSearch<T>(X, y, predType, w, d, f, dPhi0, alphaInit, thetaNew->getArray(),
+                                          gradientNew->getArray(), fNew, m, fitIntercept);
+
+        if (step == 0) {
+            // line search failed, θ is as good as it gets
+            break;
+        }
+
+        // store the new curvature pair, overwriting the oldest one when the buffer is full
+        int i = historyCount < historySize ? (historyStart + historyCount) % historySize : historyStart;
+        T* s_i = S->getArray() + i * m;
+        T* y_i = Y->getArray() + i * m;
+
+        for (int j = 0; j < m; ++j) {
+            s_i[j] = thetaNew->getNElement(j) - w[j];
+            y_i[j] = gradientNew->getNElement(j) - g[j];
+            w[j] = thetaNew->getNElement(j);
+            g[j] = gradientNew->getNElement(j);
+        }
+
+        T sy = vectorDot(s_i, y_i, m);
+
+        // skip the update if the curvature condition does not hold
+        if (sy > 1e-10 * vectorDot(y_i, y_i, m)) {
+            (*rho)[i] = 1 / sy;
+
+            if (historyCount < historySize) {
+                historyCount++;
+            }
+            else {
+                historyStart = (historyStart + 1) % historySize;
+            }
+        }
+
+        f = fNew;
+
+        JNew = objectiveToCost<T>(f, predType, n);
+
+        e = fabs(JOld) - fabs(JNew);
+
+        costArray->setNElement(JNew, iteration + 1);
+
+        iteration++;
+    }
+
+    delete S;
+    delete Y;
+    delete rho;
+    delete a;
+    delete gradient;
+    delete gradientNew;
+    delete thetaNew;
+    delete direction;
+}
+
+
+template <typename T>
+inline void logisticHessianVectorProduct(flatArray<T>& X, const T* weights, const T* v, T* result, T n,
+                                         int fitIntercept) {
+
+    // H · v = X^T · W · X · v / n, without forming H. With fitIntercept v[0] and result[0]
+    // are the intercept terms, as if X had a leading column of ones
+    flatIndex rows = X.getRows();
+    flatIndex cols = X.getCols();
+    flatIndex m = cols + fitIntercept;
+    T* x = X.getArray();
+    const T* vFeatures = v + fitIntercept;
+    T* resultFeatures = result + fitIntercept;
+
+    for (flatIndex j = 0; j < m; ++j) {
+        result[j] = 0;
+    }
+
+    for (flatIndex i = 0; i < rows; ++i) {
+        T* row = x + i * cols;
+        T Xv = ((fitIntercept ? v[0] : 0) + vectorDot(row, vFeatures, cols)) * weights[i];
+
+        if (fitIntercept) {
+            result[0] += Xv;
+        }
+
+        for (flatIndex j = 0; j < cols; ++j) {
+            resultFeatures[j] += Xv * row[j];
+        }
+    }
+
+    for (flatIndex j = 0; j < m; ++j) {
+        result[j] /= n;
+    }
+}
+
+
+template <typename T>
+void logisticHessian(flatArray<T>& X, const T* weights, flatArray<T>* H, T n, int fitIntercept) {
+
+    // H = X^T · W · X / n, accumulated with a rank k update for each block of k rows of X.
+    // Only the upper triangle is computed, since H is symmetric. With fitIntercept the first
+    // row and column of H belong to the intercept, as if X had a leading column of ones.
+    const int blockSize = 64;
+
+    flatIndex rows = X.getRows();
+    flatIndex cols = X.getCols();
+    flatIndex m = cols + fitIntercept;
+    T* x = X.getArray();
+    T* h = H->getArray();
+
+    // upper triangle of the features
+    T* hFeatures = h + fitIntercept * (m + 1);
+
+    auto* weightedColumn = new T[blockSize];
+
+    for (flatIndex i = 0; i < m * m; ++i) {
+        h[i] = 0;
+    }
+
+    for (flatIndex blockStart = 0; blockStart < rows; blockStart += blockSize) {
+
+        flatIndex blockEnd = MIN<flatIndex>(blockStart + blockSize, rows);
+        T* block = x + blockStart * cols;
+
+        if (fitIntercept) {
+            // Σ w[i] and Σ w[i] · x[i, b]
+            for (flatIndex i = 0; i < blockEnd - blockStart; ++i) {
+                h[0] += weights[blockStart + i];
+
+                for (flatIndex b = 0; b < cols; ++b) {
+                    h[b + 1] += weights[blockStart + i] * block[i * cols + b];
+                }
+            }
+        }
+
+        for (flatIndex a = 0; a < cols; ++a) {
+
+            // ath column of W · X for the rows of this block
+            for (flatIndex i = 0; i < blockEnd - blockStart; ++i) {
+                weightedColumn[i] = weights[blockStart + i] * block[i * cols + a];
+            }
+
+            for (flatIndex b = a; b < cols; ++b) {
+                T result = 0;
+
+                for (flatIndex i = 0; i < blockEnd - blockStart; ++i) {
+                    result += weightedColumn[i] * block[i * cols + b];
+                }
+
+                hFeatures[a * m + b] += result;
+            }
+        }
+    }
+
+    for (flatIndex a = 0; a < m; ++a) {
+        for (flatIndex b = a; b < m; ++b) {
+            h[a * m + b] /= n;
+            h[b * m + a] = h[a * m + b];
+        }
+    }
+
+    delete [] weightedColumn;
+}
+
+
+template <typename T>
+void conjugateGradient(flatArray<T>& X, const T* weights, const T* b, T* result, T n, int m, int fitIntercept) {
+
+    // Truncated conjugate gradient for H · result = b, using Hessian vector products.
+    // The tolerance follows the forcing sequence min(0.5, ||b|| ** .5) · ||b||.
+    auto* r = new T[m];
+    auto* p = new T[m];
+    auto* Hp = new T[m];
+
+    for (int j = 0; j < m; ++j) {
+        result[j] = 0;
+        r[j] = b[j];
+        p[j] = b[j];
+    }
+
+    T rr = vectorDot(r, r, m);
+    T tolerance = MIN<T>(0.5, sqrt(sqrt(rr))) * sqrt(rr);
+
+    for (int k = 0; k < m && sqrt(rr) > tolerance; ++k) {
+
+        logisticHessianVectorProduct(X, weights, p, Hp, n, fitIntercept);
+
+        T pHp = vectorDot(p, Hp, m);
+
+        if (pHp <= 0) {
+            // no curvature left along p
+            break;
+        }
+
+        T alpha = rr / pHp;
+
+        for (int j = 0; j < m; ++j) {
+            result[j] += alpha * p[j];
+            r[j] -= alpha * Hp[j];
+        }
+
+        T rrNew = vectorDot(r, r, m);
+
+        for (int j = 0; j < m; ++j) {
+            p[j] = r[j] + rrNew / rr * p[j];
+        }
+
+        rr = rrNew;
+    }
+
+    if (vectorDot(result, result, m) == 0) {
+        // fall back to the gradient direction
+        for (int j = 0; j < m; ++j) {
+            result[j] = b[j];
+        }
+    }
+
+    delete [] r;
+    delete [] p;
+    delete [] Hp;
+}
+
+
+template <typename T>
+int newtonMethod(flatArray<T>& X, flatArray<T>& y, flatArray<T>* theta, flatArray<T>* costArray, double epsilon,
+                 int maxIteration, int cgThreshold, int fitIntercept) {
+
+    // #######################################################
+    //          Newton's method (IRLS) for logistic regression
+    // #######################################################
+    //
+    //              p = σ(X · θ)        W = diag(p · (1 - p))
+    //
+    //            H = X^T · W · X / n   ∇J(θ) = X^T · (p - y) / n
+    //
+    //                  θ[t + 1] = θ[t] - H^-1 · ∇J(θ[t])
+    //
+    // For up to cgThreshold features H is formed explicitly and the Newton step is solved
+    // with gaussian elimination, otherwise truncated conjugate gradient is used.
+    // The step is halved until the objective decreases.
+    //
+    // With fitIntercept θ[0] is the intercept and X has no column of ones (see lossAndGradient).
+
+    char predType[10] = "logit";
+    int iteration = 0;
+    flatIndex cols = X.getCols();
+    flatIndex m = cols + fitIntercept;
+    flatIndex rows = X.getRows();
+    auto n = static_cast<T>(rows);
+    double e = epsilon * 2;
+
+    T* w = theta->getArray();
+    T* x = X.getArray();
+
+    auto* gradient = new T[m];
+    auto* step = new T[m];
+    auto* thetaNew = new T[m];
+    auto* gradientNew = new T[m];
+    auto* weights = new T[rows];
+
+    flatArray<T>* H = nullptr;
+    flatArray<T>* A = nullptr;
+
+    if (m <= cgThreshold) {
+        H = emptyArray<T>(m, m);
+        A = emptyArray<T>(m, m + 1);
+    }
+
+    T f = lossAndGradient<T>(X, y, w, predType, gradient, fitIntercept);
+    T JNew = objectiveToCost<T>(f, predType, n);
+    T JOld;
+
+    costArray->setNElement(JNew, iteration);
+
+    while (fabs(e) >= epsilon and iteration < maxIteration) {
+
+        JOld = JNew;
+
+        for (flatIndex i = 0; i < rows; ++i) {
+            T p = 1 / (1 + exp(-((fitIntercept ? w[0] : 0) + vectorDot(x + i * cols, w + fitIntercept, cols))));
+            weights[i] = p * (1 - p);
+        }
+
+        if (m <= cgThreshold) {
+
+            logisticHessian(X, weights, H, n, fitIntercept);
+
+            // augmented matrix [H + δI | ∇J(θ)], δ keeps H invertible with separable data
+            for (int i = 0; i < m; ++i) {
+                for (int j = 0; j < m; ++j) {
+                    A->setNElement(H->getNElement(i * m + j), i * (m + 1) + j);
+                }
+                A->setNElement(A->getNElement(i * (m + 1) + i) + 1e-10, i * (m + 1) + i);
+                A->setNElement(gradient[i], i * (m + 1) + m);
+            }
+
+            try {
+                gaussianElimination(A, step);
+            }
+            catch (singularMatrixException &exception) {
+                break;
+            }
+        }
+
+        else {
+            conjugateGradient(X, weights, gradient, step, n, m, fitIntercept);
+        }
+
+        // backtracking line search along the Newton direction
+        T decrease = vectorDot(gradient, step, m);
+        T t = 1;
+        T fNew = f;
+
+        while (t > 1e-10) {
+            for (int j = 0; j < m; ++j) {
+                thetaNew[j] = w[j] - t * step[j];
+            }
+
+            fNew = lossAndGradient<T>(X, y, thetaNew, predType, gradientNew, fitIntercept);
+
+            if (fNew <= f - 1e-4 * t * decrease) {
+                break;
+            }
+
+            t /= 2;
+        }
+
+        if (t <= 1e-10) {
+            // no progress possible along this direction
+            break;
+        }
+
+        for (int j = 0; j < m; ++j) {
+            w[j] = thetaNew[j];
+            gradient[j] = gradientNew[j];
+        }
+
+        f = fNew;
+
+        JNew = objectiveToCost<T>(f, predType, n);
+
+        e = fabs(JOld) - fabs(JNew);
+
+        costArray->setNElement(JNew, iteration + 1);
+
+        iteration++;
+    }
+
+    delete [] gradient;
+    delete [] step;
+    delete [] thetaNew;
+    delete [] gradientNew;
+    delete [] weights;
+    delete H;
+    delete A;
+
+    return iteration;
+}
+
+
+template <typename T>
+inline void softmax(T* scores, int k) {
+
+    // numerically stable softmax of a row of scores (in place)
+    T maxScore = scores[0];
+
+    for (int c = 1; c < k; ++c) {
+        maxScore = MAX(maxScore, scores[c]);
+    }
+
+    T total = 0;
+
+    for (int c = 0; c < k; ++c) {
+        scores[c] = exp(scores[c] - maxScore);
+        total += scores[c];
+    }
+
+    for (int c = 0; c < k; ++c) {
+        scores[c] /= total;
+    }
+}
+
+
+template <typename T>
+inline void softmaxScores(const T* row, const T* Theta, int m, int k, T* scores, int fitIntercept) {
+
+    // scores = x · Θ for a single row of m features, with Θ stored as a m by k matrix
+    // so that the inner loop runs over contiguous class coefficients. With fitIntercept
+    // the first row of Θ has the intercepts, which the scores start from
+    for (int c = 0; c < k; ++c) {
+        scores[c] = fitIntercept ? Theta[c] : 0;
+    }
+
+    const T* coefficients = Theta + fitIntercept * k;
+
+    for (int j = 0; j < m; ++j) {
+        T x_j = row[j];
+        const T* theta_j = coefficients + j * k;
+
+        for (int c = 0; c < k; ++c) {
+            scores[c] += x_j * theta_j[c];
+        }
+    }
+}
+
+
+template <typename T>
+T softmaxLossAndGradient(flatArray<T>& X, const int* labels, const T* Theta, int k, T* probabilities,
+                         T* gradient, int fitIntercept) {
+
+    // Fused softmax cross entropy loss and gradient of a multinomial logistic regression,
+    // computed with a single pass over the rows of X
+    //
+    //                 P = softmax(X · Θ)        J(Θ) = -Σ log(P[i, y[i]]) / n
+    //
+    //                           ∇J(Θ) = X^T · (P - Y) / n
+    //
+    // where Y is the one hot encoding of the labels. Θ and ∇J(Θ) are m by k matrices, with
+    // fitIntercept their first row belongs to the intercepts and X has no column of ones, so
+    // the gradient of the intercepts is the mean of P - Y.
+
+    flatIndex rows = X.getRows();
+    flatIndex m = X.getCols();
+    flatIndex size = (m + fitIntercept) * k;
+    auto n = static_cast<T>(rows);
+
+    T* x = X.getArray();
+    T* gradientFeatures = gradient + fitIntercept * k;
+    T loss = 0;
+
+    for (flatIndex j = 0; j < size; ++j) {
+        gradient[j] = 0;
+    }
+
+    for (flatIndex i = 0; i < rows; ++i) {
+
+        T* row = x + i * m;
+
+        softmaxScores(row, Theta, m, k, probabilities, fitIntercept);
+        softmax(probabilities, k);
+
+        loss -= log(MAX<T>(probabilities[labels[i]], 1e-300));
+
+        // P - Y
+        probabilities[labels[i]] -= 1;
+
+        if (fitIntercept) {
+            for (int c = 0; c < k; ++c) {
+                gradient[c] += probabilities[c];
+            }
+        }
+
+        for (int j = 0; j < m; ++j) {
+            T x_j = row[j];
+            T* gradient_j = gradientFeatures + j * k;
+
+            for (int c = 0; c < k; ++c) {
+                gradient_j[c] += x_j * probabilities[c];
+            }
+        }
+    }
+
+    for (flatIndex j = 0; j < size; ++j) {
+        gradient[j] /= n;
+    }
+
+    return loss / n;
+}
+
+
+template <typename T>
+int softmaxGradientDescent(flatArray<T>& X, const int* labels, flatArray<T>* Theta, flatArray<T>* costArray,
+                           int maxIteration, double epsilon, double learningRate, double gamma, char method[10],
+                           T fudgeFactor, double beta2, double weightDecay, int fitIntercept) {
+
+    // #######################################################
+    //          Multinomial (softmax) logistic regression
+    // #######################################################
+    //
+    // All k classes are trained together, with one pass over X per step.
+    // Supports the momentum ("normal"), "nesterov" and Adam family updates,
+    // applied elementwise to the m by k coefficient matrix.
+    //
+    // The cost is the multinomial log likelihood Σ log(P[i, y[i]]).
+    //
+    // With fitIntercept the first row of Θ has the intercepts and X has no column of ones.
+
+    int iteration = 0;
+    int m = Theta->getRows();
+    int k = Theta->getCols();
+    int size = m * k;
+    auto n = static_cast<T>(X.getRows());
+    double e = epsilon * 2;
+    int nesterov = strcmp(method, "nesterov") == 0;
+    int adam = strcmp(method, "adam") == 0 || strcmp(method, "adamw") == 0 || strcmp(method, "nadam") == 0;
+
+    T* w = Theta->getArray();
+    auto* gradient = new T[size];
+    auto* nu = new T[size];
+    auto* G = new T[size];
+    auto* lookAhead = new T[size];
+    auto* probabilities = new T[k];
+
+    for (int j = 0; j < size; ++j) {
+        nu[j] = 0;
+        G[j] = 0;
+    }
+
+    T JNew = -softmaxLossAndGradient<T>(X, labels, w, k, probabilities, gradient, fitIntercept) * n;
+    T JOld;
+
+    costArray->setNElement(JNew, iteration);
+
+    while (fabs(e) >= epsilon and iteration < maxIteration) {
+
+        JOld = JNew;
+
+        if (adam) {
+            adamUpdate<T>(w, gradient, nu, G, size, gamma, beta2, learningRate, fudgeFactor,
+                          strcmp(method, "adamw") == 0 ? weightDecay : 0, strcmp(method, "nadam") == 0,
+                          iteration + 1);
+        }
+
+        else {
+            if (nesterov) {
+                // gradient at the approximate next position (Θ − γ · v[t-1])
+                for (int j = 0; j < size; ++j) {
+                    lookAhead[j] = w[j] - gamma * nu[j];
+                }
+                softmaxLossAndGradient<T>(X, labels, lookAhead, k, probabilities, gradient, fitIntercept);
+            }
+
+            //          v[t] = γ · v[t-1] + η · ∇J(Θ)
+            //                 Θ[t + 1] = Θ[t] − v[t]
+            for (int j = 0; j < size; ++j) {
+                nu[j] = gamma * nu[j] + learningRate * gradient[j];
+                w[j] -= nu[j];
+            }
+        }
+
+        JNew = -softmaxLossAndGradient<T>(X, labels, w, k, probabilities, gradient, fitIntercept) * n;
+
+        e = fabs(JOld) - fabs(JNew);
+
+        costArray->setNElement(JNew, iteration + 1);
+
+        iteration++;
+    }
+
+    delete [] gradient;
+    delete [] nu;
+    delete [] G;
+    delete [] lookAhead;
+    delete [] probabilities;
+
+    return iteration;
+}
+
+
+// init + row i of X · w, X is dense or sparse
+template <typename A, typename T, typename W>
+inline A rowDot(const flatArray<T>& X, flatIndex i, const W* w, A init) {
+
+    const T* row = X.getArray() + i * X.getCols();
+
+    for (flatIndex j = 0; j < X.getCols(); ++j) {
+        init += row[j] * w[j];
+    }
+
+    return init;
+}
+
+template <typename A, typename T, typename W>
+inline A rowDot(const csrArray<T>& X, flatIndex i, const W* w, A init) {
+    return X.rowDot(i, w, init);
+}
+
+
+// out += alpha · row i of X, X is dense or sparse. Only the non zeros of the row are written to out
+template <typename A, typename T, typename W>
+inline void rowAxpy(const flatArray<T>& X, flatIndex i, A alpha, W* out) {
+
+    const T* row = X.getArray() + i * X.getCols();
+
+    for (flatIndex j = 0; j < X.getCols(); ++j) {
+        if (row[j] != 0) {
+            out[j] += alpha * row[j];
+        }
+    }
+}
+
+template <typename A, typename T, typename W>
+inline void rowAxpy(const csrArray<T>& X, flatIndex i, A alpha, W* out) {
+    X.rowAxpy(i, alpha, out);
+}
+
+
+template <typename T, class M>
+void linearPredict(M& X, flatArray<T>& coefficients, int bias, char link[10], T* result, int nThreads) {
+
+    // #######################################################
+    //          Batched prediction of linear models
+    // #######################################################
+    //
+    //          s[i, c] = w[c, 0] + Σ x[i, j] · w[c, j + 1]       (with bias)
+    //
+    // for the k rows w[c] of coefficients, followed by the link function:
+    //  - "identity":  s[i, 0]
+    //  - "sigmoid":   1 / (1 + exp(−s[i, 0]))
+    //  - "softmax":   exp(s[i, c]) / Σ exp(s[i, c'])
+    //
+    // The intercept is added to the score, so X doesn't need a column of ones, and X can be sparse. Rows are
+    // processed in blocks of predictBlockRows, which the threads take in turn, and the scores
+    // of a block are passed through the link function while they are still in cache.
+    // result is n by k for softmax and n otherwise.
+
+    typedef typename accumulator<T>::type A;
+
+    const int predictBlockRows = 256;
+
+    flatIndex rows = X.getRows();
+    flatIndex k = coefficients.getRows();
+    flatIndex stride = coefficients.getCols();
+    int sigmoid = strcmp(link, "sigmoid") == 0;
+    int softmaxLink = strcmp(link, "softmax") == 0;
+
+    const T* w = coefficients.getArray();
+
+    flatIndex blocks = rows / predictBlockRows + (rows % predictBlockRows != 0 ? 1 : 0);
+    std::atomic<flatIndex> nextBlock(0);
+
+    auto worker = [&]() {
+
+        for (flatIndex b = nextBlock++; b < blocks; b = nextBlock++) {
+
+            flatIndex end = MIN<flatIndex>(rows, (b + 1) * predictBlockRows);
+
+            for (flatIndex i = b * predictBlockRows; i < end; ++i) {
+
+                T* scores = softmaxLink ? result + i * k : result + i;
+
+                for (int c = 0; c < k; ++c) {
+
+                    const T* wc = w + c * stride;
+                    A score = rowDot(X, i, wc + bias, static_cast<A>(bias ? wc[0] : 0));
+
+                    scores[c] = static_cast<T>(score);
+                }
+
+                if (sigmoid) {
+                    scores[0] = 1 / (1 + exp(-scores[0]));
+                }
+
+                else if (softmaxLink) {
+                    softmax(scores, k);
+                }
+            }
+        }
+    };
+
+    // the calling thread is worker 0, and there is no point in having more threads than blocks
+    nThreads = static_cast<int>(MAX<flatIndex>(1, MIN<flatIndex>(nThreads, blocks)));
+
+    std::vector<std::thread> pool;
+
+    for (int t = 1; t < nThreads; ++t) {
+        pool.emplace_back(worker);
+    }
+
+    worker();
+
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
+
+
+// coefficient shared by the Hogwild! workers, read and written with relaxed atomics, so
+// concurrent updates can be lost but never torn
+template <typename T>
+class relaxedWeight {
+
+public:
+    operator T() const {return value.load(std::memory_order_relaxed);}
+
+    relaxedWeight& operator=(T x) {
+        value.store(x, std::memory_order_relaxed);
+        return *this;
+    }
+
+    relaxedWeight& operator+=(T x) {
+        value.store(value.load(std::memory_order_relaxed) + x, std::memory_order_relaxed);
+        return *this;
+    }
+
+private:
+    std::atomic<T> value;
+};
+
+
+template <typename T, class M>
+int hogwild(M& X, flatArray<T>& y, flatArray<T>* theta, flatArray<T>* costArray, int maxIteration,
+            double epsilon, double learningRate, char predType[10], int seed, int nWorkers, double& throughput,
+            int fitIntercept) {
+
+    // #######################################################
+    //             Hogwild! asynchronous SGD
+    // #######################################################
+    //
+    // Each worker samples examples with its own random number generator and updates
+    // the shared θ without locks:
+    //
+    //              θ[j] ← θ[j] − η · (h(x[i]) − y[i]) · x[i, j]      for x[i, j] ≠ 0
+    //
+    // Loads and stores are relaxed atomics, so concurrent updates to the same coefficient
+    // can be lost. This is harmless when the data is sparse and collisions are rare.
+    // X is dense or sparse (M is a csrArray), with sparse X an update costs O(non zeros of the row).
+    //
+    // One iteration is n updates spread over the workers, followed by a cost evaluation.
+    // The workers are started once and wait for the next iteration while the cost is evaluated.
+    // throughput is the number of updates per second, excluding the cost evaluations.
+    //
+    // With fitIntercept θ[0] is the intercept and X has no column of ones, every update
+    // moves the intercept by the residual (see lossAndGradient).
+
+    int iteration = 0;
+    flatIndex rows = X.getRows();
+    flatIndex m = X.getCols() + fitIntercept;
+    double e = epsilon * 2;
+    int logit = strcmp(predType, "logit") == 0;
+
+    auto* w = new relaxedWeight<T>[m];
+    relaxedWeight<T>* wFeatures = w + fitIntercept;
+    auto* prediction = emptyArray<T>(1, rows);
+
+    for (flatIndex j = 0; j < m; ++j) {
+        w[j] = theta->getNElement(j);
+    }
+
+    // per worker random number generators, a worker keeps its stream across iterations
+    std::vector<std::mt19937> generators;
+
+    for (int t = 0; t < nWorkers; ++t) {
+        std::seed_seq sequence{seed, t};
+        generators.emplace_back(sequence);
+    }
+
+    // the n updates of an iteration are spread over the workers
+    auto update = [&](int t) {
+
+        std::mt19937& generator = generators[t];
+        flatIndex updates = rows / nWorkers + (t < rows % nWorkers ? 1 : 0);
+
+        for (flatIndex u = 0; u < updates; ++u) {
+
+            auto i = static_cast<flatIndex>(generator() % rows);
+
+            T score = rowDot(X, i, wFeatures, fitIntercept ? static_cast<T>(w[0]) : static_cast<T>(0));
+
+            if (logit) {
+                score = 1 / (1 + exp(-score));
+            }
+
+            T step = learningRate * (score - y[i]);
+
+            if (fitIntercept) {
+                w[0] += -step;
+            }
+
+            rowAxpy(X, i, -step, wFeatures);
+        }
+    };
+
+    // the calling thread is worker 0, the others wait for the start of each iteration
+    std::mutex mutex;
+    std::condition_variable started;
+    std::condition_variable finished;
+    int round = 0;
+    int done = 0;
+    bool stop = false;
+
+    std::vector<std::thread> pool;
+
+    for (int t = 1; t < nWorkers; ++t) {
+        pool.emplace_back([&, t]() {
+
+            int seen = 0;
+
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    started.wait(lock, [&]() {return stop || round != seen;});
+
+                    if (stop) {
+                        return;
+                    }
+
+                    seen = round;
+                }
+
+                update(t);
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    done++;
+                }
+
+                finished.notify_one();
+            }
+        });
+    }
+
+    T JOld;
+    T JNew = calculateCost(X, *theta, y, prediction, predType, fitIntercept);
+    costArray->setNElement(JNew, iteration);
+
+    double elapsed = 0;
+    long long totalUpdates = 0;
+
+    while (fabs(e) >= epsilon and iteration < maxIteration) {
+
+        JOld = JNew;
+
+        auto start = std::chrono::steady_clock::now();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = 0;
+            round++;
+        }
+
+        started.notify_all();
+
+        update(0);
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [&]() {return done == nWorkers - 1;});
+        }
+
+        elapsed += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        totalUpdates += rows;
+
+        for (flatIndex j = 0; j < m; ++j) {
+            theta->setNElement(w[j], j);
+        }
+
+        JNew = calculateCost(X, *theta, y, prediction, predType, fitIntercept);
+
+        e = fabs(JOld) - fabs(JNew);
+
+        costArray->setNElement(JNew, iteration + 1);
+
+        iteration++;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+
+    started.notify_all();
+
+    for (auto& thread : pool) {
+        thread.join();
+    }
+
+    throughput = elapsed > 0 ? totalUpdates / elapsed : 0;
+
+    delete [] w;
+    delete prediction;
+
+    return iteration;
+}
+
+
+template <typename T>
+class coordinateDescentSolver {
+
+    // #######################################################
+    //          Elastic net coordinate descent
+    // #######################################################
+    //
+    //   J(θ) = ||y − X · θ||² / (2n) + λ · Σ p[j] · (ρ · |θ[j]| + (1 − ρ) / 2 · θ[j]²)
+    //
+    // where ρ is the l1 ratio (ρ = 1 is the Lasso) and p[j] is 0 for the intercept column.
+    // Each coordinate update is
+    //
+    //   z = x[j]^T · r / n + ||x[j]||² / n · θ[j]
+    //   θ[j] ← S(z, λ · ρ · p[j]) / (||x[j]||² / n + λ · (1 − ρ) · p[j])
+    //
+    // with S the soft thresholding operator. X is stored column major so that each x[j] is
+    // contiguous and the column norms are computed once.
+    //
+    // Naive updates keep the residual r and cost O(n) per coordinate. Covariance updates keep
+    // the gradient x[j]^T · r / n for every feature instead, and the Gram matrix row x[j]^T · X / n
+    // is computed the first time θ[j] becomes non zero, so with n ≫ m each update costs O(m).
+    //
+    // Sweeps iterate over the active set (non zero coefficients) until convergence, followed by
+    // a sweep over all the candidates to find new active features. Along a regularisation path
+    // the sequential strong rule discards feature j at λ[k] if
+    //
+    //   |x[j]^T · r(λ[k − 1])| / n < ρ · (2 · λ[k] − λ[k − 1])
+    //
+    // and the KKT conditions of the discarded features are checked once the others converge.
+    //
+    // With intercept θ[0] is not penalised. With fitIntercept X has no column of ones and θ[0]
+    // is the intercept, the ones are only added to the column major copy of X.
+
+public:
+    coordinateDescentSolver(flatArray<T>& X, flatArray<T>& y, double l1Ratio, int intercept, int covariance,
+                            int fitIntercept) :
+            n(X.getRows()), m(X.getCols() + fitIntercept), l1Ratio(l1Ratio), covariance(covariance), gram(m) {
+
+        XColumns = columns(X, fitIntercept);
+        y_ = y.getArray();
+
+        theta = new T[m]();
+        norms = new T[m];
+        penalty = new T[m];
+        xty = new T[m];
+        gradient = new T[m];
+        residual = covariance ? nullptr : new T[n];
+
+        yy = 0;
+        for (int i = 0; i < n; ++i) {
+            yy += y_[i] * y_[i];
+        }
+        yy /= n;
+
+        for (int j = 0; j < m; ++j) {
+            const T* column = XColumns->getArray() + j * n;
+            norms[j] = vectorDot(column, column, n) / n;
+            xty[j] = vectorDot(column, y_, n) / n;
+            penalty[j] = (intercept || fitIntercept) && j == 0 ? 0 : 1;
+        }
+
+        // θ starts at zero
+        if (covariance) {
+            std::copy(xty, xty + m, gradient);
+        }
+        else {
+            std::copy(y_, y_ + n, residual);
+        }
+    }
+
+    ~coordinateDescentSolver() {
+        delete XColumns;
+        delete [] theta;
+        delete [] norms;
+        delete [] penalty;
+        delete [] xty;
+        delete [] gradient;
+        delete [] residual;
+    }
+
+    void setTheta(const T* start) {
+
+        // warm start, the residual (or the gradient) is computed from scratch
+        std::copy(start, start + m, theta);
+
+        if (covariance) {
+            std::copy(xty, xty + m, gradient);
+
+            for (int j = 0; j < m; ++j) {
+                if (theta[j] != 0) {
+                    const T* row = gramRow(j);
+                    for (int k = 0; k < m; ++k) {
+                        gradient[k] -= row[k] * theta[j];
+                    }
+                }
+            }
+        }
+        else {
+            std::copy(y_, y_ + n, residual);
+
+            for (int j = 0; j < m; ++j) {
+                if (theta[j] != 0) {
+                    const T* column = XColumns->getArray() + j * n;
+                    for (int i = 0; i < n; ++i) {
+                        residual[i] -= column[i] * theta[j];
+                    }
+                }
+            }
+        }
+    }
+
+    void getTheta(T* result) const {
+        std::copy(theta, theta + m, result);
+    }
+
+    double lambdaMax() {
+
+        // smallest λ with all the penalised coefficients at zero, i.e. the largest gradient
+        // after fitting the unpenalised intercept
+        T intercept = 0;
+        T* X0 = XColumns->getArray();
+
+        if (penalty[0] == 0 && norms[0] > 0) {
+            intercept = xty[0] / norms[0];
+        }
+
+        double result = 0;
+
+        for (int j = 0; j < m; ++j) {
+            if (penalty[j] == 0) {
+                continue;
+            }
+
+            T g = xty[j];
+
+            if (intercept != 0) {
+                g -= intercept * vectorDot(X0, X0 + j * n, n) / n;
+            }
+
+            result = MAX(result, static_cast<double>(fabs(g)));
+        }
+
+        return result / MAX(l1Ratio, 1e-3);
+    }
+
+    T objective(double lambda) const {
+
+        T loss = 0;
+
+        if (covariance) {
+            // ||y − X · θ||² / (2n) = (y^T · y / n − θ^T · (X^T · y / n + X^T · r / n)) / 2
+            loss = yy;
+            for (int j = 0; j < m; ++j) {
+                loss -= theta[j] * (xty[j] + gradient[j]);
+            }
+            loss /= 2;
+        }
+        else {
+            loss = vectorDot(residual, residual, n) / (2 * n);
+        }
+
+        T regularisation = 0;
+
+        for (int j = 0; j < m; ++j) {
+            regularisation += penalty[j] * (l1Ratio * fabs(theta[j]) + (1 - l1Ratio) / 2 * theta[j] * theta[j]);
+        }
+
+        return loss + lambda * regularisation;
+    }
+
+    int solve(double lambda, double previousLambda, double epsilon, int maxIteration, flatArray<T>* costArray) {
+
+        // returns the number of sweeps, previousLambda <= 0 disables the strong rule screening
+        int iteration = 0;
+        std::vector<char> strong(m, 1);
+        std::vector<int> candidates;
+        std::vector<int> active;
+
+        if (previousLambda > 0) {
+            double threshold = l1Ratio * (2 * lambda - previousLambda);
+
+            for (int j = 0; j < m; ++j) {
+                strong[j] = penalty[j] == 0 || theta[j] != 0 || fabs(coordinateGradient(j)) >= threshold;
+            }
+        }
+
+        if (costArray != nullptr) {
+            costArray->setNElement(objective(lambda), 0);
+        }
+
+        while (iteration < maxIteration) {
+
+            candidates.clear();
+            for (int j = 0; j < m; ++j) {
+                if (strong[j]) {
+                    candidates.push_back(j);
+                }
+            }
+
+            // sweeps over the candidates, each followed by sweeps over the active set until convergence
+            while (iteration < maxIteration) {
+
+                T change = sweep(candidates, lambda);
+                record(costArray, lambda, ++iteration);
+
+                if (change < epsilon) {
+                    break;
+                }
+
+                active.clear();
+                for (int j : candidates) {
+                    if (theta[j] != 0) {
+                        active.push_back(j);
+                    }
+                }
+
+                while (iteration < maxIteration) {
+                    change = sweep(active, lambda);
+                    record(costArray, lambda, ++iteration);
+
+                    if (change < epsilon) {
+                        break;
+                    }
+                }
+            }
+
+            // features discarded by the strong rule that violate the KKT conditions
+            bool violations = false;
+
+            for (int j = 0; j < m; ++j) {
+                if (!strong[j] && fabs(coordinateGradient(j)) > lambda * l1Ratio) {
+                    strong[j] = 1;
+                    violations = true;
+                }
+            }
+
+            if (!violations) {
+                break;
+            }
+        }
+
+        return iteration;
+    }
+
+private:
+    flatIndex n;
+    int m;
+    double l1Ratio;
+    int covariance;
+    flatArray<T>* XColumns;
+    const T* y_;
+    T* theta;
+    T* norms;
+    T* penalty;
+    T* xty;
+    T* gradient;
+    T* residual;
+    T yy;
+    std::vector<std::vector<T>> gram;
+
+    static flatArray<T>* columns(flatArray<T>& X, int fitIntercept) {
+
+        // X stored column major, with a leading column of ones if fitIntercept
+        if (!fitIntercept) {
+            return X.transpose();
+        }
+
+        flatIndex rows = X.getRows();
+        flatIndex cols = X.getCols();
+        const T* x = X.getArray();
+        auto* result = emptyArray<T>(cols + 1, rows);
+        T* column = result->getArray();
+
+        for (flatIndex i = 0; i < rows; ++i) {
+            column[i] = 1;
+
+            for (flatIndex j = 0; j < cols; ++j) {
+                column[(j + 1) * rows + i] = x[i * cols + j];
+            }
+        }
+
+        return result;
+    }
+
+    const T* gramRow(int j) {
+
+        if (gram[j].empty()) {
+            const T* x = XColumns->getArray();
+            gram[j].resize(m);
+
+            for (int k = 0; k < m; ++k) {
+                gram[j][k] = vectorDot(x + j * n, x + k * n, n) / n;
+            }
+        }
+
+        return gram[j].data();
+    }
+
+    T coordinateGradient(int j) const {
+        return covariance ? gradient[j] : vectorDot(XColumns->getArray() + j * n, residual, n) / n;
+    }
+
+    T sweep(const std::vector<int>& coordinates, double lambda) {
+
+        // returns the largest weighted squared change ||x[j]||² / n · Δθ[j]²
+        T change = 0;
+
+        for (int j : coordinates) {
+
+            if (norms[j] == 0) {
+                continue;
+            }
+
+            T z = coordinateGradient(j) + norms[j] * theta[j];
+            T threshold = lambda * l1Ratio * penalty[j];
+            T shrunk = z > threshold ? z - threshold : z < -threshold ? z + threshold : 0;
+            T updated = shrunk / (norms[j] + lambda * (1 - l1Ratio) * penalty[j]);
+            T delta = updated - theta[j];
+
+            if (delta == 0) {
+                continue;
+            }
+
+            theta[j] = updated;
+
+            if (covariance) {
+                const T* row = gramRow(j);
+                for (int k = 0; k < m; ++k) {
+                    gradient[k] -= row[k] * delta;
+                }
+            }
+            else {
+                const T* column = XColumns->getArray() + j * n;
+                for (int i = 0; i < n; ++i) {
+                    residual[i] -= column[i] * delta;
+                }
+            }
+
+            change = MAX(change, norms[j] * delta * delta);
+        }
+
+        return change;
+    }
+
+    void record(flatArray<T>* costArray, double lambda, int iteration) {
+        if (costArray != nullptr && iteration < costArray->getCols()) {
+            costArray->setNElement(objective(lambda), iteration);
+        }
+    }
+};
+
+
+template <typename T>
+int elasticNet(flatArray<T>& X, flatArray<T>& y, flatArray<T>* theta, flatArray<T>* costArray, double lambda,
+               double l1Ratio, double epsilon, int maxIteration, int intercept, int covariance, int fitIntercept) {
+
+    // single elastic net fit by coordinate descent, warm started from θ
+    coordinateDescentSolver<T> solver(X, y, l1Ratio, intercept, covariance, fitIntercept);
+
+    solver.setTheta(theta->getArray());
+
+    int iteration = solver.solve(lambda, 0, epsilon, maxIteration, costArray);
+
+    solver.getTheta(theta->getArray());
+
+    return iteration;
+}
+
+
+template <typename T>
+void elasticNetPath(flatArray<T>& X, flatArray<T>& y, double* lambdas, int nLambdas, double lambdaRatio,
+                    flatArray<T>* thetas, T* costs, int* iterations, double l1Ratio, double epsilon,
+                    int maxIteration, int intercept, int covariance, int fitIntercept) {
+
+    // regularisation path over a descending λ grid, each fit is warm started from the previous one.
+    // If lambdaRatio > 0 the grid is filled with nLambdas values evenly spaced on a log scale from
+    // λ max down to lambdaRatio · λ max. thetas is nLambdas by m (plus one with fitIntercept).
+    coordinateDescentSolver<T> solver(X, y, l1Ratio, intercept, covariance, fitIntercept);
+
+    int m = X.getCols() + fitIntercept;
+
+    if (lambdaRatio > 0) {
+        double lambdaMax = solver.lambdaMax();
+
+        for (int k = 0; k < nLambdas; ++k) {
+            lambdas[k] = nLambdas == 1 ? lambdaMax :
+                         lambdaMax * pow(lambdaRatio, static_cast<double>(k) / (nLambdas - 1));
+        }
+    }
+
+    for (int k = 0; k < nLambdas; ++k) {
+        iterations[k] = solver.solve(lambdas[k], k > 0 ? lambdas[k - 1] : 0, epsilon, maxIteration, nullptr);
+        costs[k] = solver.objective(lambdas[k]);
+        solver.getTheta(thetas->getArray() + k * m);
+    }
+}
+
+
+template <typename T>
+class optimiserState {
+
+    // coefficients and optimiser state kept between partialFit calls: momentum (or first
+    // moment) nu, accumulated squared gradients (or second moment) G, the number of updates
+    // and epochs, and the random number generator used to shuffle mini batches
+
+public:
+    optimiserState(flatArray<T>* theta, int seed) : theta(theta), nu(zeroArray<T>(1, theta->getCols())),
+                                                    G(zeroArray<T>(1, theta->getCols())), updates(0), epochs(0),
+                                                    generator(static_cast<unsigned>(seed)) {}
+
+    optimiserState(const optimiserState&) = delete;
+    optimiserState& operator=(const optimiserState&) = delete;
+
+    ~optimiserState() {
+        delete theta;
+        delete nu;
+        delete G;
+    }
+
+    flatArray<T>* theta;
+    flatArray<T>* nu;
+    flatArray<T>* G;
+    int updates;
+    int epochs;
+    std::mt19937 generator;
+};
+
+
+template <typename T>
+void partialFit(flatArray<T>& X, flatArray<T>& y, optimiserState<T>& state, flatArray<T>* costArray, int epochs,
+                double learningRate, double alpha, char predType[10], char method[10], T fudgeFactor,
+                double beta2, double weightDecay, int batchSize, const learningRateSchedule& schedule,
+                int fitIntercept) {
+
+    // runs epochs passes over (X, y) continuing from state, without a convergence test.
+    // The updates are the same as in batchGradientDescent (batchSize <= 0 or >= n) and
+    // minibatchGradientDescent, so fitting the same data in several calls is equivalent to
+    // fitting it in one call. costArray has the cost before the first epoch and after each one.
+
+    flatIndex rows = X.getRows();
+    int m = X.getCols() + fitIntercept;
+    bool minibatch = batchSize > 0 && batchSize < rows;
+    flatIndex batch = minibatch ? batchSize : rows;
+    flatIndex batches = rows / batch + (rows % batch != 0 ? 1 : 0);
+
+    auto* prediction = emptyArray<T>(1, rows);
+    auto* error = emptyArray<T>(1, batch);
+    flatIndex* rNums = minibatch ? new flatIndex[rows] : nullptr;
+
+    // temporaries of the weight updates
+    scratchArena scratch;
+
+    costArray->setNElement(calculateCost(X, *state.theta, y, prediction, predType, fitIntercept), 0);
+
+    for (int epoch = 0; epoch < epochs; ++epoch) {
+
+        if (minibatch) {
+            for (flatIndex i = 0; i < rows; ++i) {
+                rNums[i] = i;
+            }
+
+            shuffle(rNums, rows, state.generator);
+        }
+
+        for (flatIndex i = 0; i < batches; ++i) {
+
+            flatIndex start = i * batch;
+            flatIndex count = MIN(batch, rows - start);
+
+            // batch gradient descent counts updates, mini batch gradient descent counts epochs
+            updateWeights<T>(X, y, minibatch ? rNums + start : nullptr, count, state.theta, state.nu, error, alpha,
+                             schedule.rate(learningRate, state.updates), m, predType, method, fudgeFactor, state.G,
+                             minibatch ? state.epochs : state.updates, state.updates + 1, beta2, weightDecay,
+                             fitIntercept, scratch);
+
+            state.updates++;
+        }
+
+        state.epochs++;
+
+        costArray->setNElement(calculateCost(X, *state.theta, y, prediction, predType, fitIntercept), epoch + 1);
+    }
+
+    delete prediction;
+    delete error;
+    delete [] rNums;
+}
+
+
+template <typename T, class M>
+int fitGradientDescent(M& X, flatArray<T> &y, flatArray<T> *theta, int maxIteration,
+                       T epsilon, T learningRate, T alpha, flatArray<T>* costArray, char predType[10], int batchSize,
+                       char method[10], T fudge_factor, double beta2, double weightDecay, int historySize,
+                       char monitor[10], int monitorFrequency, int monitorSamples, int physicalShuffle,
+                       std::mt19937* generator, M* XVal, flatArray<T>* yVal, int patience,
+                       double minImprovement, const learningRateSchedule& schedule, int fitIntercept) {
+
+    // X is not modified, so it can be shared by concurrent fits.
+    // With fitIntercept theta[0] is an intercept that X (and XVal) has no column for.
+    // If XVal is not a nullptr, gradient descent stops early once the cost of the validation set
+    // (XVal, yVal) stops improving, and theta is set to the best weights (not supported by L-BFGS).
+    // On return costArray only holds the recorded costs.
 
     // variable declaration
     int iteration = 0;
     double e = epsilon * 2;
 
-    int m = X.getCols();
+    int m = X.getCols() + fitIntercept;
 
     auto n = static_cast<T>(X.getRows());
 
-    flatArray<T>* XT = nullptr;
     flatArray<T>* nu = nullptr;
 
-    // X pyTranspose (m by n matrix)
-    // X is a n by m matrix
-    XT = X.transpose();
-
     // initialise nu (when using momentum) as an empty array with same dimensions as theta (m dimensional vector)
     nu = zeroArray<T>(1, theta->getCols());
 
-    // decide which type of gradient descent to perform (batch or mini batch gradient descent)
-    if (batchSize <= 0) {
+    earlyStopping<T, M>* stopping = nullptr;
+
+    if (XVal != nullptr && strcmp(method, "lbfgs") != 0) {
+        stopping = new earlyStopping<T, M>(XVal, yVal, patience, minImprovement, predType, theta, fitIntercept);
+    }
+
+    // decide which type of gradient descent to perform (L-BFGS, batch or mini batch gradient descent)
+    if (strcmp(method, "lbfgs") == 0) {
+        // quasi-Newton method always uses the whole dataset
+        lbfgs(X, y, theta, costArray, epsilon, maxIteration, predType, m, n, iteration, historySize, fitIntercept);
+        costArray->setCols(iteration + 1);
+    }
+
+    else if (batchSize <= 0) {
         // batch gradient descent
-        batchGradientDescent(X, y, theta, *XT, costArray, nu, e, epsilon, maxIteration,
-                             predType, alpha, learningRate, m, n, iteration, method, fudge_factor);
+        batchGradientDescent(X, y, theta, costArray, nu, e, epsilon, maxIteration,
+                             predType, alpha, learningRate, m, n, iteration, method, fudge_factor, beta2,
+                             weightDecay, stopping, schedule, fitIntercept);
+        costArray->setCols(iteration + 1);
     }
 
     else if (batchSize > 0 && batchSize < X.getRows()) {
         // mini batch gradient descent (if batch size = 1 it's the equivalent of stochastic gradient descent)
-        minibatchGradientDescent(X, y, theta, *XT, costArray, nu, e, epsilon, maxIteration, predType,
-                                 alpha, learningRate, m, n, batchSize, iteration, method, fudge_factor);
+        minibatchGradientDescent(X, y, theta, costArray, nu, e, epsilon, maxIteration, predType,
+                                 alpha, learningRate, m, n, batchSize, iteration, method, fudge_factor, beta2,
+                                 weightDecay, monitor, monitorFrequency, monitorSamples, physicalShuffle,
+                                 generator, stopping, schedule, fitIntercept);
     }
 
-    else if (batchSize >= X.getRows()) {
+    else {
         // batch_size > number of examples, default to batch gradient descent
-        batchGradientDescent(X, y, theta, *XT, costArray, nu, e, epsilon, maxIteration,
-                             predType, alpha, learningRate, m, n, iteration, method, fudge_factor);
+        batchGradientDescent(X, y, theta, costArray, nu, e, epsilon, maxIteration,
+                             predType, alpha, learningRate, m, n, iteration, method, fudge_factor, beta2,
+                             weightDecay, stopping, schedule, fitIntercept);
+        costArray->setCols(iteration + 1);
     }
 
-    else {
-        PyErr_SetString(PyExc_ValueError, std::to_string(batchSize).c_str());
+    if (stopping != nullptr) {
+        stopping->restore(theta);
     }
 
     // free up memory
-    delete XT;
     delete nu;
+    delete stopping;
 
     // return number of iterations needed to reach convergence
     return iteration;
 }
 
+
+template <typename T, class M>
+int gradientDescent(M& X, flatArray<T> &y, flatArray<T> *theta, int maxIteration, T epsilon,
+                    T learningRate, T alpha, flatArray<T>* costArray, char predType[10], int batchSize,
+                    int seed, char method[10], T fudge_factor, double beta2, double weightDecay, int historySize,
+                    char monitor[10], int monitorFrequency, int monitorSamples, int physicalShuffle,
+                    M* XVal, flatArray<T>* yVal, int patience, double minImprovement,
+                    const learningRateSchedule& schedule, int fitIntercept) {
+
+    // set random variables
+    srand(static_cast<unsigned int>(seed));
+
+    return fitGradientDescent(X, y, theta, maxIteration, epsilon, learningRate, alpha, costArray, predType,
+                              batchSize, method, fudge_factor, beta2, weightDecay, historySize, monitor,
+                              monitorFrequency, monitorSamples, physicalShuffle, nullptr, XVal, yVal, patience,
+                              minImprovement, schedule, fitIntercept);
+}
+
+
+template <typename T>
+void oneVsRest(flatArray<T>& X, const int* labels, std::vector<flatArray<T>*>& thetas,
+               std::vector<flatArray<T>*>& costArrays, int* iterations, int maxIteration, T epsilon,
+               T learningRate, T alpha, int batchSize, int seed, char method[10], T fudge_factor, double beta2,
+               double weightDecay, int historySize, char monitor[10], int monitorFrequency, int monitorSamples,
+               int physicalShuffle, flatArray<T>* XVal, const int* labelsVal, int patience, double minImprovement,
+               const learningRateSchedule& schedule, int nThreads, int fitIntercept) {
+
+    // #######################################################
+    //            Parallel one-vs-rest classification
+    // #######################################################
+    //
+    // Trains the k binary problems (class c against the rest) concurrently. All workers read
+    // the same X, while theta, nu, G and the random number generator are owned by
+    // each class. A class always draws from the stream seeded with (seed, c), so the result
+    // does not depend on the number of threads or on scheduling.
+    //
+    // With a validation set (XVal, labelsVal) each class stops early on its own.
+    //
+    // Must be called without the GIL, nothing in here touches Python objects.
+
+    auto k = static_cast<int>(thetas.size());
+    int n = X.getRows();
+
+    char predType[10] = "logit";
+
+    // workers pick the next untrained class until there are none left
+    std::atomic<int> nextClass(0);
+
+    auto worker = [&]() {
+
+        auto* y = emptyArray<T>(1, n);
+        flatArray<T>* yVal = nullptr;
+
+        if (XVal != nullptr) {
+            yVal = emptyArray<T>(1, XVal->getRows());
+        }
+
+        for (int c = nextClass++; c < k; c = nextClass++) {
+
+            std::seed_seq sequence{seed, c};
+            std::mt19937 generator(sequence);
+
+            // relabel classes
+            for (int i = 0; i < n; ++i) {
+                y->setNElement(labels[i] == c ? 1 : 0, i);
+            }
+
+            for (int i = 0; yVal != nullptr && i < XVal->getRows(); ++i) {
+                yVal->setNElement(labelsVal[i] == c ? 1 : 0, i);
+            }
+
+            iterations[c] = fitGradientDescent(X, *y, thetas[c], maxIteration, epsilon, learningRate, alpha,
+                                               costArrays[c], predType, batchSize, method, fudge_factor, beta2,
+                                               weightDecay, historySize, monitor, monitorFrequency,
+                                               monitorSamples, physicalShuffle, &generator, XVal, yVal, patience,
+                                               minImprovement, schedule, fitIntercept);
+        }
+
+        delete y;
+        delete yVal;
+    };
+
+    nThreads = MAX(1, MIN(nThreads, k));
+
+    std::vector<std::thread> pool;
+
+    for (int t = 1; t < nThreads; ++t) {
+        pool.emplace_back(worker);
+    }
+
+    // the calling thread is also a worker
+    worker();
+
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
@@ -8,17 +8,799 @@
 #include "optimisers.cpp"
 
 
-static PyObject *GD(PyObject *self, PyObject *args) {
+template <typename T>
+static flatArray<T>* allocateCostArray(int n, int batchSize, int maxIterations, bool minibatch) {
+
+    // memory allocation of costArray
+    if (minibatch) {
+        auto batchIterations = static_cast<int>(std::floor(n / batchSize));
+
+        if (n % batchSize == 0) {
+            return emptyArray<T>(1, maxIterations * batchIterations);
+        }
+
+        else {
+            return emptyArray<T>(1, maxIterations * (batchIterations + 1));
+        }
+    }
+
+    else {
+        // initial cost plus the cost after each iteration
+        return emptyArray<T>(1, maxIterations + 1);
+    }
+}
+
+
+static bool validMonitor(const char* monitor, int monitorFrequency, int monitorSamples) {
+
+    // sets a Python error and returns false if the mini batch monitor policy is not valid
+    if (strcmp(monitor, "full") != 0 && strcmp(monitor, "average") != 0 && strcmp(monitor, "every") != 0 &&
+        strcmp(monitor, "subsample") != 0) {
+        PyErr_SetString(PyExc_ValueError, "Unknown monitor policy!");
+        return false;
+    }
+
+    if (monitorFrequency < 1 || monitorSamples < 1) {
+        PyErr_SetString(PyExc_ValueError, "Monitor frequency and number of samples must be at least 1.");
+        return false;
+    }
+
+    return true;
+}
+
+
+template <typename T>
+static bool readFeatures(PyObject* pX, flatArray<T>** X) {
+
+    // reads the features of the examples, a non empty list of lists (or list for a single example) or
+    // a CSR matrix (see isSparse). Sets a Python error and returns false if they can't be read
+    if (!PyList_Check(pX) || PyList_Size(pX) == 0) {
+        PyErr_SetString(PyExc_TypeError, "Expected a non empty list or a CSR matrix!");
+        return false;
+    }
+
+    *X = readFromPythonList<T>(pX);
+
+    return true;
+}
+
+
+template <typename T>
+static bool readFeatures(PyObject* pX, csrArray<T>** X) {
+
+    *X = convertPy_csrArray<T>(pX);
+
+    return *X != nullptr;
+}
+
+
+template <class M>
+static bool readValidationSet(PyObject* pXVal, PyObject* pyVal, int m, M** XVal) {
+
+    // reads the validation features if they were passed, in the same format as the training set, sets a
+    // Python error and returns false if they don't match the training set
+    if (pXVal == nullptr && pyVal == nullptr) {
+        return true;
+    }
+
+    if (pXVal == nullptr || pyVal == nullptr || (PyList_Check(pXVal) && PyList_Size(pXVal) == 0) ||
+        PyObject_Length(pXVal) != PyList_Size(pyVal)) {
+        PyErr_Clear();
+        PyErr_SetString(PyExc_ValueError, "X_val and y_val should have the same number of examples.");
+        return false;
+    }
+
+    if (!readFeatures(pXVal, XVal)) {
+        return false;
+    }
+
+    if ((*XVal)->getCols() != m) {
+        PyErr_SetString(PyExc_ValueError, "X_val should have the same number of features as X.");
+        delete *XVal;
+        *XVal = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+
+static bool readSchedule(PyObject* pySchedule, learningRateSchedule* schedule) {
+
+    // reads a schedule descriptor (name, gamma, period, min_learning_rate, warmup), sets a Python
+    // error and returns false if it is not valid
+    char* name;
+    double gamma, minRate, warmup;
+    int period;
+
+    if (pySchedule == nullptr) {
+        return true;
+    }
+
+    if (!PyArg_ParseTuple(pySchedule, "sdidd", &name, &gamma, &period, &minRate, &warmup)) {
+        PyErr_SetString(PyExc_TypeError, "The schedule should be a tuple (name, gamma, period, min_learning_rate, "
+                                         "warmup)");
+        return false;
+    }
+
+    if (!learningRateSchedule::valid(name)) {
+        PyErr_SetString(PyExc_ValueError, "Unknown learning rate schedule!");
+        return false;
+    }
+
+    if (period < 1 || warmup < 0 || warmup > 1) {
+        PyErr_SetString(PyExc_ValueError, "The schedule period must be at least 1 and warmup between 0 and 1.");
+        return false;
+    }
+
+    *schedule = learningRateSchedule(name, gamma, period, minRate, warmup);
+
+    return true;
+}
+
+
+template <typename T, class M>
+static PyObject *fitGD(PyObject* pX, PyObject* ptheta, PyObject* py, PyObject* pXVal, PyObject* pyVal,
+                       int batchSize, int maxIterations, double epsilon, double learningRate, double alpha,
+                       char* predType, char* method, int seed, double fudge_factor, double beta2, double weightDecay,
+                       int historySize, char* monitor, int monitorFrequency, int monitorSamples, int physicalShuffle,
+                       int patience, double minImprovement, const learningRateSchedule& schedule,
+                       int fitIntercept) {
+
+    // gradient descent with T precision data, the results are returned as Python floats.
+    // With fitIntercept theta[0] is the intercept and X has no column of ones. X (and XVal) is either
+    // dense (M is a flatArray) or sparse (M is a csrArray)
+
+    // variable declaration
+    int m, n, iterations;
+    flatArray<T>* costArray = nullptr;
+    M* X = nullptr;
+    flatArray<T>* y = nullptr;
+    flatArray<T>* theta = nullptr;
+    M* XVal = nullptr;
+    flatArray<T>* yVal = nullptr;
+
+    PyObject* pyCostArray;
+    PyObject* pyTheta;
+
+    // read python lists
+    if (!readFeatures(pX, &X)) {
+        return nullptr;
+    }
+
+    y = readFromPythonList<T>(py);
+    theta = readFromPythonList<T>(ptheta);
+
+    n = X->getRows();
+    m = X->getCols();
+
+    if (PyList_Size(ptheta) != m + fitIntercept) {
+        PyErr_SetString(PyExc_ValueError, "Theta should be the same size as the number of features (plus one with "
+                                          "fit_intercept).");
+        delete theta;
+        delete y;
+        delete X;
+        return nullptr;
+    }
+
+    // sparse features (e.g. bag of words) often outnumber the examples
+    if (m + fitIntercept > n && !isSparse(pX)) {
+        PyErr_SetString(PyExc_ValueError, "More features than training examples!");
+        delete theta;
+        delete y;
+        delete X;
+        return nullptr;
+    }
+
+    if (y->getSize() != n) {
+        PyErr_SetString(PyExc_ValueError, "X and y should have the same number of examples.");
+        delete theta;
+        delete y;
+        delete X;
+        return nullptr;
+    }
+
+    if (historySize < 1) {
+        PyErr_SetString(PyExc_ValueError, "L-BFGS history size must be at least 1.");
+        delete theta;
+        delete y;
+        delete X;
+        return nullptr;
+    }
+
+    if (patience < 1) {
+        PyErr_SetString(PyExc_ValueError, "Patience must be at least 1.");
+        delete theta;
+        delete y;
+        delete X;
+        return nullptr;
+    }
+
+    if (!readValidationSet(pXVal, pyVal, m, &XVal)) {
+        delete theta;
+        delete y;
+        delete X;
+        return nullptr;
+    }
+
+    if (XVal != nullptr) {
+        yVal = emptyArray<T>(1, XVal->getRows());
+
+        for (int i = 0; i < XVal->getRows(); ++i) {
+            yVal->setNElement(static_cast<T>(PyFloat_AsDouble(PyList_GET_ITEM(pyVal, i))), i);
+        }
+    }
+
+    // L-BFGS always uses the whole dataset
+    bool minibatch = batchSize > 0 && batchSize < n && strcmp(method, "lbfgs") != 0;
+
+    costArray = allocateCostArray<T>(n, batchSize, maxIterations, minibatch);
+
+    // gradient descent
+    iterations = gradientDescent<T>(*X, *y, theta, maxIterations, static_cast<T>(epsilon),
+                                    static_cast<T>(learningRate), static_cast<T>(alpha), costArray, predType,
+                                    batchSize, seed, method, static_cast<T>(fudge_factor), beta2, weightDecay,
+                                    historySize, monitor, monitorFrequency, monitorSamples, physicalShuffle,
+                                    XVal, yVal, patience, minImprovement, schedule, fitIntercept);
+
+    // convert cost array and theta to lists
+    pyCostArray = ConvertFlatArray_PyList(costArray, "float");
+    pyTheta = ConvertFlatArray_PyList(theta, "float");
+
+    PyObject* FinalResult = Py_BuildValue("OOi", pyTheta, pyCostArray, iterations);
+
+    // memory deallocation
+    delete costArray;
+    delete theta;
+    delete y;
+    delete X;
+    delete XVal;
+    delete yVal;
+
+    Py_DECREF(pyCostArray);
+    Py_DECREF(pyTheta);
+
+    return FinalResult;
+}
+
+
+static PyObject *GD(PyObject *self, PyObject *args, PyObject *kwargs) {
+
+    // variable declaration
+    int maxIterations, batchSize, seed;
+    double epsilon, learningRate, alpha, fudge_factor;
+    double beta2 = 0.999;
+    double weightDecay = 0.0;
+    int historySize = 10;
+    int monitorFrequency = 1;
+    int monitorSamples = 1000;
+    int physicalShuffle = 0;
+    int patience = 5;
+    double minImprovement = 0.0;
+    learningRateSchedule schedule;
+    char* predType;
+    char* method;
+    char defaultMonitor[10] = "full";
+    char* monitor = defaultMonitor;
+    char defaultDtype[10] = "float64";
+    char* dtype = defaultDtype;
+    int fitIntercept = 0;
+
+    PyObject* ptheta;
+    PyObject* pX;
+    PyObject* py;
+    PyObject* pXVal = nullptr;
+    PyObject* pyVal = nullptr;
+    PyObject* pySchedule = nullptr;
+
+    static const char* kwlist[] = {"X", "theta", "y", "batch_size", "max_iterations", "epsilon", "learning_rate",
+                                   "alpha", "pred_type", "method", "seed", "fudge_factor", "beta_2", "weight_decay",
+                                   "history_size", "monitor", "monitor_frequency", "monitor_samples",
+                                   "physical_shuffle", "X_val", "y_val", "patience", "min_improvement", "schedule",
+                                   "dtype", "fit_intercept", nullptr};
+
+    // return error if we don't get all the arguments
+    if(!PyArg_ParseTupleAndKeywords(args, kwargs, "OO!O!iidddssid|ddisiipOO!idO!sp", const_cast<char**>(kwlist),
+                                    &pX, &PyList_Type, &ptheta, &PyList_Type, &py,
+                                    &batchSize, &maxIterations, &epsilon, &learningRate, &alpha, &predType, &method,
+                                    &seed, &fudge_factor, &beta2, &weightDecay, &historySize, &monitor,
+                                    &monitorFrequency, &monitorSamples, &physicalShuffle, &pXVal,
+                                    &PyList_Type, &pyVal, &patience, &minImprovement, &PyTuple_Type, &pySchedule,
+                                    &dtype, &fitIntercept)) {
+        PyErr_SetString(PyExc_TypeError, "Check arguments!");
+        return nullptr;
+    }
+
+    if (!readSchedule(pySchedule, &schedule)) {
+        return nullptr;
+    }
+
+    if (!validMonitor(monitor, monitorFrequency, monitorSamples)) {
+        return nullptr;
+    }
+
+    // X is either a list of lists or a CSR matrix
+    bool sparse = isSparse(pX);
+
+    if (strcmp(dtype, "float32") == 0 && sparse) {
+        return fitGD<float, csrArray<float>>(pX, ptheta, py, pXVal, pyVal, batchSize, maxIterations, epsilon,
+                                             learningRate, alpha, predType, method, seed, fudge_factor, beta2,
+                                             weightDecay, historySize, monitor, monitorFrequency, monitorSamples,
+                                             physicalShuffle, patience, minImprovement, schedule, fitIntercept);
+    }
+
+    if (strcmp(dtype, "float32") == 0) {
+        return fitGD<float, flatArray<float>>(pX, ptheta, py, pXVal, pyVal, batchSize, maxIterations, epsilon,
+                                              learningRate, alpha, predType, method, seed, fudge_factor, beta2,
+                                              weightDecay, historySize, monitor, monitorFrequency, monitorSamples,
+                                              physicalShuffle, patience, minImprovement, schedule, fitIntercept);
+    }
+
+    if (strcmp(dtype, "float64") == 0 && sparse) {
+        return fitGD<double, csrArray<double>>(pX, ptheta, py, pXVal, pyVal, batchSize, maxIterations, epsilon,
+                                               learningRate, alpha, predType, method, seed, fudge_factor, beta2,
+                                               weightDecay, historySize, monitor, monitorFrequency, monitorSamples,
+                                               physicalShuffle, patience, minImprovement, schedule, fitIntercept);
+    }
+
+    if (strcmp(dtype, "float64") == 0) {
+        return fitGD<double, flatArray<double>>(pX, ptheta, py, pXVal, pyVal, batchSize, maxIterations, epsilon,
+                                                learningRate, alpha, predType, method, seed, fudge_factor, beta2,
+                                                weightDecay, historySize, monitor, monitorFrequency, monitorSamples,
+                                                physicalShuffle, patience, minImprovement, schedule, fitIntercept);
+    }
+
+    PyErr_SetString(PyExc_ValueError, "Unknown dtype!");
+    return nullptr;
+}
+
+
+static PyObject *OVR(PyObject *self, PyObject *args, PyObject *kwargs) {
+
+    // variable declaration
+    int m, n, k, maxIterations, batchSize, seed;
+    double epsilon, learningRate, alpha, fudge_factor;
+    double beta2 = 0.999;
+    double weightDecay = 0.0;
+    int historySize = 10;
+    int nJobs = 1;
+    int monitorFrequency = 1;
+    int monitorSamples = 1000;
+    int physicalShuffle = 0;
+    int patience = 5;
+    double minImprovement = 0.0;
+    int fitIntercept = 0;
+    int* labels = nullptr;
+    int* labelsVal = nullptr;
+    flatArray<double>* XVal = nullptr;
+    learningRateSchedule schedule;
+    int* iterations = nullptr;
+    flatArray<double>* X = nullptr;
+    std::vector<flatArray<double>*> thetas;
+    std::vector<flatArray<double>*> costArrays;
+    char* method;
+    char defaultMonitor[10] = "full";
+    char* monitor = defaultMonitor;
+
+    PyObject* ptheta;
+    PyObject* pX;
+    PyObject* py;
+    PyObject* pXVal = nullptr;
+    PyObject* pyVal = nullptr;
+    PyObject* pySchedule = nullptr;
+    PyObject* pyThetas;
+    PyObject* pyCostArrays;
+    PyObject* pyIterations;
+
+    static const char* kwlist[] = {"X", "theta", "y", "batch_size", "max_iterations", "epsilon", "learning_rate",
+                                   "alpha", "method", "seed", "fudge_factor", "beta_2", "weight_decay",
+                                   "history_size", "n_jobs", "monitor", "monitor_frequency", "monitor_samples",
+                                   "physical_shuffle", "X_val", "y_val", "patience", "min_improvement", "schedule",
+                                   "fit_intercept", nullptr};
+
+    // return error if we don't get all the arguments
+    if(!PyArg_ParseTupleAndKeywords(args, kwargs, "O!O!O!iidddsid|ddiisiipO!O!idO!p", const_cast<char**>(kwlist),
+                                    &PyList_Type, &pX, &PyList_Type, &ptheta, &PyList_Type, &py,
+                                    &batchSize, &maxIterations, &epsilon, &learningRate, &alpha, &method,
+                                    &seed, &fudge_factor, &beta2, &weightDecay, &historySize, &nJobs, &monitor,
+                                    &monitorFrequency, &monitorSamples, &physicalShuffle, &PyList_Type, &pXVal,
+                                    &PyList_Type, &pyVal, &patience, &minImprovement, &PyTuple_Type, &pySchedule,
+                                    &fitIntercept)) {
+        PyErr_SetString(PyExc_TypeError, "Check arguments!");
+        return nullptr;
+    }
+
+    if (!readSchedule(pySchedule, &schedule)) {
+        return nullptr;
+    }
+
+    if (!validMonitor(monitor, monitorFrequency, monitorSamples)) {
+        return nullptr;
+    }
+
+    // errors can't be raised once the workers are running, so validate everything here
+    if (strcmp(method, "normal") != 0 && strcmp(method, "nesterov") != 0 && strcmp(method, "adagrad") != 0 &&
+        strcmp(method, "adadelta") != 0 && strcmp(method, "rmsprop") != 0 && strcmp(method, "adam") != 0 &&
+        strcmp(method, "adamw") != 0 && strcmp(method, "nadam") != 0 && strcmp(method, "lbfgs") != 0) {
+        PyErr_SetString(PyExc_ValueError, "Unknown GD method");
+        return nullptr;
+    }
+
+    if (historySize < 1) {
+        PyErr_SetString(PyExc_ValueError, "L-BFGS history size must be at least 1.");
+        return nullptr;
+    }
+
+    k = static_cast<int>(PyList_Size(ptheta));
+
+    if (k < 2 || !PyList_Check(PyList_GET_ITEM(ptheta, 0))) {
+        PyErr_SetString(PyExc_ValueError, "Theta should be a list with the coefficients of each class.");
+        return nullptr;
+    }
+
+    // read python lists
+    X = readFromPythonList<double>(pX);
+
+    n = X->getRows();
+    m = X->getCols();
+
+    if (m + fitIntercept > n) {
+        PyErr_SetString(PyExc_ValueError, "More features than training examples!");
+        delete X;
+        return nullptr;
+    }
+
+    if (PyList_Size(py) != n) {
+        PyErr_SetString(PyExc_ValueError, "y should be the same size as the number of training examples.");
+        delete X;
+        return nullptr;
+    }
+
+    for (int c = 0; c < k; ++c) {
+        if (!PyList_Check(PyList_GET_ITEM(ptheta, c)) || PyList_Size(PyList_GET_ITEM(ptheta, c)) != m + fitIntercept) {
+            PyErr_SetString(PyExc_ValueError, "Theta should be the same size as the number of features.");
+            delete X;
+            return nullptr;
+        }
+    }
+
+    if (patience < 1) {
+        PyErr_SetString(PyExc_ValueError, "Patience must be at least 1.");
+        delete X;
+        return nullptr;
+    }
+
+    if (!readValidationSet(pXVal, pyVal, m, &XVal)) {
+        delete X;
+        return nullptr;
+    }
+
+    labels = convertPy_1DArray<int>(py, n);
+
+    if (XVal != nullptr) {
+        labelsVal = convertPy_1DArray<int>(pyVal, XVal->getRows());
+    }
+
+    if (nJobs <= 0) {
+        nJobs = static_cast<int>(std::thread::hardware_concurrency());
+    }
+
+    // L-BFGS always uses the whole dataset
+    bool minibatch = batchSize > 0 && batchSize < n && strcmp(method, "lbfgs") != 0;
+
+    iterations = new int[k];
+
+    for (int c = 0; c < k; ++c) {
+        thetas.push_back(readFromPythonList<double>(PyList_GET_ITEM(ptheta, c)));
+        costArrays.push_back(allocateCostArray<double>(n, batchSize, maxIterations, minibatch));
+    }
+
+    // train all classes without holding the GIL
+    Py_BEGIN_ALLOW_THREADS
+    oneVsRest<double>(*X, labels, thetas, costArrays, iterations, maxIterations, epsilon, learningRate, alpha,
+                      batchSize, seed, method, fudge_factor, beta2, weightDecay, historySize, monitor,
+                      monitorFrequency, monitorSamples, physicalShuffle, XVal, labelsVal, patience, minImprovement,
+                      schedule, nJobs, fitIntercept);
+    Py_END_ALLOW_THREADS
+
+    // convert results to lists (one entry per class)
+    pyThetas = PyList_New(k);
+    pyCostArrays = PyList_New(k);
+    pyIterations = PyList_New(k);
+
+    for (int c = 0; c < k; ++c) {
+        PyList_SET_ITEM(pyThetas, c, ConvertFlatArray_PyList(thetas[c], "float"));
+        PyList_SET_ITEM(pyCostArrays, c, ConvertFlatArray_PyList(costArrays[c], "float"));
+        PyList_SET_ITEM(pyIterations, c, PyLong_FromLong(iterations[c]));
+
+        delete thetas[c];
+        delete costArrays[c];
+    }
+
+    PyObject* FinalResult = Py_BuildValue("OOO", pyThetas, pyCostArrays, pyIterations);
+
+    // memory deallocation
+    delete [] iterations;
+    delete [] labels;
+    delete [] labelsVal;
+    delete X;
+    delete XVal;
+
+    Py_DECREF(pyThetas);
+    Py_DECREF(pyCostArrays);
+    Py_DECREF(pyIterations);
+
+    return FinalResult;
+}
+
+
+static const char* optimiserStateName = "pyml.maths.optimisers.state";
+
+
+static void deleteOptimiserState(PyObject* capsule) {
+    delete static_cast<optimiserState<double>*>(PyCapsule_GetPointer(capsule, optimiserStateName));
+}
+
+
+static PyObject *newOptimiserState(PyObject *self, PyObject *args, PyObject *kwargs) {
+
+    // variable declaration
+    int seed;
+    PyObject* ptheta;
+
+    static const char* kwlist[] = {"theta", "seed", nullptr};
+
+    // return error if we don't get all the arguments
+    if(!PyArg_ParseTupleAndKeywords(args, kwargs, "O!i", const_cast<char**>(kwlist), &PyList_Type, &ptheta, &seed)) {
+        PyErr_SetString(PyExc_TypeError, "Check arguments!");
+        return nullptr;
+    }
+
+    if (PyList_Size(ptheta) == 0) {
+        PyErr_SetString(PyExc_ValueError, "Theta should not be empty.");
+        return nullptr;
+    }
+
+    // the state is owned by the capsule and freed with it
+    auto* state = new optimiserState<double>(readFromPythonList<double>(ptheta), seed);
+
+    return PyCapsule_New(state, optimiserStateName, deleteOptimiserState);
+}
+
+
+static PyObject *partialFitGD(PyObject *self, PyObject *args, PyObject *kwargs) {
+
+    // variable declaration
+    int m, epochs;
+    int batchSize = 0;
+    double learningRate, alpha, fudge_factor;
+    double beta2 = 0.999;
+    double weightDecay = 0.0;
+    optimiserState<double>* state = nullptr;
+    flatArray<double>* costArray = nullptr;
+    flatArray<double>* X = nullptr;
+    flatArray<double>* y = nullptr;
+    learningRateSchedule schedule;
+    int fitIntercept = 0;
+    char* predType;
+    char* method;
+
+    PyObject* pState;
+    PyObject* pX;
+    PyObject* py;
+    PyObject* pySchedule = nullptr;
+    PyObject* pyCostArray;
+    PyObject* pyTheta;
+
+    static const char* kwlist[] = {"state", "X", "y", "epochs", "learning_rate", "alpha", "pred_type", "method",
+                                   "fudge_factor", "batch_size", "beta_2", "weight_decay", "schedule", "fit_intercept",
+                                   nullptr};
+
+    // return error if we don't get all the arguments
+    if(!PyArg_ParseTupleAndKeywords(args, kwargs, "OO!O!iddssd|iddO!p", const_cast<char**>(kwlist),
+                                    &pState, &PyList_Type, &pX, &PyList_Type, &py, &epochs, &learningRate, &alpha,
+                                    &predType, &method, &fudge_factor, &batchSize, &beta2, &weightDecay,
+                                    &PyTuple_Type, &pySchedule, &fitIntercept)) {
+        PyErr_SetString(PyExc_TypeError, "Check arguments!");
+        return nullptr;
+    }
+
+    state = static_cast<optimiserState<double>*>(PyCapsule_GetPointer(pState, optimiserStateName));
+
+    if (state == nullptr) {
+        return nullptr;
+    }
+
+    if (strcmp(method, "normal") != 0 && strcmp(method, "nesterov") != 0 && strcmp(method, "adagrad") != 0 &&
+        strcmp(method, "adadelta") != 0 && strcmp(method, "rmsprop") != 0 && strcmp(method, "adam") != 0 &&
+        strcmp(method, "adamw") != 0 && strcmp(method, "nadam") != 0) {
+        PyErr_SetString(PyExc_ValueError, "Unknown method for partial fit!");
+        return nullptr;
+    }
+
+    if (epochs < 0) {
+        PyErr_SetString(PyExc_ValueError, "The number of epochs must be positive.");
+        return nullptr;
+    }
+
+    if (!readSchedule(pySchedule, &schedule)) {
+        return nullptr;
+    }
+
+    // read python lists
+    X = readFromPythonList<double>(pX);
+    y = readFromPythonList<double>(py);
+
+    m = X->getCols();
+
+    if (state->theta->getCols() != m + fitIntercept || y->getSize() != X->getRows()) {
+        PyErr_SetString(PyExc_ValueError, "X should have one row per target and as many features as theta.");
+        delete X;
+        delete y;
+        return nullptr;
+    }
+
+    // cost before the first epoch plus the cost after each epoch
+    costArray = emptyArray<double>(1, epochs + 1);
+
+    partialFit<double>(*X, *y, *state, costArray, epochs, learningRate, alpha, predType, method, fudge_factor,
+                       beta2, weightDecay, batchSize, schedule, fitIntercept);
+
+    // convert cost array and theta to lists
+    pyCostArray = ConvertFlatArray_PyList(costArray, "float");
+    pyTheta = ConvertFlatArray_PyList(state->theta, "float");
+
+    PyObject* FinalResult = Py_BuildValue("OOi", pyTheta, pyCostArray, state->updates);
+
+    // memory deallocation
+    delete costArray;
+    delete y;
+    delete X;
+
+    Py_DECREF(pyCostArray);
+    Py_DECREF(pyTheta);
+
+    return FinalResult;
+}
+
+
+template <class M>
+static PyObject *fitHogwild(PyObject* pX, PyObject* ptheta, PyObject* py, int maxIterations, double epsilon,
+                            double learningRate, char* predType, int seed, int nWorkers, int fitIntercept) {
+
+    // Hogwild! with X either dense (M is a flatArray) or sparse (M is a csrArray)
+
+    // variable declaration
+    int m, n, iterations;
+    double throughput = 0;
+    flatArray<double>* costArray = nullptr;
+    M* X = nullptr;
+    flatArray<double>* y = nullptr;
+    flatArray<double>* theta = nullptr;
+
+    PyObject* pyCostArray;
+    PyObject* pyTheta;
+
+    // read python lists
+    if (!readFeatures(pX, &X)) {
+        return nullptr;
+    }
+
+    y = readFromPythonList<double>(py);
+    theta = readFromPythonList<double>(ptheta);
+
+    n = X->getRows();
+    m = X->getCols();
+
+    if (PyList_Size(ptheta) != m + fitIntercept) {
+        PyErr_SetString(PyExc_ValueError, "Theta should be the same size as the number of features (plus one with "
+                                          "fit_intercept).");
+        delete theta;
+        delete y;
+        delete X;
+        return nullptr;
+    }
+
+    // the workers sample the rows of X and index y with them, and any exception would be thrown without the GIL
+    if (n == 0 || y->getSize() != n) {
+        PyErr_SetString(PyExc_ValueError, "X and y should have the same, non zero, number of examples.");
+        delete theta;
+        delete y;
+        delete X;
+        return nullptr;
+    }
+
+    // initial cost plus the cost after each iteration
+    costArray = emptyArray<double>(1, maxIterations + 1);
+
+    // the workers don't touch Python objects
+    Py_BEGIN_ALLOW_THREADS
+    iterations = hogwild<double>(*X, *y, theta, costArray, maxIterations, epsilon, learningRate, predType, seed,
+                                 nWorkers, throughput, fitIntercept);
+    Py_END_ALLOW_THREADS
+
+    costArray->setCols(iterations + 1);
+
+    // convert cost array and theta to lists
+    pyCostArray = ConvertFlatArray_PyList(costArray, "float");
+    pyTheta = ConvertFlatArray_PyList(theta, "float");
+
+    PyObject* FinalResult = Py_BuildValue("OOid", pyTheta, pyCostArray, iterations, throughput);
+
+    // memory deallocation
+    delete costArray;
+    delete theta;
+    delete y;
+    delete X;
+
+    Py_DECREF(pyCostArray);
+    Py_DECREF(pyTheta);
+
+    return FinalResult;
+}
+
+
+static PyObject *asyncSGD(PyObject *self, PyObject *args, PyObject *kwargs) {
+
+    // variable declaration
+    int maxIterations, seed;
+    int nWorkers = 1;
+    int fitIntercept = 0;
+    double epsilon, learningRate;
+    char* predType;
+
+    PyObject* ptheta;
+    PyObject* pX;
+    PyObject* py;
+
+    static const char* kwlist[] = {"X", "theta", "y", "max_iterations", "epsilon", "learning_rate", "pred_type",
+                                   "seed", "n_workers", "fit_intercept", nullptr};
+
+    // return error if we don't get all the arguments
+    if(!PyArg_ParseTupleAndKeywords(args, kwargs, "OO!O!iddsi|ip", const_cast<char**>(kwlist),
+                                    &pX, &PyList_Type, &ptheta, &PyList_Type, &py,
+                                    &maxIterations, &epsilon, &learningRate, &predType, &seed, &nWorkers,
+                                    &fitIntercept)) {
+        PyErr_SetString(PyExc_TypeError, "Check arguments!");
+        return nullptr;
+    }
+
+    if (strcmp(predType, "logit") != 0 && strcmp(predType, "linear") != 0 && strcmp(predType, "regressor") != 0) {
+        PyErr_SetString(PyExc_ValueError, "Unknown pred_type, expected logit or linear!");
+        return nullptr;
+    }
+
+    if (maxIterations < 0) {
+        PyErr_SetString(PyExc_ValueError, "max_iterations cannot be negative.");
+        return nullptr;
+    }
+
+    if (nWorkers <= 0) {
+        nWorkers = static_cast<int>(std::thread::hardware_concurrency());
+    }
+
+    // X is either a list of lists or a CSR matrix
+    if (isSparse(pX)) {
+        return fitHogwild<csrArray<double>>(pX, ptheta, py, maxIterations, epsilon, learningRate, predType, seed,
+                                            nWorkers, fitIntercept);
+    }
+
+    return fitHogwild<flatArray<double>>(pX, ptheta, py, maxIterations, epsilon, learningRate, predType, seed,
+                                         nWorkers, fitIntercept);
+}
+
+
+static PyObject *newton(PyObject *self, PyObject *args, PyObject *kwargs) {
 
     // variable declaration
-    int m, n, maxIterations, iterations, batchSize, seed;
-    double epsilon, learningRate, alpha, fudge_factor;
+    int m, n, maxIterations, iterations;
+    int cgThreshold = 500;
+    int fitIntercept = 0;
+    double epsilon;
     flatArray<double>* costArray = nullptr;
     flatArray<double>* X = nullptr;
     flatArray<double>* y = nullptr;
     flatArray<double>* theta = nullptr;
-    char* predType;
-    char* method;
 
     PyObject* ptheta;
     PyObject* pX;
@@ -26,10 +808,13 @@ static PyObject *GD(PyObject *self, PyObject *args) {
     PyObject* pyCostArray;
     PyObject* pyTheta;
 
+    static const char* kwlist[] = {"X", "theta", "y", "max_iterations", "epsilon", "cg_threshold", "fit_intercept",
+                                   nullptr};
+
     // return error if we don't get all the arguments
-    if(!PyArg_ParseTuple(args, "O!O!O!iidddssid", &PyList_Type, &pX, &PyList_Type, &ptheta, &PyList_Type, &py,
-                         &batchSize, &maxIterations, &epsilon, &learningRate, &alpha, &predType, &method, &seed,
-                         &fudge_factor)) {
+    if(!PyArg_ParseTupleAndKeywords(args, kwargs, "O!O!O!id|ip", const_cast<char**>(kwlist),
+                                    &PyList_Type, &pX, &PyList_Type, &ptheta, &PyList_Type, &py,
+                                    &maxIterations, &epsilon, &cgThreshold, &fitIntercept)) {
         PyErr_SetString(PyExc_TypeError, "Check arguments!");
         return nullptr;
     }
@@ -42,55 +827,128 @@ static PyObject *GD(PyObject *self, PyObject *args) {
     n = X->getRows();
     m = X->getCols();
 
-    if (PyList_Size(ptheta) != m) {
-        PyErr_SetString(PyExc_ValueError, "Theta should be the same size as the number of features.");
+    if (PyList_Size(ptheta) != m + fitIntercept) {
+        PyErr_SetString(PyExc_ValueError, "Theta should be the same size as the number of features (plus one with "
+                                          "fit_intercept).");
+        delete theta;
+        delete y;
+        delete X;
         return nullptr;
     }
 
-    if (m > n) {
-        PyErr_SetString(PyExc_ValueError, "More features than training examples!");
+    if (y->getSize() != n) {
+        PyErr_SetString(PyExc_ValueError, "X and y should have the same number of examples.");
+        delete theta;
+        delete y;
+        delete X;
         return nullptr;
     }
 
+    // IRLS fits a logistic regression
+    for (int i = 0; i < n; ++i) {
+        if ((*y)[i] != 0 && (*y)[i] != 1) {
+            PyErr_SetString(PyExc_ValueError, "The labels in y should be 0 or 1.");
+            delete theta;
+            delete y;
+            delete X;
+            return nullptr;
+        }
+    }
 
-    // memory allocation of costArray
-    if (batchSize > 0 && batchSize < n) {
-        auto batchIterations = static_cast<int>(std::floor(n / batchSize));
+    // initial cost plus the cost after each iteration
+    costArray = emptyArray<double>(1, maxIterations + 1);
 
-        if (n % batchSize == 0) {
-            costArray = emptyArray<double>(1, maxIterations * batchIterations);
-        }
+    iterations = newtonMethod<double>(*X, *y, theta, costArray, epsilon, maxIterations, cgThreshold, fitIntercept);
 
-        else {
-            costArray = emptyArray<double>(1, maxIterations * (batchIterations + 1));
-        }
-    }
+    costArray->setCols(iterations + 1);
 
-    else {
-        costArray = emptyArray<double>(1, maxIterations);
+    // convert cost array and theta to lists
+    pyCostArray = ConvertFlatArray_PyList(costArray, "float");
+    pyTheta = ConvertFlatArray_PyList(theta, "float");
+
+    PyObject* FinalResult = Py_BuildValue("OOi", pyTheta, pyCostArray, iterations);
+
+    // memory deallocation
+    delete costArray;
+    delete theta;
+    delete y;
+    delete X;
+
+    Py_DECREF(pyCostArray);
+    Py_DECREF(pyTheta);
+
+    return FinalResult;
+}
+
+
+static PyObject *elasticNetCD(PyObject *self, PyObject *args, PyObject *kwargs) {
+
+    // variable declaration
+    int m, n, maxIterations, iterations;
+    int intercept = 1;
+    int covariance = 1;
+    int fitIntercept = 0;
+    double epsilon, lambda, l1Ratio;
+    flatArray<double>* costArray = nullptr;
+    flatArray<double>* X = nullptr;
+    flatArray<double>* y = nullptr;
+    flatArray<double>* theta = nullptr;
+
+    PyObject* ptheta;
+    PyObject* pX;
+    PyObject* py;
+    PyObject* pyCostArray;
+    PyObject* pyTheta;
+
+    static const char* kwlist[] = {"X", "theta", "y", "max_iterations", "epsilon", "regularisation", "l1_ratio",
+                                   "intercept", "covariance", "fit_intercept", nullptr};
+
+    // return error if we don't get all the arguments
+    if(!PyArg_ParseTupleAndKeywords(args, kwargs, "O!O!O!iddd|ppp", const_cast<char**>(kwlist),
+                                    &PyList_Type, &pX, &PyList_Type, &ptheta, &PyList_Type, &py,
+                                    &maxIterations, &epsilon, &lambda, &l1Ratio, &intercept, &covariance,
+                                    &fitIntercept)) {
+        PyErr_SetString(PyExc_TypeError, "Check arguments!");
+        return nullptr;
     }
 
-    // gradient descent
-    iterations = gradientDescent<double>(*X, *y, theta, maxIterations, epsilon, learningRate, alpha, costArray, predType,
-                                         batchSize, seed, method, fudge_factor);
+    if (lambda < 0 || l1Ratio < 0 || l1Ratio > 1) {
+        PyErr_SetString(PyExc_ValueError, "The regularisation must be positive and l1_ratio between 0 and 1.");
+        return nullptr;
+    }
 
-    // costArray only needs #iterations columns
-    if (batchSize > 0 && batchSize < n) {
-        auto batchIterations = static_cast<int>(std::floor(n / batchSize));
+    // read python lists
+    X = readFromPythonList<double>(pX);
+    y = readFromPythonList<double>(py);
+    theta = readFromPythonList<double>(ptheta);
 
-        if (n % batchSize == 0) {
-            costArray->setCols(iterations * batchIterations);
-        }
+    n = X->getRows();
+    m = X->getCols();
 
-        else {
-            costArray->setCols(iterations * (batchIterations + 1));
-        }
+    if (PyList_Size(ptheta) != m + fitIntercept) {
+        PyErr_SetString(PyExc_ValueError, "Theta should be the same size as the number of features (plus one with "
+                                          "fit_intercept).");
+        delete theta;
+        delete y;
+        delete X;
+        return nullptr;
     }
 
-    else {
-        costArray->setCols(iterations + 1);
+    if (y->getSize() != n) {
+        PyErr_SetString(PyExc_ValueError, "y should be the same size as the number of training examples.");
+        delete theta;
+        delete y;
+        delete X;
+        return nullptr;
     }
 
+    // initial cost plus the cost after each sweep
+    costArray = emptyArray<double>(1, maxIterations + 1);
+
+    iterations = elasticNet<double>(*X, *y, theta, costArray, lambda, l1Ratio, epsilon, maxIterations, intercept,
+                                    covariance, fitIntercept);
+
+    costArray->setCols(iterations + 1);
 
     // convert cost array and theta to lists
     pyCostArray = ConvertFlatArray_PyList(costArray, "float");
@@ -111,15 +969,385 @@ static PyObject *GD(PyObject *self, PyObject *args) {
 }
 
 
+static PyObject *elasticNetRegularisationPath(PyObject *self, PyObject *args, PyObject *kwargs) {
+
+    // variable declaration
+    int m, n, maxIterations;
+    int nLambdas = 100;
+    int intercept = 1;
+    int covariance = 1;
+    int fitIntercept = 0;
+    double epsilon, l1Ratio;
+    double lambdaRatio = 0.001;
+    double* lambdas = nullptr;
+    double* costs = nullptr;
+    int* iterations = nullptr;
+    flatArray<double>* X = nullptr;
+    flatArray<double>* y = nullptr;
+    flatArray<double>* thetas = nullptr;
+
+    PyObject* pX;
+    PyObject* py;
+    PyObject* pLambdas = nullptr;
+    PyObject* pyLambdas;
+    PyObject* pyThetas;
+    PyObject* pyCosts;
+    PyObject* pyIterations;
+
+    static const char* kwlist[] = {"X", "y", "max_iterations", "epsilon", "l1_ratio", "n_lambdas", "lambda_ratio",
+                                   "lambdas", "intercept", "covariance", "fit_intercept", nullptr};
+
+    // return error if we don't get all the arguments
+    if(!PyArg_ParseTupleAndKeywords(args, kwargs, "O!O!idd|idO!ppp", const_cast<char**>(kwlist),
+                                    &PyList_Type, &pX, &PyList_Type, &py, &maxIterations, &epsilon, &l1Ratio,
+                                    &nLambdas, &lambdaRatio, &PyList_Type, &pLambdas, &intercept, &covariance,
+                                    &fitIntercept)) {
+        PyErr_SetString(PyExc_TypeError, "Check arguments!");
+        return nullptr;
+    }
+
+    if (l1Ratio < 0 || l1Ratio > 1) {
+        PyErr_SetString(PyExc_ValueError, "l1_ratio should be between 0 and 1.");
+        return nullptr;
+    }
+
+    // an explicit grid replaces the log spaced one
+    if (pLambdas != nullptr) {
+        nLambdas = static_cast<int>(PyList_Size(pLambdas));
+        lambdaRatio = 0;
+    }
+
+    else if (lambdaRatio <= 0 || lambdaRatio >= 1) {
+        PyErr_SetString(PyExc_ValueError, "lambda_ratio should be between 0 and 1.");
+        return nullptr;
+    }
+
+    if (nLambdas < 1) {
+        PyErr_SetString(PyExc_ValueError, "The regularisation path needs at least one lambda.");
+        return nullptr;
+    }
+
+    // read python lists
+    X = readFromPythonList<double>(pX);
+    y = readFromPythonList<double>(py);
+
+    n = X->getRows();
+    m = X->getCols() + fitIntercept;
+
+    if (y->getSize() != n) {
+        PyErr_SetString(PyExc_ValueError, "y should be the same size as the number of training examples.");
+        delete X;
+        delete y;
+        return nullptr;
+    }
+
+    lambdas = pLambdas != nullptr ? convertPy_1DArray<double>(pLambdas, nLambdas) : new double[nLambdas];
+    costs = new double[nLambdas];
+    iterations = new int[nLambdas];
+    thetas = emptyArray<double>(nLambdas, m);
+
+    elasticNetPath<double>(*X, *y, lambdas, nLambdas, lambdaRatio, thetas, costs, iterations, l1Ratio, epsilon,
+                           maxIterations, intercept, covariance, fitIntercept);
+
+    // convert results to lists (one entry per lambda)
+    pyLambdas = PyList_New(nLambdas);
+    pyThetas = PyList_New(nLambdas);
+    pyCosts = PyList_New(nLambdas);
+    pyIterations = PyList_New(nLambdas);
+
+    for (int k = 0; k < nLambdas; ++k) {
+        PyObject* pyTheta = PyList_New(m);
+
+        for (int j = 0; j < m; ++j) {
+            PyList_SET_ITEM(pyTheta, j, PyFloat_FromDouble(thetas->getElement(k, j)));
+        }
+
+        PyList_SET_ITEM(pyLambdas, k, PyFloat_FromDouble(lambdas[k]));
+        PyList_SET_ITEM(pyThetas, k, pyTheta);
+        PyList_SET_ITEM(pyCosts, k, PyFloat_FromDouble(costs[k]));
+        PyList_SET_ITEM(pyIterations, k, PyLong_FromLong(iterations[k]));
+    }
+
+    PyObject* FinalResult = Py_BuildValue("OOOO", pyLambdas, pyThetas, pyCosts, pyIterations);
+
+    // memory deallocation
+    delete [] lambdas;
+    delete [] costs;
+    delete [] iterations;
+    delete thetas;
+    delete y;
+    delete X;
+
+    Py_DECREF(pyLambdas);
+    Py_DECREF(pyThetas);
+    Py_DECREF(pyCosts);
+    Py_DECREF(pyIterations);
+
+    return FinalResult;
+}
+
+
+static PyObject *softmaxRegression(PyObject *self, PyObject *args, PyObject *kwargs) {
+
+    // variable declaration
+    int m, n, k, maxIterations, iterations;
+    double epsilon, learningRate, alpha, fudge_factor;
+    double beta2 = 0.999;
+    double weightDecay = 0.0;
+    int fitIntercept = 0;
+    int* labels = nullptr;
+    flatArray<double>* costArray = nullptr;
+    flatArray<double>* X = nullptr;
+    flatArray<double>* theta = nullptr;
+    flatArray<double>* coefficients = nullptr;
+    char* method;
+
+    PyObject* ptheta;
+    PyObject* pX;
+    PyObject* py;
+    PyObject* pyCostArray;
+    PyObject* pyTheta;
+
+    static const char* kwlist[] = {"X", "theta", "y", "max_iterations", "epsilon", "learning_rate", "alpha",
+                                   "method", "fudge_factor", "beta_2", "weight_decay", "fit_intercept", nullptr};
+
+    // return error if we don't get all the arguments
+    if(!PyArg_ParseTupleAndKeywords(args, kwargs, "O!O!O!idddsd|ddp", const_cast<char**>(kwlist),
+                                    &PyList_Type, &pX, &PyList_Type, &ptheta, &PyList_Type, &py,
+                                    &maxIterations, &epsilon, &learningRate, &alpha, &method,
+                                    &fudge_factor, &beta2, &weightDecay, &fitIntercept)) {
+        PyErr_SetString(PyExc_TypeError, "Check arguments!");
+        return nullptr;
+    }
+
+    if (strcmp(method, "normal") != 0 && strcmp(method, "nesterov") != 0 && strcmp(method, "adam") != 0 &&
+        strcmp(method, "adamw") != 0 && strcmp(method, "nadam") != 0) {
+        PyErr_SetString(PyExc_ValueError, "Unknown method for multinomial regression!");
+        return nullptr;
+    }
+
+    k = static_cast<int>(PyList_Size(ptheta));
+
+    if (k < 2 || !PyList_Check(PyList_GET_ITEM(ptheta, 0))) {
+        PyErr_SetString(PyExc_ValueError, "Theta should be a list with the coefficients of each class.");
+        return nullptr;
+    }
+
+    // read python lists
+    X = readFromPythonList<double>(pX);
+
+    n = X->getRows();
+    m = X->getCols();
+
+    if (PyList_Size(PyList_GET_ITEM(ptheta, 0)) != m + fitIntercept) {
+        PyErr_SetString(PyExc_ValueError, "Theta should be the same size as the number of features (plus one with "
+                                          "fit_intercept).");
+        delete X;
+        return nullptr;
+    }
+
+    if (PyList_Size(py) != n) {
+        PyErr_SetString(PyExc_ValueError, "y should be the same size as the number of training examples.");
+        delete X;
+        return nullptr;
+    }
+
+    labels = convertPy_1DArray<int>(py, n);
+
+    for (int i = 0; i < n; ++i) {
+        if (labels[i] < 0 || labels[i] >= k) {
+            PyErr_SetString(PyExc_ValueError, "Labels should be in the range [0, number of classes).");
+            delete [] labels;
+            delete X;
+            return nullptr;
+        }
+    }
+
+    // theta is passed as k rows of coefficients, the kernels expect a (m + fitIntercept) by k matrix
+    coefficients = readFromPythonList<double>(ptheta);
+    theta = coefficients->transpose();
+    delete coefficients;
+
+    // initial cost plus the cost after each iteration
+    costArray = emptyArray<double>(1, maxIterations + 1);
+
+    iterations = softmaxGradientDescent<double>(*X, labels, theta, costArray, maxIterations, epsilon, learningRate,
+                                                alpha, method, fudge_factor, beta2, weightDecay, fitIntercept);
+
+    costArray->setCols(iterations + 1);
+
+    coefficients = theta->transpose();
+
+    // convert cost array and coefficients to lists
+    pyCostArray = ConvertFlatArray_PyList(costArray, "float");
+    pyTheta = ConvertFlatArray_PyList(coefficients, "float");
+
+    PyObject* FinalResult = Py_BuildValue("OOi", pyTheta, pyCostArray, iterations);
+
+    // memory deallocation
+    delete costArray;
+    delete coefficients;
+    delete theta;
+    delete [] labels;
+    delete X;
+
+    Py_DECREF(pyCostArray);
+    Py_DECREF(pyTheta);
+
+    return FinalResult;
+}
+
+
+template <typename T, class M>
+static PyObject *linearPredictT(PyObject* pX, PyObject* pCoefficients, int bias, char* link, int nJobs) {
+
+    // batched prediction with T precision data, the results are returned as Python floats.
+    // X is either dense (M is a flatArray) or sparse (M is a csrArray)
+
+    // variable declaration
+    M* X = nullptr;
+    flatArray<T>* coefficients = nullptr;
+    flatArray<T>* result = nullptr;
+
+    PyObject* pyResult;
+
+    bool softmaxLink = strcmp(link, "softmax") == 0;
+
+    if (!readFeatures(pX, &X)) {
+        return nullptr;
+    }
+
+    // a single class is read from its row
+    if (PyList_Size(pCoefficients) == 1 && PyList_Check(PyList_GET_ITEM(pCoefficients, 0))) {
+        coefficients = readFromPythonList<T>(PyList_GET_ITEM(pCoefficients, 0));
+    }
+
+    else {
+        coefficients = readFromPythonList<T>(pCoefficients);
+    }
+
+    if (coefficients->getCols() != X->getCols() + bias) {
+        PyErr_SetString(PyExc_ValueError, "The coefficients should be the same size as the number of features "
+                                          "(plus one with a bias).");
+        delete coefficients;
+        delete X;
+        return nullptr;
+    }
+
+    if (softmaxLink ? coefficients->getRows() < 2 : coefficients->getRows() != 1) {
+        PyErr_SetString(PyExc_ValueError, "The softmax link needs the coefficients of each class, identity and "
+                                          "sigmoid a single list of coefficients.");
+        delete coefficients;
+        delete X;
+        return nullptr;
+    }
+
+    result = softmaxLink ? emptyArray<T>(X->getRows(), coefficients->getRows()) : emptyArray<T>(1, X->getRows());
+
+    Py_BEGIN_ALLOW_THREADS
+
+    linearPredict(*X, *coefficients, bias, link, result->getArray(), nJobs);
+
+    Py_END_ALLOW_THREADS
+
+    // softmax probabilities of a single observation are still returned as a list of lists
+    if (!softmaxLink || X->getRows() > 1) {
+        pyResult = ConvertFlatArray_PyList(result, "float");
+    }
+
+    else {
+        PyObject* row = ConvertFlatArray_PyList(result, "float");
+        pyResult = PyList_New(1);
+        PyList_SET_ITEM(pyResult, 0, row);
+    }
+
+    // memory deallocation
+    delete result;
+    delete coefficients;
+    delete X;
+
+    return pyResult;
+}
+
+
+static PyObject *batchPredict(PyObject *self, PyObject *args, PyObject *kwargs) {
+
+    // variable declaration
+    int bias;
+    int nJobs = 1;
+    char* link;
+    char defaultDtype[10] = "float64";
+    char* dtype = defaultDtype;
+
+    PyObject* pX;
+    PyObject* pCoefficients;
+
+    static const char* kwlist[] = {"X", "coefficients", "bias", "link", "n_jobs", "dtype", nullptr};
+
+    // return error if we don't get all the arguments
+    if(!PyArg_ParseTupleAndKeywords(args, kwargs, "OO!ps|is", const_cast<char**>(kwlist),
+                                    &pX, &PyList_Type, &pCoefficients, &bias, &link,
+                                    &nJobs, &dtype)) {
+        PyErr_SetString(PyExc_TypeError, "Check arguments!");
+        return nullptr;
+    }
+
+    if (strcmp(link, "identity") != 0 && strcmp(link, "sigmoid") != 0 && strcmp(link, "softmax") != 0) {
+        PyErr_SetString(PyExc_ValueError, "Unknown link function!");
+        return nullptr;
+    }
+
+    if (nJobs <= 0) {
+        nJobs = static_cast<int>(std::thread::hardware_concurrency());
+    }
+
+    // X is either a list of lists or a CSR matrix
+    bool sparse = isSparse(pX);
+
+    if ((!sparse && (!PyList_Check(pX) || PyList_Size(pX) == 0)) || PyList_Size(pCoefficients) == 0) {
+        PyErr_SetString(PyExc_ValueError, "X and the coefficients can't be empty.");
+        return nullptr;
+    }
+
+    if (strcmp(dtype, "float32") == 0) {
+        return sparse ? linearPredictT<float, csrArray<float>>(pX, pCoefficients, bias, link, nJobs) :
+               linearPredictT<float, flatArray<float>>(pX, pCoefficients, bias, link, nJobs);
+    }
+
+    if (strcmp(dtype, "float64") == 0) {
+        return sparse ? linearPredictT<double, csrArray<double>>(pX, pCoefficients, bias, link, nJobs) :
+               linearPredictT<double, flatArray<double>>(pX, pCoefficients, bias, link, nJobs);
+    }
+
+    PyErr_SetString(PyExc_ValueError, "Unknown dtype!");
+    return nullptr;
+}
+
+
+static PyObject* scratchStatisticsPy(PyObject* self) {
+    return scratchStatisticsDict();
+}
+
+
 static PyObject* version(PyObject* self) {
     return Py_BuildValue("s", "Version 0.2.1");
 }
 
 static PyMethodDef optimisersMethods[] = {
-        // Python name       C function              argument representation  description
-        {"gradient_descent", GD,       METH_VARARGS,            "Gradient Descent"},
-        {"version",          (PyCFunction)version,   METH_NOARGS,             "Returns version."},
-        {nullptr,            nullptr,                0,                       nullptr}
+        // Python name       C function              argument representation         description
+        {"gradient_descent", (PyCFunction)GD,        METH_VARARGS | METH_KEYWORDS,   "Gradient Descent"},
+        {"one_vs_rest",      (PyCFunction)OVR,       METH_VARARGS | METH_KEYWORDS,   "Parallel one-vs-rest gradient descent"},
+        {"optimiser_state",  (PyCFunction)newOptimiserState, METH_VARARGS | METH_KEYWORDS, "Optimiser state for partial_fit"},
+        {"partial_fit",      (PyCFunction)partialFitGD, METH_VARARGS | METH_KEYWORDS,   "Gradient descent epochs continuing from an optimiser state"},
+        {"hogwild",          (PyCFunction)asyncSGD,  METH_VARARGS | METH_KEYWORDS,   "Lock-free asynchronous SGD"},
+        {"newton",           (PyCFunction)newton,    METH_VARARGS | METH_KEYWORDS,   "Newton's method for logistic regression"},
+        {"elastic_net",      (PyCFunction)elasticNetCD, METH_VARARGS | METH_KEYWORDS,   "Elastic net coordinate descent"},
+        {"elastic_net_path", (PyCFunction)elasticNetRegularisationPath, METH_VARARGS | METH_KEYWORDS, "Elastic net regularisation path"},
+        {"softmax_regression", (PyCFunction)softmaxRegression, METH_VARARGS | METH_KEYWORDS, "Multinomial logistic regression"},
+        {"predict",          (PyCFunction)batchPredict, METH_VARARGS | METH_KEYWORDS,   "Batched linear model predictions"},
+        {"scratch_statistics", (PyCFunction)scratchStatisticsPy, METH_NOARGS,             "Counters of the scratch arenas"},
+        {"version",          (PyCFunction)version,   METH_NOARGS,                    "Returns version."},
+        {nullptr,            nullptr,                0,                              nullptr}
 };
 
 
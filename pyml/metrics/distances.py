@@ -1,7 +1,7 @@
 from .CMetrics import norm
 
 
-def calculate_distance(u, v, p):
+def calculate_distance(u, v, p, dtype='float64'):
 
     if isinstance(p, str):
         if p == 'l1':
@@ -12,16 +12,16 @@ def calculate_distance(u, v, p):
             raise ValueError("Unknown norm.")
 
     if p == 1:
-        return manhattan_distance(u, v)
+        return manhattan_distance(u, v, dtype)
     elif p == 2:
-        return euclidean_distance(u, v)
+        return euclidean_distance(u, v, dtype)
     else:
-        return norm(u, v, p)
+        return norm(u, v, p, dtype)
 
 
-def euclidean_distance(u, v):
-    return norm(u, v, 2)
+def euclidean_distance(u, v, dtype='float64'):
+    return norm(u, v, 2, dtype)
 
 
-def manhattan_distance(u, v):
-    return norm(u, v, 1)
+def manhattan_distance(u, v, dtype='float64'):
+    return norm(u, v, 1, dtype)
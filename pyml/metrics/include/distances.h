@@ -5,10 +5,24 @@
 #ifndef METRICS_DISTANCES_H
 #define METRICS_DISTANCES_H
 
+#include "csrArrays.h"
 
-double vectorVectorNorm(double* A, double* B, int p, int cols);
-void matrixMatrixNorm(double** A, double** B, int p, int rows, int cols, double* result);
-void matrixVectorNorm(double** A, double* B, int p, int rows, int cols, double* result);
+template <typename T>
+T vectorVectorNorm(T* A, T* B, int p, int cols);
+
+template <typename T>
+void matrixMatrixNorm(T** A, T** B, int p, int rows, int cols, T* result);
+
+template <typename T>
+void matrixVectorNorm(T** A, T* B, int p, int rows, int cols, T* result);
+
+// norms of each row of a sparse matrix to a dense vector with A.getCols() elements
+template <typename T>
+void sparseVectorNorm(const csrArray<T>& A, const T* B, int p, T* result);
+
+// norms of each row of A to the same row of B, or to the only row of B
+template <typename T>
+void sparseSparseNorm(const csrArray<T>& A, const csrArray<T>& B, int p, T* result);
 
 
 #endif //METRICS_DISTANCES_H
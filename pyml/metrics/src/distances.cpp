@@ -2,11 +2,14 @@
 // Created by gil on 09/11/17.
 //
 #include <cmath>
+#include "flatArrays.h"
 #include "distances.h"
 
-double vectorVectorNorm(double* A, double* B, int p, int cols) {
+template <typename T>
+T vectorVectorNorm(T* A, T* B, int p, int cols) {
 
-    double normResult = 0;
+    // the sum is accumulated in double precision for single precision data
+    typename accumulator<T>::type normResult = 0;
 
     for (int i = 0; i < cols; ++i) {
         normResult += pow(fabs(A[i] - B[i]), p);
@@ -14,10 +17,11 @@ double vectorVectorNorm(double* A, double* B, int p, int cols) {
 
     normResult = pow(normResult, (double) 1 / p);
 
-    return normResult;
+    return static_cast<T>(normResult);
 }
 
-void matrixMatrixNorm(double** A, double** B, int p, int rows, int cols, double* result) {
+template <typename T>
+void matrixMatrixNorm(T** A, T** B, int p, int rows, int cols, T* result) {
 
     for (int i = 0; i < rows; ++i) {
         result[i] = vectorVectorNorm(A[i], B[i], p, cols);
@@ -25,9 +29,104 @@ void matrixMatrixNorm(double** A, double** B, int p, int rows, int cols, double*
 }
 
 
-void matrixVectorNorm(double** A, double* B, int p, int rows, int cols, double* result) {
+template <typename T>
+void matrixVectorNorm(T** A, T* B, int p, int rows, int cols, T* result) {
 
     for (int i = 0; i < rows; ++i) {
         result[i] = vectorVectorNorm(A[i], B, p, cols);
     }
 }
+
+
+template <typename T>
+void sparseVectorNorm(const csrArray<T>& A, const T* B, int p, T* result) {
+
+    typedef typename accumulator<T>::type accumulatorType;
+
+    const T* data = A.getData();
+    const flatIndex* indices = A.getIndices();
+
+    for (flatIndex i = 0; i < A.getRows(); ++i) {
+
+        accumulatorType normResult = 0;
+        flatIndex k = A.rowStart(i);
+
+        // the zeros between the (sorted) column indices of the row contribute |b| ** p. They are summed
+        // directly rather than taken off the norm of B, which cancels when the row is close to B
+        for (flatIndex j = 0; j < A.getCols(); ++j) {
+
+            T a = 0;
+
+            if (k < A.rowEnd(i) && indices[k] == j) {
+                a = data[k++];
+            }
+
+            normResult += pow(fabs(a - B[j]), p);
+        }
+
+        result[i] = static_cast<T>(pow(normResult, (double) 1 / p));
+    }
+}
+
+
+template <typename T>
+void sparseSparseNorm(const csrArray<T>& A, const csrArray<T>& B, int p, T* result) {
+
+    typedef typename accumulator<T>::type accumulatorType;
+
+    const T* dataA = A.getData();
+    const T* dataB = B.getData();
+    const flatIndex* indicesA = A.getIndices();
+    const flatIndex* indicesB = B.getIndices();
+
+    for (flatIndex i = 0; i < A.getRows(); ++i) {
+
+        flatIndex iB = B.getRows() == 1 ? 0 : i;
+
+        flatIndex kA = A.rowStart(i);
+        flatIndex kB = B.rowStart(iB);
+        flatIndex both = 0;
+
+        accumulatorType normResult = 0;
+
+        // the column indices of both rows are sorted, so they are merged in a single pass
+        while (kA < A.rowEnd(i) || kB < B.rowEnd(iB)) {
+
+            T difference;
+
+            if (kB == B.rowEnd(iB) || (kA < A.rowEnd(i) && indicesA[kA] < indicesB[kB])) {
+                difference = dataA[kA++];
+            }
+
+            else if (kA == A.rowEnd(i) || indicesB[kB] < indicesA[kA]) {
+                difference = dataB[kB++];
+            }
+
+            else {
+                difference = dataA[kA++] - dataB[kB++];
+            }
+
+            normResult += pow(fabs(difference), p);
+            both++;
+        }
+
+        // columns that are 0 in both rows only count with a negative p, where they make the norm 0
+        if (p < 0 && both < A.getCols()) {
+            normResult += pow(0.0, p);
+        }
+
+        result[i] = static_cast<T>(pow(normResult, (double) 1 / p));
+    }
+}
+
+
+template double vectorVectorNorm<double>(double* A, double* B, int p, int cols);
+template float vectorVectorNorm<float>(float* A, float* B, int p, int cols);
+template void matrixMatrixNorm<double>(double** A, double** B, int p, int rows, int cols, double* result);
+template void matrixMatrixNorm<float>(float** A, float** B, int p, int rows, int cols, float* result);
+template void matrixVectorNorm<double>(double** A, double* B, int p, int rows, int cols, double* result);
+template void matrixVectorNorm<float>(float** A, float* B, int p, int rows, int cols, float* result);
+template void sparseVectorNorm<double>(const csrArray<double>& A, const double* B, int p, double* result);
+template void sparseVectorNorm<float>(const csrArray<float>& A, const float* B, int p, float* result);
+template void sparseSparseNorm<double>(const csrArray<double>& A, const csrArray<double>& B, int p, double* result);
+template void sparseSparseNorm<float>(const csrArray<float>& A, const csrArray<float>& B, int p, float* result);
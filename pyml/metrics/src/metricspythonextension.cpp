@@ -3,66 +3,29 @@
 //
 
 #include <Python.h>
+#include <utility>
 #include "pythonconverters.h"
 #include "distances.h"
 
-static PyObject* norm(PyObject* self, PyObject *args) {
-
-    // variable instantiation
-    // A is a list of lists (matrix)
-    // u is a list (vector)
-    int colsA, rowsA, colsB, rowsB;
-    int p;
-
-    // pointers to python lists
-    PyObject* pA;
-    PyObject* pB;
-
-    // return error if we don't get all the arguments
-    if (!PyArg_ParseTuple(args, "O!O!i", &PyList_Type, &pA, &PyList_Type, &pB, &p)) {
-        PyErr_SetString(PyExc_TypeError, "Expected two lists and one integer!");
-        return nullptr;
-    }
-
-    if (PyList_Check(PyList_GET_ITEM(pA, 0))) {
-        rowsA = static_cast<int>(PyList_GET_SIZE(pA));
-        colsA = static_cast<int>(PyList_GET_SIZE(PyList_GET_ITEM(pA, 0)));
-    }
-    else {
-        rowsA = 0;
-        colsA = static_cast<int>(PyList_GET_SIZE(pA));
-    }
-
-
-    if (PyList_Check(PyList_GET_ITEM(pB, 0))) {
-        rowsB = static_cast<int>(PyList_GET_SIZE(pB));
-        colsB = static_cast<int>(PyList_GET_SIZE(PyList_GET_ITEM(pB, 0)));
-    }
-
-    else {
-        rowsB = 0;
-        colsB = static_cast<int>(PyList_GET_SIZE(pB));
-    }
+template <typename T>
+static PyObject* normT(PyObject* pA, PyObject* pB, int p, int rowsA, int colsA, int rowsB, int colsB) {
 
-    if (p == 0) {
-        PyErr_SetString(PyExc_TypeError, "P cannot be 0!");
-        return nullptr;
-    }
+    // norms with T precision data, the results are returned as Python floats
 
     if (rowsA == 0){
         if (rowsB == 0) {
             // int this case it's the norm of two vectors
             // variable declaration
-            double* A = nullptr;
-            double* B = nullptr;
-            double result;
+            T* A = nullptr;
+            T* B = nullptr;
+            T result;
 
-            A = convertPy_1DArray<double>(pA, colsA);
-            B = convertPy_1DArray<double>(pB, colsB);
+            A = convertPy_1DArray<T>(pA, colsA);
+            B = convertPy_1DArray<T>(pB, colsB);
 
             result = vectorVectorNorm(A, B, p, colsA);
 
-            PyObject *FinalResult = Py_BuildValue("d", result);
+            PyObject *FinalResult = Py_BuildValue("d", static_cast<double>(result));
 
             // memory deallocation
             delete [] A;
@@ -80,22 +43,22 @@ static PyObject* norm(PyObject* self, PyObject *args) {
     else if (rowsA > 0) {
         // if B is a vector
         if (rowsB == 0 && colsA == colsB) {
-            double** A = nullptr;
-            double* B = nullptr;
-            double* result = nullptr;
+            T** A = nullptr;
+            T* B = nullptr;
+            T* result = nullptr;
             PyObject* pylistResult = nullptr;
             PyObject* FinalResult = nullptr;
 
             // memory allocation
-            A = new double *[rowsA];
+            A = new T *[rowsA];
             for (int i = 0; i < rowsA; ++i) {
-                A[i] = new double [colsA];
+                A[i] = new T [colsA];
             }
-            result = new double [rowsA];
+            result = new T [rowsA];
 
             // convert python to C++
             convertPy_2DArray(pA, A, rowsA, colsA);
-            B = convertPy_1DArray<double>(pB, colsB);
+            B = convertPy_1DArray<T>(pB, colsB);
 
             matrixVectorNorm(A, B, p, rowsA, colsA, result);
 
@@ -122,22 +85,22 @@ static PyObject* norm(PyObject* self, PyObject *args) {
         }
 
         else {
-            double** A = nullptr;
-            double** B = nullptr;
-            double* result = nullptr;
+            T** A = nullptr;
+            T** B = nullptr;
+            T* result = nullptr;
             PyObject* pylistResult = nullptr;
             PyObject* FinalResult = nullptr;
 
             // memory allocation
-            A = new double *[rowsA];
+            A = new T *[rowsA];
             for (int i = 0; i < rowsA; ++i) {
-                A[i] = new double [colsA];
+                A[i] = new T [colsA];
             }
-            B = new double *[rowsB];
+            B = new T *[rowsB];
             for (int i = 0; i < rowsB; ++i) {
-                B[i] = new double[colsB];
+                B[i] = new T[colsB];
             }
-            result = new double [rowsA];
+            result = new T [rowsA];
 
             // convert python to C++
             convertPy_2DArray(pA, A, rowsA, colsA);
@@ -172,6 +135,162 @@ static PyObject* norm(PyObject* self, PyObject *args) {
 }
 
 
+template <typename T>
+static PyObject* sparseNormT(PyObject* pA, PyObject* pB, int p) {
+
+    // norms of the rows of a CSR matrix (see isSparse) to a vector or to the rows of another CSR matrix.
+    // The rows are never made dense, two CSR matrices are compared in time proportional to their non zeros
+
+    csrArray<T>* A = nullptr;
+    T* result = nullptr;
+    PyObject* FinalResult = nullptr;
+
+    // the norm is symmetric, so a vector and a sparse matrix are swapped
+    if (!isSparse(pA)) {
+        std::swap(pA, pB);
+    }
+
+    if (!isSparse(pB) && (!PyList_Check(pB) || PyList_GET_SIZE(pB) == 0 || PyList_Check(PyList_GET_ITEM(pB, 0)))) {
+        PyErr_SetString(PyExc_ValueError, "A sparse matrix can only be compared with a vector or another sparse "
+                                          "matrix.");
+        return nullptr;
+    }
+
+    A = convertPy_csrArray<T>(pA);
+
+    if (A == nullptr) {
+        return nullptr;
+    }
+
+    result = new T [A->getRows()];
+
+    if (isSparse(pB)) {
+
+        csrArray<T>* B = convertPy_csrArray<T>(pB);
+
+        if (B == nullptr) {
+            delete A;
+            delete [] result;
+            return nullptr;
+        }
+
+        if (B->getCols() != A->getCols()) {
+            PyErr_SetString(PyExc_TypeError, "Number of columns of A must match number of columns of B!");
+        }
+
+        else if (B->getRows() != A->getRows() && B->getRows() != 1) {
+            PyErr_SetString(PyExc_ValueError, "B must have as many rows as A, or a single row!");
+        }
+
+        else {
+            sparseSparseNorm(*A, *B, p, result);
+            FinalResult = Convert_1DArray(result, A->getRows());
+        }
+
+        delete B;
+    }
+
+    else if (PyList_GET_SIZE(pB) != A->getCols()) {
+        PyErr_SetString(PyExc_TypeError, "Number of columns of A must match number of columns of B!");
+    }
+
+    else {
+        T* B = convertPy_1DArray<T>(pB, A->getCols());
+
+        sparseVectorNorm(*A, B, p, result);
+        FinalResult = Convert_1DArray(result, A->getRows());
+
+        delete [] B;
+    }
+
+    // memory deallocation
+    delete A;
+    delete [] result;
+
+    return FinalResult;
+}
+
+
+static PyObject* norm(PyObject* self, PyObject *args) {
+
+    // variable instantiation
+    // A is a list of lists (matrix)
+    // u is a list (vector)
+    // either can also be a sparse matrix
+    int colsA, rowsA, colsB, rowsB;
+    int p;
+
+    // pointers to python lists
+    PyObject* pA;
+    PyObject* pB;
+
+    char defaultDtype[10] = "float64";
+    char* dtype = defaultDtype;
+
+    // return error if we don't get all the arguments
+    if (!PyArg_ParseTuple(args, "OOi|s", &pA, &pB, &p, &dtype)) {
+        PyErr_SetString(PyExc_TypeError, "Expected two lists, one integer and optionally a dtype!");
+        return nullptr;
+    }
+
+    if (p == 0) {
+        PyErr_SetString(PyExc_TypeError, "P cannot be 0!");
+        return nullptr;
+    }
+
+    // sparse matrices (see isSparse) are compared without reading their zeros
+    if (isSparse(pA) || isSparse(pB)) {
+
+        if (strcmp(dtype, "float32") == 0) {
+            return sparseNormT<float>(pA, pB, p);
+        }
+
+        if (strcmp(dtype, "float64") == 0) {
+            return sparseNormT<double>(pA, pB, p);
+        }
+
+        PyErr_SetString(PyExc_ValueError, "Unknown dtype!");
+        return nullptr;
+    }
+
+    if (!PyList_Check(pA) || !PyList_Check(pB)) {
+        PyErr_SetString(PyExc_TypeError, "Expected two lists, one integer and optionally a dtype!");
+        return nullptr;
+    }
+
+    if (PyList_Check(PyList_GET_ITEM(pA, 0))) {
+        rowsA = static_cast<int>(PyList_GET_SIZE(pA));
+        colsA = static_cast<int>(PyList_GET_SIZE(PyList_GET_ITEM(pA, 0)));
+    }
+    else {
+        rowsA = 0;
+        colsA = static_cast<int>(PyList_GET_SIZE(pA));
+    }
+
+
+    if (PyList_Check(PyList_GET_ITEM(pB, 0))) {
+        rowsB = static_cast<int>(PyList_GET_SIZE(pB));
+        colsB = static_cast<int>(PyList_GET_SIZE(PyList_GET_ITEM(pB, 0)));
+    }
+
+    else {
+        rowsB = 0;
+        colsB = static_cast<int>(PyList_GET_SIZE(pB));
+    }
+
+    if (strcmp(dtype, "float32") == 0) {
+        return normT<float>(pA, pB, p, rowsA, colsA, rowsB, colsB);
+    }
+
+    if (strcmp(dtype, "float64") == 0) {
+        return normT<double>(pA, pB, p, rowsA, colsA, rowsB, colsB);
+    }
+
+    PyErr_SetString(PyExc_ValueError, "Unknown dtype!");
+    return nullptr;
+}
+
+
 static PyObject* version(PyObject* self) {
     return Py_BuildValue("s", "Version 0.1");
 }
@@ -33,6 +33,16 @@ public:
         flatArrayDimensionMismatchException::errorMsg = msg.c_str();
     };
 
+    // shapes of operands that aren't flatArrays, e.g. lazy expressions (see flatArrayExpressions.h)
+    flatArrayDimensionMismatchException(flatIndex rowsA, flatIndex colsA, flatIndex rowsB, flatIndex colsB) {
+
+        std::string msg = "Shape mismatch! Got an array of shape {" + std::to_string(rowsA) + ", " +
+                          std::to_string(colsA) + "} and {" + std::to_string(rowsB) + ", " +
+                          std::to_string(colsB) + "}!";
+
+        flatArrayDimensionMismatchException::errorMsg = msg.c_str();
+    };
+
     const char* what() const throw() override {
         return errorMsg.c_str();
     }
@@ -81,7 +91,7 @@ template <class T>
 class flatArrayOutOfBoundsException: public flatArrayException {
     std::string errorMsg;
 public:
-    flatArrayOutOfBoundsException(const flatArray<T> &A, int n) {
+    flatArrayOutOfBoundsException(const flatArray<T> &A, flatIndex n) {
 
         std::string nString = std::to_string(n);
         std::string sizeString = std::to_string(A.getSize());
@@ -102,7 +112,7 @@ template <class T>
 class flatArrayOutOfBoundsRowException: public flatArrayException {
     std::string errorMsg;
 public:
-    flatArrayOutOfBoundsRowException(const flatArray<T> &A, int n) {
+    flatArrayOutOfBoundsRowException(const flatArray<T> &A, flatIndex n) {
 
         std::string nString = std::to_string(n);
         std::string sizeString = std::to_string(A.getRows());
@@ -123,7 +133,7 @@ template <class T>
 class flatArrayOutOfBoundsColumnException: public flatArrayException {
     std::string errorMsg;
 public:
-    flatArrayOutOfBoundsColumnException(const flatArray<T> &A, int n) {
+    flatArrayOutOfBoundsColumnException(const flatArray<T> &A, flatIndex n) {
 
         std::string nString = std::to_string(n);
         std::string sizeString = std::to_string(A.getCols());
@@ -185,7 +195,7 @@ public:
 class arrayOutOfBoundsException: public arrayException {
     std::string errorMsg;
 public:
-    arrayOutOfBoundsException(int size, int n) {
+    arrayOutOfBoundsException(flatIndex size, flatIndex n) {
 
         std::string nString = std::to_string(n);
         std::string sizeString = std::to_string(size);
@@ -202,6 +212,38 @@ public:
 };
 
 
+class mappedFileException: public arrayException {
+    std::string errorMsg;
+public:
+    mappedFileException(const std::string &path, const std::string &reason) {
+
+        std::string msg = "Could not map " + path + ": " + reason + "!";
+
+        mappedFileException::errorMsg = msg.c_str();
+    };
+
+    const char* what() const throw() override {
+        return errorMsg.c_str();
+    }
+};
+
+
+class csrArrayException: public arrayException {
+    std::string errorMsg;
+public:
+    explicit csrArrayException(const std::string &reason) {
+
+        std::string msg = "Invalid CSR matrix: " + reason + "!";
+
+        csrArrayException::errorMsg = msg.c_str();
+    };
+
+    const char* what() const throw() override {
+        return errorMsg.c_str();
+    }
+};
+
+
 class linearAlgebraException: public std::exception {
 public:
     const char* what() const throw() override {
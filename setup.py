@@ -17,7 +17,8 @@ linear_algebra_module = Extension('pyml.maths.Clinear_algebra',
                                            'pyml/maths/src/linearalgebraextension.cpp',
                                            'pyml/maths/src/flatArrays.cpp',
                                            'pyml/maths/src/maths.cpp'],
-                                  extra_compile_args=['-std=c++11'],
+                                  extra_compile_args=['-std=c++11', '-pthread'],
+                                  extra_link_args=['-pthread'],
                                   # extra_compile_args=['-std=c++11', '-fopenmp'],
                                   # extra_link_args=['-lgomp'],
                                   include_dirs=['pyml/maths/include',
@@ -28,7 +29,8 @@ optimisers_module = Extension('pyml.maths.optimisers',
                               sources=['pyml/maths/src/optimisers.cpp',
                                        'pyml/maths/src/optimisersExtension.cpp',
                                        'pyml/maths/src/flatArrays.cpp'],
-                              extra_compile_args=['-std=c++11'],
+                              extra_compile_args=['-std=c++11', '-pthread'],
+                              extra_link_args=['-pthread'],
                               # extra_compile_args=['-std=c++11', '-fopenmp'],
                               # extra_link_args=['-lgomp'],
                               include_dirs=['pyml/maths/include',
@@ -39,7 +41,8 @@ distances = Extension('pyml.metrics.CMetrics',
                       sources=['pyml/metrics/src/metricspythonextension.cpp',
                                'pyml/metrics/src/distances.cpp',
                                'pyml/maths/src/flatArrays.cpp'],
-                      extra_compile_args=['-std=c++11'],
+                      extra_compile_args=['-std=c++11', '-pthread'],
+                      extra_link_args=['-pthread'],
                       # extra_compile_args=['-std=c++11', '-fopenmp'],
                       # extra_link_args=['-lgomp'],
                       include_dirs=['pyml/metrics/include',
@@ -51,7 +54,8 @@ maths = Extension('pyml.maths.CMaths',
                   sources=['pyml/maths/src/maths.cpp',
                            'pyml/maths/src/mathsextension.cpp',
                            'pyml/maths/src/flatArrays.cpp'],
-                  extra_compile_args=['-std=c++11'],
+                  extra_compile_args=['-std=c++11', '-pthread'],
+                  extra_link_args=['-pthread'],
                   # extra_compile_args=['-std=c++11', '-fopenmp'],
                   # extra_link_args=['-lgomp'],
                   include_dirs=['pyml/maths/include',
@@ -15,8 +15,9 @@ class PCATest(unittest.TestCase):
         self.assertEqual(self.decomposer.n_components, 4)
 
     def test_PCA_eigenvalues(self):
-        self.assertCountEqual(self.decomposer.eigenvalues, [4.1966751631979795, 0.24062861448333198,
-                                                            0.07800041537352681, 0.023525140278494793])
+        # the last digits of the smaller eigenvalues depend on the (pairwise) summation order of the means
+        self.assertCountEqual(self.decomposer.eigenvalues, [4.1966751631979795, 0.2406286144833322,
+                                                            0.078000415373527, 0.023525140278495688])
 
     def test_PCA_eigenvectors(self):
         self.assertAlmostEqual(self.decomposer.eigenvectors[0][2], 0.5809972798275975)
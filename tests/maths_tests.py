@@ -1,6 +1,12 @@
 import unittest
+import os
+import sys
+import tempfile
+from array import array
 from pyml.maths.math_utils import *
 from pyml.maths.linear_algebra import *
+from pyml.maths import CSRMatrix
+from pyml.maths.Clinear_algebra import scratch_statistics, transpose_bandwidth
 from pyml.utils import set_seed
 import random
 
@@ -19,6 +25,14 @@ class MathsTest(unittest.TestCase):
         sorted_array = sort(array)
         self.assertEqual(sorted_array, [-5, -1, 1, 2, 3, 10])
 
+    def test_sort_rows(self):
+        # rows are sorted in place
+        self.assertEqual(sort([[3, 1, 2], [0, 5, -1]], axis=1), [[1, 2, 3], [-1, 0, 5]])
+        self.assertEqual(argsort([[3, 1, 2], [0, 5, -1]], axis=1), [[1, 2, 0], [2, 0, 1]])
+
+    def test_sort_columns(self):
+        self.assertEqual(sort([[3, 1, 2], [0, 5, -1]], axis=0), [[0, 1, -1], [3, 5, 2]])
+
     def test_argsort(self):
         array = [-5, 3, 10, 2, 1, -1]
         argsorted_array = argsort(array)
@@ -78,6 +92,60 @@ class MathsTest(unittest.TestCase):
     def test_mean_EmptyList_ValueError(self):
         self.assertRaises(ValueError, mean, [])
 
+    def test_mean_pairwise(self):
+        # a running sum of 0.1 drifts by ~1e-12 after a million additions, the pairwise sum doesn't
+        self.assertAlmostEqual(mean([0.1] * 10 ** 6), 0.1, places=15)
+
+    def test_std_all(self):
+        self.assertAlmostEqual(std(self.A), 0.2950762917786873)
+
+    def test_variance_all(self):
+        self.assertAlmostEqual(variance(self.A, 1), 0.08817217009606179)
+
+    def test_running_moments_chunks(self):
+        moments = RunningMoments(8)
+        moments.update(self.A[:3])
+        moments.update(self.A[3:4])
+        moments.update(self.A[4])
+        moments.update(self.A[5:])
+        result = moments.result(degrees_of_freedom=1)
+        self.assertEqual(moments.count, 10)
+        for a, b in zip(result['mean'], mean(self.A, axis=0)):
+            self.assertAlmostEqual(a, b)
+        for a, b in zip(result['variance'], variance(self.A, 1, axis=0)):
+            self.assertAlmostEqual(a, b)
+        for a, b in zip(result['std'], std(self.A, 1, axis=0)):
+            self.assertAlmostEqual(a, b)
+
+    def test_running_moments_merge(self):
+        first, second, single = RunningMoments(8, True), RunningMoments(8, True), RunningMoments(8, True)
+        first.update(self.A[:6])
+        second.update(self.A[6:])
+        first.merge(second)
+        single.update(self.A)
+        self.assertEqual(first.count, 10)
+        for a, b in zip(first.result()['covariance'][1], single.result()['covariance'][1]):
+            self.assertAlmostEqual(a, b)
+        self.assertAlmostEqual(first.result()['covariance'][1][7], 0.015228530607877794)
+
+    def test_running_moments_DimensionMismatch(self):
+        moments = RunningMoments(8)
+        self.assertRaises(Exception, moments.update, [[1, 2, 3]])
+        self.assertRaises(Exception, moments.merge, RunningMoments(3))
+
+    def test_running_moments_invalid_rows(self):
+        # rows that aren't numbers are rejected without changing the accumulator
+        moments = RunningMoments(2)
+        self.assertRaises(TypeError, moments.update, [['a', 'b']])
+        self.assertEqual(moments.count, 0)
+        moments.update([[1, 2], [3, 4]])
+        self.assertEqual(moments.result()['mean'], [2.0, 3.0])
+
+    def test_argmax_ties(self):
+        # the first of equal elements is returned
+        self.assertEqual(argmax([[1, 3, 3], [3, 0, 3]], axis=1), [1, 0])
+        self.assertEqual(argmin([[1, 0, 2], [1, 0, 2]], axis=0), [0, 0, 0])
+
     def test_std_0(self):
         self.assertAlmostEqual(std(self.A, axis=0)[0], 0.3054795187645529)
 
@@ -128,12 +196,58 @@ class LinearAlgebraTest(unittest.TestCase):
     def test_transpose(self):
         self.assertAlmostEqual(transpose(self.A)[5][8], 0.38628163852256203)
 
+    def test_transpose_blocked(self):
+        # shapes that are split recursively and don't divide into whole tiles, square ones are transposed in place
+        for rows, cols in [(37, 53), (130, 7), (301, 301), (64, 64)]:
+            A = [[i * cols + j for j in range(cols)] for i in range(rows)]
+            self.assertEqual(transpose(A), [[float(x) for x in column] for column in zip(*A)])
+
+    def test_transpose_bandwidth(self):
+        timings = transpose_bandwidth(100, 60, repeats=1, dtype='float32')
+        self.assertEqual(timings['bytes'], 100 * 60 * 4)
+        self.assertTrue(all(timings[key] >= 0 for key in ['transpose', 'transpose_in_place', 'memcpy']))
+
     def test_matrix_product(self):
         self.assertAlmostEqual(dot_product(self.A, self.B)[5][8], 2.2269865779018874)
 
     def test_dot_product(self):
         self.assertAlmostEqual(dot_product(self.A[0], transpose(self.B)[0])[0], 0.691239893627)
 
+    def test_dot_product_float32(self):
+        self.assertAlmostEqual(dot_product(self.A[0], transpose(self.B)[0], 'float32')[0], 0.691239893627,
+                               delta=1e-6)
+        # the sum is accumulated in double precision
+        self.assertEqual(dot_product([0.1] * 100000, [1] * 100000, 'float32'), [10000.0])
+        self.assertRaises(ValueError, dot_product, [1, 2], [3, 4], 'float16')
+
+    def test_sparse_dot(self):
+        # zero out most of A, products only read the non zeros
+        A = [[x if x > 0.7 else 0.0 for x in row] for row in self.A]
+        S = CSRMatrix.from_dense(A)
+        self.assertEqual(S.nnz, sum(x != 0 for row in A for x in row))
+        self.assertEqual(S.to_dense(), A)
+        for expected, result in zip(dot_product(A, transpose(self.B)[0]), S.dot(transpose(self.B)[0])):
+            self.assertAlmostEqual(expected, result)
+        for expected, result in zip(dot_product(A, self.B), S.dot(self.B)):
+            self.assertAlmostEqual(expected[8], result[8])
+        for expected, result in zip(dot_product(transpose(A), self.B[0][:10]), S.transpose_dot(self.B[0][:10])):
+            self.assertAlmostEqual(expected, result)
+        self.assertAlmostEqual(S.transpose_dot(transpose(self.B))[5][7],
+                               dot_product(transpose(A), transpose(self.B))[5][7])
+
+    def test_sparse_slice(self):
+        S = CSRMatrix.from_dense([[0, 1, 0], [2, 0, 0], [0, 0, 0], [0, 3, 4]])
+        self.assertEqual(S[1:].to_dense(), [[2, 0, 0], [0, 0, 0], [0, 3, 4]])
+        self.assertEqual(S.take([3, 0]).dot([1, 1, 1]), [7.0, 1.0])
+        self.assertEqual(S[-1], [0, 3, 4])
+
+    def test_sparse_invalid(self):
+        # unsorted column indices, a column out of bounds and a product with the wrong number of rows
+        self.assertRaises(ValueError, CSRMatrix([1, 2], [2, 0], [0, 2], (1, 3)).dot, [1, 1, 1])
+        self.assertRaises(ValueError, CSRMatrix([1], [3], [0, 1], (1, 3)).dot, [1, 1, 1])
+        self.assertRaises(ValueError, CSRMatrix, [1], [0], [0, 1, 1], (1, 3))
+        self.assertRaises(Exception, CSRMatrix([1], [0], [0, 1], (1, 3)).dot, [1, 1])
+
     def test_add_matrix(self):
         self.assertAlmostEqual(add(self.A, transpose(self.B))[0][-1], 0.16094185221109958)
 
@@ -161,6 +275,23 @@ class LinearAlgebraTest(unittest.TestCase):
     def test_divide_ZeroDivisionError(self):
         self.assertRaises(ZeroDivisionError, divide, self.A[0], 0)
 
+    def test_broadcast_vectors(self):
+        A = [[0, -4, 4], [-3, -2, 0]]
+        # a vector matching the number of rows is applied row by row, otherwise column by column
+        self.assertEqual(add(A, [0, 1]), [[0.0, -4.0, 4.0], [-2.0, -1.0, 1.0]])
+        self.assertEqual(add(A, [0, 1, 2]), [[0.0, -3.0, 6.0], [-3.0, -1.0, 2.0]])
+        # explicit column vector
+        self.assertEqual(multiply(A, [[1], [2]]), [[0.0, -4.0, 4.0], [-6.0, -4.0, 0.0]])
+        # the vector can also be the first operand, or both operands can be stretched
+        self.assertEqual(subtract([0, 1, 2], A), [[0.0, 5.0, -2.0], [3.0, 3.0, 2.0]])
+        self.assertEqual(add([[1], [2]], [0, 1, 2]), [[1.0, 2.0, 3.0], [2.0, 3.0, 4.0]])
+
+    def test_broadcast_mismatch(self):
+        self.assertRaises(Exception, add, [[0, -4, 4], [-3, -2, 0]], [1, 2, 3, 4])
+
+    def test_divide_broadcast_ZeroDivisionError(self):
+        self.assertRaises(ZeroDivisionError, divide, [[0, -4, 4], [-3, -2, 0]], [1, 0, 2])
+
     def test_cov_matrix(self):
         self.assertAlmostEqual(covariance(self.A)[1][7], 0.015228530607877794)
 
@@ -185,3 +316,84 @@ class LinearAlgebraTest(unittest.TestCase):
     def test_determinant_2(self):
         A = [[1, 3, 2], [4, 1, 3], [2, 5, 2]]
         self.assertAlmostEqual(determinant(A), 17)
+
+    def test_determinant_scratch(self):
+        # the minors of every level of the expansion share the memory of a single arena block
+        A = [[2, 0, 1, 3, 1], [1, 1, 0, 2, 4], [3, 2, 1, 0, 1], [0, 1, 4, 1, 2], [1, 3, 2, 1, 0]]
+        before = scratch_statistics()
+        self.assertAlmostEqual(determinant(A), -346)
+        after = scratch_statistics()
+        self.assertEqual(after['mallocs'] - before['mallocs'], 1)
+        self.assertGreater(after['mallocs_avoided'] - before['mallocs_avoided'], 0)
+
+
+class MappedMeanTest(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+
+        with tempfile.NamedTemporaryFile(delete=False) as f:
+            array('d', [1, 2, 3, 4, 5, 6]).tofile(f)
+            cls.path = f.name
+
+    @classmethod
+    def tearDownClass(cls):
+        os.remove(cls.path)
+
+    def test_mapped_mean_0(self):
+        self.assertEqual(mapped_mean(self.path, (2, 3), axis=0), [2.5, 3.5, 4.5])
+
+    def test_mapped_mean_1(self):
+        self.assertEqual(mapped_mean(self.path, (2, 3), axis=1), [2.0, 5.0])
+
+    def test_mapped_mean_all(self):
+        self.assertEqual(mapped_mean(self.path, (2, 3)), 3.5)
+
+    def test_mapped_mean_offset(self):
+        self.assertEqual(mapped_mean(self.path, 4, offset=16), 4.5)
+
+    def test_mapped_mean_OutOfBounds(self):
+        self.assertRaises(Exception, mapped_mean, self.path, (3, 3))
+
+    def test_mapped_mean_OSError(self):
+        self.assertRaises(OSError, mapped_mean, self.path + '.missing', (2, 3))
+
+    def test_mapped_mean_dtype_ValueError(self):
+        self.assertRaises(ValueError, mapped_mean, self.path, (2, 3), dtype='float16')
+
+    def test_running_moments_file(self):
+        moments = RunningMoments(3)
+        moments.update_file(self.path, 1)
+        moments.update_file(self.path, 1, offset=24)
+        self.assertEqual(moments.result()['mean'], [2.5, 3.5, 4.5])
+        self.assertEqual(moments.result()['variance'], [2.25, 2.25, 2.25])
+
+
+@unittest.skipUnless(sys.maxsize > 2 ** 32, "requires a 64 bit platform")
+class LargeArrayTest(unittest.TestCase):
+
+    # float32 array with 64 elements more than 2 ** 31, which is sparse on disk except for the last
+    # 64 elements. These are 2 ** 27 and 2 ** 28 in turn, so only sums indexed past 2 ** 31 are non zero
+
+    size = 2 ** 31 + 64
+
+    @classmethod
+    def setUpClass(cls):
+
+        with tempfile.NamedTemporaryFile(delete=False) as f:
+            f.truncate(cls.size * 4)
+            f.seek((cls.size - 64) * 4)
+            array('f', [2 ** 27, 2 ** 28] * 32).tofile(f)
+            cls.path = f.name
+
+    @classmethod
+    def tearDownClass(cls):
+        os.remove(cls.path)
+
+    def test_vector_mean(self):
+        self.assertAlmostEqual(mapped_mean(self.path, self.size, dtype='float32'), 6, delta=0.001)
+
+    def test_column_mean(self):
+        means = mapped_mean(self.path, (self.size // 2, 2), axis=0, dtype='float32')
+        self.assertAlmostEqual(means[0], 4, delta=0.001)
+        self.assertAlmostEqual(means[1], 8, delta=0.001)
@@ -3,6 +3,7 @@ from pyml.metrics.distances import euclidean_distance, manhattan_distance, calcu
 from pyml.metrics.scores import mean_absolute_error, mean_squared_error
 from pyml.preprocessing import train_test_split
 from pyml.utils import set_seed
+from pyml.maths import CSRMatrix
 import random
 from pyml.datasets import regression
 from pyml.nearest_neighbours import KNNRegressor
@@ -29,6 +30,33 @@ class DistancesTest(unittest.TestCase):
                                                                   1.068591055912026,
                                                                   0.19746815659817757])
 
+    def test_euclidean_float32(self):
+        distances = euclidean_distance(self.A, self.B, 'float32')
+        self.assertAlmostEqual(distances[0], 0.9506105259861932, delta=1e-6)
+        self.assertAlmostEqual(distances[1], 1.068591055912026, delta=1e-6)
+        self.assertAlmostEqual(distances[2], 0.19746815659817757, delta=1e-6)
+
+    def test_sparse_norm(self):
+        # the zeros of the sparse rows aren't read, but the norms are the same as with dense rows
+        A = [[x if x > 0.5 else 0.0 for x in row] for row in self.A]
+        S = CSRMatrix.from_dense(A)
+        for p in [1, 2, 3, -1]:
+            for expected, result in zip(calculate_distance(A, self.B[0], p), calculate_distance(S, self.B[0], p)):
+                self.assertAlmostEqual(expected, result)
+            for expected, result in zip(calculate_distance(A, self.B, p),
+                                        calculate_distance(S, CSRMatrix.from_dense(self.B), p)):
+                self.assertAlmostEqual(expected, result)
+        self.assertEqual(euclidean_distance(self.B[0], S), euclidean_distance(S, self.B[0]))
+        self.assertRaises(ValueError, euclidean_distance, S, self.B)
+
+    def test_sparse_norm_large_values(self):
+        # a row close to a vector of large values, the norm of the vector must not cancel the difference
+        rng = random.Random(2017)
+        B = [rng.uniform(0, 1e4) for _ in range(100000)]
+        row = [b + 1e-3 if j % 1000 == 0 else b for j, b in enumerate(B)]
+        self.assertEqual(euclidean_distance(CSRMatrix.from_dense([row]), B), euclidean_distance([row], B))
+        self.assertAlmostEqual(euclidean_distance(CSRMatrix.from_dense([[1e8 + 1, 1e8]]), [1e8, 1e8])[0], 1.0)
+
     def test_manhattan(self):
         self.assertListEqual(manhattan_distance(self.A, self.B), [1.390086685264639,
                                                                   1.6562536208811662,
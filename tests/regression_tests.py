@@ -1,8 +1,13 @@
 import unittest
+import random
+import math
 from pyml.linear_models import LinearRegression, LogisticRegression
 from pyml.linear_models.base import LinearBase
 from pyml.datasets import regression, gaussian
 from pyml.preprocessing import train_test_split
+from pyml.maths.optimisers import newton, elastic_net, gradient_descent, optimiser_state, partial_fit, predict, \
+    one_vs_rest, scratch_statistics, hogwild, softmax_regression, elastic_net_path
+from pyml.maths import least_squares, CSRMatrix
 
 
 class LinearRegressionGradientDescentTest(unittest.TestCase):
@@ -109,6 +114,14 @@ class LogisticRegressionTest(unittest.TestCase):
     def test_LogR_seed(self):
         self.assertEqual(self.classifier.seed, 1970)
 
+    def test_LogR_cost_large_scores(self):
+        # log(1 + exp(s)) overflows for scores above ~709, the cost must stay finite
+        X = [[1000.0], [900.0], [-800.0], [-1000.0]] * 10
+        y = [1, 1, 0, 0] * 10
+        for batch_size in [0, 8]:
+            _, cost, _ = gradient_descent(X, [1.0], y, batch_size, 20, 1e-8, 0.1, 0.0, 'logit', 'normal', 1970, 1e-8)
+            self.assertTrue(all(abs(c) < 1 for c in cost))
+
 
 class MultiClassLogisticRegressionTest(unittest.TestCase):
 
@@ -217,6 +230,14 @@ class MultiClassLogisticRegressionMiniBatch(unittest.TestCase):
     def test_MLogRMin_accuracy(self):
         self.assertAlmostEqual(self.classifier.score(self.X_test, self.y_test), 0.9833333333333333, delta=0.001)
 
+    def test_MLogRMin_physical_shuffle(self):
+        # reading the batches from a shuffled copy of X gives the same result
+        classifier = LogisticRegression(seed=1970, alpha=0.9, batch_size=64, physical_shuffle=True)
+        classifier.train(X=self.X_train, y=self.y_train)
+        self.assertEqual(classifier.iterations, self.classifier.iterations)
+        self.assertEqual(classifier.coefficients, self.classifier.coefficients)
+        self.assertEqual(classifier.cost, self.classifier.cost)
+
 
 class MultiClassLogisticRegressionNesterovOpt(unittest.TestCase):
 
@@ -356,3 +377,995 @@ class MultiClassLogisticRegressionRMSpropOpt(unittest.TestCase):
 
     def test_MLogRAdagradOpt_accuracy(self):
         self.assertAlmostEqual(self.classifier.score(self.X_test, self.y_test), 0.9833333333333333, delta=0.001)
+
+
+class MultiClassLogisticRegressionAdamOpt(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        cls.X, cls.y = gaussian(labels=3, sigma=0.2, seed=1970)
+        cls.X_train, cls.y_train, cls.X_test, cls.y_test = train_test_split(cls .X, cls.y,
+                                                                            train_split=0.8, seed=1970)
+        cls.classifier = LogisticRegression(seed=1970, learning_rate=0.1, alpha=0.9, method='adam')
+        cls.classifier.train(X=cls.X_train, y=cls.y_train)
+
+    def test_MLogRAdamOpt_iterations(self):
+        self.assertEqual(self.classifier.iterations[0], 695)
+        self.assertEqual(self.classifier.iterations[1], 279)
+        self.assertEqual(self.classifier.iterations[2], 383)
+
+    def test_MLogRAdamOpt_coefficients(self):
+        self.assertAlmostEqual(self.classifier.coefficients[0][-1], -11.714841598362927, delta=0.001)
+        self.assertAlmostEqual(self.classifier.coefficients[1][-1], 7.055590492599174, delta=0.001)
+        self.assertAlmostEqual(self.classifier.coefficients[2][-1], 3.5092307217998777, delta=0.001)
+
+    def test_MLogRAdamOpt_cost(self):
+        self.assertAlmostEqual(self.classifier.cost[0][-1], -22.71543368457669, delta=0.001)
+        self.assertAlmostEqual(self.classifier.cost[1][-1], -59.0613985583672, delta=0.001)
+        self.assertAlmostEqual(self.classifier.cost[2][-1], -23.428036387914453, delta=0.001)
+
+    def test_MLogRAdamOpt_predict_proba(self):
+        self.assertAlmostEqual(self.classifier.predict_proba(self.X_test)[0][0], 0.004525456591420174, delta=0.001)
+
+    def test_MLogRAdamOpt_accuracy(self):
+        self.assertAlmostEqual(self.classifier.score(self.X_test, self.y_test), 0.9833333333333333, delta=0.001)
+
+
+class MultiClassLogisticRegressionAdamWOpt(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        cls.X, cls.y = gaussian(labels=3, sigma=0.2, seed=1970)
+        cls.X_train, cls.y_train, cls.X_test, cls.y_test = train_test_split(cls .X, cls.y,
+                                                                            train_split=0.8, seed=1970)
+        cls.classifier = LogisticRegression(seed=1970, learning_rate=0.1, alpha=0.9, method='adamw',
+                                            weight_decay=0.01)
+        cls.classifier.train(X=cls.X_train, y=cls.y_train)
+
+    def test_MLogRAdamWOpt_iterations(self):
+        self.assertEqual(self.classifier.iterations[0], 691)
+        self.assertEqual(self.classifier.iterations[1], 297)
+        self.assertEqual(self.classifier.iterations[2], 393)
+
+    def test_MLogRAdamWOpt_coefficients(self):
+        # weight decay shrinks the coefficients with respect to Adam
+        self.assertAlmostEqual(self.classifier.coefficients[0][-1], -9.551041786851336, delta=0.001)
+        self.assertAlmostEqual(self.classifier.coefficients[1][-1], 6.5751586495723595, delta=0.001)
+        self.assertAlmostEqual(self.classifier.coefficients[2][-1], 3.2311248068206617, delta=0.001)
+
+    def test_MLogRAdamWOpt_accuracy(self):
+        self.assertAlmostEqual(self.classifier.score(self.X_test, self.y_test), 0.9833333333333333, delta=0.001)
+
+
+class MultiClassLogisticRegressionNadamOpt(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        cls.X, cls.y = gaussian(labels=3, sigma=0.2, seed=1970)
+        cls.X_train, cls.y_train, cls.X_test, cls.y_test = train_test_split(cls .X, cls.y,
+                                                                            train_split=0.8, seed=1970)
+        cls.classifier = LogisticRegression(seed=1970, learning_rate=0.1, alpha=0.9, method='nadam')
+        cls.classifier.train(X=cls.X_train, y=cls.y_train)
+
+    def test_MLogRNadamOpt_iterations(self):
+        self.assertEqual(self.classifier.iterations[0], 685)
+        self.assertEqual(self.classifier.iterations[1], 277)
+        self.assertEqual(self.classifier.iterations[2], 382)
+
+    def test_MLogRNadamOpt_coefficients(self):
+        self.assertAlmostEqual(self.classifier.coefficients[0][-1], -11.76637576897568, delta=0.001)
+        self.assertAlmostEqual(self.classifier.coefficients[1][-1], 7.060081484255452, delta=0.001)
+        self.assertAlmostEqual(self.classifier.coefficients[2][-1], 3.5184884685391586, delta=0.001)
+
+    def test_MLogRNadamOpt_accuracy(self):
+        self.assertAlmostEqual(self.classifier.score(self.X_test, self.y_test), 0.9833333333333333, delta=0.001)
+
+
+class LinearRegressionNadamTest(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        cls.X, cls.y = regression(100, seed=1970)
+        cls.X_train, cls.y_train, cls.X_test, cls.y_test = train_test_split(cls.X, cls.y,
+                                                                            train_split=0.8, seed=1970)
+        cls.regressor = LinearRegression(seed=1970, solver='gradient_descent', learning_rate=0.1, alpha=0.9,
+                                         method='nadam')
+        cls.regressor.train(X=cls.X_train, y=cls.y_train)
+
+    def test_LinRNadam_iterations(self):
+        self.assertEqual(self.regressor.iterations, 4)
+
+    def test_LinRNadam_coefficients(self):
+        self.assertAlmostEqual(self.regressor.coefficients[0], 0.8144884911561968, delta=0.001)
+        self.assertAlmostEqual(self.regressor.coefficients[1], 0.9072811411206099, delta=0.001)
+
+    def test_LinRNadam_cost(self):
+        self.assertAlmostEqual(self.regressor.cost[-1], 0.5187251115222187, delta=0.001)
+
+    def test_LinRNadam_beta_1_warning(self):
+        self.assertWarns(UserWarning, LinearRegression, seed=1970, solver='gradient_descent', method='adam')
+
+
+class LinearRegressionLBFGSTest(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        cls.X, cls.y = regression(100, seed=1970)
+        cls.X_train, cls.y_train, cls.X_test, cls.y_test = train_test_split(cls.X, cls.y,
+                                                                            train_split=0.8, seed=1970)
+        cls.regressor = LinearRegression(seed=1970, solver='gradient_descent', method='lbfgs', epsilon=1e-8)
+        cls.regressor.train(X=cls.X_train, y=cls.y_train)
+
+    def test_LinRLBFGS_iterations(self):
+        self.assertEqual(self.regressor.iterations, 4)
+
+    def test_LinRLBFGS_coefficients(self):
+        # converges to the OLS solution
+        self.assertAlmostEqual(self.regressor.coefficients[0], 0.518888884839874, delta=0.001)
+        self.assertAlmostEqual(self.regressor.coefficients[1], 0.9128356664164721, delta=0.001)
+
+    def test_LinRLBFGS_cost(self):
+        self.assertAlmostEqual(self.regressor.cost[-1], 0.4833830106664908, delta=0.001)
+
+    def test_LinRLBFGS_history_error(self):
+        regressor = LinearRegression(seed=1970, solver='gradient_descent', method='lbfgs', history_size=0)
+        self.assertRaises(ValueError, regressor.train, self.X_train, self.y_train)
+
+
+class MultiClassLogisticRegressionLBFGSOpt(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        cls.X, cls.y = gaussian(labels=3, sigma=0.2, seed=1970)
+        cls.X_train, cls.y_train, cls.X_test, cls.y_test = train_test_split(cls .X, cls.y,
+                                                                            train_split=0.8, seed=1970)
+        cls.classifier = LogisticRegression(seed=1970, method='lbfgs')
+        cls.classifier.train(X=cls.X_train, y=cls.y_train)
+
+    def test_MLogRLBFGSOpt_iterations(self):
+        self.assertEqual(self.classifier.iterations[0], 14)
+        self.assertEqual(self.classifier.iterations[1], 9)
+        self.assertEqual(self.classifier.iterations[2], 11)
+
+    def test_MLogRLBFGSOpt_coefficients(self):
+        self.assertAlmostEqual(self.classifier.coefficients[0][-1], -19.750359507917647, delta=0.001)
+        self.assertAlmostEqual(self.classifier.coefficients[1][-1], 8.36741686502787, delta=0.001)
+        self.assertAlmostEqual(self.classifier.coefficients[2][-1], 4.357598099240376, delta=0.001)
+
+    def test_MLogRLBFGSOpt_cost(self):
+        self.assertAlmostEqual(self.classifier.cost[0][-1], -19.06327168629906, delta=0.001)
+        self.assertAlmostEqual(self.classifier.cost[1][-1], -58.34951257070125, delta=0.001)
+        self.assertAlmostEqual(self.classifier.cost[2][-1], -21.68539899761478, delta=0.001)
+
+    def test_MLogRLBFGSOpt_accuracy(self):
+        self.assertAlmostEqual(self.classifier.score(self.X_test, self.y_test), 0.9833333333333333, delta=0.001)
+
+
+class LogisticRegressionNewtonTest(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        cls.X, cls.y = gaussian(labels=2, sigma=1, seed=1970)
+        cls.X_train, cls.y_train, cls.X_test, cls.y_test = train_test_split(cls.X, cls.y,
+                                                                            train_split=0.8, seed=1970)
+        cls.classifier = LogisticRegression(seed=1970, solver='newton')
+        cls.classifier.train(X=cls.X_train, y=cls.y_train)
+
+    def test_LogRNewton_iterations(self):
+        self.assertEqual(self.classifier.iterations, 4)
+
+    def test_LogRNewton_coefficients(self):
+        self.assertAlmostEqual(self.classifier.coefficients[0], -0.47816251481162464, delta=0.001)
+        self.assertAlmostEqual(self.classifier.coefficients[1], -0.2802499932808987, delta=0.001)
+        self.assertAlmostEqual(self.classifier.coefficients[2], 0.835884966273457, delta=0.001)
+
+    def test_LogRNewton_cost(self):
+        self.assertAlmostEqual(self.classifier.cost[0], -140.13938579515298, delta=0.001)
+        self.assertAlmostEqual(self.classifier.cost[-1], -97.7973869128949, delta=0.001)
+
+    def test_LogRNewton_conjugate_gradient(self):
+        # truncated conjugate gradient reaches the same solution as the explicit Hessian
+        X = [[1] + row for row in self.X_train]
+        theta = [0.0] * len(X[0])
+        coefficients, _, _ = newton(X, theta, self.y_train, 100, 1e-6)
+        coefficients_cg, _, _ = newton(X, theta, self.y_train, 100, 1e-6, cg_threshold=0)
+        for coefficient, coefficient_cg in zip(coefficients, coefficients_cg):
+            self.assertAlmostEqual(coefficient, coefficient_cg, delta=0.0001)
+
+    def test_LogRNewton_solver_error(self):
+        self.assertRaises(ValueError, LogisticRegression, solver='unknown_solver')
+
+    def test_LogRNewton_input_errors(self):
+        X = [[1] + row for row in self.X_train]
+        theta = [0.0] * len(X[0])
+        self.assertRaises(ValueError, newton, X, theta, self.y_train[:-1], 100, 1e-6)
+        self.assertRaises(ValueError, newton, X, theta, [2] + self.y_train[1:], 100, 1e-6)
+        self.assertRaises(ValueError, newton, X, theta[:-1], self.y_train, 100, 1e-6)
+
+
+class MultiClassLogisticRegressionNewtonTest(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        cls.X, cls.y = gaussian(labels=3, sigma=0.2, seed=1970)
+        cls.X_train, cls.y_train, cls.X_test, cls.y_test = train_test_split(cls .X, cls.y,
+                                                                            train_split=0.8, seed=1970)
+        cls.classifier = LogisticRegression(seed=1970, solver='newton')
+        cls.classifier.train(X=cls.X_train, y=cls.y_train)
+
+    def test_MLogRNewton_iterations(self):
+        self.assertEqual(self.classifier.iterations[0], 7)
+        self.assertEqual(self.classifier.iterations[1], 5)
+        self.assertEqual(self.classifier.iterations[2], 7)
+
+    def test_MLogRNewton_coefficients(self):
+        self.assertAlmostEqual(self.classifier.coefficients[0][-1], -19.76688656949605, delta=0.001)
+        self.assertAlmostEqual(self.classifier.coefficients[1][-1], 8.374260112828743, delta=0.001)
+        self.assertAlmostEqual(self.classifier.coefficients[2][-1], 4.406075491623663, delta=0.001)
+
+    def test_MLogRNewton_accuracy(self):
+        self.assertAlmostEqual(self.classifier.score(self.X_test, self.y_test), 0.9833333333333333, delta=0.001)
+
+
+class MultiClassLogisticRegressionMultinomialTest(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        cls.X, cls.y = gaussian(labels=3, sigma=0.2, seed=1970)
+        cls.X_train, cls.y_train, cls.X_test, cls.y_test = train_test_split(cls .X, cls.y,
+                                                                            train_split=0.8, seed=1970)
+        cls.classifier = LogisticRegression(seed=1970, multi_class='multinomial', method='nesterov',
+                                            learning_rate=0.1, alpha=0.9)
+        cls.classifier.train(X=cls.X_train, y=cls.y_train)
+
+    def test_MLogRMultinomial_iterations(self):
+        self.assertEqual(self.classifier.iterations, 659)
+
+    def test_MLogRMultinomial_cost(self):
+        self.assertAlmostEqual(self.classifier.cost[0], -567.5185825215374, delta=0.001)
+        self.assertAlmostEqual(self.classifier.cost[-1], -40.95004322701267, delta=0.001)
+
+    def test_MLogRMultinomial_coefficients(self):
+        self.assertAlmostEqual(self.classifier.coefficients[0][-1], -7.919530179708003, delta=0.001)
+        self.assertAlmostEqual(self.classifier.coefficients[1][-1], 4.150185261147817, delta=0.001)
+        self.assertAlmostEqual(self.classifier.coefficients[2][-1], 2.430339805702959, delta=0.001)
+
+    def test_MLogRMultinomial_predict_proba(self):
+        probabilities = self.classifier.predict_proba(self.X_test[:1])
+        self.assertAlmostEqual(probabilities[0][1], 0.9650328518742896, delta=0.001)
+        self.assertAlmostEqual(sum(probabilities[0]), 1, delta=0.000001)
+
+    def test_MLogRMultinomial_accuracy(self):
+        self.assertAlmostEqual(self.classifier.score(self.X_test, self.y_test), 0.9833333333333333, delta=0.001)
+
+    def test_MLogRMultinomial_method_error(self):
+        self.assertRaises(ValueError, LogisticRegression, multi_class='multinomial', method='adagrad')
+
+    def test_MLogRMultinomial_multi_class_error(self):
+        self.assertRaises(ValueError, LogisticRegression, multi_class='unknown')
+
+
+class MultiClassLogisticRegressionParallelTest(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        cls.X, cls.y = gaussian(labels=3, sigma=0.2, seed=1970)
+        cls.X_train, cls.y_train, cls.X_test, cls.y_test = train_test_split(cls .X, cls.y,
+                                                                            train_split=0.8, seed=1970)
+        cls.classifier = LogisticRegression(seed=1970, alpha=0.9, n_jobs=3)
+        cls.classifier.train(X=cls.X_train, y=cls.y_train)
+        cls.minibatch_classifier = LogisticRegression(seed=1970, alpha=0.9, batch_size=64, n_jobs=2)
+        cls.minibatch_classifier.train(X=cls.X_train, y=cls.y_train)
+
+    def test_MLogRPar_iterations(self):
+        # batch gradient descent is identical to the serial one-vs-rest
+        self.assertEqual(self.classifier.iterations[0], 1671)
+        self.assertEqual(self.classifier.iterations[1], 1691)
+        self.assertEqual(self.classifier.iterations[2], 1546)
+
+    def test_MLogRPar_coefficients(self):
+        self.assertAlmostEqual(self.classifier.coefficients[0][-1], -6.179813361986948, delta=0.001)
+        self.assertAlmostEqual(self.classifier.coefficients[1][-1], 3.915365241814121, delta=0.001)
+        self.assertAlmostEqual(self.classifier.coefficients[2][-1], 1.4391187417309603, delta=0.001)
+
+    def test_MLogRPar_cost(self):
+        self.assertAlmostEqual(self.classifier.cost[0][-1], -38.80552082812185, delta=0.001)
+        self.assertAlmostEqual(self.classifier.cost[1][-1], -71.11678230563942, delta=0.001)
+        self.assertAlmostEqual(self.classifier.cost[2][-1], -39.44585417456268, delta=0.001)
+
+    def test_MLogRPar_minibatch_iterations(self):
+        self.assertEqual(self.minibatch_classifier.iterations[0], 910)
+        self.assertEqual(self.minibatch_classifier.iterations[1], 783)
+        self.assertEqual(self.minibatch_classifier.iterations[2], 844)
+
+    def test_MLogRPar_minibatch_deterministic(self):
+        # each class has its own random stream, so the number of threads doesn't change the result
+        classifier = LogisticRegression(seed=1970, alpha=0.9, batch_size=64, n_jobs=-1)
+        classifier.train(X=self.X_train, y=self.y_train)
+        self.assertEqual(classifier.coefficients, self.minibatch_classifier.coefficients)
+        self.assertEqual(classifier.cost, self.minibatch_classifier.cost)
+
+    def test_MLogRPar_accuracy(self):
+        self.assertAlmostEqual(self.minibatch_classifier.score(self.X_test, self.y_test), 0.9833333333333333,
+                               delta=0.001)
+
+
+class LinearRegressionHogwildTest(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        cls.X, cls.y = regression(100, seed=1970)
+        cls.X_train, cls.y_train, cls.X_test, cls.y_test = train_test_split(cls.X, cls.y,
+                                                                            train_split=0.8, seed=1970)
+        cls.regressor = LinearRegression(seed=1970, solver='gradient_descent', method='hogwild', epsilon=0.001)
+        cls.regressor.train(X=cls.X_train, y=cls.y_train)
+
+    def test_LinRHogwild_iterations(self):
+        self.assertEqual(self.regressor.iterations, 72)
+
+    def test_LinRHogwild_coefficients(self):
+        self.assertAlmostEqual(self.regressor.coefficients[0], 0.41210206558560164, delta=0.001)
+        self.assertAlmostEqual(self.regressor.coefficients[1], 0.9045594267476242, delta=0.001)
+
+    def test_LinRHogwild_cost(self):
+        self.assertAlmostEqual(self.regressor.cost[0], 3.5181936893597365, delta=0.001)
+        self.assertAlmostEqual(self.regressor.cost[-1], 0.4951792242491588, delta=0.001)
+
+    def test_LinRHogwild_throughput(self):
+        self.assertGreater(self.regressor.throughput, 0)
+
+    def test_LinRHogwild_workers(self):
+        # updates from concurrent workers may interleave differently in each run, so only check convergence
+        regressor = LinearRegression(seed=1970, solver='gradient_descent', method='hogwild', epsilon=0.001,
+                                     n_workers=4)
+        regressor.train(X=self.X_train, y=self.y_train)
+        self.assertLess(regressor.cost[-1], 1)
+        self.assertGreater(regressor.throughput, 0)
+
+    def test_LinRHogwild_no_throughput(self):
+        self.assertIsNone(LinearRegression(seed=1970, solver='gradient_descent').throughput)
+
+    def test_LinRHogwild_input_errors(self):
+        # checked before the workers start
+        X = [[1] + row for row in self.X_train]
+        self.assertRaises(ValueError, hogwild, X, [0.0, 0.0], [1.0], 10, 0.001, 0.01, 'regressor', 1970)
+        self.assertRaises(ValueError, hogwild, X, [0.0], self.y_train, 10, 0.001, 0.01, 'regressor', 1970)
+        self.assertRaises(ValueError, hogwild, X, [0.0, 0.0], self.y_train, 10, 0.001, 0.01, 'probit', 1970)
+        self.assertRaises(ValueError, hogwild, X, [0.0, 0.0], self.y_train, -1, 0.001, 0.01, 'regressor', 1970)
+
+
+class LogisticRegressionMonitorTest(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        cls.X, cls.y = gaussian(labels=2, sigma=0.2, seed=1970)
+        cls.X_train, cls.y_train, cls.X_test, cls.y_test = train_test_split(cls.X, cls.y,
+                                                                            train_split=0.8, seed=1970)
+        cls.classifiers = {}
+        for monitor in ['full', 'average', 'every', 'subsample']:
+            cls.classifiers[monitor] = LogisticRegression(seed=1970, alpha=0.9, batch_size=16, monitor=monitor,
+                                                          monitor_frequency=5, monitor_samples=50)
+            cls.classifiers[monitor].train(X=cls.X_train, y=cls.y_train)
+
+    def test_LogRMonitor_iterations(self):
+        self.assertEqual(self.classifiers['full'].iterations, 520)
+        self.assertEqual(self.classifiers['average'].iterations, 308)
+        self.assertEqual(self.classifiers['subsample'].iterations, 374)
+
+    def test_LogRMonitor_cost_length(self):
+        # one cost per batch, except with "every" which has one per monitor_frequency batches
+        self.assertEqual(len(self.classifiers['full'].cost), 5200)
+        self.assertEqual(len(self.classifiers['average'].cost), 3080)
+        self.assertEqual(len(self.classifiers['every'].cost), 1040)
+        self.assertEqual(len(self.classifiers['subsample'].cost), 3740)
+
+    def test_LogRMonitor_cost(self):
+        self.assertAlmostEqual(self.classifiers['average'].cost[-1], -19.99379621287519, delta=0.001)
+        self.assertAlmostEqual(self.classifiers['subsample'].cost[-1], -16.96375019109601, delta=0.001)
+
+    def test_LogRMonitor_every(self):
+        # the full cost is evaluated at the end of every epoch, so the result is the same as with "full"
+        self.assertEqual(self.classifiers['every'].iterations, self.classifiers['full'].iterations)
+        self.assertEqual(self.classifiers['every'].coefficients, self.classifiers['full'].coefficients)
+        self.assertEqual(self.classifiers['every'].cost, self.classifiers['full'].cost[4::5])
+
+    def test_LogRMonitor_accuracy(self):
+        for classifier in self.classifiers.values():
+            self.assertAlmostEqual(classifier.score(self.X_test, self.y_test), 0.975, delta=0.001)
+
+    def test_LogRMonitor_error(self):
+        self.assertRaises(ValueError, LogisticRegression, monitor='unknown')
+
+
+class LogisticRegressionEarlyStoppingTest(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        cls.X, cls.y = gaussian(labels=3, sigma=0.2, seed=1970)
+        cls.X_train, cls.y_train, cls.X_test, cls.y_test = train_test_split(cls.X, cls.y,
+                                                                            train_split=0.8, seed=1970)
+        cls.classifier = LogisticRegression(seed=1970, alpha=0.9, epsilon=1e-6, early_stopping=True, patience=3,
+                                            min_improvement=0.01)
+        cls.classifier.train(X=cls.X_train, y=cls.y_train)
+
+    def test_LogREarly_iterations(self):
+        self.assertEqual(self.classifier.iterations[0], 812)
+        self.assertEqual(self.classifier.iterations[1], 905)
+        self.assertEqual(self.classifier.iterations[2], 753)
+
+    def test_LogREarly_coefficients(self):
+        self.assertAlmostEqual(self.classifier.coefficients[0][-1], -4.2347627813900095, delta=0.001)
+        self.assertAlmostEqual(self.classifier.coefficients[1][-1], 2.4761698499413822, delta=0.001)
+        self.assertAlmostEqual(self.classifier.coefficients[2][-1], 1.02468413363838, delta=0.001)
+
+    def test_LogREarly_parallel(self):
+        classifier = LogisticRegression(seed=1970, alpha=0.9, epsilon=1e-6, early_stopping=True, patience=3,
+                                        min_improvement=0.01, n_jobs=2)
+        classifier.train(X=self.X_train, y=self.y_train)
+        self.assertEqual(classifier.iterations, self.classifier.iterations)
+        self.assertEqual(classifier.coefficients, self.classifier.coefficients)
+
+    def test_LogREarly_accuracy(self):
+        self.assertAlmostEqual(self.classifier.score(self.X_test, self.y_test), 0.9833333333333333, delta=0.001)
+
+    def test_LogREarly_errors(self):
+        self.assertRaises(ValueError, LogisticRegression, early_stopping=True, method='lbfgs')
+        self.assertRaises(ValueError, LogisticRegression, early_stopping=True, solver='newton')
+        self.assertRaises(ValueError, LogisticRegression, early_stopping=True, validation_split=1)
+
+
+class LinearRegressionEarlyStoppingTest(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        cls.X, cls.y = regression(100, seed=1970)
+        cls.X_train, cls.y_train, cls.X_test, cls.y_test = train_test_split(cls.X, cls.y,
+                                                                            train_split=0.8, seed=1970)
+        cls.regressor = LinearRegression(seed=1970, solver='gradient_descent', epsilon=1e-8, early_stopping=True,
+                                         validation_split=0.2)
+        cls.regressor.train(X=cls.X_train, y=cls.y_train)
+
+    def test_LinREarly_iterations(self):
+        # without early stopping gradient descent needs 825 iterations to reach epsilon
+        self.assertEqual(self.regressor.iterations, 12)
+
+    def test_LinREarly_coefficients(self):
+        self.assertAlmostEqual(self.regressor.coefficients[0], 0.4913946752750091, delta=0.001)
+        self.assertAlmostEqual(self.regressor.coefficients[1], 0.9065183408906884, delta=0.001)
+
+    def test_LinREarly_mse(self):
+        self.assertAlmostEqual(self.regressor.score(self.X_test, self.y_test), 1.3271676527926013, delta=0.001)
+
+
+class LinearRegressionScheduleTest(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        cls.X, cls.y = regression(100, seed=1970)
+        cls.X_train, cls.y_train, cls.X_test, cls.y_test = train_test_split(cls.X, cls.y,
+                                                                            train_split=0.8, seed=1970)
+        cls.constant = LinearRegression(seed=1970, solver='gradient_descent', epsilon=1e-8, schedule='constant')
+        cls.constant.train(X=cls.X_train, y=cls.y_train)
+        cls.step = LinearRegression(seed=1970, solver='gradient_descent', epsilon=1e-8,
+                                    schedule={'type': 'step', 'gamma': 0.5, 'period': 200})
+        cls.step.train(X=cls.X_train, y=cls.y_train)
+        cls.cosine = LinearRegression(seed=1970, solver='gradient_descent', epsilon=1e-8,
+                                      schedule={'type': 'cosine', 'gamma': 2, 'period': 200,
+                                                'min_learning_rate': 0.001})
+        cls.cosine.train(X=cls.X_train, y=cls.y_train)
+        cls.one_cycle = LinearRegression(seed=1970, solver='gradient_descent', epsilon=1e-8, learning_rate=0.05,
+                                         schedule={'type': 'one_cycle', 'period': 300, 'min_learning_rate': 0.001,
+                                                   'warmup': 0.3})
+        cls.one_cycle.train(X=cls.X_train, y=cls.y_train)
+
+    def test_LinRSchedule_constant(self):
+        # same as the unscheduled run
+        self.assertEqual(self.constant.iterations, 825)
+        self.assertAlmostEqual(self.constant.coefficients[0], 0.5141820127226112, delta=0.001)
+        self.assertAlmostEqual(self.constant.coefficients[1], 0.9135195843724171, delta=0.001)
+
+    def test_LinRSchedule_step(self):
+        self.assertEqual(self.step.iterations, 601)
+        self.assertAlmostEqual(self.step.coefficients[0], 0.5061189763995386, delta=0.001)
+        self.assertAlmostEqual(self.step.coefficients[1], 0.9146911597165956, delta=0.001)
+
+    def test_LinRSchedule_cosine(self):
+        self.assertEqual(self.cosine.iterations, 560)
+        self.assertAlmostEqual(self.cosine.score(self.X_test, self.y_test), 1.3350840840272744, delta=0.001)
+
+    def test_LinRSchedule_one_cycle(self):
+        self.assertEqual(self.one_cycle.iterations, 252)
+        self.assertAlmostEqual(self.one_cycle.score(self.X_test, self.y_test), 1.338875295087846, delta=0.001)
+
+    def test_LinRSchedule_unknown(self):
+        self.assertRaises(ValueError, LinearRegression, 1970, True, 'gradient_descent',
+                          schedule='amazing_schedule')
+        self.assertRaises(ValueError, LinearRegression, 1970, True, 'gradient_descent',
+                          schedule={'type': 'step', 'amazing_parameter': 1})
+        self.assertRaises(ValueError, LinearRegression, 1970, True, 'gradient_descent', method='lbfgs',
+                          schedule='step')
+
+
+class LogisticRegressionScheduleTest(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        cls.X, cls.y = gaussian(labels=2, sigma=0.2, seed=1970)
+        cls.X_train, cls.y_train, cls.X_test, cls.y_test = train_test_split(cls.X, cls.y,
+                                                                            train_split=0.8, seed=1970)
+        cls.classifier = LogisticRegression(seed=1970, learning_rate=0.1, batch_size=20, epsilon=0.001,
+                                            schedule={'type': 'cosine', 'gamma': 2, 'period': 500,
+                                                      'min_learning_rate': 0.001})
+        cls.classifier.train(X=cls.X_train, y=cls.y_train)
+
+    def test_LogRSchedule_iterations(self):
+        # the constant learning rate needs 2514 iterations
+        self.assertEqual(self.classifier.iterations, 420)
+
+    def test_LogRSchedule_coefficients(self):
+        self.assertAlmostEqual(self.classifier.coefficients[0], -3.877714341287934, delta=0.001)
+        self.assertAlmostEqual(self.classifier.coefficients[1], -0.971036172254779, delta=0.001)
+        self.assertAlmostEqual(self.classifier.coefficients[2], 7.152534267180271, delta=0.001)
+
+    def test_LogRSchedule_accuracy(self):
+        self.assertAlmostEqual(self.classifier.score(self.X_test, self.y_test), 0.975, delta=0.001)
+
+
+class LinearRegressionCoordinateDescentTest(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        cls.X, cls.y = regression(100, seed=1970)
+        cls.X_train, cls.y_train, cls.X_test, cls.y_test = train_test_split(cls.X, cls.y,
+                                                                            train_split=0.8, seed=1970)
+        cls.lasso = LinearRegression(solver='coordinate_descent', epsilon=1e-8, regularisation=0.1)
+        cls.lasso.train(X=cls.X_train, y=cls.y_train)
+        cls.elastic_net = LinearRegression(solver='coordinate_descent', epsilon=1e-8, regularisation=0.1,
+                                           l1_ratio=0.5)
+        cls.elastic_net.train(X=cls.X_train, y=cls.y_train)
+
+        # 30 features, only the first three are informative
+        rng = random.Random(1970)
+        cls.X_sparse = [[rng.gauss(0, 1) for j in range(30)] for i in range(200)]
+        cls.y_sparse = [3 + 2 * row[0] - 1.5 * row[1] + row[2] + rng.gauss(0, 0.5) for row in cls.X_sparse]
+        cls.sparse = LinearRegression(solver='coordinate_descent', epsilon=1e-8, regularisation=0.1)
+        cls.sparse.train(X=cls.X_sparse, y=cls.y_sparse)
+
+    def test_LinRCD_lasso_iterations(self):
+        self.assertEqual(self.lasso.iterations, 42)
+        self.assertEqual(len(self.lasso.cost), 43)
+
+    def test_LinRCD_lasso_coefficients(self):
+        self.assertAlmostEqual(self.lasso.coefficients[0], 0.5865555352938512, delta=0.001)
+        self.assertAlmostEqual(self.lasso.coefficients[1], 0.9004011179233564, delta=0.001)
+
+    def test_LinRCD_lasso_mse(self):
+        self.assertAlmostEqual(self.lasso.score(self.X_test, self.y_test), 1.3743343583996233, delta=0.001)
+
+    def test_LinRCD_elastic_net_coefficients(self):
+        self.assertAlmostEqual(self.elastic_net.coefficients[0], 0.5832070308859695, delta=0.001)
+        self.assertAlmostEqual(self.elastic_net.coefficients[1], 0.9010164624623319, delta=0.001)
+
+    def test_LinRCD_sparsity(self):
+        self.assertEqual([j for j, c in enumerate(self.sparse.coefficients) if c != 0], [0, 1, 2, 3])
+        self.assertAlmostEqual(self.sparse.coefficients[1], 1.9134998465567254, delta=0.001)
+        self.assertAlmostEqual(self.sparse.cost[-1], 0.5577917301722317, delta=0.001)
+
+    def test_LinRCD_naive_updates(self):
+        # residual updates reach the same solution as the covariance updates
+        X = [[1] + row for row in self.X_sparse]
+        theta, cost, iterations = elastic_net(X, [0.0] * 31, self.y_sparse, 1000, 1e-8, 0.1, 1.0,
+                                              covariance=False)
+        for a, b in zip(theta, self.sparse.coefficients):
+            self.assertAlmostEqual(a, b, delta=0.001)
+
+    def test_LinRCD_path(self):
+        regressor = LinearRegression(solver='coordinate_descent', epsilon=1e-10)
+        lambdas, coefficients = regressor.regularisation_path(self.X_train, self.y_train, n_lambdas=5)
+        self.assertEqual(len(lambdas), 5)
+        self.assertAlmostEqual(lambdas[0], 7.362363891731668, delta=0.001)
+        self.assertAlmostEqual(lambdas[4], 0.007362363891731669, delta=0.001)
+        # only the bias is left with the largest regularisation
+        self.assertEqual(coefficients[0][1], 0)
+        # and the smallest one is close to least squares
+        self.assertAlmostEqual(coefficients[4][0], 0.5238792659500887, delta=0.001)
+        self.assertAlmostEqual(coefficients[4][1], 0.9119189592082524, delta=0.001)
+
+    def test_LinRCD_bad_regularisation(self):
+        self.assertRaises(ValueError, LinearRegression, solver='coordinate_descent', l1_ratio=2)
+
+    def test_LinRCD_input_errors(self):
+        X = [[1] + row for row in self.X_sparse]
+        self.assertRaises(ValueError, elastic_net, X, [0.0] * 31, self.y_sparse[:-1], 1000, 1e-8, 0.1, 1.0)
+        self.assertRaises(ValueError, elastic_net, X, [0.0] * 30, self.y_sparse, 1000, 1e-8, 0.1, 1.0)
+
+
+class LinearRegressionWarmStartTest(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        cls.X, cls.y = regression(100, seed=1970)
+        cls.X_train, cls.y_train, cls.X_test, cls.y_test = train_test_split(cls.X, cls.y,
+                                                                            train_split=0.8, seed=1970)
+        cls.regressor = LinearRegression(seed=1970, solver='gradient_descent', epsilon=1e-8, warm_start=True)
+        cls.regressor.train(X=cls.X_train, y=cls.y_train)
+        cls.first_iterations = cls.regressor.iterations
+        cls.regressor.train(X=cls.X_train, y=cls.y_train)
+
+        # four chunks of 20 examples, 5 epochs each
+        cls.incremental = LinearRegression(seed=1970, solver='gradient_descent', method='adam', learning_rate=0.1,
+                                           alpha=0.9)
+        for i in range(4):
+            cls.incremental.partial_fit(cls.X_train[i * 20:(i + 1) * 20], cls.y_train[i * 20:(i + 1) * 20],
+                                        epochs=5)
+
+    def test_LinRWarm_iterations(self):
+        self.assertEqual(self.first_iterations, 825)
+        # the second fit starts from the first solution
+        self.assertEqual(self.regressor.iterations, 1)
+
+    def test_LinRWarm_coefficients(self):
+        self.assertAlmostEqual(self.regressor.coefficients[0], 0.514191893083343, delta=0.001)
+        self.assertAlmostEqual(self.regressor.coefficients[1], 0.9135181487361926, delta=0.001)
+
+    def test_LinRPartial_iterations(self):
+        self.assertEqual(self.incremental.iterations, 20)
+        # cost of the last chunk before the first epoch and after each one
+        self.assertEqual(len(self.incremental.cost), 6)
+
+    def test_LinRPartial_coefficients(self):
+        self.assertAlmostEqual(self.incremental.coefficients[0], 0.576066697493233, delta=0.001)
+        self.assertAlmostEqual(self.incremental.coefficients[1], 0.812245529181034, delta=0.001)
+
+    def test_LinRPartial_mse(self):
+        self.assertAlmostEqual(self.incremental.score(self.X_test, self.y_test), 1.639027175614844, delta=0.001)
+
+    def test_LinRPartial_lbfgs(self):
+        regressor = LinearRegression(solver='gradient_descent', method='lbfgs')
+        self.assertRaises(ValueError, regressor.partial_fit, self.X_train, self.y_train)
+
+
+class LogisticRegressionPartialFitTest(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        cls.X, cls.y = gaussian(labels=2, sigma=0.2, seed=1970)
+        cls.X_train, cls.y_train, cls.X_test, cls.y_test = train_test_split(cls.X, cls.y,
+                                                                            train_split=0.8, seed=1970)
+        cls.classifier = LogisticRegression(seed=1970, learning_rate=0.1, batch_size=20)
+        cls.classifier.partial_fit(cls.X_train[:80], cls.y_train[:80], epochs=10)
+        cls.classifier.partial_fit(cls.X_train[80:], cls.y_train[80:], epochs=10)
+
+    def test_LogRPartial_iterations(self):
+        self.assertEqual(self.classifier.iterations, 20)
+
+    def test_LogRPartial_coefficients(self):
+        self.assertAlmostEqual(self.classifier.coefficients[0], -0.7610245820141697, delta=0.001)
+        self.assertAlmostEqual(self.classifier.coefficients[1], 0.29216480401856787, delta=0.001)
+        self.assertAlmostEqual(self.classifier.coefficients[2], 1.871281362845797, delta=0.001)
+
+    def test_LogRPartial_accuracy(self):
+        self.assertAlmostEqual(self.classifier.score(self.X_test, self.y_test), 0.925, delta=0.001)
+
+    def test_LogRPartial_resumes(self):
+        # two calls with the same data are the same as one call with all the epochs
+        X = [[1] + row for row in self.X_train]
+        theta = [0.5, -0.5, 0.5]
+        for method in ['nesterov', 'adagrad', 'adam']:
+            coefficients, cost, iterations = gradient_descent(X, list(theta), self.y_train, 0, 10, 0.0, 0.1, 0.9,
+                                                              'logit', method, 1970, 1e-8)
+            state = optimiser_state(list(theta), 1970)
+            partial_fit(state, X, self.y_train, 5, 0.1, 0.9, 'logit', method, 1e-8)
+            resumed, resumed_cost, updates = partial_fit(state, X, self.y_train, 5, 0.1, 0.9, 'logit', method, 1e-8)
+            self.assertEqual(updates, 10)
+            for a, b in zip(coefficients, resumed):
+                self.assertAlmostEqual(a, b, delta=1e-10)
+
+    def test_LogRPartial_multiclass(self):
+        classifier = LogisticRegression(seed=1970)
+        self.assertRaises(ValueError, classifier.partial_fit, [[0, 1], [1, 0], [1, 1]], [0, 1, 2])
+
+
+class Float32Test(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        cls.X, cls.y = gaussian(labels=2, sigma=0.2, seed=1970)
+        cls.X_train, cls.y_train, cls.X_test, cls.y_test = train_test_split(cls.X, cls.y,
+                                                                            train_split=0.8, seed=1970)
+        cls.classifier = LogisticRegression(seed=1970, dtype='float32')
+        cls.classifier.train(X=cls.X_train, y=cls.y_train)
+        cls.minibatch = LogisticRegression(seed=1970, dtype='float32', batch_size=20, learning_rate=0.1)
+        cls.minibatch.train(X=cls.X_train, y=cls.y_train)
+
+        cls.X_reg, cls.y_reg = regression(100, seed=1970)
+        cls.X_reg_train, cls.y_reg_train, cls.X_reg_test, cls.y_reg_test = train_test_split(cls.X_reg, cls.y_reg,
+                                                                                            train_split=0.8,
+                                                                                            seed=1970)
+        cls.regressor = LinearRegression(seed=1970, solver='gradient_descent', epsilon=1e-4, dtype='float32')
+        cls.regressor.train(X=cls.X_reg_train, y=cls.y_reg_train)
+
+    def test_Float32_LogR_iterations(self):
+        # double precision takes 1623, the change in cost crosses epsilon an iteration earlier in float32
+        self.assertEqual(self.classifier.iterations, 1622)
+
+    def test_Float32_LogR_coefficients(self):
+        self.assertAlmostEqual(self.classifier.coefficients[0], -1.1576475345638408, delta=0.001)
+        self.assertAlmostEqual(self.classifier.coefficients[1], 0.1437129269620468, delta=0.001)
+        self.assertAlmostEqual(self.classifier.coefficients[2], 2.4464052394504856, delta=0.001)
+
+    def test_Float32_LogR_accuracy(self):
+        self.assertAlmostEqual(self.classifier.score(self.X_test, self.y_test), 0.975, delta=0.001)
+
+    def test_Float32_MBLogR(self):
+        self.assertEqual(self.minibatch.iterations, 568)
+        self.assertAlmostEqual(self.minibatch.coefficients[0], -5.586956977844238, delta=0.001)
+
+    def test_Float32_LinR(self):
+        self.assertEqual(self.regressor.iterations, 12)
+        self.assertAlmostEqual(self.regressor.coefficients[0], 0.4927367596471592, delta=0.001)
+        self.assertAlmostEqual(self.regressor.coefficients[1], 0.9154419238935216, delta=0.001)
+        self.assertAlmostEqual(self.regressor.score(self.X_reg_test, self.y_reg_test), 1.3285162347383603,
+                               delta=0.001)
+
+    def test_Float32_unknown(self):
+        self.assertRaises(ValueError, LinearRegression, dtype='float16')
+
+
+class BatchPredictTest(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        cls.X, cls.y = gaussian(labels=3, sigma=0.2, seed=1970)
+        cls.X_train, cls.y_train, cls.X_test, cls.y_test = train_test_split(cls.X, cls.y,
+                                                                            train_split=0.8, seed=1970)
+        cls.classifier = LogisticRegression(seed=1970)
+        cls.classifier.train(X=cls.X_train, y=cls.y_train)
+
+        random.seed(1970)
+        # enough rows for several blocks
+        cls.X_large = [[random.gauss(0, 1) for _ in range(5)] for _ in range(2000)]
+        cls.w = [0.5, 1.0, -2.0, 0.25, 0.0, 3.0]
+
+    def test_predict_identity(self):
+        result = predict(self.X_large, self.w, True, 'identity')
+        expected = [self.w[0] + sum(x * w for x, w in zip(row, self.w[1:])) for row in self.X_large]
+        self.assertEqual(len(result), 2000)
+        for a, b in zip(result, expected):
+            self.assertAlmostEqual(a, b, delta=1e-10)
+
+    def test_predict_threads(self):
+        self.assertEqual(predict(self.X_large, self.w, True, 'sigmoid'),
+                         predict(self.X_large, self.w, True, 'sigmoid', n_jobs=4))
+
+    def test_predict_softmax(self):
+        coefficients = self.classifier.coefficients
+        result = predict(self.X_test, coefficients, True, 'softmax', n_jobs=2)
+        for x, row in zip(self.X_test, result):
+            scores = [math.exp(w[0] + sum(x_j * w_j for x_j, w_j in zip(x, w[1:]))) for w in coefficients]
+            for p, score in zip(row, scores):
+                self.assertAlmostEqual(p, score / sum(scores), delta=1e-10)
+            self.assertAlmostEqual(sum(row), 1.0, delta=1e-10)
+
+    def test_predict_single_row(self):
+        self.assertEqual(len(predict([self.X_test[0]], self.classifier.coefficients, True, 'softmax')), 1)
+        self.assertEqual(len(predict([self.X_large[0]], self.w, True, 'identity')), 1)
+
+    def test_predict_errors(self):
+        self.assertRaises(ValueError, predict, self.X_large, self.w, True, 'tanh')
+        self.assertRaises(ValueError, predict, self.X_large, self.w, False, 'identity')
+        self.assertRaises(ValueError, predict, self.X_large, self.w, True, 'softmax')
+
+    def test_LogR_predict(self):
+        self.assertAlmostEqual(self.classifier.score(self.X_test, self.y_test), 0.9666666666666667, delta=0.001)
+
+
+class FitInterceptTest(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        cls.X, cls.y = gaussian(labels=2, sigma=0.2, seed=1970)
+        cls.X_ones = [[1] + row for row in cls.X]
+        cls.X_reg, cls.y_reg = regression(100, seed=1970)
+        cls.theta = [0.5, -0.5, 0.5]
+
+    def assertSameCoefficients(self, a, b):
+        self.assertEqual(len(a), len(b))
+        for a_i, b_i in zip(a, b):
+            self.assertAlmostEqual(a_i, b_i, delta=1e-10)
+
+    def test_GD_intercept(self):
+        # the intercept is added to the score, so the result is the same as with a column of ones
+        for method, batch_size in [('normal', 0), ('adam', 0), ('nesterov', 20), ('lbfgs', 0)]:
+            expected = gradient_descent(self.X_ones, list(self.theta), self.y, batch_size, 100, 1e-8, 0.1, 0.9,
+                                        'logit', method, 1970, 1e-8)
+            result = gradient_descent(self.X, list(self.theta), self.y, batch_size, 100, 1e-8, 0.1, 0.9, 'logit',
+                                      method, 1970, 1e-8, fit_intercept=True)
+            self.assertEqual(expected[2], result[2])
+            self.assertSameCoefficients(expected[0], result[0])
+
+    def test_GD_intercept_validation(self):
+        X_val, y_val = self.X[:20], self.y[:20]
+        expected = gradient_descent(self.X_ones, list(self.theta), self.y, 20, 100, 1e-8, 0.1, 0.9, 'logit',
+                                    'normal', 1970, 1e-8, physical_shuffle=True,
+                                    X_val=[[1] + row for row in X_val], y_val=y_val)
+        result = gradient_descent(self.X, list(self.theta), self.y, 20, 100, 1e-8, 0.1, 0.9, 'logit', 'normal',
+                                  1970, 1e-8, physical_shuffle=True, X_val=X_val, y_val=y_val, fit_intercept=True)
+        self.assertEqual(expected[2], result[2])
+        self.assertSameCoefficients(expected[0], result[0])
+
+    def test_GD_intercept_size(self):
+        self.assertRaises(ValueError, gradient_descent, self.X, [0.5, 0.5], self.y, 0, 10, 1e-8, 0.1, 0.9, 'logit',
+                          'normal', 1970, 1e-8, fit_intercept=True)
+
+    def test_OVR_intercept(self):
+        X, y = gaussian(labels=3, sigma=0.2, seed=1970)
+        theta = [[0.5, -0.5, 0.5], [0.1, 0.2, 0.3], [-0.5, 0.5, -0.5]]
+        expected = one_vs_rest([[1] + row for row in X], theta, y, 0, 50, 1e-8, 0.1, 0.9, 'normal', 1970, 1e-8,
+                               n_jobs=2)
+        result = one_vs_rest(X, theta, y, 0, 50, 1e-8, 0.1, 0.9, 'normal', 1970, 1e-8, n_jobs=2, fit_intercept=True)
+        for a, b in zip(expected[0], result[0]):
+            self.assertSameCoefficients(a, b)
+
+    def test_partial_fit_intercept(self):
+        state = optimiser_state(list(self.theta), 1970)
+        expected, _, _ = partial_fit(state, self.X_ones, self.y, 5, 0.1, 0.9, 'logit', 'adam', 1e-8, batch_size=20)
+        state = optimiser_state(list(self.theta), 1970)
+        result, _, _ = partial_fit(state, self.X, self.y, 5, 0.1, 0.9, 'logit', 'adam', 1e-8, batch_size=20,
+                                   fit_intercept=True)
+        self.assertSameCoefficients(expected, result)
+
+    def test_least_squares_intercept(self):
+        # centred normal equations
+        self.assertSameCoefficients(least_squares([[1] + row for row in self.X_reg], self.y_reg),
+                                    least_squares(self.X_reg, self.y_reg, fit_intercept=True))
+
+    def test_newton_intercept(self):
+        for cg_threshold in [500, 0]:
+            expected = newton(self.X_ones, list(self.theta), self.y, 100, 1e-6, cg_threshold=cg_threshold)
+            result = newton(self.X, list(self.theta), self.y, 100, 1e-6, cg_threshold=cg_threshold,
+                            fit_intercept=True)
+            self.assertEqual(expected[2], result[2])
+            self.assertSameCoefficients(expected[0], result[0])
+
+    def test_hogwild_intercept(self):
+        expected = hogwild(self.X_ones, list(self.theta), self.y, 20, 1e-8, 0.01, 'logit', 1970)
+        result = hogwild(self.X, list(self.theta), self.y, 20, 1e-8, 0.01, 'logit', 1970, fit_intercept=True)
+        self.assertEqual(expected[2], result[2])
+        self.assertSameCoefficients(expected[0], result[0])
+
+    def test_softmax_intercept(self):
+        X, y = gaussian(labels=3, sigma=0.2, seed=1970)
+        theta = [[0.5, -0.5, 0.5], [0.1, 0.2, 0.3], [-0.5, 0.5, -0.5]]
+        expected = softmax_regression([[1] + row for row in X], theta, y, 50, 1e-8, 0.1, 0.9, 'nesterov', 1e-8)
+        result = softmax_regression(X, theta, y, 50, 1e-8, 0.1, 0.9, 'nesterov', 1e-8, fit_intercept=True)
+        for a, b in zip(expected[0], result[0]):
+            self.assertSameCoefficients(a, b)
+
+    def test_elastic_net_intercept(self):
+        X_ones = [[1] + row for row in self.X_reg]
+        for covariance in [True, False]:
+            expected = elastic_net(X_ones, [0.0, 0.0], self.y_reg, 100, 1e-8, 0.1, 0.5, covariance=covariance)
+            result = elastic_net(self.X_reg, [0.0, 0.0], self.y_reg, 100, 1e-8, 0.1, 0.5, covariance=covariance,
+                                 fit_intercept=True)
+            self.assertEqual(expected[2], result[2])
+            self.assertSameCoefficients(expected[0], result[0])
+
+        expected = elastic_net_path(X_ones, self.y_reg, 100, 1e-8, 0.5, n_lambdas=5)
+        result = elastic_net_path(self.X_reg, self.y_reg, 100, 1e-8, 0.5, n_lambdas=5, fit_intercept=True)
+        for a, b in zip(expected[1], result[1]):
+            self.assertSameCoefficients(a, b)
+
+    def test_LinR_no_copy(self):
+        # the training set is not copied to add a column of ones
+        model = LinearRegression(seed=1970, solver='gradient_descent').train(self.X_reg, self.y_reg)
+        self.assertIs(model.X, self.X_reg)
+        model = LinearRegression(solver='coordinate_descent').train(self.X_reg, self.y_reg)
+        self.assertIs(model.X, self.X_reg)
+
+
+class ScratchArenaTest(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        cls.X, cls.y = gaussian(labels=2, sigma=0.2, seed=1970)
+        cls.theta = [0.5, -0.5, 0.5]
+
+    def test_GD_scratch(self):
+        # the temporaries of every update after the first come from the arena, without a malloc
+        for method in ['normal', 'nesterov', 'adagrad', 'adadelta', 'rmsprop', 'adam']:
+            before = scratch_statistics()
+            result = gradient_descent(self.X, list(self.theta), self.y, 0, 50, 1e-8, 0.1, 0.9, 'logit', method,
+                                      1970, 1e-8, fit_intercept=True)
+            after = scratch_statistics()
+            self.assertEqual(after['arenas'] - before['arenas'], 1)
+            self.assertEqual(after['mallocs'] - before['mallocs'], 1)
+            self.assertGreaterEqual(after['mallocs_avoided'] - before['mallocs_avoided'], result[2] - 1)
+            self.assertGreater(after['peak_bytes'], 0)
+
+    def test_partial_fit_scratch(self):
+        before = scratch_statistics()
+        state = optimiser_state(list(self.theta), 1970)
+        partial_fit(state, self.X, self.y, 5, 0.1, 0.9, 'logit', 'adagrad', 1e-8, batch_size=20, fit_intercept=True)
+        after = scratch_statistics()
+        self.assertEqual(after['mallocs'] - before['mallocs'], 1)
+        # 5 epochs of 10 updates, each with 2 arrays (the data and the array itself)
+        self.assertEqual(after['allocations'] - before['allocations'], 5 * 10 * 2 * 2)
+
+
+class SparseTest(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        # one hot features, a single non zero per row and group
+        rng = random.Random(1970)
+        cls.X = [[1.0 if j == rng.randrange(4) else 0.0 for j in range(4)] +
+                 [1.0 if j == rng.randrange(6) else 0.0 for j in range(6)] for _ in range(120)]
+        cls.y = [sum(row[:4]) * 2 + row[5] - row[7] + rng.gauss(0, 0.1) for row in cls.X]
+        cls.X_sparse = CSRMatrix.from_dense(cls.X)
+
+    def test_GD_sparse(self):
+        # the sparse kernels add the same terms in the same order as the dense ones
+        for method, batch_size in [('normal', 0), ('adam', 16), ('lbfgs', 0), ('nesterov', 16)]:
+            dense = gradient_descent(self.X, [0.0] * 11, self.y, batch_size, 50, 1e-8, 0.05, 0.0, 'linear', method,
+                                     1970, 1e-8, fit_intercept=True)
+            sparse = gradient_descent(self.X_sparse, [0.0] * 11, self.y, batch_size, 50, 1e-8, 0.05, 0.0, 'linear',
+                                      method, 1970, 1e-8, fit_intercept=True)
+            self.assertEqual(dense[0], sparse[0])
+            self.assertEqual(dense[2], sparse[2])
+
+    def test_GD_sparse_physical_shuffle(self):
+        dense = gradient_descent(self.X, [0.0] * 11, self.y, 16, 20, 1e-8, 0.05, 0.0, 'linear', 'adagrad', 1970,
+                                 1e-8, physical_shuffle=True, fit_intercept=True)
+        sparse = gradient_descent(self.X_sparse, [0.0] * 11, self.y, 16, 20, 1e-8, 0.05, 0.0, 'linear', 'adagrad',
+                                  1970, 1e-8, physical_shuffle=True, fit_intercept=True)
+        self.assertEqual(dense[0], sparse[0])
+
+    def test_hogwild_sparse(self):
+        # an update only visits the non zeros of the row, in the same order as the dense scan
+        dense = hogwild(self.X, [0.0] * 11, self.y, 20, 1e-8, 0.05, 'linear', 1970, fit_intercept=True)
+        sparse = hogwild(self.X_sparse, [0.0] * 11, self.y, 20, 1e-8, 0.05, 'linear', 1970, fit_intercept=True)
+        self.assertEqual(dense[0], sparse[0])
+        self.assertEqual(dense[2], sparse[2])
+
+    def test_LinR_hogwild_sparse(self):
+        model = LinearRegression(seed=1970, solver='gradient_descent', method='hogwild', n_workers=2)
+        model.train(self.X_sparse, self.y)
+        self.assertLess(model.cost[-1], model.cost[0])
+
+    def test_predict_sparse(self):
+        coefficients = [0.5] + [0.1 * j for j in range(10)]
+        for link in ['identity', 'sigmoid']:
+            self.assertEqual(predict(self.X, coefficients, True, link),
+                             predict(self.X_sparse, coefficients, True, link))
+
+    def test_LinR_sparse(self):
+        dense = LinearRegression(seed=1970, solver='gradient_descent', early_stopping=True).train(self.X, self.y)
+        sparse = LinearRegression(seed=1970, solver='gradient_descent', early_stopping=True).train(self.X_sparse,
+                                                                                                   self.y)
+        self.assertEqual(dense.coefficients, sparse.coefficients)
+        self.assertEqual(dense.predict(self.X[:5]), sparse.predict(self.X_sparse[:5]))
+
+    def test_LogR_sparse(self):
+        labels = [int(row[0] + row[1] > 0) + int(row[5] > 0) for row in self.X]
+        dense = LogisticRegression(seed=1970, n_jobs=2).train(self.X, labels)
+        sparse = LogisticRegression(seed=1970, n_jobs=2).train(self.X_sparse, labels)
+        self.assertEqual(dense.predict(self.X), sparse.predict(self.X_sparse))
+
+    def test_LinR_sparse_other_csr(self):
+        # any object with CSR buffers and a shape, e.g. a scipy csr_matrix, including early stopping
+        class OtherCSR(object):
+            def __init__(self, X):
+                self.data, self.indices, self.indptr, self.shape = X.data, X.indices, X.indptr, X.shape
+
+        other = OtherCSR(self.X_sparse)
+        expected = LinearRegression(seed=1970, solver='gradient_descent', early_stopping=True).train(self.X_sparse,
+                                                                                                      self.y)
+        result = LinearRegression(seed=1970, solver='gradient_descent', early_stopping=True).train(other, self.y)
+        self.assertEqual(expected.coefficients, result.coefficients)
+        self.assertEqual(expected.predict(self.X_sparse), result.predict(other))
+
+    def test_sparse_unsupported(self):
+        self.assertRaises(ValueError, LinearRegression(solver='OLS').train, self.X_sparse, self.y)
+        self.assertRaises(ValueError, LogisticRegression(solver='newton').train, self.X_sparse,
+                          [int(row[0] > 0) for row in self.X])